@@ -19,7 +19,7 @@
 
 #include "sound_queue.h"
 #include <string>
-#include <assert.h>
+#include <string.h>
 #include "../../src/gearsystem.h"
 
 static void sdl_error(const char* str)
@@ -33,10 +33,25 @@ static void sdl_error(const char* str)
 
 SoundQueue::SoundQueue()
 {
-    m_buffers = NULL;
-    m_free_sem = NULL;
-    m_sound_open = false;
+    m_buffer = NULL;
+    m_currently_playing = NULL;
+    m_read_position = 0;
+    m_write_position = 0;
+    m_underruns = 0;
+    m_overruns = 0;
+    m_measured_fill = 0;
     m_sync_output = true;
+    m_capacity = 0;
+    m_mask = 0;
+    m_sound_open = false;
+    m_starved = true;
+    m_sample_rate = 0;
+    m_channel_count = 0;
+    m_buffer_size = 0;
+    m_latency_ms = SOUND_QUEUE_DEFAULT_LATENCY;
+    m_target_level = 0;
+    m_rate_ratio = 1.0;
+    m_resample_position = 0.0;
 
     int audio_drivers_count = SDL_GetNumAudioDrivers();
     int audio_devices_count = SDL_GetNumAudioDevices(0);
@@ -90,29 +105,40 @@ SoundQueue::~SoundQueue()
     Stop();
 }
 
-bool SoundQueue::Start(int sample_rate, int channel_count, int buffer_size, int buffer_count)
+bool SoundQueue::Start(int sample_rate, int channel_count, int latency_ms, int buffer_size)
 {
-    Log("SoundQueue: Starting with %d Hz, %d channels, %d buffer size, %d buffers ...", sample_rate, channel_count, buffer_size, buffer_count);
-
-    m_write_buffer = 0;
-    m_write_position = 0;
-    m_read_buffer = 0;
-    m_buffer_size = buffer_size;
-    m_buffer_count = buffer_count;
-
-    m_buffers = new int16_t[m_buffer_size * m_buffer_count];
-    m_currently_playing = m_buffers;
-
-    for (int i = 0; i < (m_buffer_size * m_buffer_count); i++)
-        m_buffers[i] = 0;
+    Log("SoundQueue: Starting with %d Hz, %d channels, %d ms latency, %d buffer size ...", sample_rate, channel_count, latency_ms, buffer_size);
 
-    m_free_sem = SDL_CreateSemaphore(m_buffer_count - 1);
-    if (!m_free_sem)
+    if ((channel_count < 1) || (channel_count > SOUND_QUEUE_MAX_CHANNELS))
     {
-        sdl_error("Couldn't create semaphore");
+        Log("SoundQueue: Invalid channel count %d", channel_count);
         return false;
     }
 
+    m_sample_rate = sample_rate;
+    m_channel_count = channel_count;
+    m_buffer_size = buffer_size;
+    m_latency_ms = latency_ms;
+    m_target_level = ((sample_rate * latency_ms) / 1000) * channel_count;
+    m_rate_ratio = 1.0;
+    m_resample_position = 0.0;
+
+    uint32_t min_capacity = (uint32_t)((m_target_level > buffer_size ? m_target_level : buffer_size) * 4);
+    m_capacity = 1;
+    while (m_capacity < min_capacity)
+        m_capacity <<= 1;
+    m_mask = m_capacity - 1;
+
+    m_buffer = new int16_t[m_capacity];
+    memset(m_buffer, 0, m_capacity * sizeof(int16_t));
+    memset(m_last_frame, 0, sizeof(m_last_frame));
+
+    m_read_position.store(0);
+    m_write_position.store(0);
+    m_measured_fill.store(0);
+    m_starved = true;
+    ResetStats();
+
     SDL_AudioSpec spec;
     spec.freq = sample_rate;
     spec.format = AUDIO_S16SYS;
@@ -128,11 +154,19 @@ bool SoundQueue::Start(int sample_rate, int channel_count, int buffer_size, int
     if (SDL_OpenAudio(&spec, NULL) < 0)
     {
         sdl_error("Couldn't open SDL audio");
+        delete [] m_buffer;
+        m_buffer = NULL;
         return false;
     }
 
     Log("SoundQueue: Obtained - frequency: %d format: f %d s %d be %d sz %d channels: %d samples: %d", spec.freq, SDL_AUDIO_ISFLOAT(spec.format), SDL_AUDIO_ISSIGNED(spec.format), SDL_AUDIO_ISBIGENDIAN(spec.format), SDL_AUDIO_BITSIZE(spec.format), spec.channels, spec.samples);
 
+    m_buffer_size = spec.samples * channel_count;
+    m_currently_playing = new int16_t[m_buffer_size];
+    memset(m_currently_playing, 0, m_buffer_size * sizeof(int16_t));
+
+    Log("SoundQueue: Ring buffer of %d samples, target level %d samples", m_capacity, m_target_level);
+
     SDL_PauseAudio(false);
     m_sound_open = true;
 
@@ -148,20 +182,18 @@ void SoundQueue::Stop()
         SDL_CloseAudio();
     }
 
-    if (m_free_sem)
-    {
-        SDL_DestroySemaphore(m_free_sem);
-        m_free_sem = NULL;
-    }
-
-    delete [] m_buffers;
-    m_buffers = NULL;
+    delete [] m_buffer;
+    m_buffer = NULL;
+    delete [] m_currently_playing;
+    m_currently_playing = NULL;
 }
 
 int SoundQueue::GetSampleCount()
 {
-    int buffer_free = SDL_SemValue(m_free_sem) * m_buffer_size + (m_buffer_size - m_write_position);
-    return m_buffer_size * m_buffer_count - buffer_free;
+    if (!m_sound_open)
+        return 0;
+
+    return (int)GetFillLevel();
 }
 
 int16_t* SoundQueue::GetCurrentlyPlaying()
@@ -174,50 +206,172 @@ bool SoundQueue::IsOpen()
     return m_sound_open;
 }
 
+void SoundQueue::SetLatency(int latency_ms)
+{
+    if (latency_ms == m_latency_ms)
+        return;
+
+    m_latency_ms = latency_ms;
+
+    if (m_sound_open)
+    {
+        Stop();
+        Start(m_sample_rate, m_channel_count, latency_ms, m_buffer_size);
+    }
+}
+
+int SoundQueue::GetLatency()
+{
+    return m_latency_ms;
+}
+
+void SoundQueue::GetStats(SoundQueueStats& stats)
+{
+    int frame_rate = m_sample_rate * m_channel_count;
+
+    stats.fill_level = m_sound_open ? (int)GetFillLevel() : 0;
+    stats.target_level = m_target_level;
+    stats.capacity = (int)m_capacity;
+    stats.underruns = m_underruns.load(std::memory_order_relaxed);
+    stats.overruns = m_overruns.load(std::memory_order_relaxed);
+    stats.latency_ms = frame_rate > 0 ? ((m_measured_fill.load(std::memory_order_relaxed) + m_buffer_size) * 1000.0f) / frame_rate : 0.0f;
+    stats.target_latency_ms = (float)m_latency_ms;
+    stats.rate_ratio = (float)m_rate_ratio;
+}
+
+void SoundQueue::ResetStats()
+{
+    m_underruns.store(0, std::memory_order_relaxed);
+    m_overruns.store(0, std::memory_order_relaxed);
+}
+
+uint32_t SoundQueue::GetFillLevel()
+{
+    uint32_t write = m_write_position.load(std::memory_order_relaxed);
+    uint32_t read = m_read_position.load(std::memory_order_acquire);
+    return write - read;
+}
+
+void SoundQueue::UpdateRateRatio(uint32_t fill)
+{
+    if (m_target_level <= 0)
+    {
+        m_rate_ratio = 1.0;
+        return;
+    }
+
+    double error = (double)(m_target_level - (int)fill) / (double)m_target_level;
+
+    if (error > 1.0)
+        error = 1.0;
+    else if (error < -1.0)
+        error = -1.0;
+
+    double ratio = 1.0 + (error * SOUND_QUEUE_MAX_RATE_DELTA);
+    m_rate_ratio += (ratio - m_rate_ratio) * 0.05;
+}
+
 void SoundQueue::Write(int16_t* samples, int count, bool sync)
 {
     if (!m_sound_open)
         return;
 
-    m_sync_output = sync;
+    m_sync_output.store(sync, std::memory_order_relaxed);
 
-    while (count)
+    if (sync)
     {
-        int n = m_buffer_size - m_write_position;
-        if (n > count)
-            n = count;
+        int timeout = 100;
 
-        memcpy(Buffer(m_write_buffer) + m_write_position, samples, n * sizeof(int16_t));
-        samples += n;
-        m_write_position += n;
-        count -= n;
+        while ((GetFillLevel() > (uint32_t)m_target_level) && (timeout > 0))
+        {
+            SDL_Delay(1);
+            timeout--;
+        }
+    }
+
+    uint32_t write = m_write_position.load(std::memory_order_relaxed);
+    uint32_t read = m_read_position.load(std::memory_order_acquire);
+
+    UpdateRateRatio(write - read);
 
-        if (m_write_position >= m_buffer_size)
+    int channels = m_channel_count;
+    int frames = count / channels;
+    double step = 1.0 / m_rate_ratio;
+    double position = m_resample_position;
+    bool overrun = false;
+
+    while (position < (double)frames)
+    {
+        if ((m_capacity - (write - read)) < (uint32_t)channels)
         {
-            m_write_position = 0;
-            m_write_buffer = (m_write_buffer + 1) % m_buffer_count;
-            
-            if (m_sync_output)
-                SDL_SemWait(m_free_sem);
+            overrun = true;
+            break;
         }
+
+        int index = (int)position;
+        int fraction = (int)((position - index) * 0x10000);
+        const int16_t* a = (index == 0) ? m_last_frame : samples + ((index - 1) * channels);
+        const int16_t* b = samples + (index * channels);
+
+        for (int c = 0; c < channels; c++)
+        {
+            int sample = a[c] + (((b[c] - a[c]) * fraction) >> 16);
+            m_buffer[write & m_mask] = (int16_t)sample;
+            write++;
+        }
+
+        position += step;
     }
+
+    if (overrun)
+    {
+        m_overruns.fetch_add(1, std::memory_order_relaxed);
+        position = (double)frames;
+    }
+
+    m_resample_position = position - frames;
+
+    if (frames > 0)
+        memcpy(m_last_frame, samples + ((frames - 1) * channels), channels * sizeof(int16_t));
+
+    m_write_position.store(write, std::memory_order_release);
 }
 
 void SoundQueue::FillBuffer(uint8_t* buffer, int count)
 {
-    if ((SDL_SemValue(m_free_sem) < (unsigned int)m_buffer_count - 1) || !m_sync_output)
+    int16_t* out = (int16_t*)buffer;
+    uint32_t requested = (uint32_t)count / sizeof(int16_t);
+    uint32_t read = m_read_position.load(std::memory_order_relaxed);
+    uint32_t write = m_write_position.load(std::memory_order_acquire);
+    uint32_t available = write - read;
+    uint32_t n = available < requested ? available : requested;
+
+    m_measured_fill.store(available, std::memory_order_relaxed);
+
+    uint32_t offset = read & m_mask;
+    uint32_t first = m_capacity - offset;
+    if (first > n)
+        first = n;
+
+    memcpy(out, m_buffer + offset, first * sizeof(int16_t));
+    memcpy(out + first, m_buffer, (n - first) * sizeof(int16_t));
+
+    m_read_position.store(read + n, std::memory_order_release);
+
+    if (n < requested)
     {
-        m_currently_playing = Buffer(m_read_buffer);
-        memcpy( buffer, Buffer(m_read_buffer), count);
-        m_read_buffer = (m_read_buffer + 1) % m_buffer_count;
+        memset(out + n, 0, (requested - n) * sizeof(int16_t));
 
-        if (m_sync_output)
-            SDL_SemPost(m_free_sem);
+        if (!m_starved && m_sync_output.load(std::memory_order_relaxed))
+            m_underruns.fetch_add(1, std::memory_order_relaxed);
+
+        m_starved = true;
     }
     else
-    {
-        memset(buffer, 0, count);
-    }
+        m_starved = false;
+
+    uint32_t playing = requested < (uint32_t)m_buffer_size ? requested : (uint32_t)m_buffer_size;
+    memcpy(m_currently_playing, out, playing * sizeof(int16_t));
 }
 
 void SoundQueue::FillBufferCallback(void* user_data, uint8_t* buffer, int count)
@@ -22,43 +22,68 @@
 
 #include <SDL.h>
 #include <stdint.h>
-#include <assert.h>
+#include <atomic>
+
+#define SOUND_QUEUE_DEFAULT_LATENCY 60
+#define SOUND_QUEUE_MAX_CHANNELS 8
+#define SOUND_QUEUE_MAX_RATE_DELTA 0.005
+
+struct SoundQueueStats
+{
+    int fill_level;
+    int target_level;
+    int capacity;
+    unsigned int underruns;
+    unsigned int overruns;
+    float latency_ms;
+    float target_latency_ms;
+    float rate_ratio;
+};
 
 class SoundQueue
 {
 public:
     SoundQueue();
     ~SoundQueue();
-    bool Start(int sample_rate, int channel_count, int buffer_size = 2048, int buffer_count = 3);
+    bool Start(int sample_rate, int channel_count, int latency_ms = SOUND_QUEUE_DEFAULT_LATENCY, int buffer_size = 1024);
     void Stop();
     void Write(int16_t* samples, int count, bool sync);
     int GetSampleCount();
     int16_t* GetCurrentlyPlaying();
     bool IsOpen();
+    void SetLatency(int latency_ms);
+    int GetLatency();
+    void GetStats(SoundQueueStats& stats);
+    void ResetStats();
 
 private:
-    int16_t* volatile m_buffers;
-    SDL_sem* volatile m_free_sem;
-    int16_t* volatile m_currently_playing;
-    int volatile m_read_buffer;
-    int m_write_buffer;
-    int m_write_position;
+    int16_t* m_buffer;
+    int16_t* m_currently_playing;
+    std::atomic<uint32_t> m_read_position;
+    std::atomic<uint32_t> m_write_position;
+    std::atomic<uint32_t> m_underruns;
+    std::atomic<uint32_t> m_overruns;
+    std::atomic<uint32_t> m_measured_fill;
+    std::atomic<bool> m_sync_output;
+    uint32_t m_capacity;
+    uint32_t m_mask;
     bool m_sound_open;
-    bool m_sync_output;
+    bool m_starved;
+    int m_sample_rate;
+    int m_channel_count;
     int m_buffer_size;
-    int m_buffer_count;
+    int m_latency_ms;
+    int m_target_level;
+    double m_rate_ratio;
+    double m_resample_position;
+    int16_t m_last_frame[SOUND_QUEUE_MAX_CHANNELS];
 
 private:
-    int16_t* Buffer(int index);
+    uint32_t GetFillLevel();
+    void UpdateRateRatio(uint32_t fill);
     void FillBuffer(uint8_t* buffer, int count);
     bool IsRunningInWSL();
     static void FillBufferCallback(void* user_data, uint8_t* buffer, int count);
 };
 
-inline int16_t* SoundQueue::Buffer(int index)
-{
-    assert(index < m_buffer_count);
-    return m_buffers + (index * m_buffer_size);
-}
-
-#endif /* SOUND_QUEUE_H */
\ No newline at end of file
+#endif /* SOUND_QUEUE_H */
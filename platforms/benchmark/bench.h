@@ -0,0 +1,52 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef BENCH_H
+#define	BENCH_H
+
+#include <stdint.h>
+#include <vector>
+#include "Cartridge.h"
+
+class GearsystemCore;
+
+struct BenchOptions
+{
+    int iterations;
+    bool verbose;
+    const char* rom_path;
+};
+
+uint64_t bench_time_ns();
+void bench_report(const char* group, const char* name, const char* metric, double value, const char* unit);
+bool bench_rom(const BenchOptions& options, std::vector<uint8_t>& rom);
+size_t bench_heap_bytes();
+GearsystemCore* bench_core(const std::vector<uint8_t>& rom, Cartridge::ForceConfiguration* config = NULL);
+void bench_force_config(Cartridge::ForceConfiguration& config);
+
+bool bench_cpu(const BenchOptions& options);
+bool bench_memory(const BenchOptions& options);
+bool bench_video(const BenchOptions& options);
+bool bench_render(const BenchOptions& options);
+bool bench_apu(const BenchOptions& options);
+bool bench_fm(const BenchOptions& options);
+bool bench_state(const BenchOptions& options);
+bool bench_fork(const BenchOptions& options);
+
+#endif	/* BENCH_H */
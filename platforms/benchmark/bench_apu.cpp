@@ -0,0 +1,132 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "bench.h"
+#include "gearsystem.h"
+
+#define APU_FRAMES 600
+#define APU_TICK_CYCLES 12
+#define APU_FRAME_CYCLES (GS_CYCLES_PER_LINE * GS_LINES_PER_FRAME_NTSC)
+
+enum ApuScenario
+{
+    ApuSilent,
+    ApuTones,
+    ApuPCM,
+    ApuFM
+};
+
+static const char* const kApuScenarioNames[] = { "psg_silent", "psg_tones", "psg_pcm", "ym2413_9ch" };
+
+static void apu_psg_setup(Audio* audio)
+{
+    static const u8 kWrites[] =
+    {
+        0x8E, 0x0F, 0x90,   // tone 0
+        0xA5, 0x0A, 0xB2,   // tone 1
+        0xCC, 0x05, 0xD4,   // tone 2
+        0xE5, 0xF6          // white noise
+    };
+
+    for (size_t i = 0; i < sizeof(kWrites); i++)
+        audio->WriteAudioRegister(kWrites[i]);
+}
+
+static void apu_fm_setup(Audio* audio)
+{
+    audio->YM2413Write(0xF2, 0x01);
+
+    for (int ch = 0; ch < 9; ch++)
+    {
+        audio->YM2413Write(0xF0, (u8)(0x30 + ch));
+        audio->YM2413Write(0xF1, (u8)(((ch + 1) << 4) | 0x02));
+        audio->YM2413Write(0xF0, (u8)(0x10 + ch));
+        audio->YM2413Write(0xF1, (u8)(0xAD + ch * 11));
+        audio->YM2413Write(0xF0, (u8)(0x20 + ch));
+        audio->YM2413Write(0xF1, (u8)(0x10 | ((3 + (ch % 3)) << 1)));
+    }
+}
+
+static double apu_run(Audio* audio, ApuScenario scenario, int frames, int& samples)
+{
+    static s16 buffer[GS_AUDIO_BUFFER_SIZE];
+    int count = 0;
+    samples = 0;
+
+    uint64_t start = bench_time_ns();
+
+    for (int f = 0; f < frames; f++)
+    {
+        for (int cycles = 0; cycles < APU_FRAME_CYCLES; cycles += APU_TICK_CYCLES)
+        {
+            audio->Tick(APU_TICK_CYCLES);
+
+            // 4-bit samples through the volume of tone 0, about 15 kHz
+            if ((scenario == ApuPCM) && ((cycles % 240) == 0))
+                audio->WriteAudioRegister((u8)(0x90 | ((cycles >> 4) & 0x0F)));
+        }
+
+        if (scenario == ApuTones)
+            audio->WriteAudioRegister((u8)(0x80 | (f & 0x0F)));
+
+        audio->EndFrame(buffer, &count);
+        samples += count;
+    }
+
+    return (double)(bench_time_ns() - start);
+}
+
+bool bench_apu(const BenchOptions& options)
+{
+    std::vector<uint8_t> rom;
+
+    if (!bench_rom(options, rom))
+        return false;
+
+    for (int s = ApuSilent; s <= ApuFM; s++)
+    {
+        ApuScenario scenario = (ApuScenario)s;
+        GearsystemCore* core = bench_core(rom);
+
+        if (!IsValidPointer(core))
+            return false;
+
+        Audio* audio = core->GetAudio();
+
+        if (scenario == ApuFM)
+            apu_fm_setup(audio);
+        else if (scenario != ApuSilent)
+            apu_psg_setup(audio);
+
+        int samples = 0;
+        int frames = APU_FRAMES * options.iterations;
+        double ns = apu_run(audio, scenario, frames, samples);
+
+        bench_report("apu", kApuScenarioNames[s], "us_per_frame", ns / frames / 1000.0, "us");
+        bench_report("apu", kApuScenarioNames[s], "ns_per_sample", samples ? ns / samples : 0.0, "ns");
+        bench_report("apu", kApuScenarioNames[s], "samples_per_frame", (double)samples / frames, "samples");
+
+        SafeDelete(core);
+    }
+
+    return true;
+}
@@ -0,0 +1,134 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "bench.h"
+#include "gearsystem.h"
+
+#define CPU_INSTRUCTIONS 4000000
+#define CPU_BODY_START 0x0100
+#define CPU_BODY_END 0x3F00
+
+struct CpuGroup
+{
+    const char* name;
+    uint8_t code[48];
+    int size;
+};
+
+// Each body leaves HL, DE, IX, IY and SP pointing into work RAM, so it can
+// be repeated and looped forever. The prefixed groups keep a few main
+// opcodes only where a register would otherwise drift away.
+static const CpuGroup kCpuGroups[] =
+{
+    { "main", {
+        0x78, 0x80, 0x04, 0x7E, 0x77, 0xA8, 0x3E, 0x55, 0x87, 0x2F, 0x0F, 0xC5,
+        0xC1, 0x1A, 0x12, 0x18, 0x00, 0x28, 0x00, 0xFE, 0x10, 0x00, 0x4F, 0x93 }, 24 },
+    { "cb", {
+        0xCB, 0x00, 0xCB, 0x47, 0xCB, 0xC7, 0xCB, 0x87, 0xCB, 0x3F, 0xCB, 0x46,
+        0xCB, 0x16, 0xCB, 0x1B, 0xCB, 0x7E, 0xCB, 0xFE, 0xCB, 0x21, 0xCB, 0x38 }, 24 },
+    { "ed", {
+        0xED, 0x44, 0xED, 0x43, 0x10, 0xC0, 0xED, 0x4B, 0x10, 0xC0, 0xED, 0x4A,
+        0xED, 0x42, 0xED, 0x67, 0xED, 0x6F, 0xED, 0x57, 0xED, 0x5F, 0xED, 0x53,
+        0x12, 0xC0, 0x21, 0x00, 0xC0 }, 29 },
+    { "ddfd", {
+        0xDD, 0x7E, 0x05, 0xDD, 0x77, 0x06, 0xDD, 0x86, 0x07, 0xFD, 0x34, 0x08,
+        0xFD, 0x35, 0x08, 0xDD, 0x23, 0xDD, 0x2B, 0xDD, 0xCB, 0x05, 0x46, 0xFD,
+        0xCB, 0x06, 0xC6, 0xFD, 0xCB, 0x06, 0x86, 0xDD, 0xE5, 0xDD, 0xE1, 0xFD,
+        0x7E, 0x10, 0xFD, 0x77, 0x11 }, 41 },
+    { NULL, { 0 }, 0 }
+};
+
+static const uint8_t kCpuPrologue[] =
+{
+    0xF3,                       // di
+    0x31, 0xF0, 0xDF,           // ld sp,$DFF0
+    0x21, 0x00, 0xC0,           // ld hl,$C000
+    0x11, 0x00, 0xC1,           // ld de,$C100
+    0x01, 0x01, 0x00,           // ld bc,$0001
+    0xDD, 0x21, 0x00, 0xC2,     // ld ix,$C200
+    0xFD, 0x21, 0x00, 0xC3,     // ld iy,$C300
+    0xC3, 0x00, 0x01            // jp $0100
+};
+
+static void cpu_build_rom(const CpuGroup& group, std::vector<uint8_t>& rom)
+{
+    rom.assign(0x8000, 0);
+    memcpy(&rom[0], kCpuPrologue, sizeof(kCpuPrologue));
+
+    int address = CPU_BODY_START;
+
+    while (address + group.size < CPU_BODY_END)
+    {
+        memcpy(&rom[address], group.code, group.size);
+        address += group.size;
+    }
+
+    rom[address++] = 0xC3;
+    rom[address++] = CPU_BODY_START & 0xFF;
+    rom[address++] = CPU_BODY_START >> 8;
+
+    memcpy(&rom[0x7FF0], "TMR SEGA", 8);
+    rom[0x7FFF] = 0x4C;
+}
+
+bool bench_cpu(const BenchOptions& options)
+{
+    for (int g = 0; kCpuGroups[g].name; g++)
+    {
+        const CpuGroup& group = kCpuGroups[g];
+        std::vector<uint8_t> rom;
+        cpu_build_rom(group, rom);
+
+        GearsystemCore* core = bench_core(rom);
+
+        if (!IsValidPointer(core))
+            return false;
+
+        Processor* processor = core->GetProcessor();
+
+        // Past the prologue and into the body
+        for (int i = 0; i < 16; i++)
+            processor->RunFor(1);
+
+        uint64_t instructions = (uint64_t)CPU_INSTRUCTIONS * options.iterations;
+        uint64_t tstates = 0;
+        uint64_t start = bench_time_ns();
+
+        for (uint64_t i = 0; i < instructions; i++)
+            tstates += processor->RunFor(1);
+
+        double ns = (double)(bench_time_ns() - start);
+        bool looping = (processor->GetState()->PC->GetValue() >= CPU_BODY_START) && (processor->GetState()->PC->GetValue() < CPU_BODY_END);
+
+        bench_report("cpu", group.name, "minstr_per_s", instructions * 1000.0 / ns, "Minstr/s");
+        bench_report("cpu", group.name, "ns_per_instr", ns / instructions, "ns");
+        bench_report("cpu", group.name, "mtstates_per_s", tstates * 1000.0 / ns, "MHz");
+        bench_report("cpu", group.name, "looping", looping ? 1.0 : 0.0, "bool");
+
+        SafeDelete(core);
+
+        if (!looping)
+            return false;
+    }
+
+    return true;
+}
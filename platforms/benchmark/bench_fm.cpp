@@ -0,0 +1,305 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "bench.h"
+#include "../../src/audio/emu2413/emu2413.h"
+
+#define FM_SAMPLE_RATE 49716
+#define FM_SCENARIO_SAMPLES (FM_SAMPLE_RATE * 10)
+
+struct FmWrite
+{
+    uint32_t sample;
+    uint8_t reg;
+    uint8_t value;
+};
+
+struct FmScenario
+{
+    const char* name;
+    std::vector<FmWrite> writes;
+};
+
+static const uint16_t kNotes[12] = { 0xAD, 0xB7, 0xC2, 0xCD, 0xD9, 0xE6, 0xF4, 0x102, 0x112, 0x122, 0x133, 0x146 };
+
+static const uint8_t kUserPatch[8] = { 0xC1, 0x61, 0x1E, 0x00, 0xF2, 0xF3, 0x24, 0x25 };
+
+static void fm_write(FmScenario& scenario, uint32_t sample, uint8_t reg, uint8_t value)
+{
+    FmWrite w;
+    w.sample = sample;
+    w.reg = reg;
+    w.value = value;
+    scenario.writes.push_back(w);
+}
+
+static void fm_note_on(FmScenario& scenario, uint32_t sample, int ch, int instrument, int note, int block)
+{
+    uint16_t fnum = kNotes[note % 12];
+    fm_write(scenario, sample, 0x30 + ch, (uint8_t)((instrument << 4) | 0x02));
+    fm_write(scenario, sample, 0x10 + ch, fnum & 0xFF);
+    fm_write(scenario, sample, 0x20 + ch, (uint8_t)(0x10 | (block << 1) | (fnum >> 8)));
+}
+
+static void fm_note_off(FmScenario& scenario, uint32_t sample, int ch, int note, int block)
+{
+    uint16_t fnum = kNotes[note % 12];
+    fm_write(scenario, sample, 0x20 + ch, (uint8_t)((block << 1) | (fnum >> 8)));
+}
+
+static void fm_user_patch(FmScenario& scenario)
+{
+    for (int i = 0; i < 8; i++)
+        fm_write(scenario, 0, (uint8_t)i, kUserPatch[i]);
+}
+
+static void fm_build_scenarios(std::vector<FmScenario>& scenarios)
+{
+    FmScenario full;
+    full.name = "full-9ch";
+    fm_user_patch(full);
+    for (uint32_t t = 0; t < FM_SCENARIO_SAMPLES; t += 12000)
+    {
+        for (int ch = 0; ch < 9; ch++)
+        {
+            int note = (int)(t / 12000) + ch * 2;
+            if (t > 0)
+                fm_note_off(full, t, ch, note - 1, 3);
+            fm_note_on(full, t + 4, ch, 1 + ch, note, 3 + (ch % 3));
+        }
+    }
+    scenarios.push_back(full);
+
+    FmScenario sparse;
+    sparse.name = "sparse-3ch";
+    fm_user_patch(sparse);
+    for (int ch = 0; ch < 9; ch++)
+    {
+        fm_note_on(sparse, 0, ch, 1 + ch, ch, 4);
+        if (ch >= 3)
+            fm_note_off(sparse, 2000, ch, ch, 4);
+    }
+    for (uint32_t t = 6000; t < FM_SCENARIO_SAMPLES; t += 6000)
+    {
+        for (int ch = 0; ch < 3; ch++)
+        {
+            int note = (int)(t / 6000) * (ch + 1);
+            fm_note_on(sparse, t, ch, 3 + ch * 4, note, 4);
+            fm_note_off(sparse, t + 4000, ch, note, 4);
+        }
+    }
+    scenarios.push_back(sparse);
+
+    FmScenario rhythm;
+    rhythm.name = "rhythm";
+    fm_write(rhythm, 0, 0x16, 0x20);
+    fm_write(rhythm, 0, 0x17, 0x50);
+    fm_write(rhythm, 0, 0x18, 0xC0);
+    fm_write(rhythm, 0, 0x26, 0x05);
+    fm_write(rhythm, 0, 0x27, 0x05);
+    fm_write(rhythm, 0, 0x28, 0x01);
+    fm_write(rhythm, 0, 0x36, 0x00);
+    fm_write(rhythm, 0, 0x37, 0x11);
+    fm_write(rhythm, 0, 0x38, 0x11);
+    fm_write(rhythm, 0, 0x0E, 0x20);
+    for (uint32_t t = 0; t < FM_SCENARIO_SAMPLES; t += 5000)
+    {
+        static const uint8_t kDrums[4] = { 0x10, 0x01, 0x08, 0x05 };
+        fm_write(rhythm, t, 0x0E, 0x20 | kDrums[(t / 5000) % 4]);
+        fm_write(rhythm, t + 1500, 0x0E, 0x20);
+        for (int ch = 0; ch < 2; ch++)
+        {
+            int note = (int)(t / 5000) + ch * 7;
+            fm_note_on(rhythm, t, ch, 6 + ch, note, 3);
+            fm_note_off(rhythm, t + 3500, ch, note, 3);
+        }
+    }
+    scenarios.push_back(rhythm);
+
+    FmScenario staccato;
+    staccato.name = "staccato-lfo";
+    fm_user_patch(staccato);
+    for (uint32_t t = 0; t < FM_SCENARIO_SAMPLES; t += 4500)
+    {
+        for (int ch = 0; ch < 9; ch++)
+        {
+            uint32_t start = t + ch * 500;
+            int note = (int)(t / 4500) + ch;
+            fm_note_on(staccato, start, ch, (ch % 3) ? 0 : 12, note, 2 + (ch % 5));
+            fm_note_off(staccato, start + 1500, ch, note, 2 + (ch % 5));
+        }
+    }
+    scenarios.push_back(staccato);
+
+    FmScenario silence;
+    silence.name = "mostly-silent";
+    fm_user_patch(silence);
+    for (int ch = 0; ch < 9; ch++)
+    {
+        fm_note_on(silence, 0, ch, ch, ch, 4);
+        fm_note_off(silence, 2000, ch, ch, 4);
+    }
+    for (uint32_t t = 100000; t < FM_SCENARIO_SAMPLES; t += 100000)
+    {
+        fm_note_on(silence, t, 0, 2, (int)(t / 100000), 4);
+        fm_note_off(silence, t + 3000, 0, (int)(t / 100000), 4);
+    }
+    scenarios.push_back(silence);
+}
+
+static uint64_t fm_run(const FmScenario& scenario, bool skip, int16_t* output, uint64_t* idle_channels)
+{
+    OPLL* opll = OPLL_new();
+    OPLL_setIdleSkip(opll, skip ? 1 : 0);
+
+    size_t next = 0;
+    size_t count = scenario.writes.size();
+    uint64_t idle = 0;
+    uint64_t start = bench_time_ns();
+
+    for (uint32_t s = 0; s < FM_SCENARIO_SAMPLES; s++)
+    {
+        while ((next < count) && (scenario.writes[next].sample <= s))
+        {
+            OPLL_writeReg(opll, scenario.writes[next].reg, scenario.writes[next].value);
+            next++;
+        }
+
+        output[s] = OPLL_calc(opll);
+
+        if (idle_channels)
+        {
+            uint32_t mask = OPLL_getIdleMask(opll);
+            while (mask)
+            {
+                idle += mask & 1;
+                mask >>= 1;
+            }
+        }
+    }
+
+    uint64_t elapsed = bench_time_ns() - start;
+
+    if (idle_channels)
+        *idle_channels = idle;
+
+    OPLL_delete(opll);
+
+    return elapsed;
+}
+
+static bool fm_compare_state(const FmScenario& scenario)
+{
+    OPLL* a = OPLL_new();
+    OPLL* b = OPLL_new();
+    OPLL_setIdleSkip(a, 0);
+    OPLL_setIdleSkip(b, 1);
+
+    size_t next = 0;
+    bool ok = true;
+
+    for (uint32_t s = 0; (s < FM_SCENARIO_SAMPLES) && ok; s++)
+    {
+        while ((next < scenario.writes.size()) && (scenario.writes[next].sample <= s))
+        {
+            OPLL_writeReg(a, scenario.writes[next].reg, scenario.writes[next].value);
+            OPLL_writeReg(b, scenario.writes[next].reg, scenario.writes[next].value);
+            next++;
+        }
+
+        OPLL_calc(a);
+        OPLL_calc(b);
+
+        if ((s % 997) == 0)
+        {
+            OPLL_syncIdle(b);
+
+            for (int i = 0; i < 18; i++)
+            {
+                OPLL_SLOT* x = &a->slot[i];
+                OPLL_SLOT* y = &b->slot[i];
+
+                if ((x->pg_phase != y->pg_phase) || (x->pg_out != y->pg_out) || (x->eg_out != y->eg_out) ||
+                    (x->eg_state != y->eg_state) || (x->output[0] != y->output[0]) || (x->output[1] != y->output[1]))
+                {
+                    printf("fm: %s state mismatch at sample %u slot %d\n", scenario.name, s, i);
+                    ok = false;
+                    break;
+                }
+            }
+        }
+    }
+
+    OPLL_delete(a);
+    OPLL_delete(b);
+
+    return ok;
+}
+
+bool bench_fm(const BenchOptions& options)
+{
+    std::vector<FmScenario> scenarios;
+    fm_build_scenarios(scenarios);
+
+    std::vector<int16_t> reference(FM_SCENARIO_SAMPLES);
+    std::vector<int16_t> skipped(FM_SCENARIO_SAMPLES);
+    bool ok = true;
+
+    for (size_t i = 0; i < scenarios.size(); i++)
+    {
+        const FmScenario& scenario = scenarios[i];
+        uint64_t idle = 0;
+
+        fm_run(scenario, true, &skipped[0], &idle);
+        fm_run(scenario, false, &reference[0], NULL);
+
+        bool exact = (memcmp(&reference[0], &skipped[0], FM_SCENARIO_SAMPLES * sizeof(int16_t)) == 0);
+        exact = exact && fm_compare_state(scenario);
+
+        uint64_t best_reference = ~0ull;
+        uint64_t best_skipped = ~0ull;
+
+        for (int it = 0; it < options.iterations; it++)
+        {
+            uint64_t r = fm_run(scenario, false, &reference[0], NULL);
+            uint64_t s = fm_run(scenario, true, &skipped[0], NULL);
+            if (r < best_reference)
+                best_reference = r;
+            if (s < best_skipped)
+                best_skipped = s;
+        }
+
+        double ns_reference = (double)best_reference / FM_SCENARIO_SAMPLES;
+        double ns_skipped = (double)best_skipped / FM_SCENARIO_SAMPLES;
+
+        bench_report("fm", scenario.name, "ns_per_sample_reference", ns_reference, "ns");
+        bench_report("fm", scenario.name, "ns_per_sample_skip", ns_skipped, "ns");
+        bench_report("fm", scenario.name, "speedup", ns_reference / ns_skipped, "x");
+        bench_report("fm", scenario.name, "avg_idle_channels", (double)idle / FM_SCENARIO_SAMPLES, "ch");
+        bench_report("fm", scenario.name, "exact", exact ? 1.0 : 0.0, "bool");
+
+        if (!exact)
+            ok = false;
+    }
+
+    return ok;
+}
@@ -0,0 +1,167 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "bench.h"
+#include "gearsystem.h"
+
+#define FORK_WARMUP_FRAMES 120
+#define FORK_VERIFY_FRAMES 60
+#define FORK_MEMORY_CORES 32
+
+static uint64_t fork_hash(uint64_t hash, const void* data, size_t size)
+{
+    const uint8_t* p = (const uint8_t*)data;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= p[i];
+        hash *= 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+static uint64_t fork_run(GearsystemCore* core, int frames)
+{
+    static u8 frame_buffer[GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN * GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN * 4];
+    static s16 sample_buffer[GS_AUDIO_BUFFER_SIZE];
+    uint64_t hash = 0xCBF29CE484222325ULL;
+
+    for (int i = 0; i < frames; i++)
+    {
+        int count = 0;
+        core->RunToVBlank(frame_buffer, sample_buffer, &count);
+        hash = fork_hash(hash, frame_buffer, sizeof(frame_buffer));
+        hash = fork_hash(hash, sample_buffer, count * sizeof(s16));
+    }
+
+    return hash;
+}
+
+bool bench_fork(const BenchOptions& options)
+{
+    std::vector<uint8_t> rom;
+
+    if (!bench_rom(options, rom))
+        return false;
+
+    GearsystemCore* core = bench_core(rom);
+
+    if (!IsValidPointer(core))
+        return false;
+
+    fork_run(core, FORK_WARMUP_FRAMES);
+
+    size_t state_size = core->GetStateSize();
+    std::vector<u8> state(state_size);
+    int count = 500 * options.iterations;
+
+    // Fork into a new core every time
+    uint64_t start = bench_time_ns();
+    for (int i = 0; i < count; i++)
+    {
+        GearsystemCore* fork = core->Fork();
+        SafeDelete(fork);
+    }
+    double fork_new_ns = (double)(bench_time_ns() - start) / count;
+
+    // Clone into a new core through a save state
+    start = bench_time_ns();
+    for (int i = 0; i < count; i++)
+    {
+        size_t size = state_size;
+        core->SaveState(&state[0], size);
+        GearsystemCore* clone = bench_core(rom);
+        clone->LoadState(&state[0], size);
+        SafeDelete(clone);
+    }
+    double clone_new_ns = (double)(bench_time_ns() - start) / count;
+
+    // Reused targets, the common case for search
+    GearsystemCore* target = core->Fork();
+    count *= 10;
+
+    start = bench_time_ns();
+    for (int i = 0; i < count; i++)
+        core->Fork(target);
+    double fork_reuse_ns = (double)(bench_time_ns() - start) / count;
+
+    start = bench_time_ns();
+    for (int i = 0; i < count; i++)
+    {
+        size_t size = state_size;
+        core->SaveState(&state[0], size);
+        target->LoadState(&state[0], size);
+    }
+    double roundtrip_ns = (double)(bench_time_ns() - start) / count;
+
+    // Heap owned by each live fork
+    std::vector<GearsystemCore*> cores;
+    size_t heap = bench_heap_bytes();
+    for (int i = 0; i < FORK_MEMORY_CORES; i++)
+        cores.push_back(core->Fork());
+    size_t fork_bytes = (bench_heap_bytes() - heap) / FORK_MEMORY_CORES;
+    for (int i = 0; i < FORK_MEMORY_CORES; i++)
+        SafeDelete(cores[i]);
+    cores.clear();
+
+    heap = bench_heap_bytes();
+    for (int i = 0; i < FORK_MEMORY_CORES; i++)
+    {
+        size_t size = state_size;
+        core->SaveState(&state[0], size);
+        cores.push_back(bench_core(rom));
+        cores.back()->LoadState(&state[0], size);
+    }
+    size_t clone_bytes = (bench_heap_bytes() - heap) / FORK_MEMORY_CORES;
+    for (int i = 0; i < FORK_MEMORY_CORES; i++)
+        SafeDelete(cores[i]);
+
+    // A fork must continue exactly like its source
+    core->Fork(target);
+    GearsystemCore* fork = core->Fork();
+    uint64_t expected = fork_run(core, FORK_VERIFY_FRAMES);
+    bool exact = (fork_run(target, FORK_VERIFY_FRAMES) == expected) && (fork_run(fork, FORK_VERIFY_FRAMES) == expected);
+
+    bench_report("fork", "new", "forks_per_s", 1e9 / fork_new_ns, "1/s");
+    bench_report("fork", "new", "us_per_fork", fork_new_ns / 1000.0, "us");
+    bench_report("fork", "savestate_new", "clones_per_s", 1e9 / clone_new_ns, "1/s");
+    bench_report("fork", "savestate_new", "us_per_clone", clone_new_ns / 1000.0, "us");
+    bench_report("fork", "reuse", "forks_per_s", 1e9 / fork_reuse_ns, "1/s");
+    bench_report("fork", "reuse", "us_per_fork", fork_reuse_ns / 1000.0, "us");
+    bench_report("fork", "savestate_reuse", "roundtrips_per_s", 1e9 / roundtrip_ns, "1/s");
+    bench_report("fork", "savestate_reuse", "us_per_roundtrip", roundtrip_ns / 1000.0, "us");
+    bench_report("fork", "memory", "state_bytes", (double)state_size, "B");
+    bench_report("fork", "memory", "rom_bytes", (double)rom.size(), "B");
+    if (heap > 0)
+    {
+        bench_report("fork", "memory", "heap_per_fork", (double)fork_bytes, "B");
+        bench_report("fork", "memory", "heap_per_savestate_clone", (double)clone_bytes, "B");
+    }
+    bench_report("fork", "verify", "exact", exact ? 1.0 : 0.0, "bool");
+
+    SafeDelete(fork);
+    SafeDelete(target);
+    SafeDelete(core);
+
+    return exact;
+}
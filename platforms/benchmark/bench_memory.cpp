@@ -0,0 +1,201 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "bench.h"
+#include "gearsystem.h"
+
+#define MEMORY_ROM_SIZE 0x100000
+#define MEMORY_ACCESSES 0x10000
+#define MEMORY_PASSES 64
+
+struct MemoryMapper
+{
+    Cartridge::CartridgeTypes type;
+    const char* name;
+};
+
+static const MemoryMapper kMemoryMappers[] =
+{
+    { Cartridge::CartridgeRomOnlyMapper, "rom_only" },
+    { Cartridge::CartridgeSegaMapper, "sega" },
+    { Cartridge::CartridgeCodemastersMapper, "codemasters" },
+    { Cartridge::CartridgeSG1000Mapper, "sg1000" },
+    { Cartridge::CartridgeKoreanMapper, "korean" },
+    { Cartridge::CartridgeKoreanMSXSMS8000Mapper, "korean_msx_sms_8000" },
+    { Cartridge::CartridgeKoreanSMS32KB2000Mapper, "korean_sms_32kb_2000" },
+    { Cartridge::CartridgeKoreanMSX32KB2000Mapper, "korean_msx_32kb_2000" },
+    { Cartridge::CartridgeKorean2000XOR1FMapper, "korean_2000_xor_1f" },
+    { Cartridge::CartridgeKoreanMSX8KB0300Mapper, "korean_msx_8kb_0300" },
+    { Cartridge::CartridgeKorean0000XORFFMapper, "korean_0000_xor_ff" },
+    { Cartridge::CartridgeKoreanFFFFHiComMapper, "korean_ffff_hicom" },
+    { Cartridge::CartridgeKoreanFFFEMapper, "korean_fffe" },
+    { Cartridge::CartridgeKoreanBFFCMapper, "korean_bffc" },
+    { Cartridge::CartridgeKoreanFFF3FFFCMapper, "korean_fff3_fffc" },
+    { Cartridge::CartridgeKoreanMDFFF5Mapper, "korean_md_fff5" },
+    { Cartridge::CartridgeMSXMapper, "msx" },
+    { Cartridge::CartridgeJanggunMapper, "janggun" },
+    { Cartridge::CartridgeMulti4PAKAllActionMapper, "multi_4pak_all_action" },
+    { Cartridge::CartridgeJumboDahjeeMapper, "jumbo_dahjee" },
+    { Cartridge::CartridgeNotSupported, NULL }
+};
+
+static volatile u32 memory_sink;
+
+static uint32_t memory_random(uint32_t& seed)
+{
+    seed = seed * 1664525 + 1013904223;
+    return seed >> 8;
+}
+
+bool bench_memory(const BenchOptions& options)
+{
+    std::vector<uint8_t> rom(MEMORY_ROM_SIZE);
+    uint32_t seed = 1;
+
+    for (size_t i = 0; i < rom.size(); i++)
+        rom[i] = (uint8_t)memory_random(seed);
+
+    memcpy(&rom[0x7FF0], "TMR SEGA", 8);
+    rom[0x7FFF] = 0x4C;
+
+    std::vector<u16> addresses(MEMORY_ACCESSES);
+    std::vector<u8> values(MEMORY_ACCESSES);
+
+    for (int i = 0; i < MEMORY_ACCESSES; i++)
+    {
+        addresses[i] = (u16)memory_random(seed);
+        values[i] = (u8)memory_random(seed);
+    }
+
+    int passes = MEMORY_PASSES * options.iterations;
+    double accesses = (double)MEMORY_ACCESSES * passes;
+
+    for (int m = 0; kMemoryMappers[m].name; m++)
+    {
+        Cartridge::ForceConfiguration config;
+        bench_force_config(config);
+        config.type = kMemoryMappers[m].type;
+
+        if (config.type == Cartridge::CartridgeSG1000Mapper)
+            config.system = Cartridge::CartridgeSG1000;
+
+        GearsystemCore* core = bench_core(rom, &config);
+
+        if (!IsValidPointer(core))
+            return false;
+
+        Memory* memory = core->GetMemory();
+        u32 sink = 0;
+
+        // Random reads over the whole address space
+        uint64_t start = bench_time_ns();
+        for (int p = 0; p < passes; p++)
+        {
+            for (int i = 0; i < MEMORY_ACCESSES; i++)
+                sink += memory->Read(addresses[i]);
+        }
+        double read_ns = (double)(bench_time_ns() - start) / accesses;
+
+        // Sequential reads, like opcode fetches
+        start = bench_time_ns();
+        for (int p = 0; p < passes; p++)
+        {
+            for (int i = 0; i < MEMORY_ACCESSES; i++)
+                sink += memory->Read((u16)i);
+        }
+        double fetch_ns = (double)(bench_time_ns() - start) / accesses;
+
+        // Work RAM writes
+        start = bench_time_ns();
+        for (int p = 0; p < passes; p++)
+        {
+            for (int i = 0; i < MEMORY_ACCESSES; i++)
+                memory->Write(0xC000 | (addresses[i] & 0x1FFF), values[i]);
+        }
+        double ram_write_ns = (double)(bench_time_ns() - start) / accesses;
+
+        // Random writes, hitting the mapper registers and cartridge RAM too
+        start = bench_time_ns();
+        for (int p = 0; p < passes; p++)
+        {
+            for (int i = 0; i < MEMORY_ACCESSES; i++)
+                memory->Write(addresses[i], values[i]);
+        }
+        double write_ns = (double)(bench_time_ns() - start) / accesses;
+
+        // The mapper page table alone, without the breakpoint and code/data
+        // log checks of Memory::Read. Both pairs run the same Read and Write
+        // of MapperMemoryRule; the first calls them directly, the second
+        // through the virtual MemoryRule interface the core used before the
+        // mapper table.
+        MapperMemoryRule* mapper = memory->GetCurrentRule();
+        MemoryRule* rule = mapper;
+
+        start = bench_time_ns();
+        for (int p = 0; p < passes; p++)
+        {
+            for (int i = 0; i < MEMORY_ACCESSES; i++)
+                sink += mapper->Read(addresses[i]);
+        }
+        double direct_read_ns = (double)(bench_time_ns() - start) / accesses;
+
+        start = bench_time_ns();
+        for (int p = 0; p < passes; p++)
+        {
+            for (int i = 0; i < MEMORY_ACCESSES; i++)
+                mapper->Write(addresses[i], values[i]);
+        }
+        double direct_write_ns = (double)(bench_time_ns() - start) / accesses;
+
+        start = bench_time_ns();
+        for (int p = 0; p < passes; p++)
+        {
+            for (int i = 0; i < MEMORY_ACCESSES; i++)
+                sink += rule->PerformRead(addresses[i]);
+        }
+        double virtual_read_ns = (double)(bench_time_ns() - start) / accesses;
+
+        start = bench_time_ns();
+        for (int p = 0; p < passes; p++)
+        {
+            for (int i = 0; i < MEMORY_ACCESSES; i++)
+                rule->PerformWrite(addresses[i], values[i]);
+        }
+        double virtual_write_ns = (double)(bench_time_ns() - start) / accesses;
+
+        const char* name = kMemoryMappers[m].name;
+        bench_report("memory", name, "ns_per_read", read_ns, "ns");
+        bench_report("memory", name, "ns_per_fetch", fetch_ns, "ns");
+        bench_report("memory", name, "ns_per_ram_write", ram_write_ns, "ns");
+        bench_report("memory", name, "ns_per_write", write_ns, "ns");
+        bench_report("memory", name, "ns_per_direct_read", direct_read_ns, "ns");
+        bench_report("memory", name, "ns_per_direct_write", direct_write_ns, "ns");
+        bench_report("memory", name, "ns_per_virtual_read", virtual_read_ns, "ns");
+        bench_report("memory", name, "ns_per_virtual_write", virtual_write_ns, "ns");
+
+        memory_sink = sink;
+
+        SafeDelete(core);
+    }
+
+    return true;
+}
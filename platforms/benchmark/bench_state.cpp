@@ -0,0 +1,95 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "bench.h"
+#include "gearsystem.h"
+
+#define STATE_WARMUP_FRAMES 120
+#define STATE_COUNT 2000
+
+bool bench_state(const BenchOptions& options)
+{
+    static u8 frame_buffer[GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN * GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN * 4];
+    static s16 sample_buffer[GS_AUDIO_BUFFER_SIZE];
+    std::vector<uint8_t> rom;
+
+    if (!bench_rom(options, rom))
+        return false;
+
+    GearsystemCore* core = bench_core(rom);
+
+    if (!IsValidPointer(core))
+        return false;
+
+    int count = 0;
+    for (int i = 0; i < STATE_WARMUP_FRAMES; i++)
+        core->RunToVBlank(frame_buffer, sample_buffer, &count);
+
+    size_t state_size = core->GetStateSize();
+    std::vector<u8> state(state_size);
+    std::vector<u8> check(state_size);
+    int states = STATE_COUNT * options.iterations;
+
+    uint64_t start = bench_time_ns();
+    for (int i = 0; i < states; i++)
+    {
+        size_t size = state_size;
+        core->SaveState(&state[0], size);
+    }
+    double save_ns = (double)(bench_time_ns() - start) / states;
+
+    start = bench_time_ns();
+    for (int i = 0; i < states; i++)
+        core->LoadState(&state[0], state_size);
+    double load_ns = (double)(bench_time_ns() - start) / states;
+
+    // Loading invalidates the hash, so this is the full pass
+    start = bench_time_ns();
+    for (int i = 0; i < states; i++)
+    {
+        core->InvalidateStateHash();
+        core->StateHash();
+    }
+    double hash_full_ns = (double)(bench_time_ns() - start) / states;
+
+    start = bench_time_ns();
+    for (int i = 0; i < states; i++)
+        core->StateHash();
+    double hash_clean_ns = (double)(bench_time_ns() - start) / states;
+
+    size_t size = state_size;
+    core->SaveState(&check[0], size);
+    bool exact = (size == state_size) && (memcmp(&state[0], &check[0], state_size) == 0);
+
+    bench_report("state", "save", "us_per_state", save_ns / 1000.0, "us");
+    bench_report("state", "save", "mb_per_s", state_size * 1000.0 / save_ns, "MB/s");
+    bench_report("state", "load", "us_per_state", load_ns / 1000.0, "us");
+    bench_report("state", "load", "mb_per_s", state_size * 1000.0 / load_ns, "MB/s");
+    bench_report("state", "hash_full", "us_per_hash", hash_full_ns / 1000.0, "us");
+    bench_report("state", "hash_clean", "us_per_hash", hash_clean_ns / 1000.0, "us");
+    bench_report("state", "size", "state_bytes", (double)state_size, "B");
+    bench_report("state", "verify", "exact", exact ? 1.0 : 0.0, "bool");
+
+    SafeDelete(core);
+
+    return exact;
+}
@@ -0,0 +1,222 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "bench.h"
+#include "gearsystem.h"
+
+#define VIDEO_FRAMES 120
+#define VIDEO_TICK_CYCLES 12
+#define RENDER_FRAMES 300
+
+struct VideoMode
+{
+    const char* name;
+    Cartridge::CartridgeSystem system;
+    u8 registers[11];
+    u16 sat;
+    bool sprites;
+};
+
+static const VideoMode kVideoModes[] =
+{
+    { "sms_mode4", Cartridge::CartridgeSMS, { 0x06, 0x40, 0xFF, 0xFF, 0xFF, 0xFF, 0xFB, 0x00, 0x00, 0x00, 0xFF }, 0x3F00, false },
+    { "sms_mode4_sprites", Cartridge::CartridgeSMS, { 0x06, 0x40, 0xFF, 0xFF, 0xFF, 0xFF, 0xFB, 0x00, 0x00, 0x00, 0xFF }, 0x3F00, true },
+    { "gg_mode4", Cartridge::CartridgeGG, { 0x06, 0x40, 0xFF, 0xFF, 0xFF, 0xFF, 0xFB, 0x00, 0x00, 0x00, 0xFF }, 0x3F00, false },
+    { "gg_mode4_sprites", Cartridge::CartridgeGG, { 0x06, 0x40, 0xFF, 0xFF, 0xFF, 0xFF, 0xFB, 0x00, 0x00, 0x00, 0xFF }, 0x3F00, true },
+    { "tms_graphics1", Cartridge::CartridgeSG1000, { 0x00, 0xC0, 0x0E, 0x80, 0x00, 0x76, 0x03, 0xF4, 0x00, 0x00, 0x00 }, 0x3B00, false },
+    { "tms_graphics1_sprites", Cartridge::CartridgeSG1000, { 0x00, 0xC0, 0x0E, 0x80, 0x00, 0x76, 0x03, 0xF4, 0x00, 0x00, 0x00 }, 0x3B00, true },
+    { "tms_graphics2", Cartridge::CartridgeSG1000, { 0x02, 0xC0, 0x0E, 0xFF, 0x03, 0x76, 0x03, 0xF4, 0x00, 0x00, 0x00 }, 0x3B00, false },
+    { "tms_graphics2_sprites", Cartridge::CartridgeSG1000, { 0x02, 0xC2, 0x0E, 0xFF, 0x03, 0x76, 0x03, 0xF4, 0x00, 0x00, 0x00 }, 0x3B00, true },
+    { "tms_text", Cartridge::CartridgeSG1000, { 0x00, 0xD0, 0x0E, 0x80, 0x00, 0x76, 0x03, 0xF4, 0x00, 0x00, 0x00 }, 0x3B00, false },
+    { "tms_multicolor", Cartridge::CartridgeSG1000, { 0x00, 0xC8, 0x0E, 0x80, 0x00, 0x76, 0x03, 0xF4, 0x00, 0x00, 0x00 }, 0x3B00, false },
+    { "tms_multicolor_sprites", Cartridge::CartridgeSG1000, { 0x00, 0xC8, 0x0E, 0x80, 0x00, 0x76, 0x03, 0xF4, 0x00, 0x00, 0x00 }, 0x3B00, true },
+    { NULL, Cartridge::CartridgeUnknownSystem, { 0 }, 0, false }
+};
+
+static const GS_Color_Format kRenderFormats[] = { GS_PIXEL_RGBA8888, GS_PIXEL_BGRA8888, GS_PIXEL_RGB565, GS_PIXEL_RGB555, GS_PIXEL_BGR565, GS_PIXEL_BGR555 };
+static const char* const kRenderFormatNames[] = { "rgba8888", "bgra8888", "rgb565", "rgb555", "bgr565", "bgr555" };
+
+static void video_write_address(Video* video, u16 address, u8 code)
+{
+    video->WriteControl(address & 0xFF);
+    video->WriteControl((u8)((code << 6) | ((address >> 8) & 0x3F)));
+}
+
+// Random patterns, names and colors, with the sprite table either empty or
+// spread so that most lines hit the per line sprite limit
+static void video_setup(Video* video, const VideoMode& mode)
+{
+    bool mode4 = (mode.system != Cartridge::CartridgeSG1000);
+    u32 seed = 7;
+
+    for (int i = 0; i < 11; i++)
+    {
+        video->WriteControl(mode.registers[i]);
+        video->WriteControl(0x80 | i);
+    }
+
+    video_write_address(video, 0x0000, 1);
+    for (int i = 0; i < 0x4000; i++)
+    {
+        seed = seed * 1664525 + 1013904223;
+        video->WriteData((u8)(seed >> 24));
+    }
+
+    video_write_address(video, mode.sat, 1);
+
+    if (mode4)
+    {
+        for (int i = 0; i < 64; i++)
+            video->WriteData(mode.sprites ? (u8)((i * 3) % 184) : 0xD0);
+
+        video_write_address(video, mode.sat + 0x80, 1);
+
+        for (int i = 0; i < 64; i++)
+        {
+            video->WriteData((u8)(i * 4));
+            video->WriteData((u8)i);
+        }
+    }
+    else
+    {
+        for (int i = 0; i < 32; i++)
+        {
+            video->WriteData(mode.sprites ? (u8)((i * 6) % 184) : 0xD0);
+            video->WriteData((u8)(i * 8));
+            video->WriteData((u8)(i * 4));
+            video->WriteData((u8)(0x01 + (i % 15)));
+        }
+    }
+
+    video_write_address(video, 0x0000, 3);
+    for (int i = 0; i < 64; i++)
+        video->WriteData((u8)(i * 37));
+}
+
+static GearsystemCore* video_core(const VideoMode& mode)
+{
+    std::vector<uint8_t> rom(0x8000, 0);
+    rom[0] = 0xF3;  // di
+    rom[1] = 0x76;  // halt
+    memcpy(&rom[0x7FF0], "TMR SEGA", 8);
+    rom[0x7FFF] = (mode.system == Cartridge::CartridgeGG) ? 0x6C : 0x4C;
+
+    Cartridge::ForceConfiguration config;
+    bench_force_config(config);
+    config.system = mode.system;
+    config.region = Cartridge::CartridgeNTSC;
+
+    GearsystemCore* core = bench_core(rom, &config);
+
+    if (IsValidPointer(core))
+        video_setup(core->GetVideo(), mode);
+
+    return core;
+}
+
+static void video_run_frame(Video* video)
+{
+    while (!video->Tick(VIDEO_TICK_CYCLES)) { }
+}
+
+bool bench_video(const BenchOptions& options)
+{
+    for (int m = 0; kVideoModes[m].name; m++)
+    {
+        const VideoMode& mode = kVideoModes[m];
+        GearsystemCore* core = video_core(mode);
+
+        if (!IsValidPointer(core))
+            return false;
+
+        Video* video = core->GetVideo();
+        video_run_frame(video);
+
+        int frames = VIDEO_FRAMES * options.iterations;
+        uint64_t start = bench_time_ns();
+
+        for (int f = 0; f < frames; f++)
+            video_run_frame(video);
+
+        double ns = (double)(bench_time_ns() - start);
+        double lines = (double)frames * GS_LINES_PER_FRAME_NTSC;
+
+        bench_report("video", mode.name, "ns_per_line", ns / lines, "ns");
+        bench_report("video", mode.name, "frames_per_s", frames * 1e9 / ns, "1/s");
+        bench_report("video", mode.name, "tms_mode", video->GetTMS9918Mode(), "mode");
+
+        SafeDelete(core);
+    }
+
+    return true;
+}
+
+bool bench_render(const BenchOptions& options)
+{
+    static const int kRenderModes[] = { 1, 3, 5 };
+    static u8 buffer[GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN * GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN * 4];
+    const int size = GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN * GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN;
+
+    for (int m = 0; m < 3; m++)
+    {
+        const VideoMode& mode = kVideoModes[kRenderModes[m]];
+        GearsystemCore* core = video_core(mode);
+
+        if (!IsValidPointer(core))
+            return false;
+
+        Video* video = core->GetVideo();
+        video_run_frame(video);
+
+        GS_RuntimeInfo runtime;
+        core->GetRuntimeInfo(runtime);
+        double pixels = (double)runtime.screen_width * runtime.screen_height;
+        const char* system = (mode.system == Cartridge::CartridgeGG) ? "gg" : ((mode.system == Cartridge::CartridgeSG1000) ? "sg1000" : "sms");
+
+        for (int f = 0; f < 6; f++)
+        {
+            GS_Color_Format format = kRenderFormats[f];
+            bool wide = (format == GS_PIXEL_RGBA8888) || (format == GS_PIXEL_BGRA8888);
+            int frames = RENDER_FRAMES * options.iterations;
+            uint64_t start = bench_time_ns();
+
+            for (int i = 0; i < frames; i++)
+            {
+                if (wide)
+                    video->Render32bit(video->GetFrameBuffer(), buffer, format, size, true);
+                else
+                    video->Render16bit(video->GetFrameBuffer(), buffer, format, size, true);
+            }
+
+            double ns = (double)(bench_time_ns() - start) / frames;
+            char name[64];
+            snprintf(name, sizeof(name), "%s_%s", system, kRenderFormatNames[f]);
+
+            bench_report("render", name, "ns_per_pixel", ns / pixels, "ns");
+            bench_report("render", name, "us_per_frame", ns / 1000.0, "us");
+        }
+
+        SafeDelete(core);
+    }
+
+    return true;
+}
@@ -0,0 +1,235 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#include "bench.h"
+#include "gearsystem.h"
+
+struct BenchGroup
+{
+    const char* name;
+    bool (*run)(const BenchOptions& options);
+};
+
+static const BenchGroup kBenchGroups[] =
+{
+    { "cpu", bench_cpu },
+    { "memory", bench_memory },
+    { "video", bench_video },
+    { "render", bench_render },
+    { "apu", bench_apu },
+    { "fm", bench_fm },
+    { "state", bench_state },
+    { "fork", bench_fork },
+    { NULL, NULL }
+};
+
+uint64_t bench_time_ns()
+{
+    using namespace std::chrono;
+    return (uint64_t)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// The core logs into stdout, -o keeps the results apart from it
+static FILE* report_file = NULL;
+static bool report_json = false;
+static const char* report_label = NULL;
+
+void bench_report(const char* group, const char* name, const char* metric, double value, const char* unit)
+{
+    FILE* file = report_file ? report_file : stdout;
+
+    if (report_json)
+    {
+        fprintf(file, "{\"group\":\"%s\",\"name\":\"%s\",\"metric\":\"%s\",\"value\":%.3f,\"unit\":\"%s\"", group, name, metric, value, unit);
+        if (report_label)
+            fprintf(file, ",\"label\":\"%s\"", report_label);
+        fprintf(file, "}\n");
+    }
+    else if (report_label)
+        fprintf(file, "%s\t%s\t%s\t%s\t%.3f\t%s\n", report_label, group, name, metric, value, unit);
+    else
+        fprintf(file, "%s\t%s\t%s\t%.3f\t%s\n", group, name, metric, value, unit);
+
+    fflush(file);
+}
+
+// Z80 loop that keeps rewriting work RAM and VRAM, used when no ROM is given
+static const uint8_t kSyntheticProgram[] =
+{
+    0xF3,               // di
+    0x31, 0xF0, 0xDF,   // ld sp,$DFF0
+    0x21, 0x00, 0xC0,   // ld hl,$C000
+    0x01, 0x00, 0x20,   // ld bc,$2000
+    0x34,               // inc (hl)
+    0x7E,               // ld a,(hl)
+    0xD3, 0xBE,         // out ($BE),a
+    0x23,               // inc hl
+    0x0B,               // dec bc
+    0x78,               // ld a,b
+    0xB1,               // or c
+    0x20, 0xF6,         // jr nz,-10
+    0xC3, 0x04, 0x00    // jp $0004
+};
+
+bool bench_rom(const BenchOptions& options, std::vector<uint8_t>& rom)
+{
+    if (options.rom_path)
+    {
+        FILE* file = fopen(options.rom_path, "rb");
+
+        if (!file)
+        {
+            fprintf(stderr, "Unable to open %s\n", options.rom_path);
+            return false;
+        }
+
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file);
+        fseek(file, 0, SEEK_SET);
+
+        rom.resize(size > 0 ? size : 0);
+        bool ok = (size > 0) && (fread(&rom[0], 1, size, file) == (size_t)size);
+        fclose(file);
+        return ok;
+    }
+
+    rom.assign(0x8000, 0);
+    memcpy(&rom[0], kSyntheticProgram, sizeof(kSyntheticProgram));
+    memcpy(&rom[0x7FF0], "TMR SEGA", 8);
+    rom[0x7FFF] = 0x4C;
+    return true;
+}
+
+void bench_force_config(Cartridge::ForceConfiguration& config)
+{
+    config.type = Cartridge::CartridgeNotSupported;
+    config.zone = Cartridge::CartridgeUnknownZone;
+    config.region = Cartridge::CartridgeUnknownRegion;
+    config.system = Cartridge::CartridgeUnknownSystem;
+}
+
+GearsystemCore* bench_core(const std::vector<uint8_t>& rom, Cartridge::ForceConfiguration* config)
+{
+    GearsystemCore* core = new GearsystemCore();
+    core->Init(GS_PIXEL_RGBA8888);
+    core->GetProcessor()->EnableDisassembler(false);
+
+    if (!core->LoadROMFromBuffer(&rom[0], (int)rom.size(), config))
+        SafeDelete(core);
+
+    return core;
+}
+
+size_t bench_heap_bytes()
+{
+#if defined(__GLIBC__) && ((__GLIBC__ > 2) || (__GLIBC_MINOR__ >= 33))
+    return mallinfo2().uordblks;
+#else
+    return 0;
+#endif
+}
+
+static void usage(void)
+{
+    printf("Usage: gearsystem-bench [-i iterations] [-r rom] [-o file] [-f tsv|json] [-l label] [-v] [group ...]\n");
+    printf("Groups:");
+    for (int i = 0; kBenchGroups[i].name; i++)
+        printf(" %s", kBenchGroups[i].name);
+    printf("\n");
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+    options.iterations = 1;
+    options.verbose = false;
+    options.rom_path = NULL;
+
+    const char* output_path = NULL;
+    const char* selected[32];
+    int selected_count = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if ((strcmp(argv[i], "-i") == 0) && (i + 1 < argc))
+            options.iterations = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-r") == 0) && (i + 1 < argc))
+            options.rom_path = argv[++i];
+        else if ((strcmp(argv[i], "-o") == 0) && (i + 1 < argc))
+            output_path = argv[++i];
+        else if ((strcmp(argv[i], "-f") == 0) && (i + 1 < argc))
+            report_json = (strcmp(argv[++i], "json") == 0);
+        else if ((strcmp(argv[i], "-l") == 0) && (i + 1 < argc))
+            report_label = argv[++i];
+        else if (strcmp(argv[i], "-v") == 0)
+            options.verbose = true;
+        else if ((strcmp(argv[i], "-h") == 0) || (strcmp(argv[i], "--help") == 0))
+        {
+            usage();
+            return 0;
+        }
+        else if (selected_count < 32)
+            selected[selected_count++] = argv[i];
+    }
+
+    if (options.iterations < 1)
+        options.iterations = 1;
+
+    if (output_path)
+    {
+        report_file = fopen(output_path, "w");
+
+        if (!report_file)
+        {
+            fprintf(stderr, "Unable to create %s\n", output_path);
+            return 1;
+        }
+    }
+
+    bool ok = true;
+
+    for (int i = 0; kBenchGroups[i].name; i++)
+    {
+        bool run = (selected_count == 0);
+
+        for (int j = 0; j < selected_count; j++)
+        {
+            if (strcmp(selected[j], kBenchGroups[i].name) == 0)
+                run = true;
+        }
+
+        if (run && !kBenchGroups[i].run(options))
+        {
+            fprintf(stderr, "Benchmark group '%s' failed\n", kBenchGroups[i].name);
+            ok = false;
+        }
+    }
+
+    if (report_file)
+        fclose(report_file);
+
+    return ok ? 0 : 1;
+}
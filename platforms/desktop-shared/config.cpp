@@ -131,6 +131,7 @@ void config_init(void)
     config_setShortcut(gui_ShortcutReset, KMOD_CTRL, SDL_SCANCODE_R);
     config_setShortcut(gui_ShortcutPause, KMOD_CTRL, SDL_SCANCODE_P);
     config_setShortcut(gui_ShortcutFFWD, KMOD_CTRL, SDL_SCANCODE_F);
+    config_setShortcut(gui_ShortcutRewind, KMOD_CTRL, SDL_SCANCODE_B);
     config_setShortcut(gui_ShortcutSaveState, KMOD_CTRL, SDL_SCANCODE_S);
     config_setShortcut(gui_ShortcutLoadState, KMOD_CTRL, SDL_SCANCODE_L);
     config_setShortcut(gui_ShortcutScreenshot, KMOD_CTRL, SDL_SCANCODE_X);
@@ -210,6 +211,13 @@ void config_read(void)
     config_emulator.light_phaser_y_offset = read_int("Emulator", "LightPhaserYOffset", 0);
     config_emulator.paddle_control = read_bool("Emulator", "PaddleControl", false);
     config_emulator.paddle_sensitivity = read_int("Emulator", "PaddleSensitivity", 5);
+    config_emulator.rewind = read_bool("Emulator", "Rewind", false);
+    config_emulator.rewind_buffer_mb = read_int("Emulator", "RewindBufferMB", 32);
+    config_emulator.rewind_frequency = read_int("Emulator", "RewindFrequency", 1);
+    config_emulator.rewind_stats = read_bool("Emulator", "RewindStats", false);
+    config_emulator.runahead = read_int("Emulator", "RunAhead", 0);
+    config_emulator.runahead_second_instance = read_bool("Emulator", "RunAheadSecondInstance", false);
+    config_emulator.runahead_stats = read_bool("Emulator", "RunAheadStats", false);
 
     if (config_emulator.light_phaser)
         config_emulator.paddle_control = false;
@@ -249,6 +257,8 @@ void config_read(void)
     config_audio.enable = read_bool("Audio", "Enable", true);
     config_audio.sync = read_bool("Audio", "Sync", true);
     config_audio.ym2413 = read_int("Audio", "YM2413", 0);
+    config_audio.latency = read_int("Audio", "Latency", 60);
+    config_audio.stats = read_bool("Audio", "Stats", false);
 
     config_input[0].key_left = (SDL_Scancode)read_int("InputA", "KeyLeft", SDL_SCANCODE_LEFT);
     config_input[0].key_right = (SDL_Scancode)read_int("InputA", "KeyRight", SDL_SCANCODE_RIGHT);
@@ -332,6 +342,13 @@ void config_write(void)
     write_int("Emulator", "LightPhaserYOffset", config_emulator.light_phaser_y_offset);
     write_bool("Emulator", "PaddleControl", config_emulator.paddle_control);
     write_int("Emulator", "PaddleSensitivity", config_emulator.paddle_sensitivity);
+    write_bool("Emulator", "Rewind", config_emulator.rewind);
+    write_int("Emulator", "RewindBufferMB", config_emulator.rewind_buffer_mb);
+    write_int("Emulator", "RewindFrequency", config_emulator.rewind_frequency);
+    write_bool("Emulator", "RewindStats", config_emulator.rewind_stats);
+    write_int("Emulator", "RunAhead", config_emulator.runahead);
+    write_bool("Emulator", "RunAheadSecondInstance", config_emulator.runahead_second_instance);
+    write_bool("Emulator", "RunAheadStats", config_emulator.runahead_stats);
 
     for (int i = 0; i < config_max_recent_roms; i++)
     {
@@ -357,6 +374,8 @@ void config_write(void)
     write_bool("Audio", "Enable", config_audio.enable);
     write_bool("Audio", "Sync", config_audio.sync);
     write_int("Audio", "YM2413", config_audio.ym2413);
+    write_int("Audio", "Latency", config_audio.latency);
+    write_bool("Audio", "Stats", config_audio.stats);
 
     write_int("InputA", "KeyLeft", config_input[0].key_left);
     write_int("InputA", "KeyRight", config_input[0].key_right);
@@ -72,6 +72,13 @@ struct config_Emulator
     bool paddle_control = false;
     int paddle_sensitivity = 5;
     bool capture_mouse = false;
+    bool rewind = false;
+    int rewind_buffer_mb = 32;
+    int rewind_frequency = 1;
+    bool rewind_stats = false;
+    int runahead = 0;
+    bool runahead_second_instance = false;
+    bool runahead_stats = false;
 };
 
 struct config_Video
@@ -97,6 +104,8 @@ struct config_Audio
     bool enable = true;
     bool sync = true;
     int ym2413 = 0;
+    int latency = 60;
+    bool stats = false;
 };
 
 struct config_Input
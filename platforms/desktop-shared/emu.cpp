@@ -31,6 +31,9 @@
 
 static GearsystemCore* gearsystem;
 static SoundQueue* sound_queue;
+static RewindBuffer* rewind_buffer;
+static bool rewind_enabled = false;
+static bool rewinding = false;
 static s16* audio_buffer;
 static bool audio_enabled;
 static bool debugging = false;
@@ -70,6 +73,8 @@ void emu_init(void)
     sound_queue = new SoundQueue();
     sound_queue->Start(GS_AUDIO_SAMPLE_RATE, 2);
 
+    rewind_buffer = new RewindBuffer(gearsystem);
+
     audio_enabled = true;
     emu_audio_sync = true;
     emu_debug_disable_breakpoints_cpu = false;
@@ -86,6 +91,7 @@ void emu_destroy(void)
     save_ram();
     SafeDeleteArray(audio_buffer);
     SafeDelete(sound_queue);
+    SafeDelete(rewind_buffer);
     SafeDelete(gearsystem);
     SafeDeleteArray(emu_frame_buffer);
     destroy_debug();
@@ -97,6 +103,7 @@ void emu_load_rom(const char* file_path, Cartridge::ForceConfiguration config)
     save_ram();
     gearsystem->LoadROM(file_path, &config);
     load_ram();
+    rewind_buffer->Reset();
     emu_debug_continue();
 }
 
@@ -108,6 +115,9 @@ void emu_update(void)
 
         if (!debugging || debug_step || debug_next_frame)
         {
+            if (rewinding && !rewind_buffer->StepBack())
+                rewinding = false;
+
             bool breakpoints = (!emu_debug_disable_breakpoints_cpu && !emu_debug_disable_breakpoints_mem) || IsValidPointer(gearsystem->GetMemory()->GetRunToBreakpoint());
 
             if (gearsystem->RunToVBlank(emu_frame_buffer, audio_buffer, &sampleCount, debug_step, breakpoints))
@@ -115,13 +125,16 @@ void emu_update(void)
                 debugging = true;
             }
 
+            if (rewind_enabled && !rewinding && !debugging && !gearsystem->IsPaused())
+                rewind_buffer->Capture();
+
             debug_next_frame = false;
             debug_step = false;
         }
 
         update_debug();
 
-        if ((sampleCount > 0) && !gearsystem->IsPaused())
+        if ((sampleCount > 0) && !gearsystem->IsPaused() && !rewinding)
         {
             sound_queue->Write(audio_buffer, sampleCount, emu_audio_sync);
         }
@@ -194,6 +207,7 @@ void emu_reset(Cartridge::ForceConfiguration config)
     save_ram();
     gearsystem->ResetROM(&config);
     load_ram();
+    rewind_buffer->Reset();
 }
 
 void emu_memory_dump(void)
@@ -206,6 +220,16 @@ void emu_dissasemble_rom(void)
     gearsystem->SaveDisassembledROM();
 }
 
+void emu_save_code_data_log(void)
+{
+    gearsystem->SaveCodeDataLog();
+}
+
+void emu_load_code_data_log(void)
+{
+    gearsystem->LoadCodeDataLog();
+}
+
 void emu_audio_mute(bool mute)
 {
     audio_enabled = !mute;
@@ -214,8 +238,9 @@ void emu_audio_mute(bool mute)
 
 void emu_audio_reset(void)
 {
+    int latency = sound_queue->GetLatency();
     sound_queue->Stop();
-    sound_queue->Start(GS_AUDIO_SAMPLE_RATE, 2);
+    sound_queue->Start(GS_AUDIO_SAMPLE_RATE, 2, latency);
 }
 
 bool emu_is_audio_enabled(void)
@@ -228,6 +253,52 @@ bool emu_is_audio_open(void)
     return sound_queue->IsOpen();
 }
 
+void emu_audio_set_latency(int latency_ms)
+{
+    sound_queue->SetLatency(latency_ms);
+}
+
+void emu_audio_get_stats(SoundQueueStats& stats)
+{
+    sound_queue->GetStats(stats);
+}
+
+void emu_rewind_config(bool enable, int buffer_mb, int frequency)
+{
+    rewind_enabled = enable;
+    rewinding = false;
+
+    if (enable)
+        rewind_buffer->Init((size_t)buffer_mb * 1024 * 1024, frequency);
+    else
+        rewind_buffer->Reset();
+}
+
+void emu_rewind(bool rewind)
+{
+    rewinding = rewind_enabled && rewind;
+}
+
+bool emu_is_rewinding(void)
+{
+    return rewinding;
+}
+
+void emu_rewind_get_stats(RewindStats& stats)
+{
+    rewind_buffer->GetStats(stats);
+}
+
+void emu_runahead_config(int frames, bool second_instance)
+{
+    gearsystem->SetRunAhead(frames, second_instance);
+}
+
+bool emu_runahead_get_stats(GS_RunAheadStats& stats)
+{
+    return gearsystem->GetRunAheadStats(stats);
+}
+
 void emu_save_ram(const char* file_path)
 {
     if (!emu_is_empty())
@@ -241,6 +312,7 @@ void emu_load_ram(const char* file_path, Cartridge::ForceConfiguration config)
         save_ram();
         gearsystem->ResetROM(&config);
         gearsystem->LoadRam(file_path, true);
+        rewind_buffer->Reset();
     }
 }
 
@@ -263,6 +335,8 @@ void emu_load_state_slot(int index)
             gearsystem->LoadState(emu_savestates_path, index);
         else
             gearsystem->LoadState(index);
+
+        rewind_buffer->Reset();
     }
 }
 
@@ -275,7 +349,10 @@ void emu_save_state_file(const char* file_path)
 void emu_load_state_file(const char* file_path)
 {
     if (!emu_is_empty())
+    {
         gearsystem->LoadState(file_path, -1);
+        rewind_buffer->Reset();
+    }
 }
 
 void emu_add_cheat(const char* cheat)
@@ -22,6 +22,8 @@
 
 #include "../../src/gearsystem.h"
 
+struct SoundQueueStats;
+
 #ifdef EMU_IMPORT
     #define EXTERN
 #else
@@ -61,10 +63,20 @@ EXTERN bool emu_is_empty(void);
 EXTERN void emu_reset(Cartridge::ForceConfiguration config);
 EXTERN void emu_memory_dump(void);
 EXTERN void emu_dissasemble_rom(void);
+EXTERN void emu_save_code_data_log(void);
+EXTERN void emu_load_code_data_log(void);
 EXTERN void emu_audio_mute(bool mute);
 EXTERN void emu_audio_reset(void);
 EXTERN bool emu_is_audio_enabled(void);
 EXTERN bool emu_is_audio_open(void);
+EXTERN void emu_audio_set_latency(int latency_ms);
+EXTERN void emu_audio_get_stats(SoundQueueStats& stats);
+EXTERN void emu_rewind_config(bool enable, int buffer_mb, int frequency);
+EXTERN void emu_rewind(bool rewind);
+EXTERN bool emu_is_rewinding(void);
+EXTERN void emu_rewind_get_stats(RewindStats& stats);
+EXTERN void emu_runahead_config(int frames, bool second_instance);
+EXTERN bool emu_runahead_get_stats(GS_RunAheadStats& stats);
 EXTERN void emu_save_ram(const char* file_path);
 EXTERN void emu_load_ram(const char* file_path, Cartridge::ForceConfiguration config);
 EXTERN void emu_save_state_slot(int index);
@@ -32,6 +32,7 @@
 #include "license.h"
 #include "backers.h"
 #include "gui_debug.h"
+#include "../audio-shared/sound_queue.h"
 
 #define GUI_IMPORT
 #include "gui.h"
@@ -77,6 +78,20 @@ static void push_recent_rom(std::string path);
 static void menu_reset(void);
 static void menu_pause(void);
 static void menu_ffwd(void);
+static void menu_rewind(void);
+static void menu_rewind(void)
+{
+    if (!config_emulator.rewind)
+        return;
+
+    emu_rewind(!emu_is_rewinding());
+
+    if (emu_is_rewinding())
+        gui_set_status_message("Rewind ON", 3000);
+    else
+        gui_set_status_message("Rewind OFF", 3000);
+}
+
 static void show_info(void);
 static void show_fps(void);
 static void show_status_message(void);
@@ -126,6 +141,9 @@ void gui_init(void)
     set_style();
 
     emu_audio_mute(!config_audio.enable);
+    emu_audio_set_latency(config_audio.latency);
+    emu_rewind_config(config_emulator.rewind, config_emulator.rewind_buffer_mb, config_emulator.rewind_frequency);
+    emu_runahead_config(config_emulator.runahead, config_emulator.runahead_second_instance);
 
     strcpy(sms_bootrom_path, config_emulator.sms_bootrom_path.c_str());
     strcpy(gg_bootrom_path, config_emulator.gg_bootrom_path.c_str());
@@ -198,6 +216,9 @@ void gui_shortcut(gui_ShortCutEvent event)
         config_emulator.ffwd = !config_emulator.ffwd;
         menu_ffwd();
         break;
+    case gui_ShortcutRewind:
+        menu_rewind();
+        break;
     case gui_ShortcutSaveState:
     {
         std::string message("Saving state to slot ");
@@ -415,6 +436,60 @@ static void main_menu(void)
 
             ImGui::Separator();
 
+            gui_event_get_shortcut_string(shortcut, sizeof(shortcut), gui_ShortcutRewind);
+            if (ImGui::MenuItem("Rewind", shortcut, emu_is_rewinding(), config_emulator.rewind))
+            {
+                menu_rewind();
+            }
+
+            if (ImGui::BeginMenu("Rewind Settings"))
+            {
+                if (ImGui::MenuItem("Enable Rewind", "", &config_emulator.rewind))
+                {
+                    emu_rewind_config(config_emulator.rewind, config_emulator.rewind_buffer_mb, config_emulator.rewind_frequency);
+                }
+
+                ImGui::PushItemWidth(130.0f);
+                ImGui::Text("Buffer Size:");
+                ImGui::SliderInt("##rewind_buffer", &config_emulator.rewind_buffer_mb, 4, 256, "%d MB");
+                if (ImGui::IsItemDeactivatedAfterEdit())
+                {
+                    emu_rewind_config(config_emulator.rewind, config_emulator.rewind_buffer_mb, config_emulator.rewind_frequency);
+                }
+                ImGui::Text("Capture Every:");
+                ImGui::SliderInt("##rewind_frequency", &config_emulator.rewind_frequency, 1, 10, "%d frames");
+                if (ImGui::IsItemDeactivatedAfterEdit())
+                {
+                    emu_rewind_config(config_emulator.rewind, config_emulator.rewind_buffer_mb, config_emulator.rewind_frequency);
+                }
+                ImGui::PopItemWidth();
+
+                ImGui::MenuItem("Show Rewind Stats", "", &config_emulator.rewind_stats);
+
+                ImGui::EndMenu();
+            }
+
+            if (ImGui::BeginMenu("Run-Ahead"))
+            {
+                ImGui::PushItemWidth(130.0f);
+                if (ImGui::Combo("##runahead", &config_emulator.runahead, "Disabled\0One Frame\0Two Frames\0Three Frames\0Four Frames\0\0"))
+                {
+                    emu_runahead_config(config_emulator.runahead, config_emulator.runahead_second_instance);
+                }
+                ImGui::PopItemWidth();
+
+                if (ImGui::MenuItem("Use Second Instance", "", &config_emulator.runahead_second_instance))
+                {
+                    emu_runahead_config(config_emulator.runahead, config_emulator.runahead_second_instance);
+                }
+
+                ImGui::MenuItem("Show Run-Ahead Stats", "", &config_emulator.runahead_stats);
+
+                ImGui::EndMenu();
+            }
+
+            ImGui::Separator();
+
             if (ImGui::MenuItem("Save RAM As...")) 
             {
                 save_ram = true;
@@ -1067,6 +1142,20 @@ static void main_menu(void)
                 ImGui::EndMenu();
             }
 
+            if (ImGui::BeginMenu("Latency"))
+            {
+                ImGui::PushItemWidth(130.0f);
+                ImGui::SliderInt("##audio_latency", &config_audio.latency, 20, 200, "%d ms");
+                if (ImGui::IsItemDeactivatedAfterEdit())
+                {
+                    emu_audio_set_latency(config_audio.latency);
+                }
+                ImGui::PopItemWidth();
+                ImGui::EndMenu();
+            }
+
+            ImGui::MenuItem("Show Audio Stats", "", &config_audio.stats);
+
             ImGui::EndMenu();
         }
 
@@ -1183,6 +1272,23 @@ static void main_menu(void)
                 gui_debug_reset_symbols();
             }
 
+            ImGui::Separator();
+
+            if (ImGui::MenuItem("Save Code/Data Log", "", (void*)0, config_debug.debug))
+            {
+                emu_save_code_data_log();
+            }
+
+            if (ImGui::MenuItem("Load Code/Data Log", "", (void*)0, config_debug.debug))
+            {
+                emu_load_code_data_log();
+            }
+
+            if (ImGui::MenuItem("Save Disassembled ROM", "", (void*)0, config_debug.debug))
+            {
+                emu_dissasemble_rom();
+            }
+
             ImGui::EndMenu();
         }
 
@@ -1367,7 +1473,7 @@ static void main_window(void)
 
     ImGui::Image((ImTextureID)(intptr_t)renderer_emu_texture, ImVec2((float)main_window_width, (float)main_window_height), ImVec2(0, 0), ImVec2(tex_h, tex_v));
 
-    if (config_video.fps)
+    if (config_video.fps || config_audio.stats || config_emulator.rewind_stats || config_emulator.runahead_stats)
         show_fps();
 
     ImGui::End();
@@ -2023,7 +2129,29 @@ static void show_fps(void)
     ImGui::PushFont(gui_default_font);
     ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f,1.00f,0.0f,1.0f));
     ImGui::SetCursorPos(ImVec2(5.0f, config_debug.debug ? 25.0f : 5.0f));
-    ImGui::Text("FPS:  %.2f\nTIME: %.2f ms", ImGui::GetIO().Framerate, 1000.0f / ImGui::GetIO().Framerate);
+    if (config_video.fps)
+        ImGui::Text("FPS:  %.2f\nTIME: %.2f ms", ImGui::GetIO().Framerate, 1000.0f / ImGui::GetIO().Framerate);
+
+    if (config_audio.stats)
+    {
+        SoundQueueStats stats;
+        emu_audio_get_stats(stats);
+        ImGui::Text("AUDIO FILL:     %d / %d\nAUDIO LATENCY:  %.1f ms (%.0f ms)\nAUDIO RATE:     %.4f\nAUDIO UNDERRUN: %u\nAUDIO OVERRUN:  %u", stats.fill_level, stats.target_level, stats.latency_ms, stats.target_latency_ms, stats.rate_ratio, stats.underruns, stats.overruns);
+    }
+
+    if (config_emulator.rewind_stats)
+    {
+        RewindStats stats;
+        emu_rewind_get_stats(stats);
+        ImGui::Text("REWIND MEMORY:  %.1f / %.1f MB\nREWIND FRAMES:  %d (%d keyframes)\nREWIND RATIO:   %.1f:1\nREWIND CAPTURE: %.1f us (avg %.1f us)\nREWIND STEP:    %.1f us", stats.memory_used / 1048576.0f, stats.memory_budget / 1048576.0f, stats.frames_available, stats.keyframe_count, stats.compression_ratio, stats.last_capture_us, stats.average_capture_us, stats.last_step_us);
+    }
+
+    if (config_emulator.runahead_stats)
+    {
+        GS_RunAheadStats stats;
+        if (emu_runahead_get_stats(stats))
+            ImGui::Text("RUNAHEAD FRAMES: %d (%s)\nRUNAHEAD COST:   %d us (avg %d us)\nRUNAHEAD SAVE:   %d us\nRUNAHEAD LOAD:   %d us\nRUNAHEAD AHEAD:  %d us\nRUNAHEAD BUDGET: %.1f%%", stats.frames, stats.second_instance ? "second instance" : "single", stats.total_us, stats.average_total_us, stats.save_us, stats.load_us, stats.ahead_us, stats.budget_usage * 100.0f);
+    }
     ImGui::PopStyleColor();
     ImGui::PopFont();
 }
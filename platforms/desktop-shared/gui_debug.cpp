@@ -58,6 +58,10 @@ static char brk_address_cpu[8] = "";
 static char brk_address_mem[10] = "";
 static bool brk_new_mem_read = true;
 static bool brk_new_mem_write = true;
+static bool brk_new_mem_execute = false;
+static bool brk_new_mem_trace = false;
+static char brk_new_mem_condition[64] = "";
+static char brk_new_mem_error[48] = "";
 static char goto_address[5] = "";
 static bool goto_address_requested = false;
 static u16 goto_address_target = 0;
@@ -171,6 +175,8 @@ void gui_debug_toggle_breakpoint(void)
         {
             breakpoints->push_back(selected_record);
         }
+
+        emu_get_core()->GetMemory()->UpdateBreakpoints();
     }
 }
 
@@ -186,12 +192,14 @@ void gui_debug_runtocursor(void)
 void gui_debug_reset_breakpoints_cpu(void)
 {
     emu_get_core()->GetMemory()->GetBreakpointsCPU()->clear();
+    emu_get_core()->GetMemory()->UpdateBreakpoints();
     brk_address_cpu[0] = 0;
 }
 
 void gui_debug_reset_breakpoints_mem(void)
 {
     emu_get_core()->GetMemory()->GetBreakpointsMem()->clear();
+    emu_get_core()->GetMemory()->UpdateBreakpoints();
     brk_address_mem[0] = 0;
 }
 
@@ -677,6 +685,7 @@ static void debug_window_disassembler(void)
         if (remove >= 0)
         {
             breakpoints_cpu->erase(breakpoints_cpu->begin() + remove);
+            memory->UpdateBreakpoints();
         }
 
         ImGui::EndChild();
@@ -706,6 +715,24 @@ static void debug_window_disassembler(void)
 
         ImGui::Checkbox("Read", &brk_new_mem_read);
         ImGui::Checkbox("Write", &brk_new_mem_write);
+        ImGui::Checkbox("Exec", &brk_new_mem_execute);
+        ImGui::Checkbox("Trace", &brk_new_mem_trace);
+
+        if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("Log the access in Tracepoints instead of stopping");
+
+        ImGui::PushItemWidth(85);
+        if (ImGui::InputTextWithHint("##condition_mem", "Condition", brk_new_mem_condition, IM_ARRAYSIZE(brk_new_mem_condition), ImGuiInputTextFlags_AutoSelectAll | ImGuiInputTextFlags_EnterReturnsTrue))
+        {
+            add_breakpoint_mem();
+        }
+        ImGui::PopItemWidth();
+
+        if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("Optional, e.g. A == 0x10 && [HL] != value\nRegisters, [address], value, address and C operators");
+
+        if (brk_new_mem_error[0] != 0)
+            ImGui::TextColored(red, "%s", brk_new_mem_error);
 
         if (ImGui::Button("Add##add_mem", ImVec2(85, 0)))
         {
@@ -749,12 +776,25 @@ static void debug_window_disassembler(void)
             {
                 ImGui::SameLine(); ImGui::TextColored(gray, "W");
             }
+            if ((*breakpoints_mem)[b].execute)
+            {
+                ImGui::SameLine(); ImGui::TextColored(gray, "X");
+            }
+            if ((*breakpoints_mem)[b].trace)
+            {
+                ImGui::SameLine(); ImGui::TextColored(yellow, "T");
+            }
+            if (!(*breakpoints_mem)[b].condition.IsEmpty())
+            {
+                ImGui::SameLine(); ImGui::TextColored(cyan, "%s", (*breakpoints_mem)[b].condition.GetSource());
+            }
             ImGui::PopFont();
         }
 
         if (remove >= 0)
         {
             breakpoints_mem->erase(breakpoints_mem->begin() + remove);
+            memory->UpdateBreakpoints();
         }
 
         ImGui::EndChild();
@@ -762,6 +802,43 @@ static void debug_window_disassembler(void)
         ImGui::Separator();
     }
 
+    if (ImGui::CollapsingHeader("Tracepoints"))
+    {
+        std::vector<Memory::stBreakpointTrace>* traces = memory->GetBreakpointTraces();
+
+        if (ImGui::Button("Clear##clear_traces", ImVec2(85, 0)))
+        {
+            traces->clear();
+        }
+
+        ImGui::SameLine();
+        ImGui::TextColored(gray, "%d entries", (int)traces->size());
+
+        ImGui::BeginChild("tracepoints", ImVec2(0, 130), false);
+        ImGui::PushFont(gui_default_font);
+
+        ImGuiListClipper clipper;
+        clipper.Begin((int)traces->size());
+
+        while (clipper.Step())
+        {
+            for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+            {
+                Memory::stBreakpointTrace& trace = (*traces)[traces->size() - 1 - i];
+                char access = (trace.access == Memory::BreakpointRead) ? 'R' : ((trace.access == Memory::BreakpointWrite) ? 'W' : 'X');
+
+                ImGui::TextColored(cyan, "%04X", trace.pc); ImGui::SameLine();
+                ImGui::TextColored(gray, "%c", access); ImGui::SameLine();
+                ImGui::TextColored(red, "%04X", trace.address); ImGui::SameLine();
+                ImGui::TextColored(white, "%02X", trace.value);
+            }
+        }
+
+        ImGui::PopFont();
+        ImGui::EndChild();
+        ImGui::Separator();
+    }
+
     ImGui::PushFont(gui_default_font);
 
     bool window_visible = ImGui::BeginChild("##dis", ImVec2(ImGui::GetContentRegionAvail().x, 0), true, 0);
@@ -1897,7 +1974,7 @@ static void add_breakpoint_cpu(void)
             }
             else
             {
-                map[target_offset]->address = 0;
+                map[target_offset]->address = target_offset;
                 map[target_offset]->bank = 0;
             }
 
@@ -1911,6 +1988,7 @@ static void add_breakpoint_cpu(void)
         }
 
         breakpoints->push_back(map[target_offset]);
+        emu_get_core()->GetMemory()->UpdateBreakpoints();
     }
 }
 
@@ -1949,13 +2027,23 @@ static void add_breakpoint_mem(void)
         return;
     }
 
+    DebugExpression condition;
+
+    if (!condition.Compile(brk_new_mem_condition))
+    {
+        snprintf(brk_new_mem_error, sizeof(brk_new_mem_error), "%s", condition.GetError());
+        return;
+    }
+
+    brk_new_mem_error[0] = 0;
+
     bool found = false;
     std::vector<Memory::stMemoryBreakpoint>* breakpoints = emu_get_core()->GetMemory()->GetBreakpointsMem();
 
     for (long unsigned int b = 0; b < breakpoints->size(); b++)
     {
-        Memory::stMemoryBreakpoint temp = (*breakpoints)[b];
-        if ((temp.address1 == address1) && (temp.address2 == address2) && (temp.range == range))
+        Memory::stMemoryBreakpoint& temp = (*breakpoints)[b];
+        if ((temp.address1 == address1) && (temp.address2 == address2) && (temp.range == range) && (strcmp(temp.condition.GetSource(), condition.GetSource()) == 0))
         {
             found = true;
             break;
@@ -1970,8 +2058,12 @@ static void add_breakpoint_mem(void)
         new_breakpoint.range = range;
         new_breakpoint.read = brk_new_mem_read;
         new_breakpoint.write = brk_new_mem_write;
+        new_breakpoint.execute = brk_new_mem_execute;
+        new_breakpoint.trace = brk_new_mem_trace;
+        new_breakpoint.condition = condition;
 
         breakpoints->push_back(new_breakpoint);
+        emu_get_core()->GetMemory()->UpdateBreakpoints();
     }
 
     brk_address_mem[0] = 0;
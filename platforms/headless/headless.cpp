@@ -0,0 +1,1014 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include "gearsystem.h"
+#include "BatchScheduler.h"
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "stb/stb_image_write.h"
+
+struct HeadlessOptions
+{
+    const char* rom_path;
+    int frames;
+    const char* input_path;
+    const char* frames_dir;
+    bool frames_png;
+    int frames_every;
+    const char* wav_path;
+    const char* state_in_path;
+    const char* state_out_path;
+    const char* hash_path;
+    const char* movie_out_path;
+    const char* movie_in_path;
+    int keyframe_interval;
+    int seek_frame;
+    bool profile;
+    const char* code_profile_path;
+    const char* symbols_path;
+    const char* trace_path;
+    const char* trace_start;
+    const char* trace_stop;
+    const char* cdl_path;
+    int batch_instances;
+    int batch_threads;
+};
+
+struct InputEvent
+{
+    int frame;
+    int pad;
+    u8 keys;
+};
+
+struct BatchInstance
+{
+    GearsystemCore* core;
+    u8* frame_buffer;
+    s16* audio_buffer;
+    size_t next_event;
+    u8 pad_keys[2];
+    u64 video_hash;
+    u64 audio_hash;
+};
+
+struct BatchFrame
+{
+    BatchInstance* instances;
+    const std::vector<InputEvent>* events;
+    int frame;
+};
+
+struct WavWriter
+{
+    FILE* file;
+    u32 bytes;
+};
+
+static const char* const kKeyNames[] = { "up", "down", "left", "right", "1", "2", "start" };
+static const int kKeyCount = 7;
+
+static u64 fnv1a(u64 hash, const void* data, size_t size)
+{
+    const u8* p = (const u8*)data;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= p[i];
+        hash *= 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+static const u64 kFnvBasis = 0xCBF29CE484222325ULL;
+
+static void usage(void)
+{
+    printf("Usage: gearsystem-headless [options] rom\n");
+    printf("  -n frames       frames to emulate (default 600)\n");
+    printf("  -i file         input script, lines of: <frame> <pad 1|2> <keys|->\n");
+    printf("                  keys: comma separated up,down,left,right,1,2,start\n");
+    printf("  -d dir          dump frames into dir\n");
+    printf("  -f raw|png      frame dump format (default png)\n");
+    printf("  -e n            dump every n frames (default 1)\n");
+    printf("  -w file         write audio to a WAV file\n");
+    printf("  -l file         load a save state before running\n");
+    printf("  -s file         write the final save state\n");
+    printf("  -t file         write the machine state hash of every frame, for diffing runs\n");
+    printf("  -M file         record the input into a movie file\n");
+    printf("  -m file         play a movie file (default frames: the movie length)\n");
+    printf("  -k n            movie keyframe interval in frames (default %d)\n", GS_MOVIE_DEFAULT_KEYFRAME_INTERVAL);
+    printf("  -g frame        seek the movie to frame before running\n");
+    printf("  -p              report time per subsystem (slower)\n");
+    printf("  -c prefix       profile the emulated code into prefix.callgrind and prefix.folded\n");
+    printf("  -y file         symbol file (WLA-DX .sym) used to name the profiled functions\n");
+    printf("  -x file         write a binary execution trace, decode it with gearsystem-tracedump\n");
+    printf("  -xstart trigger start tracing on pc:XXXX, frame:N or break (default at once)\n");
+    printf("  -xstop trigger  stop tracing on pc:XXXX, frame:N or break\n");
+    printf("  -cdl file       code/data log, loaded if it exists and updated at the end\n");
+    printf("  -b n            run n instances in lockstep and report thread scaling\n");
+    printf("  -j n            max threads for -b (default all cores)\n");
+}
+
+static bool parse_keys(const char* text, u8& keys)
+{
+    keys = 0;
+
+    if (strcmp(text, "-") == 0)
+        return true;
+
+    std::string list = text;
+    size_t start = 0;
+
+    while (start <= list.length())
+    {
+        size_t end = list.find(',', start);
+
+        if (end == std::string::npos)
+            end = list.length();
+
+        std::string name = list.substr(start, end - start);
+        bool found = false;
+
+        for (int i = 0; i < kKeyCount; i++)
+        {
+            if (name == kKeyNames[i])
+            {
+                keys |= (1 << i);
+                found = true;
+            }
+        }
+
+        if (!found)
+            return false;
+
+        start = end + 1;
+    }
+
+    return true;
+}
+
+static bool load_input_script(const char* path, std::vector<InputEvent>& events)
+{
+    FILE* file = fopen(path, "r");
+
+    if (!file)
+    {
+        fprintf(stderr, "Unable to open input script %s\n", path);
+        return false;
+    }
+
+    char line[256];
+    int line_number = 0;
+
+    while (fgets(line, sizeof(line), file))
+    {
+        line_number++;
+
+        char* comment = strchr(line, '#');
+        if (comment)
+            *comment = 0;
+
+        int frame, pad;
+        char keys[128];
+        int fields = sscanf(line, "%d %d %127s", &frame, &pad, keys);
+
+        if (fields <= 0)
+            continue;
+
+        InputEvent event;
+
+        if ((fields != 3) || (frame < 0) || (pad < 1) || (pad > 2) || !parse_keys(keys, event.keys))
+        {
+            fprintf(stderr, "Invalid input script line %d: %s\n", line_number, line);
+            fclose(file);
+            return false;
+        }
+
+        event.frame = frame;
+        event.pad = pad - 1;
+        events.push_back(event);
+    }
+
+    fclose(file);
+    return true;
+}
+
+static void apply_input(GearsystemCore* core, const std::vector<InputEvent>& events, size_t& next, int frame, u8* pad_keys)
+{
+    while ((next < events.size()) && (events[next].frame <= frame))
+    {
+        const InputEvent& event = events[next++];
+        GS_Joypads pad = (event.pad == 0) ? Joypad_1 : Joypad_2;
+        u8 changed = pad_keys[event.pad] ^ event.keys;
+
+        for (int i = 0; i < kKeyCount; i++)
+        {
+            if (!IsSetBit(changed, i))
+                continue;
+
+            if (IsSetBit(event.keys, i))
+                core->KeyPressed(pad, (GS_Keys)i);
+            else
+                core->KeyReleased(pad, (GS_Keys)i);
+        }
+
+        pad_keys[event.pad] = event.keys;
+    }
+}
+
+static bool wav_open(WavWriter& wav, const char* path)
+{
+    wav.bytes = 0;
+    wav.file = fopen(path, "wb");
+
+    if (!wav.file)
+    {
+        fprintf(stderr, "Unable to create %s\n", path);
+        return false;
+    }
+
+    u8 header[44] = { };
+    fwrite(header, 1, sizeof(header), wav.file);
+    return true;
+}
+
+static void wav_put32(u8* p, u32 value)
+{
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+    p[2] = (value >> 16) & 0xFF;
+    p[3] = (value >> 24) & 0xFF;
+}
+
+static void wav_close(WavWriter& wav)
+{
+    if (!wav.file)
+        return;
+
+    const u32 channels = 2;
+    const u32 rate = GS_AUDIO_SAMPLE_RATE;
+
+    u8 header[44];
+    memcpy(header, "RIFF", 4);
+    wav_put32(header + 4, 36 + wav.bytes);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    wav_put32(header + 16, 16);
+    wav_put32(header + 20, 1 | (channels << 16));
+    wav_put32(header + 24, rate);
+    wav_put32(header + 28, rate * channels * 2);
+    wav_put32(header + 32, (channels * 2) | (16 << 16));
+    memcpy(header + 36, "data", 4);
+    wav_put32(header + 40, wav.bytes);
+
+    fseek(wav.file, 0, SEEK_SET);
+    fwrite(header, 1, sizeof(header), wav.file);
+    fclose(wav.file);
+    wav.file = NULL;
+}
+
+static bool dump_frame(const HeadlessOptions& options, int frame, const u8* buffer, int width, int height)
+{
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/frame_%06d.%s", options.frames_dir, frame, options.frames_png ? "png" : "raw");
+
+    if (options.frames_png)
+        return stbi_write_png(path, width, height, 4, buffer, width * 4) != 0;
+
+    FILE* file = fopen(path, "wb");
+
+    if (!file)
+        return false;
+
+    size_t size = (size_t)width * height * 4;
+    bool ok = (fwrite(buffer, 1, size, file) == size);
+    fclose(file);
+    return ok;
+}
+
+static bool read_file(const char* path, std::vector<u8>& data)
+{
+    FILE* file = fopen(path, "rb");
+
+    if (!file)
+        return false;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    if (size <= 0)
+    {
+        fclose(file);
+        return false;
+    }
+
+    data.resize(size);
+    bool ok = (fread(&data[0], 1, size, file) == (size_t)size);
+    fclose(file);
+    return ok;
+}
+
+static bool report_state(GearsystemCore* core, const char* out_path)
+{
+    size_t size = core->GetStateSize();
+
+    if (size == 0)
+        return false;
+
+    std::vector<u8> state(size);
+
+    if (!core->SaveState(&state[0], size))
+        return false;
+
+    printf("state_size: %zu\n", size);
+    printf("state_hash: %016llx\n", (unsigned long long)fnv1a(kFnvBasis, &state[0], size));
+
+    StateContainer container;
+
+    if (container.Open(&state[0], size))
+    {
+        for (int i = 0; i < container.GetChunkCount(); i++)
+        {
+            const GS_StateChunk* chunk = container.GetChunk(i);
+            char id[5];
+            memcpy(id, &chunk->id, 4);
+            id[4] = 0;
+
+            for (int c = 3; (c > 0) && (id[c] == ' '); c--)
+                id[c] = 0;
+
+            printf("state_hash_%s: %016llx\n", id, (unsigned long long)fnv1a(kFnvBasis, chunk->data, chunk->size));
+        }
+    }
+
+    if (out_path)
+    {
+        FILE* file = fopen(out_path, "wb");
+
+        if (!file || (fwrite(&state[0], 1, size, file) != size))
+        {
+            fprintf(stderr, "Unable to write %s\n", out_path);
+            if (file)
+                fclose(file);
+            return false;
+        }
+
+        fclose(file);
+    }
+
+    return true;
+}
+
+static void batch_step(int index, void* userdata)
+{
+    BatchFrame* batch = (BatchFrame*)userdata;
+    BatchInstance& instance = batch->instances[index];
+
+    apply_input(instance.core, *batch->events, instance.next_event, batch->frame, instance.pad_keys);
+
+    int sample_count = 0;
+    instance.core->RunToVBlank(instance.frame_buffer, instance.audio_buffer, &sample_count);
+
+    GS_RuntimeInfo runtime;
+    instance.core->GetRuntimeInfo(runtime);
+    size_t frame_size = (size_t)runtime.screen_width * runtime.screen_height * 4;
+
+    u64 frame_hash = fnv1a(kFnvBasis, instance.frame_buffer, frame_size);
+    instance.video_hash = fnv1a(instance.video_hash, &frame_hash, sizeof(frame_hash));
+    instance.audio_hash = fnv1a(instance.audio_hash, instance.audio_buffer, sample_count * sizeof(s16));
+}
+
+static bool batch_create(const HeadlessOptions& options, std::vector<BatchInstance>& instances)
+{
+    instances.resize(options.batch_instances);
+
+    for (int i = 0; i < options.batch_instances; i++)
+    {
+        BatchInstance& instance = instances[i];
+        instance.core = new GearsystemCore();
+        instance.core->Init(GS_PIXEL_RGBA8888);
+        instance.core->GetProcessor()->EnableDisassembler(false);
+        instance.frame_buffer = new u8[GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN * GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN * 4];
+        instance.audio_buffer = new s16[GS_AUDIO_BUFFER_SIZE];
+        instance.next_event = 0;
+        instance.pad_keys[0] = instance.pad_keys[1] = 0;
+        instance.video_hash = kFnvBasis;
+        instance.audio_hash = kFnvBasis;
+
+        if (!instance.core->LoadROM(options.rom_path))
+        {
+            fprintf(stderr, "Unable to load ROM %s\n", options.rom_path);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void batch_destroy(std::vector<BatchInstance>& instances)
+{
+    for (size_t i = 0; i < instances.size(); i++)
+    {
+        SafeDeleteArray(instances[i].audio_buffer);
+        SafeDeleteArray(instances[i].frame_buffer);
+        SafeDelete(instances[i].core);
+    }
+
+    instances.clear();
+}
+
+static int run_batch(const HeadlessOptions& options, const std::vector<InputEvent>& events)
+{
+    int max_threads = options.batch_threads;
+
+    if (max_threads <= 0)
+        max_threads = (int)std::thread::hardware_concurrency();
+    if (max_threads <= 0)
+        max_threads = 1;
+
+    std::vector<int> levels;
+    for (int t = 1; t < max_threads; t *= 2)
+        levels.push_back(t);
+    levels.push_back(max_threads);
+
+    printf("rom: %s\n", options.rom_path);
+    printf("batch_instances: %d\n", options.batch_instances);
+    printf("batch_frames: %d\n", options.frames);
+
+    std::vector<u64> reference_video;
+    std::vector<u64> reference_audio;
+    double base_rate = 0.0;
+    bool deterministic = true;
+
+    for (size_t l = 0; l < levels.size(); l++)
+    {
+        int threads = levels[l];
+        std::vector<BatchInstance> instances;
+
+        if (!batch_create(options, instances))
+        {
+            batch_destroy(instances);
+            return 1;
+        }
+
+        BatchScheduler scheduler;
+        scheduler.Init(threads);
+
+        BatchFrame batch;
+        batch.instances = &instances[0];
+        batch.events = &events;
+
+        using namespace std::chrono;
+        steady_clock::time_point start = steady_clock::now();
+
+        for (int frame = 0; frame < options.frames; frame++)
+        {
+            batch.frame = frame;
+            scheduler.Run(options.batch_instances, batch_step, &batch);
+        }
+
+        double elapsed_s = duration_cast<nanoseconds>(steady_clock::now() - start).count() / 1e9;
+        double rate = ((double)options.batch_instances * options.frames) / elapsed_s;
+
+        if (l == 0)
+            base_rate = rate;
+
+        for (int i = 0; i < options.batch_instances; i++)
+        {
+            if (l == 0)
+            {
+                reference_video.push_back(instances[i].video_hash);
+                reference_audio.push_back(instances[i].audio_hash);
+            }
+            else if ((instances[i].video_hash != reference_video[i]) || (instances[i].audio_hash != reference_audio[i]))
+                deterministic = false;
+        }
+
+        printf("batch_threads_%d_instance_fps: %.1f\n", threads, rate);
+        printf("batch_threads_%d_speedup: %.2fx\n", threads, rate / base_rate);
+        printf("batch_threads_%d_efficiency: %.1f%%\n", threads, (rate / base_rate) * 100.0 / threads);
+        printf("batch_threads_%d_steals: %llu\n", threads, (unsigned long long)scheduler.GetStealCount());
+
+        batch_destroy(instances);
+    }
+
+    printf("batch_deterministic: %s\n", deterministic ? "yes" : "no");
+
+    return deterministic ? 0 : 1;
+}
+
+static bool report_code_data_log(CodeDataLogger* cdl, const char* path)
+{
+    if (!cdl->Save(path))
+    {
+        fprintf(stderr, "Unable to write the code/data log %s\n", path);
+        return false;
+    }
+
+    u32 rom = cdl->GetSize(CodeDataLogger::RegionROM);
+    u32 code = cdl->Count(CodeDataLogger::RegionROM, CodeDataLogger::FlagCode | CodeDataLogger::FlagOperand);
+    u32 data = cdl->Count(CodeDataLogger::RegionROM, CodeDataLogger::FlagData);
+    u32 logged = cdl->Count(CodeDataLogger::RegionROM, CodeDataLogger::FlagCode | CodeDataLogger::FlagOperand | CodeDataLogger::FlagData);
+
+    printf("cdl_rom_code: %u\n", code);
+    printf("cdl_rom_data: %u\n", data);
+    printf("cdl_rom_coverage: %.2f%%\n", (rom > 0) ? (logged * 100.0 / rom) : 0.0);
+    printf("cdl_jump_targets: %u\n", cdl->Count(CodeDataLogger::RegionROM, CodeDataLogger::FlagJumpTarget));
+    printf("cdl_ram_used: %u\n", cdl->Count(CodeDataLogger::RegionRAM, 0xFF));
+    printf("cdl_vram_used: %u\n", cdl->Count(CodeDataLogger::RegionVRAM, 0xFF));
+
+    return true;
+}
+
+static bool set_trace_trigger(ExecutionTrace* trace, const char* spec, bool start)
+{
+    if (!spec)
+        return true;
+
+    ExecutionTrace::Triggers trigger = ExecutionTrace::TriggerNone;
+    unsigned int value = 0;
+
+    if (strncmp(spec, "pc:", 3) == 0)
+    {
+        trigger = ExecutionTrace::TriggerAddress;
+        value = (unsigned int)strtoul(spec + 3, NULL, 16);
+    }
+    else if (strncmp(spec, "frame:", 6) == 0)
+    {
+        trigger = ExecutionTrace::TriggerFrame;
+        value = (unsigned int)strtoul(spec + 6, NULL, 10);
+    }
+    else if (strcmp(spec, "break") == 0)
+        trigger = ExecutionTrace::TriggerBreakpoint;
+    else
+    {
+        fprintf(stderr, "Invalid trace trigger %s\n", spec);
+        return false;
+    }
+
+    if (start)
+        trace->SetStartTrigger(trigger, value);
+    else
+        trace->SetStopTrigger(trigger, value);
+
+    return true;
+}
+
+static bool report_code_profile(CodeProfiler* profiler, const char* prefix, int frames)
+{
+    std::string callgrind_path = std::string(prefix) + ".callgrind";
+    std::string folded_path = std::string(prefix) + ".folded";
+
+    if (!profiler->ExportCallgrind(callgrind_path.c_str()) || !profiler->ExportFoldedStacks(folded_path.c_str()))
+    {
+        fprintf(stderr, "Unable to write the code profile %s\n", prefix);
+        return false;
+    }
+
+    std::vector<CodeProfiler::stFunction> functions;
+    profiler->GetFunctions(functions);
+
+    double total = profiler->GetTotalCycles() ? (double)profiler->GetTotalCycles() : 1.0;
+
+    printf("code_profile_tstates_per_frame: %.0f\n", profiler->GetTotalCycles() / (double)(frames ? frames : 1));
+
+    for (size_t f = 0; (f < functions.size()) && (f < 10); f++)
+    {
+        printf("code_profile_top_%d: %s self %.1f%% inclusive %.1f%% calls %llu\n", (int)f + 1, functions[f].name.c_str(),
+               functions[f].self_cycles * 100.0 / total, functions[f].inclusive_cycles * 100.0 / total, (unsigned long long)functions[f].calls);
+    }
+
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    HeadlessOptions options;
+    options.rom_path = NULL;
+    options.frames = 0;
+    options.input_path = NULL;
+    options.frames_dir = NULL;
+    options.frames_png = true;
+    options.frames_every = 1;
+    options.wav_path = NULL;
+    options.state_in_path = NULL;
+    options.state_out_path = NULL;
+    options.hash_path = NULL;
+    options.movie_out_path = NULL;
+    options.movie_in_path = NULL;
+    options.keyframe_interval = GS_MOVIE_DEFAULT_KEYFRAME_INTERVAL;
+    options.seek_frame = -1;
+    options.profile = false;
+    options.code_profile_path = NULL;
+    options.symbols_path = NULL;
+    options.trace_path = NULL;
+    options.trace_start = NULL;
+    options.trace_stop = NULL;
+    options.cdl_path = NULL;
+    options.batch_instances = 0;
+    options.batch_threads = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+
+        if ((strcmp(argv[i], "-n") == 0) && has_value)
+            options.frames = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-i") == 0) && has_value)
+            options.input_path = argv[++i];
+        else if ((strcmp(argv[i], "-d") == 0) && has_value)
+            options.frames_dir = argv[++i];
+        else if ((strcmp(argv[i], "-f") == 0) && has_value)
+            options.frames_png = (strcmp(argv[++i], "raw") != 0);
+        else if ((strcmp(argv[i], "-e") == 0) && has_value)
+            options.frames_every = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-w") == 0) && has_value)
+            options.wav_path = argv[++i];
+        else if ((strcmp(argv[i], "-l") == 0) && has_value)
+            options.state_in_path = argv[++i];
+        else if ((strcmp(argv[i], "-s") == 0) && has_value)
+            options.state_out_path = argv[++i];
+        else if ((strcmp(argv[i], "-t") == 0) && has_value)
+            options.hash_path = argv[++i];
+        else if ((strcmp(argv[i], "-M") == 0) && has_value)
+            options.movie_out_path = argv[++i];
+        else if ((strcmp(argv[i], "-m") == 0) && has_value)
+            options.movie_in_path = argv[++i];
+        else if ((strcmp(argv[i], "-k") == 0) && has_value)
+            options.keyframe_interval = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-g") == 0) && has_value)
+            options.seek_frame = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-p") == 0)
+            options.profile = true;
+        else if ((strcmp(argv[i], "-c") == 0) && has_value)
+            options.code_profile_path = argv[++i];
+        else if ((strcmp(argv[i], "-y") == 0) && has_value)
+            options.symbols_path = argv[++i];
+        else if ((strcmp(argv[i], "-x") == 0) && has_value)
+            options.trace_path = argv[++i];
+        else if ((strcmp(argv[i], "-xstart") == 0) && has_value)
+            options.trace_start = argv[++i];
+        else if ((strcmp(argv[i], "-xstop") == 0) && has_value)
+            options.trace_stop = argv[++i];
+        else if ((strcmp(argv[i], "-cdl") == 0) && has_value)
+            options.cdl_path = argv[++i];
+        else if ((strcmp(argv[i], "-b") == 0) && has_value)
+            options.batch_instances = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-j") == 0) && has_value)
+            options.batch_threads = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-h") == 0) || (strcmp(argv[i], "--help") == 0))
+        {
+            usage();
+            return 0;
+        }
+        else if (argv[i][0] != '-')
+            options.rom_path = argv[i];
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if (!options.rom_path || (options.frames < 0) || (options.movie_in_path && options.movie_out_path))
+    {
+        usage();
+        return 1;
+    }
+
+    if (options.frames_every < 1)
+        options.frames_every = 1;
+
+    std::vector<InputEvent> events;
+
+    if (options.input_path && !load_input_script(options.input_path, events))
+        return 1;
+
+    if (options.batch_instances > 0)
+    {
+        if (options.frames == 0)
+            options.frames = 600;
+        return run_batch(options, events);
+    }
+
+    GearsystemCore* core = new GearsystemCore();
+    core->Init(GS_PIXEL_RGBA8888);
+
+    if (!core->LoadROM(options.rom_path))
+    {
+        fprintf(stderr, "Unable to load ROM %s\n", options.rom_path);
+        SafeDelete(core);
+        return 1;
+    }
+
+    if (options.state_in_path)
+    {
+        std::vector<u8> state;
+
+        if (!read_file(options.state_in_path, state) || !core->LoadState(&state[0], state.size()))
+        {
+            fprintf(stderr, "Unable to load save state %s\n", options.state_in_path);
+            SafeDelete(core);
+            return 1;
+        }
+    }
+
+    Movie movie(core);
+    double seek_s = 0.0;
+
+    if (options.movie_in_path)
+    {
+        if (!movie.Load(options.movie_in_path) || !movie.StartPlayback())
+        {
+            fprintf(stderr, "Unable to play movie %s\n", options.movie_in_path);
+            SafeDelete(core);
+            return 1;
+        }
+
+        if (options.seek_frame >= 0)
+        {
+            std::chrono::steady_clock::time_point seek_start = std::chrono::steady_clock::now();
+
+            if (!movie.Seek(options.seek_frame))
+            {
+                fprintf(stderr, "Unable to seek the movie to frame %d\n", options.seek_frame);
+                SafeDelete(core);
+                return 1;
+            }
+
+            seek_s = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - seek_start).count() / 1e9;
+        }
+
+        if (options.frames == 0)
+            options.frames = movie.GetFrameCount() - movie.GetFrame();
+    }
+    else if (options.movie_out_path && !movie.StartRecording(options.keyframe_interval))
+    {
+        fprintf(stderr, "Unable to record a movie\n");
+        SafeDelete(core);
+        return 1;
+    }
+
+    if (options.frames < 1)
+        options.frames = 600;
+
+    WavWriter wav;
+    wav.file = NULL;
+
+    if (options.wav_path && !wav_open(wav, options.wav_path))
+    {
+        SafeDelete(core);
+        return 1;
+    }
+
+    core->EnableProfiling(options.profile);
+
+    CodeProfiler* code_profiler = NULL;
+
+    if (options.code_profile_path)
+    {
+        core->GetProcessor()->EnableCodeProfiler(true);
+        code_profiler = core->GetProcessor()->GetCodeProfiler();
+
+        if (options.symbols_path && !code_profiler->LoadSymbols(options.symbols_path))
+            fprintf(stderr, "Unable to load symbols %s\n", options.symbols_path);
+    }
+
+    ExecutionTrace* trace = NULL;
+
+    if (options.trace_path)
+    {
+        core->GetProcessor()->EnableExecutionTrace(true);
+        trace = core->GetProcessor()->GetExecutionTrace();
+
+        if (!set_trace_trigger(trace, options.trace_start, true) || !set_trace_trigger(trace, options.trace_stop, false))
+        {
+            wav_close(wav);
+            SafeDelete(core);
+            return 1;
+        }
+    }
+
+    CodeDataLogger* cdl = core->GetMemory()->GetCodeDataLogger();
+
+    if (options.cdl_path)
+    {
+        FILE* existing = fopen(options.cdl_path, "rb");
+
+        if (existing)
+        {
+            fclose(existing);
+
+            if (!cdl->Load(options.cdl_path))
+                fprintf(stderr, "Ignoring the code/data log %s\n", options.cdl_path);
+        }
+    }
+
+    FILE* hash_file = NULL;
+
+    if (options.hash_path)
+    {
+        hash_file = fopen(options.hash_path, "w");
+
+        if (!hash_file)
+        {
+            fprintf(stderr, "Unable to open %s\n", options.hash_path);
+            wav_close(wav);
+            SafeDelete(core);
+            return 1;
+        }
+    }
+
+    u8* frame_buffer = new u8[GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN * GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN * 4];
+    s16* audio_buffer = new s16[GS_AUDIO_BUFFER_SIZE];
+
+    u8 pad_keys[2] = { 0, 0 };
+    size_t next_event = 0;
+    u64 video_hash = kFnvBasis;
+    u64 audio_hash = kFnvBasis;
+    u64 frame_hash = 0;
+    u64 audio_samples = 0;
+    u64 emulation_ns = 0;
+    int dumped = 0;
+    bool ok = true;
+
+    using namespace std::chrono;
+    steady_clock::time_point start = steady_clock::now();
+
+    for (int frame = 0; frame < options.frames; frame++)
+    {
+        if (movie.GetMode() == Movie::MoviePlaying)
+        {
+            if (!movie.Update())
+            {
+                options.frames = frame;
+                break;
+            }
+        }
+        else
+        {
+            apply_input(core, events, next_event, frame, pad_keys);
+            movie.Update();
+        }
+
+        int sample_count = 0;
+
+        steady_clock::time_point frame_start = steady_clock::now();
+        core->RunToVBlank(frame_buffer, audio_buffer, &sample_count);
+        emulation_ns += duration_cast<nanoseconds>(steady_clock::now() - frame_start).count();
+
+        GS_RuntimeInfo runtime;
+        core->GetRuntimeInfo(runtime);
+        size_t frame_size = (size_t)runtime.screen_width * runtime.screen_height * 4;
+
+        frame_hash = fnv1a(kFnvBasis, frame_buffer, frame_size);
+        video_hash = fnv1a(video_hash, &frame_hash, sizeof(frame_hash));
+        audio_hash = fnv1a(audio_hash, audio_buffer, sample_count * sizeof(s16));
+        audio_samples += sample_count / 2;
+
+        if (hash_file)
+        {
+            GS_StateHash hash;
+            core->StateHash(hash);
+            fprintf(hash_file, "%d %016llx%016llx\n", frame, (unsigned long long)hash.high, (unsigned long long)hash.low);
+        }
+
+        if (wav.file && (sample_count > 0))
+        {
+            fwrite(audio_buffer, sizeof(s16), sample_count, wav.file);
+            wav.bytes += sample_count * sizeof(s16);
+        }
+
+        if (options.frames_dir && ((frame % options.frames_every) == 0))
+        {
+            if (!dump_frame(options, frame, frame_buffer, runtime.screen_width, runtime.screen_height))
+            {
+                fprintf(stderr, "Unable to write frame %d into %s\n", frame, options.frames_dir);
+                ok = false;
+                break;
+            }
+            dumped++;
+        }
+    }
+
+    double wall_s = duration_cast<nanoseconds>(steady_clock::now() - start).count() / 1e9;
+    double emulation_s = emulation_ns / 1e9;
+
+    wav_close(wav);
+
+    if (hash_file)
+        fclose(hash_file);
+
+    if (options.movie_out_path && !movie.Save(options.movie_out_path))
+    {
+        fprintf(stderr, "Unable to write movie %s\n", options.movie_out_path);
+        ok = false;
+    }
+
+    GS_RuntimeInfo runtime;
+    core->GetRuntimeInfo(runtime);
+    double refresh = (runtime.region == Region_PAL) ? 50.0 : 60.0;
+
+    printf("rom: %s\n", core->GetCartridge()->GetFileName());
+    printf("rom_crc: %08x\n", core->GetCartridge()->GetCRC());
+    printf("frames: %d\n", options.frames);
+    printf("frames_dumped: %d\n", dumped);
+    printf("audio_samples: %llu\n", (unsigned long long)audio_samples);
+    printf("emulation_time_s: %.3f\n", emulation_s);
+    printf("wall_time_s: %.3f\n", wall_s);
+    printf("fps: %.1f\n", options.frames / emulation_s);
+    printf("speed: %.2fx\n", (options.frames / emulation_s) / refresh);
+    printf("frame_hash: %016llx\n", (unsigned long long)frame_hash);
+    printf("video_hash: %016llx\n", (unsigned long long)video_hash);
+    printf("audio_hash: %016llx\n", (unsigned long long)audio_hash);
+
+    GS_StateHash machine_hash;
+    core->StateHash(machine_hash);
+    printf("machine_hash: %016llx%016llx\n", (unsigned long long)machine_hash.high, (unsigned long long)machine_hash.low);
+
+    if (options.movie_in_path || options.movie_out_path)
+    {
+        printf("movie_frames: %d\n", movie.GetFrameCount());
+        printf("movie_keyframes: %d\n", movie.GetKeyframeCount());
+    }
+
+    if (options.movie_in_path)
+    {
+        printf("movie_seek_s: %.3f\n", seek_s);
+        printf("movie_desync_frame: %d\n", movie.GetDesyncFrame());
+    }
+
+    if (options.profile)
+    {
+        GS_FrameProfile profile;
+        core->GetProfile(profile);
+
+        double total = (double)(profile.cpu_ns + profile.video_ns + profile.audio_ns + profile.render_ns);
+        if (total <= 0.0)
+            total = 1.0;
+
+        double frames = profile.frames ? (double)profile.frames : 1.0;
+
+        printf("profile_cpu_us: %.1f (%.1f%%)\n", profile.cpu_ns / frames / 1000.0, profile.cpu_ns * 100.0 / total);
+        printf("profile_video_us: %.1f (%.1f%%)\n", profile.video_ns / frames / 1000.0, profile.video_ns * 100.0 / total);
+        printf("profile_audio_us: %.1f (%.1f%%)\n", profile.audio_ns / frames / 1000.0, profile.audio_ns * 100.0 / total);
+        printf("profile_render_us: %.1f (%.1f%%)\n", profile.render_ns / frames / 1000.0, profile.render_ns * 100.0 / total);
+    }
+
+    if (code_profiler && !report_code_profile(code_profiler, options.code_profile_path, options.frames))
+        ok = false;
+
+    if (trace)
+    {
+        if (trace->Save(options.trace_path))
+        {
+            printf("trace_records: %llu\n", (unsigned long long)trace->GetRecordCount());
+            printf("trace_dropped_accesses: %llu\n", (unsigned long long)trace->GetDroppedAccesses());
+        }
+        else
+        {
+            fprintf(stderr, "Unable to write the trace %s\n", options.trace_path);
+            ok = false;
+        }
+    }
+
+    if (options.cdl_path && !report_code_data_log(cdl, options.cdl_path))
+        ok = false;
+
+    if (!report_state(core, options.state_out_path))
+    {
+        fprintf(stderr, "Unable to save the final state\n");
+        ok = false;
+    }
+
+    SafeDeleteArray(audio_buffer);
+    SafeDeleteArray(frame_buffer);
+    SafeDelete(core);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include "gearsystem.h"
+#include "RomLibrary.h"
+
+// Indexes ROM directories and reports the scan speed. With a cache file
+// only new or modified files are hashed again.
+
+static void usage(void)
+{
+    printf("Usage: gearsystem-library [options] dir...\n");
+    printf("  -c file         cache file, read before and written after the scan\n");
+    printf("  -j n            worker threads (default all cores)\n");
+    printf("  -n              do not scan subdirectories\n");
+    printf("  -l              list the index: crc, rom size, system, mapper, title, path\n");
+    printf("  -r n            scan n times, to measure rescans (default 1)\n");
+    printf("  -t prefix       list the database entries whose title starts with prefix\n");
+}
+
+static const char* system_name(const RomLibrary::Entry& entry)
+{
+    if (entry.sg1000)
+        return "sg";
+    else if (entry.game_gear)
+        return "gg";
+    else
+        return "sms";
+}
+
+static void print_stats(const char* dir, const RomLibrary::Stats& stats)
+{
+    double seconds = (stats.seconds > 0.0) ? stats.seconds : 1e-9;
+
+    printf("%s: %d files, %d hashed, %d cached, %d removed, %d failed, %.1f MB in %.3f s, %.0f files/s, %.1f MB/s\n",
+           dir, stats.files, stats.hashed, stats.cached, stats.removed, stats.failed,
+           stats.bytes / (1024.0 * 1024.0), stats.seconds,
+           stats.files / seconds, stats.bytes / (1024.0 * 1024.0) / seconds);
+}
+
+int main(int argc, char* argv[])
+{
+    const char* cache_path = NULL;
+    int threads = 0;
+    int repeat = 1;
+    bool recursive = true;
+    bool list = false;
+    const char* title_prefix = NULL;
+    std::vector<const char*> dirs;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+
+        if ((strcmp(argv[i], "-c") == 0) && has_value)
+            cache_path = argv[++i];
+        else if ((strcmp(argv[i], "-j") == 0) && has_value)
+            threads = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-r") == 0) && has_value)
+            repeat = atoi(argv[++i]);
+        else if ((strcmp(argv[i], "-t") == 0) && has_value)
+            title_prefix = argv[++i];
+        else if (strcmp(argv[i], "-n") == 0)
+            recursive = false;
+        else if (strcmp(argv[i], "-l") == 0)
+            list = true;
+        else if ((strcmp(argv[i], "-h") == 0) || (strcmp(argv[i], "--help") == 0))
+        {
+            usage();
+            return 0;
+        }
+        else if (argv[i][0] != '-')
+            dirs.push_back(argv[i]);
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if (title_prefix)
+    {
+        std::vector<const GS_GameDBEntry*> results;
+        Cartridge::FindDBEntriesByTitle(title_prefix, results);
+
+        for (size_t i = 0; i < results.size(); i++)
+            printf("%08X\t%d\t0x%02X\t%s\n", results[i]->crc, results[i]->mapper, results[i]->features, results[i]->title);
+
+        if (dirs.empty())
+            return 0;
+    }
+
+    if (dirs.empty() || (repeat < 1))
+    {
+        usage();
+        return 1;
+    }
+
+    RomLibrary library;
+    library.Init(threads);
+
+    if (cache_path && library.LoadCache(cache_path))
+        printf("cache: %d entries\n", library.GetEntryCount());
+
+    int ret = 0;
+
+    for (int r = 0; r < repeat; r++)
+    {
+        for (size_t i = 0; i < dirs.size(); i++)
+        {
+            if (library.Scan(dirs[i], recursive))
+                print_stats(dirs[i], library.GetStats());
+            else
+            {
+                fprintf(stderr, "Unable to scan %s\n", dirs[i]);
+                ret = 1;
+            }
+        }
+    }
+
+    if (list)
+    {
+        for (int i = 0; i < library.GetEntryCount(); i++)
+        {
+            const RomLibrary::Entry& entry = library.GetEntry(i);
+
+            if (entry.valid)
+                printf("%08X\t%d\t%s\t%d\t%s\t%s\n", entry.crc, entry.rom_size, system_name(entry),
+                       entry.db ? entry.db->mapper : -1, entry.db ? entry.db->title : "-", entry.path.c_str());
+            else
+                printf("--------\t0\t-\t-1\t-\t%s\n", entry.path.c_str());
+        }
+    }
+
+    if (cache_path && !library.SaveCache(cache_path))
+    {
+        fprintf(stderr, "Unable to write %s\n", cache_path);
+        ret = 1;
+    }
+
+    return ret;
+}
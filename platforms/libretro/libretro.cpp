@@ -62,6 +62,9 @@ static Video::LightPhaserCrosshairColor lightgun_crosshair_color = Video::LightP
 static int paddle_sensitivity = 0;
 static bool bootrom_sms = false;
 static bool bootrom_gg = false;
+static int runahead_frames = 0;
+static bool runahead_second_instance = false;
+static int runahead_report_counter = 0;
 static bool libretro_supports_bitmasks;
 static float aspect_ratio = 0.0f;
 static int current_screen_width = 0;
@@ -254,6 +257,16 @@ void retro_run(void)
     audio_sample_count = 0;
     core->RunToVBlank(frame_buffer, audio_buf, &audio_sample_count);
 
+    GS_RunAheadStats runahead_stats;
+
+    if (core->GetRunAheadStats(runahead_stats) && (++runahead_report_counter >= 600))
+    {
+        runahead_report_counter = 0;
+        log_cb(RETRO_LOG_DEBUG, "Run-ahead %d frames: %d us/frame (save %d, load %d, ahead %d), %.1f%% of frame budget\n",
+                runahead_stats.frames, runahead_stats.average_total_us, runahead_stats.save_us,
+                runahead_stats.load_us, runahead_stats.ahead_us, runahead_stats.budget_usage * 100.0f);
+    }
+
     GS_RuntimeInfo runtime_info;
     core->GetRuntimeInfo(runtime_info);
 
@@ -336,9 +349,7 @@ bool retro_load_game_special(unsigned game_type, const struct retro_game_info *i
 
 size_t retro_serialize_size(void)
 {
-    size_t size = 0;
-    core->SaveState(NULL, size);
-    return size;
+    return core->GetStateSize();
 }
 
 bool retro_serialize(void *data, size_t size)
@@ -609,6 +620,8 @@ static void set_variabless(void)
         { "gearsystem_lightgun_crosshair_offset_x", "Light Gun Crosshair Offset X; 0|-10|-9|-8|-7|-6|-5|-4|-3|-2|-1|0|1|2|3|4|5|6|7|8|9|10" },
         { "gearsystem_lightgun_crosshair_offset_y", "Light Gun Crosshair Offset Y; 0|-10|-9|-8|-7|-6|-5|-4|-3|-2|-1|0|1|2|3|4|5|6|7|8|9|10" },
         { "gearsystem_paddle_sensitivity", "Paddle Sensitivity; 1|2|3|4|5|6|7|8|9|10|11|12|13|14|15" },
+        { "gearsystem_runahead", "Internal Run-Ahead; Disabled|1 frame|2 frames|3 frames|4 frames" },
+        { "gearsystem_runahead_mode", "Internal Run-Ahead Mode; Single Instance|Second Instance" },
         
         { NULL }
     };
@@ -896,4 +909,28 @@ static void check_variables(void)
 
         core->SetGlassesConfig(glasses_config);
     }
+
+    var.key = "gearsystem_runahead";
+    var.value = NULL;
+
+    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+    {
+        if (strcmp(var.value, "Disabled") == 0)
+            runahead_frames = 0;
+        else
+            runahead_frames = atoi(var.value);
+    }
+
+    var.key = "gearsystem_runahead_mode";
+    var.value = NULL;
+
+    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+    {
+        if (strcmp(var.value, "Second Instance") == 0)
+            runahead_second_instance = true;
+        else
+            runahead_second_instance = false;
+    }
+
+    core->SetRunAhead(runahead_frames, runahead_second_instance);
 }
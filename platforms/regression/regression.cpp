@@ -0,0 +1,710 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <errno.h>
+#include <sys/stat.h>
+#if defined(_WIN32)
+#include <direct.h>
+#endif
+#include "gearsystem.h"
+#include "BatchScheduler.h"
+
+// Runs every ROM of a manifest, optionally driven by an input movie, and
+// compares the video, audio and machine state hashes at the checkpoints
+// against the golden files. Manifest lines:
+//
+//   <name> <rom> <movie|-> <frames> <checkpoint interval>
+//
+// Paths are relative to the manifest. A frame count of 0 plays the whole
+// movie. Golden files are <golden dir>/<name>.golden.
+//
+// A ROM written as @<board>[:<KB>] is not read from disk: a synthetic ROM of
+// that size (256 KB by default) is built and loaded with the board forced.
+// Its program copies itself to RAM and then keeps writing pseudo random
+// values into every known mapper register, sampling all the 8 KB regions
+// into VRAM and RAM after each write.
+
+struct RegressionOptions
+{
+    const char* manifest_path;
+    const char* golden_dir;
+    const char* report_path;
+    bool update;
+    int threads;
+};
+
+struct Checkpoint
+{
+    int frame;
+    u64 video_hash;
+    u64 audio_hash;
+    GS_StateHash state_hash;
+};
+
+enum EntryResult
+{
+    Entry_Pass,
+    Entry_Fail,
+    Entry_New,
+    Entry_Updated,
+    Entry_Error
+};
+
+struct RegressionEntry
+{
+    std::string name;
+    std::string rom_path;
+    std::string movie_path;
+    int frames;
+    int interval;
+    std::vector<Checkpoint> checkpoints;
+    EntryResult result;
+    std::string message;
+    double seconds;
+};
+
+struct RegressionRun
+{
+    const RegressionOptions* options;
+    std::vector<RegressionEntry>* entries;
+};
+
+struct BoardName
+{
+    const char* name;
+    Cartridge::CartridgeTypes type;
+};
+
+static const BoardName kBoardNames[] =
+{
+    { "rom_only", Cartridge::CartridgeRomOnlyMapper },
+    { "sega", Cartridge::CartridgeSegaMapper },
+    { "codemasters", Cartridge::CartridgeCodemastersMapper },
+    { "sg1000", Cartridge::CartridgeSG1000Mapper },
+    { "korean", Cartridge::CartridgeKoreanMapper },
+    { "korean_msx_sms_8000", Cartridge::CartridgeKoreanMSXSMS8000Mapper },
+    { "korean_sms_32kb_2000", Cartridge::CartridgeKoreanSMS32KB2000Mapper },
+    { "korean_msx_32kb_2000", Cartridge::CartridgeKoreanMSX32KB2000Mapper },
+    { "korean_2000_xor_1f", Cartridge::CartridgeKorean2000XOR1FMapper },
+    { "korean_msx_8kb_0300", Cartridge::CartridgeKoreanMSX8KB0300Mapper },
+    { "korean_0000_xor_ff", Cartridge::CartridgeKorean0000XORFFMapper },
+    { "korean_ffff_hicom", Cartridge::CartridgeKoreanFFFFHiComMapper },
+    { "korean_fffe", Cartridge::CartridgeKoreanFFFEMapper },
+    { "korean_bffc", Cartridge::CartridgeKoreanBFFCMapper },
+    { "korean_fff3_fffc", Cartridge::CartridgeKoreanFFF3FFFCMapper },
+    { "korean_md_fff5", Cartridge::CartridgeKoreanMDFFF5Mapper },
+    { "msx", Cartridge::CartridgeMSXMapper },
+    { "janggun", Cartridge::CartridgeJanggunMapper },
+    { "multi_4pak", Cartridge::CartridgeMulti4PAKAllActionMapper },
+    { "jumbo_dahjee", Cartridge::CartridgeJumboDahjeeMapper }
+};
+
+// Copied to the start of every 8 KB bank, so it runs whatever the board maps
+// at 0x0000 on reset. Moves the program at offset 0x100 into RAM at 0xC000.
+static const u8 kBoardRomBoot[] =
+{
+    0xF3,                   // di
+    0xED, 0x56,             // im 1
+    0x31, 0xF0, 0xC3,       // ld sp,0xC3F0
+    0x21, 0x00, 0x01,       // ld hl,0x0100
+    0x11, 0x00, 0xC0,       // ld de,0xC000
+    0x01, 0x00, 0x01,       // ld bc,0x0100
+    0xED, 0xB0,             // ldir
+    0xC3, 0x00, 0xC0        // jp 0xC000
+};
+
+// Runs at 0xC000, followed by the register table. Everything lives in the
+// first KB of RAM so the SG-1000 mirror does not overlap it.
+static const u8 kBoardRomProgram[] =
+{
+    0x3E, 0x04, 0xD3, 0xBF, // ld a,0x04 / out (0xBF),a
+    0x3E, 0x80, 0xD3, 0xBF, // ld a,0x80 / out (0xBF),a: mode 4
+    0x3E, 0x40, 0xD3, 0xBF, // ld a,0x40 / out (0xBF),a
+    0x3E, 0x81, 0xD3, 0xBF, // ld a,0x81 / out (0xBF),a: display on
+    0xAF, 0xD3, 0xBF,       // xor a / out (0xBF),a
+    0x3E, 0xC0, 0xD3, 0xBF, // ld a,0xC0 / out (0xBF),a: CRAM write at 0x00
+    0x06, 0x20,             // ld b,32
+    0x78, 0xD3, 0xBE,       // ld a,b / out (0xBE),a
+    0x10, 0xFB,             // djnz $-3
+    0xAF, 0xD3, 0xBF,       // xor a / out (0xBF),a
+    0x3E, 0x40, 0xD3, 0xBF, // ld a,0x40 / out (0xBF),a: VRAM write at 0x0000
+    0x3E, 0x5A,             // ld a,0x5A
+    0x32, 0x00, 0xC2,       // ld (0xC200),a: random seed
+    // loop: 0xC02A
+    0xDD, 0x21, 0x71, 0xC0, // ld ix,table
+    0x06, 0x00,             // ld b,<register count>
+    // next: 0xC030
+    0xDD, 0x5E, 0x00,       // ld e,(ix+0)
+    0xDD, 0x56, 0x01,       // ld d,(ix+1)
+    0xCD, 0x65, 0xC0,       // call random
+    0xDD, 0xA6, 0x02,       // and (ix+2)
+    0x12,                   // ld (de),a
+    0x11, 0x03, 0x00,       // ld de,3
+    0xDD, 0x19,             // add ix,de
+    0xCD, 0x65, 0xC0,       // call random
+    0x6F,                   // ld l,a
+    0xCD, 0x65, 0xC0,       // call random
+    0xE6, 0x1F,             // and 0x1F
+    0x67,                   // ld h,a
+    0x0E, 0x06,             // ld c,6
+    // sample: 0xC04E
+    0x5E,                   // ld e,(hl)
+    0x7B,                   // ld a,e
+    0xD3, 0xBE,             // out (0xBE),a
+    0x3A, 0x01, 0xC2,       // ld a,(0xC201)
+    0x07,                   // rlca
+    0xAB,                   // xor e
+    0x32, 0x01, 0xC2,       // ld (0xC201),a: checksum
+    0x7C,                   // ld a,h
+    0xC6, 0x20,             // add a,0x20
+    0x67,                   // ld h,a
+    0x0D,                   // dec c
+    0x20, 0xED,             // jr nz,sample
+    0x10, 0xCD,             // djnz next
+    0x18, 0xC5,             // jr loop
+    // random: 0xC065
+    0x3A, 0x00, 0xC2,       // ld a,(0xC200)
+    0x87,                   // add a,a
+    0x30, 0x02,             // jr nc,$+4
+    0xEE, 0x1D,             // xor 0x1D
+    0x32, 0x00, 0xC2,       // ld (0xC200),a
+    0xC9                    // ret
+    // table: 0xC071
+};
+
+static const int kBoardRomCountOffset = 0x2F;
+
+// Address and value mask of every register of every board, plus addresses
+// no board decodes. 0xFFFC never maps cartridge RAM over the program.
+static const u16 kBoardRomRegisters[][2] =
+{
+    { 0x0000, 0xFF }, { 0x0001, 0xFF }, { 0x0002, 0xFF }, { 0x0003, 0xFF }, { 0x0100, 0xFF }, { 0x0155, 0xFF },
+    { 0x0200, 0xFF }, { 0x02FF, 0xFF }, { 0x0300, 0xFF }, { 0x2000, 0xFF }, { 0x2345, 0xFF }, { 0x3000, 0xFF },
+    { 0x3ABC, 0xFF }, { 0x3FFE, 0xFF }, { 0x4000, 0xFF }, { 0x6000, 0xFF }, { 0x7FFF, 0xFF }, { 0x8000, 0xFF },
+    { 0x8123, 0xFF }, { 0xA000, 0xFF }, { 0xA123, 0xFF }, { 0xA800, 0xFF }, { 0xB000, 0xFF }, { 0xBFE5, 0xFF },
+    { 0xBFEE, 0xFF }, { 0xBFEF, 0xFF }, { 0xBFF3, 0xFF }, { 0xBFFC, 0xFF }, { 0xBFFF, 0xFF }, { 0xFFF3, 0xFF },
+    { 0xFFF5, 0xFF }, { 0xFFF8, 0xFF }, { 0xFFFA, 0xFF }, { 0xFFFC, 0x0C }, { 0xFFFD, 0xFF }, { 0xFFFE, 0xFF },
+    { 0xFFFF, 0xFF }
+};
+
+static const char* const kResultNames[] = { "PASS", "FAIL", "NEW", "UPDATED", "ERROR" };
+
+static const u64 kFnvBasis = 0xCBF29CE484222325ULL;
+
+static u64 fnv1a(u64 hash, const void* data, size_t size)
+{
+    const u8* p = (const u8*)data;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= p[i];
+        hash *= 0x100000001B3ULL;
+    }
+
+    return hash;
+}
+
+static bool build_board_rom(const std::string& spec, std::vector<u8>& rom, Cartridge::ForceConfiguration& config)
+{
+    std::string name = spec.substr(1);
+    int size_kb = 256;
+    size_t colon = name.find(':');
+
+    if (colon != std::string::npos)
+    {
+        size_kb = atoi(name.c_str() + colon + 1);
+        name = name.substr(0, colon);
+    }
+
+    const int board_count = sizeof(kBoardNames) / sizeof(kBoardNames[0]);
+    int board = 0;
+
+    while ((board < board_count) && (name != kBoardNames[board].name))
+        board++;
+
+    if ((board == board_count) || (size_kb < 8) || (size_kb > 4096) || ((size_kb & (size_kb - 1)) != 0))
+        return false;
+
+    rom.resize(size_kb * 0x400);
+
+    for (size_t i = 0; i < rom.size(); i++)
+        rom[i] = (u8)((((i >> 13) + 1) * 0x45) ^ (i * 7) ^ (i >> 8));
+
+    for (size_t bank = 0; bank < rom.size(); bank += 0x2000)
+    {
+        u8* program = &rom[bank + 0x100];
+        memcpy(&rom[bank], kBoardRomBoot, sizeof(kBoardRomBoot));
+        memcpy(program, kBoardRomProgram, sizeof(kBoardRomProgram));
+
+        const int register_count = sizeof(kBoardRomRegisters) / sizeof(kBoardRomRegisters[0]);
+        u8* table = program + sizeof(kBoardRomProgram);
+        program[kBoardRomCountOffset] = (u8)register_count;
+
+        for (int r = 0; r < register_count; r++)
+        {
+            table[(r * 3) + 0] = kBoardRomRegisters[r][0] & 0xFF;
+            table[(r * 3) + 1] = kBoardRomRegisters[r][0] >> 8;
+            table[(r * 3) + 2] = (u8)kBoardRomRegisters[r][1];
+        }
+    }
+
+    config.type = kBoardNames[board].type;
+    config.zone = Cartridge::CartridgeUnknownZone;
+    config.region = Cartridge::CartridgeUnknownRegion;
+    config.system = (config.type == Cartridge::CartridgeSG1000Mapper) ? Cartridge::CartridgeSG1000 : Cartridge::CartridgeSMS;
+
+    return true;
+}
+
+static void usage(void)
+{
+    printf("Usage: gearsystem-regression [options] manifest\n");
+    printf("  -g dir          golden files directory (default: golden next to the manifest)\n");
+    printf("  -u              write the golden files instead of comparing\n");
+    printf("  -j n            worker threads (default all cores)\n");
+    printf("  -o file         write the report into file\n");
+}
+
+static std::string directory_of(const char* path)
+{
+    std::string s = path;
+    size_t slash = s.find_last_of("/\\");
+
+    return (slash == std::string::npos) ? std::string(".") : s.substr(0, slash);
+}
+
+static std::string join_path(const std::string& dir, const char* path)
+{
+    if ((path[0] == '/') || (path[0] == '\\') || ((path[0] != 0) && (path[1] == ':')))
+        return path;
+
+    return dir + "/" + path;
+}
+
+static bool make_directory(const char* path)
+{
+#if defined(_WIN32)
+    int ret = _mkdir(path);
+#else
+    int ret = mkdir(path, 0755);
+#endif
+    return (ret == 0) || (errno == EEXIST);
+}
+
+static bool load_manifest(const char* path, std::vector<RegressionEntry>& entries)
+{
+    FILE* file = fopen(path, "r");
+
+    if (!file)
+    {
+        fprintf(stderr, "Unable to open manifest %s\n", path);
+        return false;
+    }
+
+    std::string dir = directory_of(path);
+    char line[1024];
+    int line_number = 0;
+
+    while (fgets(line, sizeof(line), file))
+    {
+        line_number++;
+
+        char* comment = strchr(line, '#');
+        if (comment)
+            *comment = 0;
+
+        char name[256], rom[512], movie[512];
+        int frames, interval;
+        int fields = sscanf(line, "%255s %511s %511s %d %d", name, rom, movie, &frames, &interval);
+
+        if (fields <= 0)
+            continue;
+
+        if ((fields != 5) || (frames < 0) || (interval < 1) || ((frames == 0) && (strcmp(movie, "-") == 0)))
+        {
+            fprintf(stderr, "Invalid manifest line %d: %s\n", line_number, line);
+            fclose(file);
+            return false;
+        }
+
+        RegressionEntry entry;
+        entry.name = name;
+        entry.rom_path = (rom[0] == '@') ? std::string(rom) : join_path(dir, rom);
+        entry.movie_path = (strcmp(movie, "-") == 0) ? std::string() : join_path(dir, movie);
+        entry.frames = frames;
+        entry.interval = interval;
+        entry.result = Entry_Error;
+        entry.seconds = 0.0;
+        entries.push_back(entry);
+    }
+
+    fclose(file);
+    return true;
+}
+
+static bool load_golden(const std::string& path, std::vector<Checkpoint>& checkpoints)
+{
+    FILE* file = fopen(path.c_str(), "r");
+
+    if (!file)
+        return false;
+
+    char line[256];
+
+    while (fgets(line, sizeof(line), file))
+    {
+        Checkpoint checkpoint;
+        unsigned long long video, audio, high, low;
+
+        if (sscanf(line, "%d %llx %llx %16llx%16llx", &checkpoint.frame, &video, &audio, &high, &low) != 5)
+            continue;
+
+        checkpoint.video_hash = video;
+        checkpoint.audio_hash = audio;
+        checkpoint.state_hash.high = high;
+        checkpoint.state_hash.low = low;
+        checkpoints.push_back(checkpoint);
+    }
+
+    fclose(file);
+    return true;
+}
+
+static bool save_golden(const std::string& path, const std::vector<Checkpoint>& checkpoints)
+{
+    FILE* file = fopen(path.c_str(), "w");
+
+    if (!file)
+        return false;
+
+    fprintf(file, "# frame video audio state\n");
+
+    for (size_t i = 0; i < checkpoints.size(); i++)
+    {
+        const Checkpoint& c = checkpoints[i];
+        fprintf(file, "%d %016llx %016llx %016llx%016llx\n", c.frame, (unsigned long long)c.video_hash, (unsigned long long)c.audio_hash,
+                (unsigned long long)c.state_hash.high, (unsigned long long)c.state_hash.low);
+    }
+
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+static bool run_entry(RegressionEntry& entry)
+{
+    GearsystemCore* core = new GearsystemCore();
+    core->Init(GS_PIXEL_RGBA8888);
+
+    bool loaded;
+
+    if (entry.rom_path[0] == '@')
+    {
+        std::vector<u8> rom;
+        Cartridge::ForceConfiguration config;
+
+        loaded = build_board_rom(entry.rom_path, rom, config) &&
+                core->LoadROMFromBuffer(&rom[0], (int)rom.size(), &config, "board.sms");
+    }
+    else
+        loaded = core->LoadROM(entry.rom_path.c_str());
+
+    if (!loaded)
+    {
+        entry.message = "unable to load " + entry.rom_path;
+        SafeDelete(core);
+        return false;
+    }
+
+    Movie movie(core);
+
+    if (!entry.movie_path.empty())
+    {
+        if (!movie.Load(entry.movie_path.c_str()) || !movie.StartPlayback())
+        {
+            entry.message = "unable to play " + entry.movie_path;
+            SafeDelete(core);
+            return false;
+        }
+
+        if (entry.frames == 0)
+            entry.frames = movie.GetFrameCount();
+    }
+
+    u8* frame_buffer = new u8[GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN * GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN * 4];
+    s16* audio_buffer = new s16[GS_AUDIO_BUFFER_SIZE];
+    u64 audio_hash = kFnvBasis;
+    bool ok = true;
+
+    for (int frame = 0; frame < entry.frames; frame++)
+    {
+        if ((movie.GetMode() == Movie::MoviePlaying) && !movie.Update())
+        {
+            entry.message = "movie ended before the last frame";
+            ok = false;
+            break;
+        }
+
+        int sample_count = 0;
+        core->RunToVBlank(frame_buffer, audio_buffer, &sample_count);
+        audio_hash = fnv1a(audio_hash, audio_buffer, sample_count * sizeof(s16));
+
+        bool last = (frame == (entry.frames - 1));
+
+        if (!last && (((frame + 1) % entry.interval) != 0))
+            continue;
+
+        GS_RuntimeInfo runtime;
+        core->GetRuntimeInfo(runtime);
+
+        Checkpoint checkpoint;
+        checkpoint.frame = frame;
+        checkpoint.video_hash = fnv1a(kFnvBasis, frame_buffer, (size_t)runtime.screen_width * runtime.screen_height * 4);
+        checkpoint.audio_hash = audio_hash;
+        core->StateHash(checkpoint.state_hash);
+        entry.checkpoints.push_back(checkpoint);
+    }
+
+    if (ok && (movie.GetDesyncFrame() >= 0))
+    {
+        char text[64];
+        snprintf(text, sizeof(text), "movie desync at frame %d", movie.GetDesyncFrame());
+        entry.message = text;
+        ok = false;
+    }
+
+    SafeDeleteArray(audio_buffer);
+    SafeDeleteArray(frame_buffer);
+    SafeDelete(core);
+
+    return ok;
+}
+
+static void compare_entry(RegressionEntry& entry, const std::vector<Checkpoint>& golden)
+{
+    for (size_t i = 0; i < entry.checkpoints.size(); i++)
+    {
+        const Checkpoint& actual = entry.checkpoints[i];
+
+        if (i >= golden.size() || (golden[i].frame != actual.frame))
+        {
+            entry.result = Entry_Fail;
+            entry.message = "checkpoints differ from the golden file";
+            return;
+        }
+
+        std::string what;
+
+        if (golden[i].video_hash != actual.video_hash)
+            what += " video";
+        if (golden[i].audio_hash != actual.audio_hash)
+            what += " audio";
+        if ((golden[i].state_hash.high != actual.state_hash.high) || (golden[i].state_hash.low != actual.state_hash.low))
+            what += " state";
+
+        if (!what.empty())
+        {
+            char text[64];
+            snprintf(text, sizeof(text), "frame %d:", actual.frame);
+            entry.result = Entry_Fail;
+            entry.message = text + what;
+            return;
+        }
+    }
+
+    entry.result = (golden.size() == entry.checkpoints.size()) ? Entry_Pass : Entry_Fail;
+
+    if (entry.result == Entry_Fail)
+        entry.message = "checkpoints differ from the golden file";
+}
+
+static void run_task(int index, void* userdata)
+{
+    RegressionRun* run = (RegressionRun*)userdata;
+    RegressionEntry& entry = (*run->entries)[index];
+    const RegressionOptions& options = *run->options;
+
+    using namespace std::chrono;
+    steady_clock::time_point start = steady_clock::now();
+
+    std::string golden_path = std::string(options.golden_dir) + "/" + entry.name + ".golden";
+
+    if (!run_entry(entry))
+        entry.result = Entry_Error;
+    else if (options.update)
+    {
+        entry.result = save_golden(golden_path, entry.checkpoints) ? Entry_Updated : Entry_Error;
+
+        if (entry.result == Entry_Error)
+            entry.message = "unable to write " + golden_path;
+    }
+    else
+    {
+        std::vector<Checkpoint> golden;
+
+        if (!load_golden(golden_path, golden))
+        {
+            entry.result = Entry_New;
+            entry.message = "no golden file, run with -u";
+        }
+        else
+        {
+            compare_entry(entry, golden);
+
+            // Keep what this run produced next to the golden file for diffing
+            if (entry.result == Entry_Fail)
+                save_golden(golden_path + ".actual", entry.checkpoints);
+        }
+    }
+
+    entry.seconds = duration_cast<nanoseconds>(steady_clock::now() - start).count() / 1e9;
+}
+
+static void write_report(FILE* file, const std::vector<RegressionEntry>& entries, int threads, double seconds)
+{
+    int counts[5] = { 0, 0, 0, 0, 0 };
+    long long frames = 0;
+
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        const RegressionEntry& entry = entries[i];
+        counts[entry.result]++;
+        frames += entry.frames;
+
+        fprintf(file, "%-8s %-24s %6d frames %7.2fs", kResultNames[entry.result], entry.name.c_str(), entry.frames, entry.seconds);
+
+        if (!entry.message.empty())
+            fprintf(file, "  %s", entry.message.c_str());
+
+        fprintf(file, "\n");
+    }
+
+    fprintf(file, "\n");
+    fprintf(file, "entries: %d\n", (int)entries.size());
+    fprintf(file, "passed: %d\n", counts[Entry_Pass]);
+    fprintf(file, "failed: %d\n", counts[Entry_Fail]);
+    fprintf(file, "new: %d\n", counts[Entry_New]);
+    fprintf(file, "updated: %d\n", counts[Entry_Updated]);
+    fprintf(file, "errors: %d\n", counts[Entry_Error]);
+    fprintf(file, "threads: %d\n", threads);
+    fprintf(file, "wall_time_s: %.3f\n", seconds);
+    fprintf(file, "fps: %.1f\n", seconds > 0.0 ? frames / seconds : 0.0);
+}
+
+int main(int argc, char* argv[])
+{
+    RegressionOptions options;
+    options.manifest_path = NULL;
+    options.golden_dir = NULL;
+    options.report_path = NULL;
+    options.update = false;
+    options.threads = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+
+        if ((strcmp(argv[i], "-g") == 0) && has_value)
+            options.golden_dir = argv[++i];
+        else if ((strcmp(argv[i], "-o") == 0) && has_value)
+            options.report_path = argv[++i];
+        else if ((strcmp(argv[i], "-j") == 0) && has_value)
+            options.threads = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-u") == 0)
+            options.update = true;
+        else if ((strcmp(argv[i], "-h") == 0) || (strcmp(argv[i], "--help") == 0))
+        {
+            usage();
+            return 0;
+        }
+        else if (argv[i][0] != '-')
+            options.manifest_path = argv[i];
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if (!options.manifest_path)
+    {
+        usage();
+        return 1;
+    }
+
+    std::vector<RegressionEntry> entries;
+
+    if (!load_manifest(options.manifest_path, entries))
+        return 1;
+
+    std::string golden_dir = directory_of(options.manifest_path) + "/golden";
+
+    if (!options.golden_dir)
+        options.golden_dir = golden_dir.c_str();
+
+    if (options.update && !make_directory(options.golden_dir))
+    {
+        fprintf(stderr, "Unable to create %s\n", options.golden_dir);
+        return 1;
+    }
+
+    BatchScheduler scheduler;
+    scheduler.Init(options.threads);
+
+    RegressionRun run;
+    run.options = &options;
+    run.entries = &entries;
+
+    using namespace std::chrono;
+    steady_clock::time_point start = steady_clock::now();
+
+    scheduler.Run((int)entries.size(), run_task, &run);
+
+    double seconds = duration_cast<nanoseconds>(steady_clock::now() - start).count() / 1e9;
+
+    write_report(stdout, entries, scheduler.GetThreadCount(), seconds);
+
+    if (options.report_path)
+    {
+        FILE* report = fopen(options.report_path, "w");
+
+        if (!report)
+        {
+            fprintf(stderr, "Unable to create %s\n", options.report_path);
+            return 1;
+        }
+
+        write_report(report, entries, scheduler.GetThreadCount(), seconds);
+        fclose(report);
+    }
+
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        if ((entries[i].result == Entry_Fail) || (entries[i].result == Entry_Error) || (entries[i].result == Entry_New))
+            return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,224 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "StateSerializer.h"
+
+struct MappedFile
+{
+    const u8* data;
+    size_t size;
+};
+
+static bool map_file(const char* path, MappedFile& file)
+{
+    file.data = NULL;
+    file.size = 0;
+
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+
+    if ((fstat(fd, &st) != 0) || (st.st_size == 0))
+    {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+        return false;
+
+    file.data = (const u8*)data;
+    file.size = st.st_size;
+
+    return true;
+}
+
+static void unmap_file(MappedFile& file)
+{
+    if (file.data)
+        munmap((void*)file.data, file.size);
+
+    file.data = NULL;
+    file.size = 0;
+}
+
+static u32 parse_chunk_id(const char* name)
+{
+    char id[4] = { ' ', ' ', ' ', ' ' };
+
+    for (int i = 0; (i < 4) && name[i]; i++)
+        id[i] = name[i];
+
+    return GS_STATE_CHUNK_ID(id[0], id[1], id[2], id[3]);
+}
+
+static std::string chunk_name(u32 id)
+{
+    std::string name;
+
+    for (int i = 0; i < 4; i++)
+    {
+        char c = (char)((id >> (i * 8)) & 0xFF);
+        if (c != ' ')
+            name += c;
+    }
+
+    return name;
+}
+
+static bool open_state(const char* path, MappedFile& file, StateContainer& container)
+{
+    if (!map_file(path, file))
+    {
+        fprintf(stderr, "%s: unable to map file\n", path);
+        return false;
+    }
+
+    if (!StateContainer::IsContainer(file.data, file.size))
+    {
+        fprintf(stderr, "%s: legacy or unknown state format, load and save it once to upgrade\n", path);
+        unmap_file(file);
+        return false;
+    }
+
+    if (!container.Open(file.data, file.size))
+    {
+        fprintf(stderr, "%s: corrupted state container\n", path);
+        unmap_file(file);
+        return false;
+    }
+
+    return true;
+}
+
+static int list_states(int count, char* paths[])
+{
+    int errors = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        MappedFile file;
+        StateContainer container;
+
+        if (!open_state(paths[i], file, container))
+        {
+            errors++;
+            continue;
+        }
+
+        const GS_StateHeader* header = container.GetHeader();
+        printf("%s: version %d, %u bytes, ROM CRC %08X\n", paths[i], header->version, header->size, header->rom_crc);
+
+        for (int c = 0; c < container.GetChunkCount(); c++)
+        {
+            const GS_StateChunk* chunk = container.GetChunk(c);
+            printf("  %-4s v%u %8u bytes at offset %zu\n", chunk_name(chunk->id).c_str(), chunk->version, chunk->size, (size_t)(chunk->data - file.data));
+        }
+
+        unmap_file(file);
+    }
+
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static int extract_chunk(const char* name, const char* output_dir, int count, char* paths[])
+{
+    u32 id = parse_chunk_id(name);
+    int errors = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        MappedFile file;
+        StateContainer container;
+
+        if (!open_state(paths[i], file, container))
+        {
+            errors++;
+            continue;
+        }
+
+        const GS_StateChunk* chunk = container.FindChunk(id);
+
+        if (chunk)
+        {
+            std::string base = paths[i];
+            size_t slash = base.find_last_of("/\\");
+            if (slash != std::string::npos)
+                base = base.substr(slash + 1);
+
+            std::string out_path = std::string(output_dir) + "/" + base + "." + chunk_name(id);
+            FILE* out = fopen(out_path.c_str(), "wb");
+
+            if (out && (fwrite(chunk->data, 1, chunk->size, out) == chunk->size))
+            {
+                printf("%s\n", out_path.c_str());
+            }
+            else
+            {
+                fprintf(stderr, "%s: unable to write\n", out_path.c_str());
+                errors++;
+            }
+
+            if (out)
+                fclose(out);
+        }
+        else
+        {
+            fprintf(stderr, "%s: no '%s' section\n", paths[i], name);
+            errors++;
+        }
+
+        unmap_file(file);
+    }
+
+    return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static void usage(void)
+{
+    printf("Usage: gearsystem-statetool list <state> [state ...]\n");
+    printf("       gearsystem-statetool extract <section> <output_dir> <state> [state ...]\n");
+    printf("Sections: RAM CPU PSG OPLL VRAM CRAM VDP INPT MAPR IO\n");
+}
+
+int main(int argc, char* argv[])
+{
+    if ((argc >= 3) && (strcmp(argv[1], "list") == 0))
+        return list_states(argc - 2, argv + 2);
+
+    if ((argc >= 5) && (strcmp(argv[1], "extract") == 0))
+        return extract_chunk(argv[2], argv[3], argc - 4, argv + 4);
+
+    usage();
+    return EXIT_FAILURE;
+}
@@ -0,0 +1,312 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "definitions.h"
+#include "ExecutionTrace.h"
+#include "opcode_names.h"
+
+typedef ExecutionTrace::Record Record;
+
+static const char* kRegisterNames[ExecutionTrace::RegisterCount] = {
+    "AF", "BC", "DE", "HL", "IX", "IY", "SP", "AF'", "BC'", "DE'", "HL'", "CTL"
+};
+
+static const char* kAccessNames[4] = { "R", "W", "IN", "OUT" };
+
+static const char* kTriggerNames[4] = { "none", "pc", "frame", "break" };
+
+static void usage(void)
+{
+    printf("Usage: gearsystem-tracedump [options] trace\n");
+    printf("  -q              instructions only, without registers and accesses\n");
+    printf("  -n count        print only the last count instructions\n");
+}
+
+static void disassemble(const Record& record, char* text, size_t size)
+{
+    const u8* bytes = record.instruction.opcodes;
+    int first = 0;
+    u8 ddfd_mod = 0;
+
+    while ((first < 2) && ((bytes[first] == 0xDD) || (bytes[first] == 0xFD)))
+        ddfd_mod = bytes[first++];
+
+    u8 opcode = bytes[first];
+    stOPCodeInfo info;
+    bool prefixed = false;
+
+    if ((opcode == 0xCB) && (first < 2))
+    {
+        prefixed = true;
+        if (ddfd_mod == 0xDD)
+            info = kOPCodeDDCBNames[bytes[first + 2]];
+        else if (ddfd_mod == 0xFD)
+            info = kOPCodeFDCBNames[bytes[first + 2]];
+        else
+            info = kOPCodeCBNames[bytes[first + 1]];
+    }
+    else if ((opcode == 0xED) && (first < 3))
+    {
+        prefixed = true;
+        info = kOPCodeEDNames[bytes[first + 1]];
+    }
+    else if (ddfd_mod == 0xDD)
+        info = kOPCodeDDNames[opcode];
+    else if (ddfd_mod == 0xFD)
+        info = kOPCodeFDNames[opcode];
+    else
+        info = kOPCodeNames[opcode];
+
+    first += prefixed ? 1 : 0;
+
+    // Operands past the four recorded bytes read as zero
+    u8 b1 = (first + 1 < 4) ? bytes[first + 1] : 0;
+    u8 b2 = (first + 2 < 4) ? bytes[first + 2] : 0;
+    u8 b0 = (first < 4) ? bytes[first] : 0;
+
+    switch (info.type)
+    {
+        case 0:
+            snprintf(text, size, "%s", info.name);
+            break;
+        case 1:
+            snprintf(text, size, info.name, b0);
+            break;
+        case 2:
+            snprintf(text, size, info.name, b1);
+            break;
+        case 3:
+            snprintf(text, size, info.name, (b2 << 8) | b1);
+            break;
+        case 4:
+            snprintf(text, size, info.name, (s8)b1);
+            break;
+        case 5:
+            snprintf(text, size, info.name, (u16)(record.instruction.pc + info.size + (s8)b1), (s8)b1);
+            break;
+        case 6:
+            snprintf(text, size, info.name, (s8)b1, b2);
+            break;
+        default:
+            snprintf(text, size, "PARSE ERROR");
+    }
+}
+
+// Instructions only keep the low 32 bits of the cycle counter, the events
+// in between carry the full value
+static u64 extend_timestamp(u64 last, u32 timestamp)
+{
+    u64 extended = (last & ~(u64)0xFFFFFFFF) | timestamp;
+
+    if (extended < last)
+        extended += (u64)1 << 32;
+
+    return extended;
+}
+
+static void print_event(const Record& record)
+{
+    unsigned long long timestamp = (unsigned long long)record.event.timestamp;
+
+    switch (record.type)
+    {
+        case ExecutionTrace::RecordInterrupt:
+            printf("%12llu  ---- interrupt $%04X, return to $%04X\n", timestamp, record.event.address, record.event.value & 0xFFFF);
+            break;
+        case ExecutionTrace::RecordFrame:
+            printf("%12llu  ---- frame %u\n", timestamp, record.event.value);
+            break;
+        case ExecutionTrace::RecordStart:
+        case ExecutionTrace::RecordStop:
+            printf("%12llu  ---- trace %s on %s", timestamp, (record.type == ExecutionTrace::RecordStart) ? "started" : "stopped",
+                   kTriggerNames[record.event.address & 3]);
+            if (record.event.address == ExecutionTrace::TriggerAddress)
+                printf(" $%04X", record.event.value);
+            else if (record.event.address == ExecutionTrace::TriggerFrame)
+                printf(" %u", record.event.value);
+            printf("\n");
+            break;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    const char* path = NULL;
+    bool quiet = false;
+    long last = -1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-q") == 0)
+            quiet = true;
+        else if ((strcmp(argv[i], "-n") == 0) && (i + 1 < argc))
+            last = atol(argv[++i]);
+        else if ((strcmp(argv[i], "-h") == 0) || (strcmp(argv[i], "--help") == 0))
+        {
+            usage();
+            return 0;
+        }
+        else if (argv[i][0] != '-')
+            path = argv[i];
+        else
+        {
+            usage();
+            return 1;
+        }
+    }
+
+    if (!path)
+    {
+        usage();
+        return 1;
+    }
+
+    FILE* file = fopen(path, "rb");
+
+    if (!file)
+    {
+        fprintf(stderr, "Unable to open %s\n", path);
+        return 1;
+    }
+
+    ExecutionTrace::FileHeader header;
+
+    if ((fread(&header, sizeof(header), 1, file) != 1) || (header.magic != GS_TRACE_MAGIC) ||
+        (header.version != GS_TRACE_VERSION) || (header.record_size != sizeof(Record)))
+    {
+        fprintf(stderr, "%s is not a Gearsystem trace\n", path);
+        fclose(file);
+        return 1;
+    }
+
+    std::vector<Record> records((size_t)header.record_count);
+
+    if (!records.empty() && (fread(&records[0], sizeof(Record), records.size(), file) != records.size()))
+    {
+        fprintf(stderr, "%s is truncated\n", path);
+        fclose(file);
+        return 1;
+    }
+
+    fclose(file);
+
+    size_t start = 0;
+
+    if (last >= 0)
+    {
+        long count = 0;
+        start = records.size();
+
+        while ((start > 0) && (count < last))
+        {
+            start--;
+            if (records[start].type == ExecutionTrace::RecordInstruction)
+                count++;
+        }
+    }
+
+    printf("; records %llu to %llu, %llu accesses dropped\n", (unsigned long long)header.first_record,
+           (unsigned long long)(header.first_record + header.record_count), (unsigned long long)header.dropped_accesses);
+
+    u64 timestamp = 0;
+    bool synced = false;
+    std::string line;
+
+    for (size_t r = start; r < records.size(); r++)
+    {
+        const Record& record = records[r];
+        char text[128];
+
+        if (record.type == ExecutionTrace::RecordInstruction)
+        {
+            if (!line.empty())
+                printf("%s\n", line.c_str());
+
+            timestamp = extend_timestamp(timestamp, record.instruction.timestamp);
+            synced = true;
+
+            int length = record.instruction.flags & ExecutionTrace::FlagLengthMask;
+            char bytes[16] = "";
+
+            for (int i = 0; i < 4; i++)
+            {
+                if (i < length)
+                    snprintf(bytes + (i * 3), 4, "%02X ", record.instruction.opcodes[i]);
+                else
+                    snprintf(bytes + (i * 3), 4, "   ");
+            }
+
+            char name[40];
+            disassemble(record, name, sizeof(name));
+
+            snprintf(text, sizeof(text), "%12llu  %02X:%04X  %s %-20s %3d", (unsigned long long)timestamp, record.instruction.bank,
+                     record.instruction.pc, bytes, name, record.instruction.cycles);
+            line = text;
+
+            if (record.instruction.flags & ExecutionTrace::FlagHalted)
+                line += "  HALT";
+            if (record.instruction.flags & ExecutionTrace::FlagAccessesDropped)
+                line += "  (accesses dropped)";
+        }
+        else if ((record.type == ExecutionTrace::RecordRegisters) && !quiet && !line.empty())
+        {
+            for (int e = 0; (e < record.registers.count) && (e < 3); e++)
+            {
+                int id = record.registers.entries[e].id;
+                snprintf(text, sizeof(text), "  %s=%04X", (id < ExecutionTrace::RegisterCount) ? kRegisterNames[id] : "?", record.registers.entries[e].value);
+                line += text;
+            }
+        }
+        else if ((record.type == ExecutionTrace::RecordAccesses) && !quiet && !line.empty())
+        {
+            for (int e = 0; (e < record.accesses.count) && (e < 3); e++)
+            {
+                int kind = record.accesses.entries[e].kind & 3;
+                if (kind >= ExecutionTrace::AccessIORead)
+                    snprintf(text, sizeof(text), "  %s %02X=%02X", kAccessNames[kind], record.accesses.entries[e].address & 0xFF, record.accesses.entries[e].value);
+                else
+                    snprintf(text, sizeof(text), "  %s %04X=%02X", kAccessNames[kind], record.accesses.entries[e].address, record.accesses.entries[e].value);
+                line += text;
+            }
+        }
+        else if ((record.type >= ExecutionTrace::RecordInterrupt) && (record.type <= ExecutionTrace::RecordStop))
+        {
+            if (!line.empty())
+                printf("%s\n", line.c_str());
+            line.clear();
+
+            timestamp = record.event.timestamp;
+            print_event(record);
+        }
+    }
+
+    if (!line.empty())
+        printf("%s\n", line.c_str());
+
+    if (!synced)
+        printf("; no instructions\n");
+
+    return 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef GEARSYSTEM_VECENV_H
+#define	GEARSYSTEM_VECENV_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(_WIN32)
+    #define GS_VECENV_API __declspec(dllexport)
+#else
+    #define GS_VECENV_API __attribute__((visibility("default")))
+#endif
+
+#define GS_VECENV_MAX_RAM_SLICES 16
+
+/* Action bits: low byte is pad 1, high byte is pad 2 */
+#define GS_VECENV_KEY_UP 0x01
+#define GS_VECENV_KEY_DOWN 0x02
+#define GS_VECENV_KEY_LEFT 0x04
+#define GS_VECENV_KEY_RIGHT 0x08
+#define GS_VECENV_KEY_1 0x10
+#define GS_VECENV_KEY_2 0x20
+#define GS_VECENV_KEY_START 0x40
+#define GS_VECENV_PAD2_SHIFT 8
+
+/* Observation formats, all but RGBA are one byte per pixel */
+#define GS_VECENV_OBS_RGBA 0
+#define GS_VECENV_OBS_PALETTE 1
+#define GS_VECENV_OBS_LUMINANCE 2
+#define GS_VECENV_OBS_LUMINANCE_84X84 3
+#define GS_VECENV_OBS_LUMINANCE_128X96 4
+
+typedef struct gs_vecenv gs_vecenv;
+
+typedef struct gs_vecenv_ram_slice
+{
+    uint16_t address;
+    uint16_t size;
+} gs_vecenv_ram_slice;
+
+typedef struct gs_vecenv_config
+{
+    const char* rom_path;
+    int num_envs;
+    int num_threads;        /* 0 uses every hardware thread */
+    int frame_skip;         /* frames per step, the observation is the last one */
+    int audio;              /* 0 skips sound mixing */
+    int obs_format;         /* GS_VECENV_OBS_* */
+    int ram_slice_count;
+    gs_vecenv_ram_slice ram_slices[GS_VECENV_MAX_RAM_SLICES];
+} gs_vecenv_config;
+
+/*
+ * Observations are written as num_envs x height x width x channels bytes
+ * and RAM slices as num_envs x ram_size bytes, both into buffers
+ * owned by the caller. Either buffer may be NULL. Functions returning int
+ * return 0 on success and -1 on error.
+ */
+GS_VECENV_API void gs_vecenv_default_config(gs_vecenv_config* config);
+GS_VECENV_API gs_vecenv* gs_vecenv_create(const gs_vecenv_config* config);
+GS_VECENV_API void gs_vecenv_destroy(gs_vecenv* env);
+GS_VECENV_API void gs_vecenv_get_shape(const gs_vecenv* env, int* num_envs, int* height, int* width, int* channels);
+GS_VECENV_API int gs_vecenv_get_ram_size(const gs_vecenv* env);
+GS_VECENV_API int gs_vecenv_reset(gs_vecenv* env, const uint8_t* mask, uint8_t* obs, uint8_t* ram);
+GS_VECENV_API int gs_vecenv_step(gs_vecenv* env, const uint16_t* actions, uint8_t* obs, uint8_t* ram);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	/* GEARSYSTEM_VECENV_H */
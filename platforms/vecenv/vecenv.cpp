@@ -0,0 +1,336 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <string.h>
+#include "gearsystem.h"
+#include "BatchScheduler.h"
+#include "gearsystem_vecenv.h"
+
+struct VecEnvInstance
+{
+    GearsystemCore* core;
+    u8* frame_buffer;
+    s16* sample_buffer;
+    u16 keys;
+};
+
+struct gs_vecenv
+{
+    gs_vecenv_config config;
+    VecEnvInstance* instances;
+    BatchScheduler scheduler;
+    u8* initial_state;
+    size_t initial_state_size;
+    int height;
+    int width;
+    int channels;
+    int ram_size;
+    bool obs_direct;
+    const u16* actions;
+    const u8* mask;
+    u8* obs;
+    u8* ram;
+};
+
+static const int kFrameBufferSize = GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN * GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN * 4;
+
+static void apply_action(VecEnvInstance& instance, u16 action)
+{
+    u16 changed = instance.keys ^ action;
+
+    for (int pad = 0; pad < 2; pad++)
+    {
+        GS_Joypads joypad = (pad == 0) ? Joypad_1 : Joypad_2;
+
+        for (int key = 0; key < 7; key++)
+        {
+            int bit = key + (pad * GS_VECENV_PAD2_SHIFT);
+
+            if (!IsSetBit(changed, bit))
+                continue;
+
+            if (IsSetBit(action, bit))
+                instance.core->KeyPressed(joypad, static_cast<GS_Keys>(key));
+            else
+                instance.core->KeyReleased(joypad, static_cast<GS_Keys>(key));
+        }
+    }
+
+    instance.keys = action;
+}
+
+static u8* observation_target(gs_vecenv* env, int index)
+{
+    if (!IsValidPointer(env->obs))
+        return NULL;
+
+    if (env->obs_direct)
+        return env->obs + ((size_t)index * env->height * env->width * env->channels);
+
+    return env->instances[index].frame_buffer;
+}
+
+static void write_observation(gs_vecenv* env, int index)
+{
+    if (!IsValidPointer(env->obs) || env->obs_direct)
+        return;
+
+    VecEnvInstance& instance = env->instances[index];
+    int screen_width, screen_height;
+
+    if (env->config.obs_format == GS_VECENV_OBS_RGBA)
+    {
+        GS_RuntimeInfo runtime;
+        instance.core->GetRuntimeInfo(runtime);
+        screen_width = runtime.screen_width;
+        screen_height = runtime.screen_height;
+    }
+    else
+        instance.core->GetObservationSize(screen_width, screen_height);
+
+    int row_size = env->width * env->channels;
+    int src_row_size = screen_width * env->channels;
+    int copy_size = (src_row_size < row_size) ? src_row_size : row_size;
+    int rows = (screen_height < env->height) ? screen_height : env->height;
+    u8* dst = env->obs + ((size_t)index * env->height * row_size);
+    const u8* src = instance.frame_buffer;
+
+    if (src_row_size == row_size)
+    {
+        memcpy(dst, src, (size_t)rows * row_size);
+    }
+    else
+    {
+        for (int y = 0; y < rows; y++)
+        {
+            memcpy(dst + (y * row_size), src + (y * src_row_size), copy_size);
+            memset(dst + (y * row_size) + copy_size, 0, row_size - copy_size);
+        }
+    }
+
+    if (rows < env->height)
+        memset(dst + (rows * row_size), 0, (size_t)(env->height - rows) * row_size);
+}
+
+static void write_ram(gs_vecenv* env, int index)
+{
+    if (!IsValidPointer(env->ram))
+        return;
+
+    const u8* map = env->instances[index].core->GetMemory()->GetMemoryMap();
+    u8* dst = env->ram + ((size_t)index * env->ram_size);
+
+    for (int i = 0; i < env->config.ram_slice_count; i++)
+    {
+        const gs_vecenv_ram_slice& slice = env->config.ram_slices[i];
+        memcpy(dst, map + slice.address, slice.size);
+        dst += slice.size;
+    }
+}
+
+static void run_frames(VecEnvInstance& instance, u8* target, int frames)
+{
+    int sample_count = 0;
+
+    for (int i = 0; i < frames; i++)
+    {
+        u8* frame_buffer = (i == (frames - 1)) ? target : NULL;
+        instance.core->RunToVBlank(frame_buffer, instance.sample_buffer, &sample_count);
+    }
+}
+
+static void step_task(int index, void* userdata)
+{
+    gs_vecenv* env = static_cast<gs_vecenv*>(userdata);
+    VecEnvInstance& instance = env->instances[index];
+
+    apply_action(instance, env->actions[index]);
+    run_frames(instance, observation_target(env, index), env->config.frame_skip);
+    write_observation(env, index);
+    write_ram(env, index);
+}
+
+static void reset_task(int index, void* userdata)
+{
+    gs_vecenv* env = static_cast<gs_vecenv*>(userdata);
+    VecEnvInstance& instance = env->instances[index];
+
+    if (IsValidPointer(env->mask) && !env->mask[index])
+        return;
+
+    instance.core->LoadState(env->initial_state, env->initial_state_size);
+    instance.keys = 0;
+
+    run_frames(instance, observation_target(env, index), 1);
+    write_observation(env, index);
+    write_ram(env, index);
+}
+
+void gs_vecenv_default_config(gs_vecenv_config* config)
+{
+    memset(config, 0, sizeof(gs_vecenv_config));
+    config->num_envs = 1;
+    config->frame_skip = 1;
+
+    // System RAM
+    config->ram_slice_count = 1;
+    config->ram_slices[0].address = 0xC000;
+    config->ram_slices[0].size = 0x2000;
+}
+
+gs_vecenv* gs_vecenv_create(const gs_vecenv_config* config)
+{
+    if (!IsValidPointer(config) || !IsValidPointer(config->rom_path) || (config->num_envs < 1) ||
+        (config->ram_slice_count < 0) || (config->ram_slice_count > GS_VECENV_MAX_RAM_SLICES) ||
+        (config->obs_format < GS_VECENV_OBS_RGBA) || (config->obs_format > GS_VECENV_OBS_LUMINANCE_128X96))
+        return NULL;
+
+    gs_vecenv* env = new gs_vecenv;
+    env->config = *config;
+    env->instances = new VecEnvInstance[config->num_envs];
+    env->ram_size = 0;
+    env->channels = (config->obs_format == GS_VECENV_OBS_RGBA) ? 4 : 1;
+    env->obs_direct = (config->obs_format == GS_VECENV_OBS_LUMINANCE_84X84) || (config->obs_format == GS_VECENV_OBS_LUMINANCE_128X96);
+    InitPointer(env->initial_state);
+    env->initial_state_size = 0;
+    InitPointer(env->actions);
+    InitPointer(env->mask);
+    InitPointer(env->obs);
+    InitPointer(env->ram);
+
+    if (env->config.frame_skip < 1)
+        env->config.frame_skip = 1;
+
+    for (int i = 0; i < config->ram_slice_count; i++)
+    {
+        gs_vecenv_ram_slice& slice = env->config.ram_slices[i];
+
+        if ((slice.address + slice.size) > 0x10000)
+            slice.size = static_cast<u16>(0x10000 - slice.address);
+
+        env->ram_size += slice.size;
+    }
+
+    for (int i = 0; i < config->num_envs; i++)
+    {
+        VecEnvInstance& instance = env->instances[i];
+        instance.core = new GearsystemCore();
+        instance.core->Init(GS_PIXEL_RGBA8888);
+        instance.core->GetProcessor()->EnableDisassembler(false);
+        instance.core->GetAudio()->SuspendOutput(config->audio == 0);
+        instance.core->SetObservationFormat(static_cast<GS_Observation_Format>(config->obs_format));
+        instance.frame_buffer = new u8[kFrameBufferSize];
+        instance.sample_buffer = new s16[GS_AUDIO_BUFFER_SIZE];
+        instance.keys = 0;
+    }
+
+    bool ok = true;
+
+    for (int i = 0; ok && (i < config->num_envs); i++)
+        ok = env->instances[i].core->LoadROM(config->rom_path);
+
+    if (ok)
+    {
+        GearsystemCore* core = env->instances[0].core;
+        env->initial_state_size = core->GetStateSize();
+        env->initial_state = new u8[env->initial_state_size];
+        ok = core->SaveState(env->initial_state, env->initial_state_size);
+
+        if (config->obs_format == GS_VECENV_OBS_RGBA)
+        {
+            GS_RuntimeInfo runtime;
+            core->GetRuntimeInfo(runtime);
+            env->width = runtime.screen_width;
+            env->height = runtime.screen_height;
+        }
+        else
+            core->GetObservationSize(env->width, env->height);
+    }
+
+    if (!ok)
+    {
+        Log("Unable to create vectorized environment for %s", config->rom_path);
+        gs_vecenv_destroy(env);
+        return NULL;
+    }
+
+    env->scheduler.Init(config->num_threads);
+
+    return env;
+}
+
+void gs_vecenv_destroy(gs_vecenv* env)
+{
+    if (!IsValidPointer(env))
+        return;
+
+    for (int i = 0; i < env->config.num_envs; i++)
+    {
+        SafeDeleteArray(env->instances[i].sample_buffer);
+        SafeDeleteArray(env->instances[i].frame_buffer);
+        SafeDelete(env->instances[i].core);
+    }
+
+    SafeDeleteArray(env->instances);
+    SafeDeleteArray(env->initial_state);
+    SafeDelete(env);
+}
+
+void gs_vecenv_get_shape(const gs_vecenv* env, int* num_envs, int* height, int* width, int* channels)
+{
+    if (IsValidPointer(num_envs))
+        *num_envs = env->config.num_envs;
+    if (IsValidPointer(height))
+        *height = env->height;
+    if (IsValidPointer(width))
+        *width = env->width;
+    if (IsValidPointer(channels))
+        *channels = env->channels;
+}
+
+int gs_vecenv_get_ram_size(const gs_vecenv* env)
+{
+    return env->ram_size;
+}
+
+int gs_vecenv_reset(gs_vecenv* env, const uint8_t* mask, uint8_t* obs, uint8_t* ram)
+{
+    if (!IsValidPointer(env))
+        return -1;
+
+    env->mask = mask;
+    env->obs = obs;
+    env->ram = ram;
+    env->scheduler.Run(env->config.num_envs, reset_task, env);
+
+    return 0;
+}
+
+int gs_vecenv_step(gs_vecenv* env, const uint16_t* actions, uint8_t* obs, uint8_t* ram)
+{
+    if (!IsValidPointer(env) || !IsValidPointer(actions))
+        return -1;
+
+    env->actions = actions;
+    env->obs = obs;
+    env->ram = ram;
+    env->scheduler.Run(env->config.num_envs, step_task, env);
+
+    return 0;
+}
@@ -37,6 +37,7 @@ Audio::Audio(Cartridge * pCartridge)
     m_bYM2413ForceDisabled = false;
     m_bYM2413CartridgeNotSupported = false;
     m_bMute = false;
+    m_bOutputSuspended = false;
 }
 
 Audio::~Audio()
@@ -87,8 +88,29 @@ void Audio::Mute(bool bMute)
     m_bMute = bMute;
 }
 
+void Audio::SuspendOutput(bool bSuspend)
+{
+    m_bOutputSuspended = bSuspend;
+
+    if (bSuspend)
+        m_pApu->output(NULL, NULL, NULL);
+    else
+        m_pApu->output(m_pBuffer->center(), m_pBuffer->left(), m_pBuffer->right());
+}
+
 void Audio::EndFrame(s16* pSampleBuffer, int* pSampleCount)
 {
+    if (m_bOutputSuspended)
+    {
+        m_pApu->end_frame(m_ElapsedCycles);
+        m_pYM2413->EndFrame(NULL);
+        m_ElapsedCycles = 0;
+
+        if (IsValidPointer(pSampleCount))
+            *pSampleCount = 0;
+        return;
+    }
+
     m_pApu->end_frame(m_ElapsedCycles);
     m_pBuffer->end_frame(m_ElapsedCycles);
 
@@ -123,30 +145,73 @@ void Audio::DisableYM2413(bool bDisable)
     m_pYM2413->Enable(bDisable ? false : m_bYM2413Enabled);
 }
 
-void Audio::SaveState(std::ostream& stream)
+void Audio::SaveState(StateWriter& writer)
 {
-    using namespace std;
-
-    stream.write(reinterpret_cast<const char*> (&m_ElapsedCycles), sizeof(m_ElapsedCycles));
-    stream.write(reinterpret_cast<const char*> (m_pSampleBuffer), sizeof(blip_sample_t) * GS_AUDIO_BUFFER_SIZE);
-    stream.write(reinterpret_cast<const char*> (&m_bYM2413Enabled), sizeof(m_bYM2413Enabled));
-    stream.write(reinterpret_cast<const char*> (&m_bPSGEnabled), sizeof(m_bPSGEnabled));
-    stream.write(reinterpret_cast<const char*> (m_pYM2413Buffer), sizeof(s16) * GS_AUDIO_BUFFER_SIZE);
-    m_pYM2413->SaveState(stream);
+    sms_apu_state_t apu;
+    m_pApu->save_state(&apu);
+
+    stereo_buffer_state_t buffer;
+    m_pBuffer->save_state(&buffer);
+
+    writer.Write(&m_ElapsedCycles, sizeof(m_ElapsedCycles));
+    writer.Write(&m_bYM2413Enabled, sizeof(m_bYM2413Enabled));
+    writer.Write(&m_bPSGEnabled, sizeof(m_bPSGEnabled));
+    writer.Write(&apu, sizeof(apu));
+    writer.Write(&buffer, sizeof(buffer));
 }
 
-void Audio::LoadState(std::istream& stream)
+void Audio::LoadState(StateReader& reader, int version)
 {
-    using namespace std;
+    reader.Read(&m_ElapsedCycles, sizeof(m_ElapsedCycles));
 
-    stream.read(reinterpret_cast<char*> (&m_ElapsedCycles), sizeof(m_ElapsedCycles));
-    stream.read(reinterpret_cast<char*> (m_pSampleBuffer), sizeof(blip_sample_t) * GS_AUDIO_BUFFER_SIZE);
-    stream.read(reinterpret_cast<char*> (&m_bYM2413Enabled), sizeof(m_bYM2413Enabled));
-    stream.read(reinterpret_cast<char*> (&m_bPSGEnabled), sizeof(m_bPSGEnabled));
-    stream.read(reinterpret_cast<char*> (m_pYM2413Buffer), sizeof(s16) * GS_AUDIO_BUFFER_SIZE);
-    m_pYM2413->LoadState(stream);
+    if (version < 2)
+    {
+        // Older states carried the mixing buffers instead of the PSG itself
+        reader.Read(m_pSampleBuffer, sizeof(blip_sample_t) * GS_AUDIO_BUFFER_SIZE);
+        reader.Read(&m_bYM2413Enabled, sizeof(m_bYM2413Enabled));
+        reader.Read(&m_bPSGEnabled, sizeof(m_bPSGEnabled));
+        reader.Read(m_pYM2413Buffer, sizeof(s16) * GS_AUDIO_BUFFER_SIZE);
+
+        m_pApu->reset(m_pCartridge->IsSG1000());
+        m_pApu->volume(1.0);
+        m_pBuffer->clear();
+        return;
+    }
 
-    m_pApu->reset(m_pCartridge->IsSG1000());
-    m_pApu->volume(1.0);
-    m_pBuffer->clear();
+    sms_apu_state_t apu;
+
+    reader.Read(&m_bYM2413Enabled, sizeof(m_bYM2413Enabled));
+    reader.Read(&m_bPSGEnabled, sizeof(m_bPSGEnabled));
+    reader.Read(&apu, sizeof(apu));
+
+    if (reader.IsOverflow())
+        return;
+
+    m_pApu->load_state(apu);
+
+    if (version < 3)
+        return;
+
+    // The filter and pending deltas let the output continue without a click
+    stereo_buffer_state_t buffer;
+    reader.Read(&buffer, sizeof(buffer));
+
+    if (!reader.IsOverflow())
+        m_pBuffer->load_state(buffer);
+}
+
+// What LoadState reads for each version
+size_t Audio::GetStateSize(int version)
+{
+    size_t size = sizeof(m_ElapsedCycles) + sizeof(m_bYM2413Enabled) + sizeof(m_bPSGEnabled);
+
+    if (version < 2)
+        return size + (sizeof(blip_sample_t) * GS_AUDIO_BUFFER_SIZE) + (sizeof(s16) * GS_AUDIO_BUFFER_SIZE);
+
+    size += sizeof(sms_apu_state_t);
+
+    if (version >= 3)
+        size += sizeof(stereo_buffer_state_t);
+
+    return size;
 }
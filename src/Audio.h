@@ -21,6 +21,7 @@
 #define	AUDIO_H
 
 #include "definitions.h"
+#include "StateSerializer.h"
 #include "audio/Multi_Buffer.h"
 #include "audio/Sms_Apu.h"
 #include "YM2413.h"
@@ -42,8 +43,11 @@ public:
     void Tick(unsigned int clockCycles);
     void EndFrame(s16* pSampleBuffer, int* pSampleCount);
     void DisableYM2413(bool bDisable);
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream);
+    void SaveState(StateWriter& writer);
+    void LoadState(StateReader& reader, int version = GS_STATE_CHUNK_PSG_VERSION);
+    size_t GetStateSize(int version = GS_STATE_CHUNK_PSG_VERSION);
+    void SuspendOutput(bool bSuspend);
+    YM2413* GetYM2413();
 
 private:
     YM2413* m_pYM2413;
@@ -60,10 +64,16 @@ private:
     Cartridge* m_pCartridge;
     s16* m_pYM2413Buffer;
     bool m_bMute;
+    bool m_bOutputSuspended;
 };
 
 #include "Cartridge.h"
 
+inline YM2413* Audio::GetYM2413()
+{
+    return m_pYM2413;
+}
+
 inline void Audio::Tick(unsigned int clockCycles)
 {
     m_ElapsedCycles += clockCycles;
@@ -0,0 +1,237 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include "BatchScheduler.h"
+
+static inline u64 PackRange(u32 begin, u32 end)
+{
+    return (static_cast<u64>(begin) << 32) | end;
+}
+
+static inline u32 RangeBegin(u64 range)
+{
+    return static_cast<u32>(range >> 32);
+}
+
+static inline u32 RangeEnd(u64 range)
+{
+    return static_cast<u32>(range & 0xFFFFFFFF);
+}
+
+BatchScheduler::BatchScheduler()
+{
+    InitPointer(m_pWorkers);
+    m_iThreadCount = 0;
+    m_iGeneration = 0;
+    m_bQuit = false;
+    m_iPending = 0;
+    m_iSteals = 0;
+    InitPointer(m_pTask);
+    InitPointer(m_pUserData);
+}
+
+BatchScheduler::~BatchScheduler()
+{
+    Shutdown();
+}
+
+void BatchScheduler::Init(int threads)
+{
+    Shutdown();
+
+    if (threads <= 0)
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+    if (threads <= 0)
+        threads = 1;
+
+    m_iThreadCount = threads;
+    m_bQuit = false;
+    m_pWorkers = new Worker[threads];
+
+    for (int i = 0; i < threads; i++)
+        m_pWorkers[i].range = PackRange(0, 0);
+
+    // Worker 0 is the calling thread
+    for (int i = 1; i < threads; i++)
+        m_pWorkers[i].thread = std::thread(&BatchScheduler::WorkerLoop, this, i);
+}
+
+int BatchScheduler::GetThreadCount() const
+{
+    return m_iThreadCount;
+}
+
+u64 BatchScheduler::GetStealCount() const
+{
+    return m_iSteals.load();
+}
+
+void BatchScheduler::Run(int count, BatchTask task, void* userdata)
+{
+    if (count <= 0)
+        return;
+
+    if (m_iThreadCount <= 1)
+    {
+        for (int i = 0; i < count; i++)
+            task(i, userdata);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        m_pTask = task;
+        m_pUserData = userdata;
+        m_iPending = count;
+
+        for (int i = 0; i < m_iThreadCount; i++)
+        {
+            u32 begin = static_cast<u32>((static_cast<u64>(count) * i) / m_iThreadCount);
+            u32 end = static_cast<u32>((static_cast<u64>(count) * (i + 1)) / m_iThreadCount);
+            m_pWorkers[i].range.store(PackRange(begin, end));
+        }
+
+        m_iGeneration++;
+    }
+
+    m_WakeCondition.notify_all();
+
+    Work(0);
+
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_DoneCondition.wait(lock, [this] { return m_iPending.load() == 0; });
+}
+
+void BatchScheduler::Shutdown()
+{
+    if (!IsValidPointer(m_pWorkers))
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_bQuit = true;
+    }
+
+    m_WakeCondition.notify_all();
+
+    for (int i = 1; i < m_iThreadCount; i++)
+    {
+        if (m_pWorkers[i].thread.joinable())
+            m_pWorkers[i].thread.join();
+    }
+
+    SafeDeleteArray(m_pWorkers);
+    m_iThreadCount = 0;
+}
+
+void BatchScheduler::WorkerLoop(int id)
+{
+    u32 generation = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_Mutex);
+            m_WakeCondition.wait(lock, [this, generation] { return m_bQuit || (m_iGeneration != generation); });
+
+            if (m_bQuit)
+                return;
+
+            generation = m_iGeneration;
+        }
+
+        Work(id);
+    }
+}
+
+void BatchScheduler::Work(int id)
+{
+    int index;
+    int done = 0;
+
+    while (Pop(id, index) || Steal(id, index))
+    {
+        m_pTask(index, m_pUserData);
+        done++;
+    }
+
+    if ((done > 0) && (m_iPending.fetch_sub(done) == done))
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_DoneCondition.notify_one();
+    }
+}
+
+bool BatchScheduler::Pop(int id, int& index)
+{
+    std::atomic<u64>& range = m_pWorkers[id].range;
+    u64 current = range.load();
+
+    while (true)
+    {
+        u32 begin = RangeBegin(current);
+        u32 end = RangeEnd(current);
+
+        if (begin >= end)
+            return false;
+
+        if (range.compare_exchange_weak(current, PackRange(begin + 1, end)))
+        {
+            index = static_cast<int>(begin);
+            return true;
+        }
+    }
+}
+
+bool BatchScheduler::Steal(int id, int& index)
+{
+    for (int i = 1; i < m_iThreadCount; i++)
+    {
+        int victim = (id + i) % m_iThreadCount;
+        std::atomic<u64>& range = m_pWorkers[victim].range;
+        u64 current = range.load();
+
+        while (true)
+        {
+            u32 begin = RangeBegin(current);
+            u32 end = RangeEnd(current);
+
+            if (begin >= end)
+                break;
+
+            u32 half = (end - begin) / 2;
+            if (half == 0)
+                half = 1;
+            u32 split = end - half;
+
+            if (range.compare_exchange_weak(current, PackRange(begin, split)))
+            {
+                // Our own range is empty here, so no other thief can be
+                // racing on it until it is published
+                m_pWorkers[id].range.store(PackRange(split + 1, end));
+                m_iSteals++;
+                index = static_cast<int>(split);
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,73 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef BATCHSCHEDULER_H
+#define	BATCHSCHEDULER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include "definitions.h"
+
+typedef void (*BatchTask)(int index, void* userdata);
+
+// Runs a batch of independent tasks (e.g. one frame of N cores) on a fixed
+// thread pool. Each worker owns a contiguous range of indices and idle
+// workers steal half of the remaining range from the others.
+class BatchScheduler
+{
+public:
+    BatchScheduler();
+    ~BatchScheduler();
+    void Init(int threads = 0);
+    int GetThreadCount() const;
+    void Run(int count, BatchTask task, void* userdata);
+    u64 GetStealCount() const;
+
+private:
+    struct Worker
+    {
+        std::atomic<u64> range;
+        std::thread thread;
+        u8 padding[64];
+    };
+
+private:
+    void Shutdown();
+    void WorkerLoop(int id);
+    void Work(int id);
+    bool Pop(int id, int& index);
+    bool Steal(int id, int& index);
+
+private:
+    Worker* m_pWorkers;
+    int m_iThreadCount;
+    std::mutex m_Mutex;
+    std::condition_variable m_WakeCondition;
+    std::condition_variable m_DoneCondition;
+    u32 m_iGeneration;
+    bool m_bQuit;
+    std::atomic<int> m_iPending;
+    std::atomic<u64> m_iSteals;
+    BatchTask m_pTask;
+    void* m_pUserData;
+};
+
+#endif	/* BATCHSCHEDULER_H */
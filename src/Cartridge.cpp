@@ -19,14 +19,28 @@
 
 #include <string>
 #include <algorithm>
+#include <vector>
 #include <ctype.h>
 #include "Cartridge.h"
 #include "miniz/miniz.h"
 #include "log.h"
+#if defined(GEARSYSTEM_MMAP)
+    #if defined(_WIN32)
+        #define WIN32_LEAN_AND_MEAN
+        #define NOMINMAX
+        #include <windows.h>
+    #else
+        #include <sys/mman.h>
+        #include <sys/stat.h>
+        #include <fcntl.h>
+        #include <unistd.h>
+    #endif
+#endif
 
 Cartridge::Cartridge()
 {
     InitPointer(m_pROM);
+    InitPointer(m_pROMStorage);
     m_iROMSize = 0;
     m_Type = CartridgeNotSupported;
     m_Zone = CartridgeUnknownZone;
@@ -46,7 +60,7 @@ Cartridge::Cartridge()
 
 Cartridge::~Cartridge()
 {
-    SafeDeleteArray(m_pROM);
+    ReleaseROM();
 }
 
 void Cartridge::Init()
@@ -56,7 +70,7 @@ void Cartridge::Init()
 
 void Cartridge::Reset()
 {
-    SafeDeleteArray(m_pROM);
+    ReleaseROM();
     m_iROMSize = 0;
     m_Type = CartridgeNotSupported;
     m_Zone = CartridgeUnknownZone;
@@ -352,23 +366,28 @@ bool Cartridge::LoadFromZipFile(const u8* buffer, int size)
             m_bGameGear = (extension == "gg");
             m_bSG1000 = (extension == "sg" || extension == "mv");
 
-            void *p;
-            size_t uncomp_size;
-
-            p = mz_zip_reader_extract_file_to_heap(&zip_archive, file_stat.m_filename, &uncomp_size, 0);
-            if (!p)
+            if (file_stat.m_uncomp_size > (MAX_ROM_SIZE + 512))
             {
-                Log("mz_zip_reader_extract_file_to_heap() failed!");
+                Log("ZIP entry too big: %u bytes", (unsigned int) file_stat.m_uncomp_size);
                 mz_zip_reader_end(&zip_archive);
                 return false;
             }
 
-            bool ok = LoadFromBuffer((const u8*) p, (int)uncomp_size);
+            // Extracted once, straight into the buffer the ROM will live in
+            size_t uncomp_size = (size_t) file_stat.m_uncomp_size;
+            ROMStorage* storage = NewROMStorage(uncomp_size);
+
+            if (!mz_zip_reader_extract_to_mem(&zip_archive, i, storage->data, uncomp_size, 0))
+            {
+                Log("mz_zip_reader_extract_to_mem() failed!");
+                FreeROMStorage(storage);
+                mz_zip_reader_end(&zip_archive);
+                return false;
+            }
 
-            free(p);
             mz_zip_reader_end(&zip_archive);
 
-            return ok;
+            return LoadFromStorage(storage);
         }
     }
     return false;
@@ -384,30 +403,28 @@ bool Cartridge::LoadFromFile(const char* path)
 
     SetROMPath(path);
 
-    ifstream file(path, ios::in | ios::binary | ios::ate);
+    string fn(path);
+    transform(fn.begin(), fn.end(), fn.begin(), (int(*)(int)) tolower);
+    string extension = fn.substr(fn.find_last_of(".") + 1);
 
-    if (file.is_open())
-    {
-        int size = static_cast<int> (file.tellg());
-        char* memblock = new char[size];
-        file.seekg(0, ios::beg);
-        file.read(memblock, size);
-        file.close();
+    ROMStorage* storage = MapROMStorage(path);
 
-        string fn(path);
-        transform(fn.begin(), fn.end(), fn.begin(), (int(*)(int)) tolower);
-        string extension = fn.substr(fn.find_last_of(".") + 1);
+    if (!IsValidPointer(storage))
+        storage = ReadROMStorage(path);
 
+    if (IsValidPointer(storage))
+    {
         if (extension == "zip")
         {
             Debug("Loading from ZIP...");
-            m_bReady = LoadFromZipFile(reinterpret_cast<u8*> (memblock), size);
+            m_bReady = LoadFromZipFile(storage->data, static_cast<int>(storage->size));
+            FreeROMStorage(storage);
         }
         else
         {
             m_bGameGear = (extension == "gg");
             m_bSG1000= (extension == "sg" || extension == "mv");
-            m_bReady = LoadFromBuffer(reinterpret_cast<u8*> (memblock), size);
+            m_bReady = LoadFromStorage(storage);
         }
 
         if (m_bReady)
@@ -418,8 +435,6 @@ bool Cartridge::LoadFromFile(const char* path)
         {
             Log("There was a problem loading the memory for file %s...", path);
         }
-
-        SafeDeleteArray(memblock);
     }
     else
     {
@@ -437,37 +452,210 @@ bool Cartridge::LoadFromFile(const char* path)
 
 bool Cartridge::LoadFromBuffer(const u8* buffer, int size, const char* path)
 {
-    if (IsValidPointer(buffer))
+    if (IsValidPointer(buffer) && (size > 0))
     {
         SetROMPath(path);
 
         Log("Loading from buffer... Size: %d", size);
-        // Some ROMs have 512 Byte File Headers
-        if ((size % 1024) == 512)
-        {
-            buffer += 512;
-            size -= 512;
-            Log("Invalid size found. ROM trimmed to %d bytes", size);
-        }
-        // Unkown size
-        else if ((size % 1024) != 0)
-        {
-            Log("Invalid size found. %d bytes", size);
-            return false;
-        }
 
-        m_iROMSize = size;
-        m_pROM = new u8[m_iROMSize];
-        memcpy(m_pROM, buffer, m_iROMSize);
+        ROMStorage* storage = NewROMStorage(size);
+        memcpy(storage->data, buffer, size);
 
-        m_bReady = true;
+        return LoadFromStorage(storage);
+    }
+    else
+        return false;
+}
 
-        m_iCRC = CalculateCRC32(0, m_pROM, m_iROMSize);
+// Takes ownership of the storage, which is released on failure
+bool Cartridge::LoadFromStorage(ROMStorage* storage)
+{
+    size_t offset = 0;
+    size_t size = storage->size;
 
-        return GatherMetadata(m_iCRC);
+    // Some ROMs have 512 Byte File Headers
+    if ((size % 1024) == 512)
+    {
+        offset = 512;
+        size -= 512;
+        Log("Invalid size found. ROM trimmed to %d bytes", (int)size);
     }
-    else
+    // Unkown size
+    else if ((size % 1024) != 0)
+    {
+        Log("Invalid size found. %d bytes", (int)size);
+        FreeROMStorage(storage);
         return false;
+    }
+
+    if ((size == 0) || (size > MAX_ROM_SIZE))
+    {
+        Log("Invalid ROM size: %d bytes", (int)size);
+        FreeROMStorage(storage);
+        return false;
+    }
+
+    m_pROMStorage = storage;
+    m_pROM = storage->data + offset;
+    m_iROMSize = static_cast<int>(size);
+
+    m_bReady = true;
+
+    m_iCRC = CalculateCRC32(0, m_pROM, m_iROMSize);
+
+    return GatherMetadata(m_iCRC);
+}
+
+// Bank masks round the ROM size up to a power of two, so the storage is
+// padded with zeros to keep those reads inside the buffer
+static size_t ROMStorageCapacity(size_t size)
+{
+    size_t offset = ((size % 1024) == 512) ? 512 : 0;
+    size_t rom = std::max(size - offset, static_cast<size_t>(0x4000));
+    size_t capacity = 0x4000;
+
+    while (capacity < rom)
+        capacity <<= 1;
+
+    return offset + capacity;
+}
+
+// Heap storage is page aligned, like a mapping
+Cartridge::ROMStorage* Cartridge::NewROMStorage(size_t size)
+{
+    ROMStorage* storage = new ROMStorage();
+    storage->references = 1;
+    storage->type = ROMStorageHeap;
+    storage->size = size;
+    storage->capacity = ROMStorageCapacity(size);
+    storage->allocation = new u8[storage->capacity + 4096];
+    storage->data = storage->allocation + ((4096 - (reinterpret_cast<uintptr_t>(storage->allocation) & 4095)) & 4095);
+    memset(storage->data + size, 0, storage->capacity - size);
+
+    return storage;
+}
+
+// Maps the file read only, so every process running the same ROM shares the
+// page cache. Files whose padded size would go past the mapping are read.
+Cartridge::ROMStorage* Cartridge::MapROMStorage(const char* path)
+{
+#if defined(GEARSYSTEM_MMAP)
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (file == INVALID_HANDLE_VALUE)
+        return NULL;
+
+    LARGE_INTEGER file_size;
+
+    if (!GetFileSizeEx(file, &file_size) || (file_size.QuadPart <= 0) || (file_size.QuadPart > (MAX_ROM_SIZE + 512)) ||
+        (ROMStorageCapacity(static_cast<size_t>(file_size.QuadPart)) != static_cast<size_t>(file_size.QuadPart)))
+    {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+
+    if (mapping == NULL)
+        return NULL;
+
+    void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+
+    if (data == NULL)
+        return NULL;
+
+    size_t size = static_cast<size_t>(file_size.QuadPart);
+#else
+    int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+        return NULL;
+
+    struct stat st;
+
+    if ((fstat(fd, &st) != 0) || !S_ISREG(st.st_mode) || (st.st_size <= 0) || (st.st_size > (MAX_ROM_SIZE + 512)) ||
+        (ROMStorageCapacity(static_cast<size_t>(st.st_size)) != static_cast<size_t>(st.st_size)))
+    {
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void* data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (data == MAP_FAILED)
+        return NULL;
+#endif
+
+    ROMStorage* storage = new ROMStorage();
+    storage->references = 1;
+    storage->type = ROMStorageMapped;
+    storage->data = static_cast<u8*>(data);
+    storage->size = size;
+    storage->allocation = storage->data;
+    storage->capacity = size;
+
+    Debug("ROM mapped: %d bytes", (int)size);
+
+    return storage;
+#else
+    (void)path;
+    return NULL;
+#endif
+}
+
+Cartridge::ROMStorage* Cartridge::ReadROMStorage(const char* path)
+{
+    using namespace std;
+
+    ifstream file(path, ios::in | ios::binary | ios::ate);
+
+    if (!file.is_open())
+        return NULL;
+
+    streamoff size = file.tellg();
+
+    if ((size <= 0) || (size > (MAX_ROM_SIZE + 512)))
+        return NULL;
+
+    ROMStorage* storage = NewROMStorage(static_cast<size_t>(size));
+    file.seekg(0, ios::beg);
+    file.read(reinterpret_cast<char*> (storage->data), size);
+
+    if (file.fail())
+    {
+        FreeROMStorage(storage);
+        return NULL;
+    }
+
+    return storage;
+}
+
+void Cartridge::FreeROMStorage(ROMStorage* storage)
+{
+    if (!IsValidPointer(storage))
+        return;
+
+    if (storage->type == ROMStorageMapped)
+    {
+#if defined(GEARSYSTEM_MMAP)
+#if defined(_WIN32)
+        UnmapViewOfFile(storage->allocation);
+#else
+        munmap(storage->allocation, storage->capacity);
+#endif
+#endif
+    }
+    else
+    {
+        SafeDeleteArray(storage->allocation);
+    }
+
+    delete storage;
 }
 
 bool Cartridge::TestValidROM(u16 location)
@@ -688,117 +876,316 @@ bool Cartridge::GatherMetadata(u32 crc)
 
 void Cartridge::GetInfoFromDB(u32 crc)
 {
-    int i = 0;
-    bool found = false;
+    const GS_GameDBEntry* entry = FindDBEntry(crc);
 
-    while(!found && (kGameDatabase[i].title != 0))
+    if (IsValidPointer(entry))
     {
-        u32 db_crc = kGameDatabase[i].crc;
+        Log("ROM found in database: %s. CRC: %X", entry->title, crc);
+
+        m_iFeatures = entry->features;
 
-        if (db_crc == crc)
+        switch (entry->mapper)
         {
-            found = true;
+            case GS_DB_CODEMASTERS_MAPPER:
+                m_Type = Cartridge::CartridgeCodemastersMapper;
+                break;
+            case GS_DB_SG1000_MAPPER:
+                m_bSG1000 = true;
+                m_Type = Cartridge::CartridgeSG1000Mapper;
+                break;
+            case GS_DB_KOREAN_MAPPER:
+                m_Type = Cartridge::CartridgeKoreanMapper;
+                break;
+            case GS_DB_KOREAN_MSX_SMS_8000_MAPPER:
+                m_Type = Cartridge::CartridgeKoreanMSXSMS8000Mapper;
+                break;
+            case GS_DB_KOREAN_SMS_32KB_2000_MAPPER:
+                m_Type = Cartridge::CartridgeKoreanSMS32KB2000Mapper;
+                break;
+            case GS_DB_KOREAN_MSX_32KB_2000_MAPPER:
+                m_Type = Cartridge::CartridgeKoreanMSX32KB2000Mapper;
+                break;
+            case GS_DB_KOREAN_2000_XOR_1F_MAPPER:
+                m_Type = Cartridge::CartridgeKorean2000XOR1FMapper;
+                break;
+            case GS_DB_KOREAN_MSX_8KB_0300_MAPPER:
+                m_Type = Cartridge::CartridgeKoreanMSX8KB0300Mapper;
+                break;
+            case GS_DB_KOREAN_0000_XOR_FF_MAPPER:
+                m_Type = Cartridge::CartridgeKorean0000XORFFMapper;
+                break;
+            case GS_DB_KOREAN_FFFF_HICOM_MAPPER:
+                m_Type = Cartridge::CartridgeKoreanFFFFHiComMapper;
+                break;
+            case GS_DB_KOREAN_FFFE_MAPPER:
+                m_Type = Cartridge::CartridgeKoreanFFFEMapper;
+                break;
+            case GS_DB_KOREAN_BFFC_MAPPER:
+                m_Type = Cartridge::CartridgeKoreanBFFCMapper;
+                break;
+            case GS_DB_KOREAN_FFF3_FFFC_MAPPER:
+                m_Type = Cartridge::CartridgeKoreanFFF3FFFCMapper;
+                break;
+            case GS_DB_KOREAN_MD_FFF5_MAPPER:
+                m_Type = Cartridge::CartridgeKoreanMDFFF5Mapper;
+                break;
+            case GS_DB_MSX_MAPPER:
+                m_Type = Cartridge::CartridgeMSXMapper;
+                break;
+            case GS_DB_JANGGUN_MAPPER:
+                m_Type = Cartridge::CartridgeJanggunMapper;
+                break;
+            case GS_DB_MULTI_4PAK_ALL_ACTION_MAPPER:
+                m_Type = Cartridge::CartridgeMulti4PAKAllActionMapper;
+                break;
+            case GS_DB_JUMBO_DAHJEE_MAPPER:
+                m_Type = Cartridge::CartridgeJumboDahjeeMapper;
+                break;
+        }
 
-            Log("ROM found in database: %s. CRC: %X", kGameDatabase[i].title, crc);
+        if (entry->features & GS_DB_FEATURE_SMS_MODE)
+        {
+            Log("Forcing Master System mode");
+            m_bGameGear = false;
+        }
 
-            m_iFeatures = kGameDatabase[i].features;
+        if (entry->features & GS_DB_FEATURE_PAL)
+        {
+            Log("PAL cartridge: Running at 50Hz");
+            m_bPAL = true;
+        }
 
-            switch (kGameDatabase[i].mapper)
-            {
-                case GS_DB_CODEMASTERS_MAPPER:
-                    m_Type = Cartridge::CartridgeCodemastersMapper;
-                    break;
-                case GS_DB_SG1000_MAPPER:
-                    m_bSG1000 = true;
-                    m_Type = Cartridge::CartridgeSG1000Mapper;
-                    break;
-                case GS_DB_KOREAN_MAPPER:
-                    m_Type = Cartridge::CartridgeKoreanMapper;
-                    break;
-                case GS_DB_KOREAN_MSX_SMS_8000_MAPPER:
-                    m_Type = Cartridge::CartridgeKoreanMSXSMS8000Mapper;
-                    break;
-                case GS_DB_KOREAN_SMS_32KB_2000_MAPPER:
-                    m_Type = Cartridge::CartridgeKoreanSMS32KB2000Mapper;
-                    break;
-                case GS_DB_KOREAN_MSX_32KB_2000_MAPPER:
-                    m_Type = Cartridge::CartridgeKoreanMSX32KB2000Mapper;
-                    break;
-                case GS_DB_KOREAN_2000_XOR_1F_MAPPER:
-                    m_Type = Cartridge::CartridgeKorean2000XOR1FMapper;
-                    break;
-                case GS_DB_KOREAN_MSX_8KB_0300_MAPPER:
-                    m_Type = Cartridge::CartridgeKoreanMSX8KB0300Mapper;
-                    break;
-                case GS_DB_KOREAN_0000_XOR_FF_MAPPER:
-                    m_Type = Cartridge::CartridgeKorean0000XORFFMapper;
-                    break;
-                case GS_DB_KOREAN_FFFF_HICOM_MAPPER:
-                    m_Type = Cartridge::CartridgeKoreanFFFFHiComMapper;
-                    break;
-                case GS_DB_KOREAN_FFFE_MAPPER:
-                    m_Type = Cartridge::CartridgeKoreanFFFEMapper;
-                    break;
-                case GS_DB_KOREAN_BFFC_MAPPER:
-                    m_Type = Cartridge::CartridgeKoreanBFFCMapper;
-                    break;
-                case GS_DB_KOREAN_FFF3_FFFC_MAPPER:
-                    m_Type = Cartridge::CartridgeKoreanFFF3FFFCMapper;
-                    break;
-                case GS_DB_KOREAN_MD_FFF5_MAPPER:
-                    m_Type = Cartridge::CartridgeKoreanMDFFF5Mapper;
-                    break;
-                case GS_DB_MSX_MAPPER:
-                    m_Type = Cartridge::CartridgeMSXMapper;
-                    break;
-                case GS_DB_JANGGUN_MAPPER:
-                    m_Type = Cartridge::CartridgeJanggunMapper;
-                    break;
-                case GS_DB_MULTI_4PAK_ALL_ACTION_MAPPER:
-                    m_Type = Cartridge::CartridgeMulti4PAKAllActionMapper;
-                    break;
-                case GS_DB_JUMBO_DAHJEE_MAPPER:
-                    m_Type = Cartridge::CartridgeJumboDahjeeMapper;
-                    break;
-            }
+        if (entry->features & GS_DB_FEATURE_NO_BATTERY)
+        {
+            Log("Cartridge with SRAM but no battery");
+            m_bRAMWithoutBattery = true;
+        }
 
-            if (kGameDatabase[i].features & GS_DB_FEATURE_SMS_MODE)
-            {
-                Log("Forcing Master System mode");
-                m_bGameGear = false;
-            }
+        if (entry->features & GS_DB_FEATURE_YM2413)
+        {
+            Log("Cartridge with YM2413 sound chip support");
+        }
 
-            if (kGameDatabase[i].features & GS_DB_FEATURE_PAL)
-            {
-                Log("PAL cartridge: Running at 50Hz");
-                m_bPAL = true;
-            }
+        if (entry->features & GS_DB_FEATURE_FORCE_JAPAN_SMS)
+        {
+            Log("Forcing SMS Japan region");
+            m_Zone = CartridgeJapanSMS;
+        }
+    }
+    else
+    {
+        Log("ROM not found in database. CRC: %X", crc);
+    }
+}
 
-            if (kGameDatabase[i].features & GS_DB_FEATURE_NO_BATTERY)
-            {
-                Log("Cartridge with SRAM but no battery");
-                m_bRAMWithoutBattery = true;
-            }
+// The database stays grouped by mapper for editing. Lookups go through a
+// chained hash table that the compiler builds from it: the head of every
+// bucket plus a link from each entry to the next one in the same bucket.
+// Chains keep the database order, so a duplicated CRC resolves to the first
+// entry, as the old linear search did. Every slot is a separate constant
+// evaluation, which keeps them small for the compiler.
 
-            if (kGameDatabase[i].features & GS_DB_FEATURE_YM2413)
-            {
-                Log("Cartridge with YM2413 sound chip support");
-            }
+static const int kDBHashBuckets = 512;
 
-            if (kGameDatabase[i].features & GS_DB_FEATURE_FORCE_JAPAN_SMS)
-            {
-                Log("Forcing SMS Japan region");
-                m_Zone = CartridgeJapanSMS;
-            }
-        }
-        else
-            i++;
+static_assert(kGameDatabaseSize < 0xFFFF, "game database too big for the hash links");
+
+template <int... I> struct DBIndexList
+{
+    typedef DBIndexList type;
+};
+
+template <class A, class B> struct DBConcat;
+
+template <int... A, int... B> struct DBConcat<DBIndexList<A...>, DBIndexList<B...> > : DBIndexList<A..., (static_cast<int>(sizeof...(A)) + B)...>
+{
+};
+
+template <int N> struct DBMakeIndexList : DBConcat<typename DBMakeIndexList<N / 2>::type, typename DBMakeIndexList<N - N / 2>::type>
+{
+};
+
+template <> struct DBMakeIndexList<0> : DBIndexList<>
+{
+};
+
+template <> struct DBMakeIndexList<1> : DBIndexList<0>
+{
+};
+
+constexpr int DBHashBucket(u32 crc)
+{
+    return static_cast<int>((crc ^ (crc >> 16)) & (kDBHashBuckets - 1));
+}
+
+constexpr int DBMin(int a, int b)
+{
+    return (a < b) ? a : b;
+}
+
+constexpr int DBFirstInRun(int bucket, int first, int last)
+{
+    return (first >= last) ? kGameDatabaseSize :
+           (DBHashBucket(kGameDatabase[first].crc) == bucket) ? first : DBFirstInRun(bucket, first + 1, last);
+}
+
+// First entry in [first, last) that falls in bucket, or kGameDatabaseSize.
+// Split in halves down to short runs so the recursion depth stays small.
+constexpr int DBFirstInBucket(int bucket, int first, int last)
+{
+    return (last - first <= 32) ? DBFirstInRun(bucket, first, last) :
+           DBMin(DBFirstInBucket(bucket, first, first + (last - first) / 2), DBFirstInBucket(bucket, first + (last - first) / 2, last));
+}
+
+template <int B> struct DBBucketHead
+{
+    static constexpr u16 value = static_cast<u16>(DBFirstInBucket(B, 0, kGameDatabaseSize));
+};
+
+template <int E> struct DBEntryNext
+{
+    static constexpr u16 value = static_cast<u16>(DBFirstInBucket(DBHashBucket(kGameDatabase[E].crc), E + 1, kGameDatabaseSize));
+};
+
+struct DBHashTable
+{
+    u16 heads[kDBHashBuckets];
+    u16 next[kGameDatabaseSize + 1];
+};
+
+template <int... B, int... E> constexpr DBHashTable MakeDBHashTable(DBIndexList<B...>, DBIndexList<E...>)
+{
+    return DBHashTable { { DBBucketHead<B>::value... }, { DBEntryNext<E>::value..., static_cast<u16>(kGameDatabaseSize) } };
+}
+
+static constexpr DBHashTable kDBHashTable = MakeDBHashTable(DBMakeIndexList<kDBHashBuckets>::type(), DBMakeIndexList<kGameDatabaseSize>::type());
+
+const GS_GameDBEntry* Cartridge::FindDBEntry(u32 crc)
+{
+    int i = kDBHashTable.heads[DBHashBucket(crc)];
+
+    while (i < kGameDatabaseSize)
+    {
+        if (kGameDatabase[i].crc == crc)
+            return &kGameDatabase[i];
+
+        i = kDBHashTable.next[i];
     }
 
-    if (!found)
+    return NULL;
+}
+
+static int CompareTitlePrefix(const char* title, const char* prefix)
+{
+    for (; *prefix != 0; title++, prefix++)
     {
-        Log("ROM not found in database. CRC: %X", crc);
+        int a = tolower(static_cast<unsigned char>(*title));
+        int b = tolower(static_cast<unsigned char>(*prefix));
+
+        if (a != b)
+            return a - b;
+    }
+
+    return 0;
+}
+
+static bool CompareDBTitles(const GS_GameDBEntry* a, const GS_GameDBEntry* b)
+{
+    int diff = CompareTitlePrefix(a->title, b->title);
+
+    if (diff == 0)
+        diff = static_cast<int>(strlen(a->title)) - static_cast<int>(strlen(b->title));
+
+    return (diff != 0) ? (diff < 0) : (a < b);
+}
+
+static std::vector<const GS_GameDBEntry*> BuildDBTitleIndex()
+{
+    std::vector<const GS_GameDBEntry*> index;
+
+    for (int i = 0; i < kGameDatabaseSize; i++)
+        index.push_back(&kGameDatabase[i]);
+
+    std::sort(index.begin(), index.end(), CompareDBTitles);
+
+    return index;
+}
+
+static bool CompareDBTitleToPrefix(const GS_GameDBEntry* entry, const char* prefix)
+{
+    return CompareTitlePrefix(entry->title, prefix) < 0;
+}
+
+// Case insensitive, in title order. Meant for tooling, the index is only
+// built the first time it is needed.
+int Cartridge::FindDBEntriesByTitle(const char* prefix, std::vector<const GS_GameDBEntry*>& results)
+{
+    static const std::vector<const GS_GameDBEntry*> index = BuildDBTitleIndex();
+
+    results.clear();
+
+    std::vector<const GS_GameDBEntry*>::const_iterator it = std::lower_bound(index.begin(), index.end(), prefix, CompareDBTitleToPrefix);
+
+    for (; (it != index.end()) && (CompareTitlePrefix((*it)->title, prefix) == 0); ++it)
+        results.push_back(*it);
+
+    return static_cast<int>(results.size());
+}
+
+// Forked cores share the ROM buffer, it is only copied when a core patches it
+void Cartridge::ShareROM(const Cartridge& source)
+{
+    if (m_pROM != source.m_pROM)
+    {
+        Reset();
+
+        if (!source.m_bReady || !IsValidPointer(source.m_pROM))
+            return;
+
+        m_pROM = source.m_pROM;
+        m_pROMStorage = source.m_pROMStorage;
+        m_pROMStorage->references++;
     }
+
+    m_iROMSize = source.m_iROMSize;
+    m_Type = source.m_Type;
+    m_Zone = source.m_Zone;
+    m_bValidROM = source.m_bValidROM;
+    m_bReady = source.m_bReady;
+    strcpy(m_szFilePath, source.m_szFilePath);
+    strcpy(m_szFileName, source.m_szFileName);
+    m_iROMBankCount16k = source.m_iROMBankCount16k;
+    m_iROMBankCount8k = source.m_iROMBankCount8k;
+    m_bGameGear = source.m_bGameGear;
+    m_bSG1000 = source.m_bSG1000;
+    m_bPAL = source.m_bPAL;
+    m_bRAMWithoutBattery = source.m_bRAMWithoutBattery;
+    m_iCRC = source.m_iCRC;
+    m_iFeatures = source.m_iFeatures;
+    m_GameGenieList = source.m_GameGenieList;
+}
+
+void Cartridge::ReleaseROM()
+{
+    if (IsValidPointer(m_pROMStorage) && (--m_pROMStorage->references == 0))
+        FreeROMStorage(m_pROMStorage);
+
+    InitPointer(m_pROM);
+    InitPointer(m_pROMStorage);
+}
+
+void Cartridge::DetachROM()
+{
+    // Mappings are read only, patching always needs a private copy
+    if (!IsValidPointer(m_pROMStorage) || ((m_pROMStorage->references.load() == 1) && (m_pROMStorage->type == ROMStorageHeap)))
+        return;
+
+    ROMStorage* storage = NewROMStorage(m_iROMSize);
+    memcpy(storage->data, m_pROM, m_iROMSize);
+
+    ReleaseROM();
+
+    m_pROMStorage = storage;
+    m_pROM = storage->data;
 }
 
 void Cartridge::SetGameGenieCheat(const char* szCheat)
@@ -821,6 +1208,8 @@ void Cartridge::SetGameGenieCheat(const char* szCheat)
             avoid_compare = false;
         }
 
+        DetachROM();
+
         for (int bank = 0; bank < GetROMBankCount(); bank++)
         {
             int bank_address = (bank * 0x4000) + (cheat_address & 0x3FFF);
@@ -843,6 +1232,9 @@ void Cartridge::ClearGameGenieCheats()
 {
     std::list<GameGenieCode>::iterator it;
 
+    if (!m_GameGenieList.empty())
+        DetachROM();
+
     for (it = m_GameGenieList.begin(); it != m_GameGenieList.end(); it++)
     {
         m_pROM[it->address] = it->old_value;
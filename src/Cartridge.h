@@ -21,6 +21,8 @@
 #define	CARTRIDGE_H
 
 #include <list>
+#include <atomic>
+#include <vector>
 #include "definitions.h"
 #include "game_db.h"
 
@@ -109,18 +111,46 @@ public:
     u8* GetROM() const;
     bool LoadFromFile(const char* path);
     bool LoadFromBuffer(const u8* buffer, int size, const char* path = NULL);
+    void ShareROM(const Cartridge& source);
     void SetGameGenieCheat(const char* szCheat);
     void ClearGameGenieCheats();
+    static const GS_GameDBEntry* FindDBEntry(u32 crc);
+    static int FindDBEntriesByTitle(const char* prefix, std::vector<const GS_GameDBEntry*>& results);
+
+private:
+    enum ROMStorageType
+    {
+        ROMStorageHeap,
+        ROMStorageMapped
+    };
+
+    struct ROMStorage
+    {
+        std::atomic<int> references;
+        ROMStorageType type;
+        u8* data;
+        size_t size;
+        u8* allocation;
+        size_t capacity;
+    };
 
 private:
     bool GatherMetadata(u32 crc);
     void GetInfoFromDB(u32 crc);
     bool LoadFromZipFile(const u8* buffer, int size);
+    bool LoadFromStorage(ROMStorage* storage);
+    static ROMStorage* NewROMStorage(size_t size);
+    static ROMStorage* MapROMStorage(const char* path);
+    static ROMStorage* ReadROMStorage(const char* path);
+    static void FreeROMStorage(ROMStorage* storage);
     bool TestValidROM(u16 location);
     void SetROMPath(const char* path);
+    void ReleaseROM();
+    void DetachROM();
 
 private:
     u8* m_pROM;
+    ROMStorage* m_pROMStorage;
     int m_iROMSize;
     CartridgeTypes m_Type;
     CartridgeZones m_Zone;
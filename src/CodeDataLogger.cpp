@@ -0,0 +1,292 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+
+#include <stdio.h>
+#include "CodeDataLogger.h"
+#include "log.h"
+
+CodeDataLogger::CodeDataLogger()
+{
+    m_bEnabled = false;
+    m_bMapped = false;
+    m_bSuspended = false;
+    m_pScratch = new u8[0x400];
+    InitPointer(m_pROMMap);
+    m_iROMSize = 0;
+    m_iROMMapSize = 0;
+    m_iROMCRC = 0;
+    m_pRAMMap = new u8[0x2000];
+    m_pVRAMMap = new u8[0x4000];
+    InitPointer(m_pROM);
+    InitPointer(m_pRAM);
+
+    for (int i = 0; i < 64; i++)
+        InitPointer(m_MapperPages[i]);
+
+    m_InstructionAddress = 0;
+    m_NextAddress = 0;
+    m_SuspendedInstructionAddress = 0;
+    m_SuspendedNextAddress = 0;
+    Clear();
+    MapPages();
+}
+
+CodeDataLogger::~CodeDataLogger()
+{
+    SafeDeleteArray(m_pScratch);
+    SafeDeleteArray(m_pROMMap);
+    SafeDeleteArray(m_pRAMMap);
+    SafeDeleteArray(m_pVRAMMap);
+}
+
+void CodeDataLogger::Enable(bool enable)
+{
+    m_bEnabled = enable;
+    MapPages();
+}
+
+bool CodeDataLogger::IsEnabled()
+{
+    return m_bEnabled;
+}
+
+void CodeDataLogger::Clear()
+{
+    if (IsValidPointer(m_pROMMap))
+        memset(m_pROMMap, 0, m_iROMMapSize);
+
+    memset(m_pRAMMap, 0, 0x2000);
+    memset(m_pVRAMMap, 0, 0x4000);
+}
+
+// Called by the mapper whenever its pages change. Another ROM starts a new
+// log, the same ROM keeps logging into the current one.
+void CodeDataLogger::UpdatePages(const u8* const* pPages, const u8* pROM, int romSize, u32 romCRC, const u8* pRAM)
+{
+    for (int i = 0; i < 64; i++)
+        m_MapperPages[i] = pPages[i];
+
+    m_pROM = pROM;
+    m_pRAM = pRAM;
+
+    if (((u32)romSize != m_iROMSize) || (romCRC != m_iROMCRC))
+    {
+        if ((u32)romSize != m_iROMSize)
+        {
+            SafeDeleteArray(m_pROMMap);
+            m_iROMSize = romSize;
+            m_iROMMapSize = (m_iROMSize + 0x3FF) & ~0x3FF;
+
+            if (m_iROMMapSize > 0)
+                m_pROMMap = new u8[m_iROMMapSize];
+        }
+
+        m_iROMCRC = romCRC;
+        Clear();
+    }
+
+    MapPages();
+}
+
+// Unmapped while the BIOS or an empty slot is visible
+void CodeDataLogger::SetMapped(bool mapped)
+{
+    if (mapped != m_bMapped)
+    {
+        m_bMapped = mapped;
+        MapPages();
+    }
+}
+
+// The instruction flow resumes where it was suspended, so the first
+// instruction afterwards is not taken for a jump target
+void CodeDataLogger::Suspend(bool suspend)
+{
+    if (suspend == m_bSuspended)
+        return;
+
+    if (suspend)
+    {
+        m_SuspendedInstructionAddress = m_InstructionAddress;
+        m_SuspendedNextAddress = m_NextAddress;
+    }
+    else
+    {
+        m_InstructionAddress = m_SuspendedInstructionAddress;
+        m_NextAddress = m_SuspendedNextAddress;
+    }
+
+    m_bSuspended = suspend;
+    MapPages();
+}
+
+void CodeDataLogger::VRAMRead(u16 address)
+{
+    if (m_bEnabled && !m_bSuspended)
+        m_pVRAMMap[address & 0x3FFF] |= FlagData;
+}
+
+void CodeDataLogger::VRAMWrite(u16 address)
+{
+    if (m_bEnabled && !m_bSuspended)
+        m_pVRAMMap[address & 0x3FFF] |= FlagWrite;
+}
+
+u8 CodeDataLogger::GetFlags(Regions region, u32 offset)
+{
+    if (offset >= GetSize(region))
+        return 0;
+
+    return GetMap(region)[offset];
+}
+
+u8* CodeDataLogger::GetMap(Regions region)
+{
+    switch (region)
+    {
+        case RegionROM:
+            return m_pROMMap;
+        case RegionRAM:
+            return m_pRAMMap;
+        case RegionVRAM:
+            return m_pVRAMMap;
+        default:
+            return NULL;
+    }
+}
+
+u32 CodeDataLogger::GetSize(Regions region)
+{
+    switch (region)
+    {
+        case RegionROM:
+            return IsValidPointer(m_pROMMap) ? m_iROMSize : 0;
+        case RegionRAM:
+            return 0x2000;
+        case RegionVRAM:
+            return 0x4000;
+        default:
+            return 0;
+    }
+}
+
+// Number of bytes with any of the given flags
+u32 CodeDataLogger::Count(Regions region, u8 flags)
+{
+    u8* map = GetMap(region);
+    u32 size = GetSize(region);
+    u32 count = 0;
+
+    for (u32 i = 0; i < size; i++)
+    {
+        if (map[i] & flags)
+            count++;
+    }
+
+    return count;
+}
+
+bool CodeDataLogger::Save(const char* szFilePath)
+{
+    FILE* file = fopen(szFilePath, "wb");
+
+    if (!IsValidPointer(file))
+        return false;
+
+    FileHeader header;
+    header.magic = GS_CDL_MAGIC;
+    header.version = GS_CDL_VERSION;
+    header.regions = RegionCount;
+
+    for (int i = 0; i < RegionCount; i++)
+        header.sizes[i] = GetSize((Regions)i);
+
+    bool ok = (fwrite(&header, sizeof(header), 1, file) == 1);
+
+    for (int i = 0; ok && (i < RegionCount); i++)
+    {
+        if (header.sizes[i] > 0)
+            ok = (fwrite(GetMap((Regions)i), 1, header.sizes[i], file) == header.sizes[i]);
+    }
+
+    fclose(file);
+
+    return ok;
+}
+
+// The log must come from a ROM of the same size, and replaces the current one
+bool CodeDataLogger::Load(const char* szFilePath)
+{
+    FILE* file = fopen(szFilePath, "rb");
+
+    if (!IsValidPointer(file))
+        return false;
+
+    FileHeader header;
+    bool ok = (fread(&header, sizeof(header), 1, file) == 1) && (header.magic == GS_CDL_MAGIC) &&
+            (header.version == GS_CDL_VERSION) && (header.regions == RegionCount);
+
+    for (int i = 0; ok && (i < RegionCount); i++)
+        ok = (header.sizes[i] == GetSize((Regions)i));
+
+    if (!ok)
+    {
+        Log("Code/data log %s does not match the current ROM", szFilePath);
+        fclose(file);
+        return false;
+    }
+
+    for (int i = 0; ok && (i < RegionCount); i++)
+    {
+        if (header.sizes[i] > 0)
+            ok = (fread(GetMap((Regions)i), 1, header.sizes[i], file) == header.sizes[i]);
+    }
+
+    fclose(file);
+
+    return ok;
+}
+
+// ROM pages and the system RAM get their part of the log, anything else
+// (cartridge RAM, reversed banks, the BIOS) goes to the scratch page
+void CodeDataLogger::MapPages()
+{
+    const u8* romEnd = m_pROM + m_iROMSize;
+    const u8* ramEnd = m_pRAM + 0x4000;
+
+    for (int i = 0; i < 64; i++)
+    {
+        m_pReadPages[i] = m_pScratch;
+        m_pWritePages[i] = m_pScratch;
+
+        const u8* page = m_MapperPages[i];
+
+        if (!m_bEnabled || !m_bMapped || m_bSuspended || !IsValidPointer(page))
+            continue;
+
+        if (IsValidPointer(m_pROMMap) && (page >= m_pROM) && (page < romEnd) && ((u32)(page - m_pROM) + 0x400 <= m_iROMMapSize))
+            m_pReadPages[i] = m_pROMMap + (page - m_pROM);
+        else if (IsValidPointer(m_pRAM) && (page >= m_pRAM) && (page < ramEnd))
+        {
+            m_pReadPages[i] = m_pRAMMap + ((page - m_pRAM) & 0x1FFF);
+            m_pWritePages[i] = m_pReadPages[i];
+        }
+    }
+}
@@ -0,0 +1,136 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+
+#ifndef CODEDATALOGGER_H
+#define	CODEDATALOGGER_H
+
+#include "definitions.h"
+
+#define GS_CDL_MAGIC 0x4C444347
+#define GS_CDL_VERSION 1
+
+// Code/data log: one byte of flags per ROM, RAM and VRAM byte, telling what
+// the CPU did with it. The CPU side is reached through shadow pages that
+// follow the mapper's 1KB read pages, so logging a byte is a single OR and a
+// disabled log just writes to a scratch page.
+class CodeDataLogger
+{
+public:
+    enum Flags
+    {
+        FlagCode = 0x01,
+        FlagOperand = 0x02,
+        FlagData = 0x04,
+        FlagJumpTarget = 0x08,
+        FlagWrite = 0x10
+    };
+
+    enum Regions
+    {
+        RegionROM,
+        RegionRAM,
+        RegionVRAM,
+        RegionCount
+    };
+
+    struct FileHeader
+    {
+        u32 magic;
+        u16 version;
+        u16 regions;
+        u32 sizes[RegionCount];
+    };
+
+public:
+    CodeDataLogger();
+    ~CodeDataLogger();
+    void Enable(bool enable);
+    bool IsEnabled();
+    void Clear();
+    void UpdatePages(const u8* const* pPages, const u8* pROM, int romSize, u32 romCRC, const u8* pRAM);
+    void SetMapped(bool mapped);
+    void Suspend(bool suspend);
+    void Execute(u16 address);
+    void Fetch(u16 address, u8 flag);
+    void Read(u16 address);
+    void Write(u16 address);
+    void VRAMRead(u16 address);
+    void VRAMWrite(u16 address);
+    u8 GetFlags(Regions region, u32 offset);
+    u8* GetMap(Regions region);
+    u32 GetSize(Regions region);
+    u32 Count(Regions region, u8 flags);
+    bool Save(const char* szFilePath);
+    bool Load(const char* szFilePath);
+
+private:
+    void MapPages();
+
+private:
+    bool m_bEnabled;
+    bool m_bMapped;
+    bool m_bSuspended;
+    u8* m_pReadPages[64];
+    u8* m_pWritePages[64];
+    u8* m_pScratch;
+    u8* m_pROMMap;
+    u32 m_iROMSize;
+    u32 m_iROMMapSize;
+    u8* m_pRAMMap;
+    u8* m_pVRAMMap;
+    const u8* m_MapperPages[64];
+    const u8* m_pROM;
+    const u8* m_pRAM;
+    u32 m_iROMCRC;
+    u16 m_InstructionAddress;
+    u16 m_NextAddress;
+    u16 m_SuspendedInstructionAddress;
+    u16 m_SuspendedNextAddress;
+};
+
+// The CPU tells its opcode and operand fetches apart from data reads
+inline void CodeDataLogger::Fetch(u16 address, u8 flag)
+{
+    m_pReadPages[address >> 10][address & 0x3FF] |= flag;
+    m_NextAddress = address + 1;
+}
+
+inline void CodeDataLogger::Read(u16 address)
+{
+    m_pReadPages[address >> 10][address & 0x3FF] |= FlagData;
+}
+
+inline void CodeDataLogger::Write(u16 address)
+{
+    m_pWritePages[address >> 10][address & 0x3FF] |= FlagWrite;
+}
+
+// Anything but the byte after the last fetch (or a repeat of the same
+// instruction, as block transfers and HALT do) was reached by a jump, a
+// call, a return or an interrupt
+inline void CodeDataLogger::Execute(u16 address)
+{
+    if ((address != m_NextAddress) && (address != m_InstructionAddress))
+        m_pReadPages[address >> 10][address & 0x3FF] |= FlagJumpTarget;
+
+    m_InstructionAddress = address;
+}
+
+#endif	/* CODEDATALOGGER_H */
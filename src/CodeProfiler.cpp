@@ -0,0 +1,450 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+
+#include <algorithm>
+#include "CodeProfiler.h"
+#include "Memory.h"
+
+const u8 CodeProfiler::kKinds[256] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    2, 0, 0, 0, 1, 0, 0, 1, 2, 2, 0, 0, 1, 1, 0, 1,
+    2, 0, 0, 0, 1, 0, 0, 1, 2, 0, 0, 0, 1, 0, 0, 1,
+    2, 0, 0, 0, 1, 0, 0, 1, 2, 0, 0, 0, 1, 3, 0, 1,
+    2, 0, 0, 0, 1, 0, 0, 1, 2, 0, 0, 0, 1, 0, 0, 1
+};
+
+CodeProfiler::CodeProfiler(Memory* pMemory)
+{
+    m_pMemory = pMemory;
+    Reset();
+}
+
+void CodeProfiler::Reset()
+{
+    m_Counters.clear();
+    m_Edges.clear();
+    m_Stack.clear();
+    m_Nodes.clear();
+    m_NodeIds.clear();
+    m_CurrentLocation = 0;
+    m_CurrentKind = KindOther;
+    m_iTotalCycles = 0;
+    m_iTotalInstructions = 0;
+    m_iDroppedCalls = 0;
+
+    stNode root;
+    root.parent = 0;
+    root.function = kRootFunction;
+    root.cycles = 0;
+    m_Nodes.push_back(root);
+
+    stFrame frame;
+    frame.function = kRootFunction;
+    frame.caller = kRootFunction;
+    frame.callsite = 0;
+    frame.node = 0;
+    frame.sp = kRootSP;
+    frame.cycles = 0;
+    frame.instructions = 0;
+    frame.recursive = false;
+    m_Stack.push_back(frame);
+}
+
+// Called before the instruction runs, while the bank it was fetched from
+// is still mapped
+void CodeProfiler::BeginInstruction(u16 pc)
+{
+    m_CurrentLocation = Locate(pc);
+
+    u8 opcode = m_pMemory->Peek(pc);
+
+    for (int i = 1; ((opcode == 0xDD) || (opcode == 0xFD)) && (i < 4); i++)
+        opcode = m_pMemory->Peek(pc + i);
+
+    m_CurrentKind = kKinds[opcode];
+
+    if (m_CurrentKind == KindPrefixED)
+        m_CurrentKind = ((m_pMemory->Peek(pc + 1) & 0xC7) == 0x45) ? KindReturn : KindOther;
+}
+
+void CodeProfiler::EndInstruction(u16 sp, u16 newPC, u16 newSP, unsigned int cycles)
+{
+    stFrame& frame = m_Stack.back();
+    stCounter& counter = m_Counters[((u64)frame.function << 32) | m_CurrentLocation];
+    counter.executions++;
+    counter.cycles += cycles;
+    m_Nodes[frame.node].cycles += cycles;
+    m_iTotalCycles += cycles;
+    m_iTotalInstructions++;
+
+    // Conditional calls and returns only count when taken
+    if ((m_CurrentKind == KindCall) && (newSP == (u16)(sp - 2)))
+        Call(m_CurrentLocation, Locate(newPC), newSP);
+    else if ((m_CurrentKind == KindReturn) && (newSP == (u16)(sp + 2)))
+        Unwind(newSP);
+}
+
+void CodeProfiler::Interrupt(u16 sp, u16 vector, unsigned int cycles)
+{
+    u16 ret = m_pMemory->Peek(sp) | (m_pMemory->Peek(sp + 1) << 8);
+    u32 callee = Locate(vector);
+
+    Call(Locate(ret), callee, sp);
+
+    stFrame& frame = m_Stack.back();
+    m_Counters[((u64)frame.function << 32) | callee].cycles += cycles;
+    m_Nodes[frame.node].cycles += cycles;
+    m_iTotalCycles += cycles;
+}
+
+bool CodeProfiler::LoadSymbols(const char* szFilePath)
+{
+    using namespace std;
+
+    ifstream file(szFilePath);
+
+    if (!file.is_open())
+        return false;
+
+    string line;
+    bool valid_section = true;
+
+    while (getline(file, line))
+    {
+        size_t comment = line.find_first_of(';');
+        if (comment != string::npos)
+            line = line.substr(0, comment);
+        line = line.erase(0, line.find_first_not_of(" \t\r\n"));
+        line = line.erase(line.find_last_not_of(" \t\r\n") + 1);
+
+        if (line.empty())
+            continue;
+
+        if (line[0] == '[')
+        {
+            valid_section = (line.find("[labels]") != string::npos);
+            continue;
+        }
+
+        if (!valid_section)
+            continue;
+
+        unsigned int bank = 0;
+        unsigned int address = 0;
+        char name[128];
+
+        if ((sscanf(line.c_str(), "%x:%x %127s", &bank, &address, name) == 3) ||
+            (sscanf(line.c_str(), "%x %127s", &address, name) == 2))
+        {
+            AddSymbol(bank, address & 0xFFFF, name);
+        }
+    }
+
+    file.close();
+
+    return true;
+}
+
+// Symbols use the WLA-DX convention: 16KB ROM bank and CPU address
+void CodeProfiler::AddSymbol(int bank, u16 address, const char* szName)
+{
+    u32 location;
+
+    if (address >= 0xC000)
+        location = kRAMLocation | address;
+    else
+        location = (0x4000 * bank) + (address & 0x3FFF);
+
+    m_Symbols[location] = szName;
+}
+
+std::string CodeProfiler::GetName(u32 location)
+{
+    if (location == kRootFunction)
+        return "(root)";
+
+    std::map<u32, std::string>::iterator it = m_Symbols.find(location);
+
+    if (it != m_Symbols.end())
+        return it->second;
+
+    char name[16];
+
+    if (location & kRAMLocation)
+        snprintf(name, sizeof(name), "RAM:%04X", location & 0xFFFF);
+    else
+        snprintf(name, sizeof(name), "%02X:%04X", location >> 14, location & 0x3FFF);
+
+    return name;
+}
+
+u64 CodeProfiler::GetTotalCycles()
+{
+    return m_iTotalCycles;
+}
+
+u64 CodeProfiler::GetTotalInstructions()
+{
+    return m_iTotalInstructions;
+}
+
+static bool compare_functions(const CodeProfiler::stFunction& a, const CodeProfiler::stFunction& b)
+{
+    return a.self_cycles > b.self_cycles;
+}
+
+// Per function totals, sorted by self cycles
+void CodeProfiler::GetFunctions(std::vector<stFunction>& functions)
+{
+    std::map<u32, stFunction> collected;
+
+    for (std::unordered_map<u64, stCounter>::iterator it = m_Counters.begin(); it != m_Counters.end(); ++it)
+    {
+        u32 location = (u32)(it->first >> 32);
+        stFunction& function = collected[location];
+        function.executions += it->second.executions;
+        function.self_cycles += it->second.cycles;
+    }
+
+    EdgeMap edges;
+    CollectEdges(edges);
+
+    for (EdgeMap::iterator it = edges.begin(); it != edges.end(); ++it)
+    {
+        stFunction& function = collected[it->first.second];
+        function.calls += it->second.calls;
+        function.inclusive_cycles += it->second.outermost_cycles;
+    }
+
+    u32 root = kRootFunction;
+    collected[root].inclusive_cycles = m_iTotalCycles;
+
+    functions.clear();
+
+    for (std::map<u32, stFunction>::iterator it = collected.begin(); it != collected.end(); ++it)
+    {
+        it->second.location = it->first;
+        it->second.name = GetName(it->first);
+        functions.push_back(it->second);
+    }
+
+    std::sort(functions.begin(), functions.end(), compare_functions);
+}
+
+// Names are written once and then referenced by their id
+static void write_callgrind_name(FILE* file, const char* key, std::map<u32, int>& ids, u32 location, const std::string& name)
+{
+    std::map<u32, int>::iterator it = ids.find(location);
+
+    if (it != ids.end())
+    {
+        fprintf(file, "%s=(%d)\n", key, it->second);
+        return;
+    }
+
+    int id = (int)ids.size() + 1;
+    ids[location] = id;
+    fprintf(file, "%s=(%d) %s\n", key, id, name.c_str());
+}
+
+// Positions are ROM offsets, or 0x0100xxxx for code running from RAM
+bool CodeProfiler::ExportCallgrind(const char* szFilePath)
+{
+    FILE* file = fopen(szFilePath, "w");
+
+    if (!IsValidPointer(file))
+        return false;
+
+    std::map<u32, std::map<u32, stCounter> > lines;
+
+    for (std::unordered_map<u64, stCounter>::iterator it = m_Counters.begin(); it != m_Counters.end(); ++it)
+        lines[(u32)(it->first >> 32)][(u32)it->first] = it->second;
+
+    EdgeMap edges;
+    CollectEdges(edges);
+
+    std::map<u32, int> ids;
+
+    fprintf(file, "# callgrind format\n");
+    fprintf(file, "version: 1\n");
+    fprintf(file, "creator: Gearsystem\n");
+    fprintf(file, "positions: instr\n");
+    fprintf(file, "events: Tstates Instructions\n");
+    fprintf(file, "summary: %llu %llu\n\n", (unsigned long long)m_iTotalCycles, (unsigned long long)m_iTotalInstructions);
+
+    for (std::map<u32, std::map<u32, stCounter> >::iterator f = lines.begin(); f != lines.end(); ++f)
+    {
+        write_callgrind_name(file, "fn", ids, f->first, GetName(f->first));
+
+        for (std::map<u32, stCounter>::iterator l = f->second.begin(); l != f->second.end(); ++l)
+            fprintf(file, "0x%X %llu %llu\n", l->first, (unsigned long long)l->second.cycles, (unsigned long long)l->second.executions);
+
+        for (EdgeMap::iterator e = edges.lower_bound(EdgeKey((u64)f->first << 32, 0)); (e != edges.end()) && ((u32)(e->first.first >> 32) == f->first); ++e)
+        {
+            u32 callee = e->first.second;
+
+            write_callgrind_name(file, "cfn", ids, callee, GetName(callee));
+            fprintf(file, "calls=%llu 0x%X\n", (unsigned long long)e->second.calls, callee);
+            fprintf(file, "0x%X %llu %llu\n", (u32)e->first.first, (unsigned long long)e->second.cycles, (unsigned long long)e->second.instructions);
+        }
+
+        fprintf(file, "\n");
+    }
+
+    fclose(file);
+
+    return true;
+}
+
+// One line per call stack with its self cycles, the input of flamegraph.pl
+bool CodeProfiler::ExportFoldedStacks(const char* szFilePath)
+{
+    FILE* file = fopen(szFilePath, "w");
+
+    if (!IsValidPointer(file))
+        return false;
+
+    std::vector<std::string> paths(m_Nodes.size());
+
+    for (size_t n = 0; n < m_Nodes.size(); n++)
+    {
+        // Parents are always created before their children
+        if (n == 0)
+            paths[n] = GetName(m_Nodes[n].function);
+        else
+            paths[n] = paths[m_Nodes[n].parent] + ";" + GetName(m_Nodes[n].function);
+
+        if (m_Nodes[n].cycles > 0)
+            fprintf(file, "%s %llu\n", paths[n].c_str(), (unsigned long long)m_Nodes[n].cycles);
+    }
+
+    fclose(file);
+
+    return true;
+}
+
+u32 CodeProfiler::Locate(u16 address)
+{
+    if (address >= 0xC000)
+        return kRAMLocation | address;
+
+    MemoryRule* rule = m_pMemory->GetCurrentRule();
+
+    if (rule->Has8kBanks())
+        return (0x2000 * rule->GetBank((address >> 13) & 0x07)) + (address & 0x1FFF);
+    else
+        return (0x4000 * rule->GetBank((address >> 14) & 0x03)) + (address & 0x3FFF);
+}
+
+void CodeProfiler::Call(u32 callsite, u32 callee, u16 sp)
+{
+    // Frames whose return address was below the new one are gone
+    Unwind((u32)sp + 2);
+
+    if (m_Stack.size() >= kMaxDepth)
+    {
+        m_iDroppedCalls++;
+        return;
+    }
+
+    stFrame& top = m_Stack.back();
+    u64 node_key = ((u64)top.node << 32) | callee;
+    std::map<u64, u32>::iterator it = m_NodeIds.find(node_key);
+    u32 node;
+
+    if (it == m_NodeIds.end())
+    {
+        stNode new_node;
+        new_node.parent = top.node;
+        new_node.function = callee;
+        new_node.cycles = 0;
+        node = (u32)m_Nodes.size();
+        m_Nodes.push_back(new_node);
+        m_NodeIds[node_key] = node;
+    }
+    else
+        node = it->second;
+
+    stFrame frame;
+    frame.recursive = false;
+
+    for (size_t f = 0; f < m_Stack.size(); f++)
+    {
+        if (m_Stack[f].function == callee)
+        {
+            frame.recursive = true;
+            break;
+        }
+    }
+
+    frame.function = callee;
+    frame.caller = top.function;
+    frame.callsite = callsite;
+    frame.node = node;
+    frame.sp = sp;
+    frame.cycles = m_iTotalCycles;
+    frame.instructions = m_iTotalInstructions;
+    m_Stack.push_back(frame);
+}
+
+void CodeProfiler::Unwind(u32 sp)
+{
+    while ((m_Stack.size() > 1) && (m_Stack.back().sp < sp))
+        Pop();
+}
+
+void CodeProfiler::Pop()
+{
+    AddEdge(m_Edges, m_Stack.back());
+    m_Stack.pop_back();
+}
+
+// Recursive calls are already inside the outermost one, so only that one
+// adds to the function inclusive time
+void CodeProfiler::AddEdge(EdgeMap& edges, const stFrame& frame)
+{
+    stEdge& edge = edges[EdgeKey(((u64)frame.caller << 32) | frame.callsite, frame.function)];
+    edge.calls++;
+    edge.cycles += m_iTotalCycles - frame.cycles;
+    edge.instructions += m_iTotalInstructions - frame.instructions;
+
+    if (!frame.recursive)
+        edge.outermost_cycles += m_iTotalCycles - frame.cycles;
+}
+
+// Completed calls plus the ones still on the stack
+void CodeProfiler::CollectEdges(EdgeMap& edges)
+{
+    edges = m_Edges;
+
+    for (size_t f = 1; f < m_Stack.size(); f++)
+        AddEdge(edges, m_Stack[f]);
+}
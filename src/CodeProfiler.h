@@ -0,0 +1,138 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+
+#ifndef CODEPROFILER_H
+#define	CODEPROFILER_H
+
+#include <vector>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include "definitions.h"
+
+class Memory;
+
+// Cycle exact profile of the executed code, per ROM location. Calls are
+// followed from CALL, RST and interrupt entry, and returns unwind every
+// frame whose return address has been popped, so code that discards
+// return addresses or reloads SP does not grow the call stack.
+class CodeProfiler
+{
+public:
+    struct stFunction
+    {
+        u32 location;
+        std::string name;
+        u64 calls;
+        u64 executions;
+        u64 self_cycles;
+        u64 inclusive_cycles;
+    };
+
+public:
+    CodeProfiler(Memory* pMemory);
+    void Reset();
+    void BeginInstruction(u16 pc);
+    void EndInstruction(u16 sp, u16 newPC, u16 newSP, unsigned int cycles);
+    void Interrupt(u16 sp, u16 vector, unsigned int cycles);
+    bool LoadSymbols(const char* szFilePath);
+    void AddSymbol(int bank, u16 address, const char* szName);
+    std::string GetName(u32 location);
+    u64 GetTotalCycles();
+    u64 GetTotalInstructions();
+    void GetFunctions(std::vector<stFunction>& functions);
+    bool ExportCallgrind(const char* szFilePath);
+    bool ExportFoldedStacks(const char* szFilePath);
+
+private:
+    enum Kinds
+    {
+        KindOther,
+        KindCall,
+        KindReturn,
+        KindPrefixED
+    };
+
+    struct stCounter
+    {
+        u64 executions;
+        u64 cycles;
+    };
+
+    struct stEdge
+    {
+        u64 calls;
+        u64 cycles;
+        u64 instructions;
+        u64 outermost_cycles;
+    };
+
+    struct stFrame
+    {
+        u32 function;
+        u32 caller;
+        u32 callsite;
+        u32 node;
+        u32 sp;
+        u64 cycles;
+        u64 instructions;
+        bool recursive;
+    };
+
+    struct stNode
+    {
+        u32 parent;
+        u32 function;
+        u64 cycles;
+    };
+
+    typedef std::pair<u64, u32> EdgeKey;
+    typedef std::map<EdgeKey, stEdge> EdgeMap;
+
+    static const u32 kRAMLocation = 0x01000000;
+    static const u32 kRootFunction = 0xFFFFFFFF;
+    static const u32 kRootSP = 0x10000;
+    static const size_t kMaxDepth = 256;
+    static const u8 kKinds[256];
+
+private:
+    u32 Locate(u16 address);
+    void Call(u32 callsite, u32 callee, u16 sp);
+    void Unwind(u32 sp);
+    void Pop();
+    void AddEdge(EdgeMap& edges, const stFrame& frame);
+    void CollectEdges(EdgeMap& edges);
+
+private:
+    Memory* m_pMemory;
+    std::unordered_map<u64, stCounter> m_Counters;
+    EdgeMap m_Edges;
+    std::vector<stFrame> m_Stack;
+    std::vector<stNode> m_Nodes;
+    std::map<u64, u32> m_NodeIds;
+    std::map<u32, std::string> m_Symbols;
+    u32 m_CurrentLocation;
+    u8 m_CurrentKind;
+    u64 m_iTotalCycles;
+    u64 m_iTotalInstructions;
+    u64 m_iDroppedCalls;
+};
+
+#endif	/* CODEPROFILER_H */
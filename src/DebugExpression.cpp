@@ -0,0 +1,381 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <ctype.h>
+#include "DebugExpression.h"
+#include "Memory.h"
+#include "Processor.h"
+
+// Binary operators by precedence, lowest first. Longer operators go before
+// their prefixes so "<=" is not read as "<"
+const DebugExpression::Operator DebugExpression::kOperators[kOperatorLevels][4] =
+{
+    { { "||", OpLogicalOr }, { NULL, 0 } },
+    { { "&&", OpLogicalAnd }, { NULL, 0 } },
+    { { "|", OpOr }, { NULL, 0 } },
+    { { "^", OpXor }, { NULL, 0 } },
+    { { "&", OpAnd }, { NULL, 0 } },
+    { { "==", OpEqual }, { "!=", OpNotEqual }, { NULL, 0 } },
+    { { "<=", OpLessEqual }, { ">=", OpGreaterEqual }, { "<", OpLess }, { ">", OpGreater } },
+    { { "<<", OpShiftLeft }, { ">>", OpShiftRight }, { NULL, 0 } },
+    { { "+", OpAdd }, { "-", OpSubtract }, { NULL, 0 } },
+    { { "*", OpMultiply }, { "/", OpDivide }, { "%", OpModulo }, { NULL, 0 } }
+};
+
+static const char* const kDebugRegisterNames[] =
+{
+    "A", "F", "B", "C", "D", "E", "H", "L", "I", "R",
+    "AF", "BC", "DE", "HL", "IX", "IY", "SP", "PC"
+};
+
+DebugExpression::DebugExpression()
+{
+    Clear();
+}
+
+void DebugExpression::Clear()
+{
+    m_iCount = 0;
+    m_szSource[0] = 0;
+    m_szError[0] = 0;
+    m_pCursor = NULL;
+}
+
+bool DebugExpression::IsEmpty() const
+{
+    return m_iCount == 0;
+}
+
+const char* DebugExpression::GetSource() const
+{
+    return m_szSource;
+}
+
+const char* DebugExpression::GetError() const
+{
+    return m_szError;
+}
+
+bool DebugExpression::Compile(const char* szExpression)
+{
+    Clear();
+
+    if (!IsValidPointer(szExpression))
+        return true;
+
+    strncpy(m_szSource, szExpression, sizeof(m_szSource) - 1);
+    m_szSource[sizeof(m_szSource) - 1] = 0;
+    m_pCursor = m_szSource;
+
+    SkipSpaces();
+
+    if (*m_pCursor == 0)
+    {
+        m_szSource[0] = 0;
+        return true;
+    }
+
+    bool ok = ParseBinary(0);
+
+    if (ok)
+    {
+        SkipSpaces();
+
+        if (*m_pCursor != 0)
+            ok = Fail("Unexpected character");
+    }
+
+    if (!ok)
+        m_iCount = 0;
+
+    m_pCursor = NULL;
+
+    return ok;
+}
+
+int DebugExpression::Evaluate(Processor* pProcessor, Memory* pMemory, u16 address, u8 value) const
+{
+    s32 stack[kMaxInstructions];
+    int top = 0;
+    Processor::ProcessorState* state = pProcessor->GetState();
+
+    for (int i = 0; i < m_iCount; i++)
+    {
+        const Instruction& instruction = m_Code[i];
+
+        if (instruction.op <= OpValue)
+        {
+            s32 operand = instruction.operand;
+
+            switch (instruction.op)
+            {
+                case OpRegister:
+                {
+                    switch (operand)
+                    {
+                        case RegisterA: operand = state->AF->GetHigh(); break;
+                        case RegisterF: operand = state->AF->GetLow(); break;
+                        case RegisterB: operand = state->BC->GetHigh(); break;
+                        case RegisterC: operand = state->BC->GetLow(); break;
+                        case RegisterD: operand = state->DE->GetHigh(); break;
+                        case RegisterE: operand = state->DE->GetLow(); break;
+                        case RegisterH: operand = state->HL->GetHigh(); break;
+                        case RegisterL: operand = state->HL->GetLow(); break;
+                        case RegisterI: operand = *state->I; break;
+                        case RegisterR: operand = *state->R; break;
+                        case RegisterAF: operand = state->AF->GetValue(); break;
+                        case RegisterBC: operand = state->BC->GetValue(); break;
+                        case RegisterDE: operand = state->DE->GetValue(); break;
+                        case RegisterHL: operand = state->HL->GetValue(); break;
+                        case RegisterIX: operand = state->IX->GetValue(); break;
+                        case RegisterIY: operand = state->IY->GetValue(); break;
+                        case RegisterSP: operand = state->SP->GetValue(); break;
+                        default: operand = state->PC->GetValue(); break;
+                    }
+                    break;
+                }
+                case OpAddress:
+                    operand = address;
+                    break;
+                case OpValue:
+                    operand = value;
+                    break;
+            }
+
+            stack[top++] = operand;
+            continue;
+        }
+
+        s32& a = stack[top - 1];
+
+        switch (instruction.op)
+        {
+            case OpPeek: a = pMemory->Peek((u16)a); continue;
+            case OpNot: a = !a; continue;
+            case OpComplement: a = ~a; continue;
+            case OpNegate: a = -a; continue;
+        }
+
+        s32 b = stack[--top];
+        s32& r = stack[top - 1];
+
+        switch (instruction.op)
+        {
+            case OpMultiply: r = r * b; break;
+            case OpDivide: r = (b != 0) ? (r / b) : 0; break;
+            case OpModulo: r = (b != 0) ? (r % b) : 0; break;
+            case OpAdd: r = r + b; break;
+            case OpSubtract: r = r - b; break;
+            case OpShiftLeft: r = r << (b & 31); break;
+            case OpShiftRight: r = r >> (b & 31); break;
+            case OpLess: r = r < b; break;
+            case OpLessEqual: r = r <= b; break;
+            case OpGreater: r = r > b; break;
+            case OpGreaterEqual: r = r >= b; break;
+            case OpEqual: r = r == b; break;
+            case OpNotEqual: r = r != b; break;
+            case OpAnd: r = r & b; break;
+            case OpXor: r = r ^ b; break;
+            case OpOr: r = r | b; break;
+            case OpLogicalAnd: r = r && b; break;
+            case OpLogicalOr: r = r || b; break;
+        }
+    }
+
+    return (top > 0) ? stack[top - 1] : 1;
+}
+
+bool DebugExpression::ParseBinary(int level)
+{
+    if (level >= kOperatorLevels)
+        return ParseUnary();
+
+    if (!ParseBinary(level + 1))
+        return false;
+
+    int op;
+
+    while ((op = MatchOperator(level)) >= 0)
+    {
+        if (!ParseBinary(level + 1))
+            return false;
+
+        if (!Emit((u8)op))
+            return false;
+    }
+
+    return true;
+}
+
+bool DebugExpression::ParseUnary()
+{
+    SkipSpaces();
+
+    u8 op;
+
+    switch (*m_pCursor)
+    {
+        case '!': op = OpNot; break;
+        case '~': op = OpComplement; break;
+        case '-': op = OpNegate; break;
+        default: return ParsePrimary();
+    }
+
+    m_pCursor++;
+
+    return ParseUnary() && Emit(op);
+}
+
+bool DebugExpression::ParsePrimary()
+{
+    SkipSpaces();
+
+    char c = *m_pCursor;
+
+    if (c == '(' || c == '[')
+    {
+        char close = (c == '(') ? ')' : ']';
+        m_pCursor++;
+
+        if (!ParseBinary(0))
+            return false;
+
+        SkipSpaces();
+
+        if (*m_pCursor != close)
+            return Fail((close == ')') ? "Missing )" : "Missing ]");
+
+        m_pCursor++;
+
+        return (close == ']') ? Emit(OpPeek) : true;
+    }
+
+    if (c == '$' || isdigit((unsigned char)c))
+    {
+        int base = 10;
+
+        if (c == '$')
+        {
+            base = 16;
+            m_pCursor++;
+        }
+        else if ((c == '0') && ((m_pCursor[1] == 'x') || (m_pCursor[1] == 'X')))
+        {
+            base = 16;
+            m_pCursor += 2;
+        }
+
+        char* end = NULL;
+        long number = strtol(m_pCursor, &end, base);
+
+        if (end == m_pCursor)
+            return Fail("Invalid number");
+
+        m_pCursor = end;
+
+        return Emit(OpNumber, (s32)number);
+    }
+
+    if (isalpha((unsigned char)c))
+        return ParseIdentifier();
+
+    return Fail((c == 0) ? "Unexpected end" : "Unexpected character");
+}
+
+bool DebugExpression::ParseIdentifier()
+{
+    char name[16];
+    int length = 0;
+
+    while (isalnum((unsigned char)*m_pCursor) || (*m_pCursor == '_'))
+    {
+        if (length < (int)sizeof(name) - 1)
+            name[length++] = (char)toupper((unsigned char)*m_pCursor);
+        m_pCursor++;
+    }
+
+    name[length] = 0;
+
+    if (strcmp(name, "VALUE") == 0)
+        return Emit(OpValue);
+
+    if (strcmp(name, "ADDRESS") == 0)
+        return Emit(OpAddress);
+
+    for (int r = 0; r <= RegisterPC; r++)
+    {
+        if (strcmp(name, kDebugRegisterNames[r]) == 0)
+            return Emit(OpRegister, r);
+    }
+
+    return Fail("Unknown name");
+}
+
+int DebugExpression::MatchOperator(int level)
+{
+    SkipSpaces();
+
+    for (int i = 0; (i < 4) && IsValidPointer(kOperators[level][i].text); i++)
+    {
+        const char* text = kOperators[level][i].text;
+        size_t length = strlen(text);
+
+        if (strncmp(m_pCursor, text, length) != 0)
+            continue;
+
+        // "|", "&", "<" and ">" must not eat the first half of "||", "&&",
+        // "<<" and ">>"
+        if ((length == 1) && (m_pCursor[1] == text[0]) && IsValidPointer(strchr("|&<>", text[0])))
+            continue;
+
+        m_pCursor += length;
+        return kOperators[level][i].op;
+    }
+
+    return -1;
+}
+
+void DebugExpression::SkipSpaces()
+{
+    while (isspace((unsigned char)*m_pCursor))
+        m_pCursor++;
+}
+
+bool DebugExpression::Emit(u8 op, s32 operand)
+{
+    if (m_iCount >= kMaxInstructions)
+        return Fail("Expression too long");
+
+    m_Code[m_iCount].op = op;
+    m_Code[m_iCount].operand = operand;
+    m_iCount++;
+
+    return true;
+}
+
+bool DebugExpression::Fail(const char* szError)
+{
+    if (m_szError[0] == 0)
+    {
+        strncpy(m_szError, szError, sizeof(m_szError) - 1);
+        m_szError[sizeof(m_szError) - 1] = 0;
+    }
+
+    return false;
+}
@@ -0,0 +1,132 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef DEBUGEXPRESSION_H
+#define	DEBUGEXPRESSION_H
+
+#include "definitions.h"
+
+class Memory;
+class Processor;
+
+// Breakpoint condition, compiled once into a small stack bytecode.
+// Operands: numbers (42, 0x2A, $2A), registers (A, F, B, C, D, E, H, L,
+// I, R, AF, BC, DE, HL, IX, IY, SP, PC), [expr] for a memory byte,
+// "value" and "address" for the access that triggered the breakpoint.
+// Operators follow C precedence: ! ~ - * / % + - << >> < <= > >= == !=
+// & ^ | && ||
+class DebugExpression
+{
+public:
+    DebugExpression();
+    bool Compile(const char* szExpression);
+    void Clear();
+    bool IsEmpty() const;
+    int Evaluate(Processor* pProcessor, Memory* pMemory, u16 address, u8 value) const;
+    const char* GetSource() const;
+    const char* GetError() const;
+
+private:
+    enum Ops
+    {
+        OpNumber,
+        OpRegister,
+        OpAddress,
+        OpValue,
+        OpPeek,
+        OpNot,
+        OpComplement,
+        OpNegate,
+        OpMultiply,
+        OpDivide,
+        OpModulo,
+        OpAdd,
+        OpSubtract,
+        OpShiftLeft,
+        OpShiftRight,
+        OpLess,
+        OpLessEqual,
+        OpGreater,
+        OpGreaterEqual,
+        OpEqual,
+        OpNotEqual,
+        OpAnd,
+        OpXor,
+        OpOr,
+        OpLogicalAnd,
+        OpLogicalOr
+    };
+
+    enum Registers
+    {
+        RegisterA,
+        RegisterF,
+        RegisterB,
+        RegisterC,
+        RegisterD,
+        RegisterE,
+        RegisterH,
+        RegisterL,
+        RegisterI,
+        RegisterR,
+        RegisterAF,
+        RegisterBC,
+        RegisterDE,
+        RegisterHL,
+        RegisterIX,
+        RegisterIY,
+        RegisterSP,
+        RegisterPC
+    };
+
+    struct Instruction
+    {
+        u8 op;
+        s32 operand;
+    };
+
+    struct Operator
+    {
+        const char* text;
+        u8 op;
+    };
+
+    static const int kMaxInstructions = 48;
+    static const int kOperatorLevels = 10;
+    static const Operator kOperators[kOperatorLevels][4];
+
+private:
+    bool ParseBinary(int level);
+    bool ParseUnary();
+    bool ParsePrimary();
+    bool ParseIdentifier();
+    int MatchOperator(int level);
+    void SkipSpaces();
+    bool Emit(u8 op, s32 operand = 0);
+    bool Fail(const char* szError);
+
+private:
+    Instruction m_Code[kMaxInstructions];
+    int m_iCount;
+    char m_szSource[64];
+    char m_szError[48];
+    const char* m_pCursor;
+};
+
+#endif	/* DEBUGEXPRESSION_H */
@@ -0,0 +1,431 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+
+#include <algorithm>
+#include "ExecutionTrace.h"
+#include "Processor.h"
+#include "Memory.h"
+
+ExecutionTrace::ExecutionTrace(Processor* pProcessor, Memory* pMemory, size_t records)
+{
+    m_pProcessor = pProcessor;
+    m_pMemory = pMemory;
+
+    size_t capacity = 1024;
+
+    while (capacity < records)
+        capacity <<= 1;
+
+    m_pRing = new Record[capacity];
+    memset(m_pRing, 0, capacity * sizeof(Record));
+    m_iMask = capacity - 1;
+    m_StartTrigger = TriggerNone;
+    m_iStartValue = 0;
+    m_StopTrigger = TriggerNone;
+    m_iStopValue = 0;
+    Reset();
+}
+
+ExecutionTrace::~ExecutionTrace()
+{
+    SafeDeleteArray(m_pRing);
+}
+
+void ExecutionTrace::Reset()
+{
+    m_iHead.store(0, std::memory_order_release);
+    m_iWrite = 0;
+    m_iCycles = 0;
+    m_iDroppedAccesses = 0;
+    m_iFrame = 0;
+    m_bRecording = (m_StartTrigger == TriggerNone);
+    m_bArmed = true;
+    m_bInInstruction = false;
+    m_bContinued = false;
+    m_bFullRegisters = true;
+    m_iPC = 0;
+    m_iBank = 0;
+    m_iTimestamp = 0;
+    m_iPendingCycles = 0;
+    m_iOpcodeCount = 0;
+    m_iAccessCount = 0;
+    m_bAccessesDropped = false;
+
+    for (int i = 0; i < RegisterCount; i++)
+        m_Registers[i] = 0;
+}
+
+// Without a start trigger recording begins right away
+void ExecutionTrace::SetStartTrigger(Triggers trigger, u32 value)
+{
+    m_StartTrigger = trigger;
+    m_iStartValue = value;
+    m_bRecording = (trigger == TriggerNone);
+    m_bArmed = true;
+}
+
+void ExecutionTrace::SetStopTrigger(Triggers trigger, u32 value)
+{
+    m_StopTrigger = trigger;
+    m_iStopValue = value;
+}
+
+void ExecutionTrace::Start()
+{
+    if (!m_bRecording)
+    {
+        m_bRecording = true;
+        m_bFullRegisters = true;
+    }
+}
+
+void ExecutionTrace::Stop()
+{
+    m_bRecording = false;
+    m_bInInstruction = false;
+    m_bContinued = false;
+}
+
+bool ExecutionTrace::IsRecording()
+{
+    return m_bRecording;
+}
+
+void ExecutionTrace::BeginInstruction(u16 pc)
+{
+    // The second step of IN A,(n) fetches the opcode again
+    if (m_bContinued)
+    {
+        m_bContinued = false;
+
+        if (m_bInInstruction)
+        {
+            m_iOpcodeCount = 0;
+            m_iAccessCount = 0;
+            return;
+        }
+    }
+
+    if (m_bRecording)
+        CheckStopTrigger(TriggerAddress, pc);
+    else
+        CheckStartTrigger(TriggerAddress, pc);
+
+    m_bInInstruction = m_bRecording;
+
+    if (!m_bRecording)
+        return;
+
+    m_iPC = pc;
+    m_iTimestamp = (u32)m_iCycles;
+    m_iPendingCycles = 0;
+    m_iOpcodeCount = 0;
+    m_iAccessCount = 0;
+    m_bAccessesDropped = false;
+
+    if (pc >= 0xC000)
+        m_iBank = 0;
+    else
+    {
+        MemoryRule* rule = m_pMemory->GetCurrentRule();
+
+        if (rule->Has8kBanks())
+            m_iBank = (u16)(rule->GetBank((pc >> 13) & 0x07) >> 1);
+        else
+            m_iBank = (u16)rule->GetBank((pc >> 14) & 0x03);
+    }
+}
+
+void ExecutionTrace::EndInstruction(unsigned int cycles, bool continues)
+{
+    m_iCycles += cycles;
+
+    if (!m_bInInstruction)
+        return;
+
+    // Instructions executed in two steps make a single record
+    if (continues)
+    {
+        m_iPendingCycles += cycles;
+        m_bContinued = true;
+        return;
+    }
+
+    cycles += m_iPendingCycles;
+    m_iPendingCycles = 0;
+    m_bInInstruction = false;
+
+    int length = m_iOpcodeCount;
+
+    u16 registers[RegisterCount];
+    ReadRegisters(registers);
+
+    Record* record = NextRecord();
+    record->instruction.type = RecordInstruction;
+    record->instruction.flags = (u8)length;
+    record->instruction.bank = m_iBank;
+    record->instruction.pc = m_iPC;
+    record->instruction.cycles = (u16)cycles;
+    record->instruction.timestamp = m_iTimestamp;
+
+    // The fetched values, memory may have changed since they were read
+    for (int i = 0; i < 4; i++)
+        record->instruction.opcodes[i] = (i < length) ? m_Opcodes[i] : 0;
+
+    if (registers[RegisterControl] & 0x0400)
+        record->instruction.flags |= FlagHalted;
+    if (m_bAccessesDropped)
+        record->instruction.flags |= FlagAccessesDropped;
+
+    record = NULL;
+
+    for (int i = 0; i < RegisterCount; i++)
+    {
+        if (!m_bFullRegisters && (registers[i] == m_Registers[i]))
+            continue;
+
+        if (!IsValidPointer(record) || (record->registers.count == 3))
+        {
+            record = NextRecord();
+            record->registers.type = RecordRegisters;
+            record->registers.count = 0;
+        }
+
+        int e = record->registers.count++;
+        record->registers.entries[e].id = (u8)i;
+        record->registers.entries[e].unused = 0;
+        record->registers.entries[e].value = registers[i];
+        m_Registers[i] = registers[i];
+    }
+
+    m_bFullRegisters = false;
+    record = NULL;
+
+    for (int i = 0; i < m_iAccessCount; i++)
+    {
+        if (!IsValidPointer(record) || (record->accesses.count == 3))
+        {
+            record = NextRecord();
+            record->accesses.type = RecordAccesses;
+            record->accesses.count = 0;
+        }
+
+        int e = record->accesses.count++;
+        record->accesses.entries[e].kind = m_Accesses[i].kind;
+        record->accesses.entries[e].value = m_Accesses[i].value;
+        record->accesses.entries[e].address = m_Accesses[i].address;
+    }
+
+    Publish();
+}
+
+// The first four fetched bytes, prefixes and DDCB/FDCB displacements included
+void ExecutionTrace::Fetch(u8 value)
+{
+    if (m_bInInstruction && (m_iOpcodeCount < 4))
+        m_Opcodes[m_iOpcodeCount++] = value;
+}
+
+void ExecutionTrace::Access(u16 address, u8 kind, u8 value)
+{
+    if (!m_bInInstruction)
+        return;
+
+    if (m_iAccessCount == kMaxAccesses)
+    {
+        m_bAccessesDropped = true;
+        m_iDroppedAccesses++;
+        return;
+    }
+
+    m_Accesses[m_iAccessCount].kind = kind;
+    m_Accesses[m_iAccessCount].value = value;
+    m_Accesses[m_iAccessCount].address = address;
+    m_iAccessCount++;
+}
+
+void ExecutionTrace::Interrupt(u16 sp, u16 vector, unsigned int cycles)
+{
+    if (m_bRecording)
+    {
+        u16 ret = m_pMemory->Peek(sp) | (m_pMemory->Peek(sp + 1) << 8);
+        WriteEvent(RecordInterrupt, vector, ret);
+        Publish();
+    }
+
+    m_iCycles += cycles;
+}
+
+void ExecutionTrace::Frame()
+{
+    m_iFrame++;
+
+    if (m_bRecording)
+        CheckStopTrigger(TriggerFrame, m_iFrame);
+    else
+        CheckStartTrigger(TriggerFrame, m_iFrame);
+
+    if (m_bRecording)
+    {
+        WriteEvent(RecordFrame, 0, m_iFrame);
+        Publish();
+    }
+}
+
+void ExecutionTrace::Breakpoint()
+{
+    if (m_bRecording)
+        CheckStopTrigger(TriggerBreakpoint, 0);
+    else
+        CheckStartTrigger(TriggerBreakpoint, 0);
+}
+
+u64 ExecutionTrace::GetRecordCount()
+{
+    return m_iHead.load(std::memory_order_acquire);
+}
+
+u64 ExecutionTrace::GetDroppedAccesses()
+{
+    return m_iDroppedAccesses;
+}
+
+// Copies the records still in the ring and returns the index of the first
+// one. Safe to call while the emulation thread keeps writing: records the
+// writer may have reused during the copy are discarded.
+u64 ExecutionTrace::Snapshot(std::vector<Record>& records)
+{
+    u64 capacity = m_iMask + 1;
+    u64 head = m_iHead.load(std::memory_order_acquire);
+    u64 first = (head > capacity) ? (head - capacity) : 0;
+
+    records.resize((size_t)(head - first));
+
+    for (u64 i = first; i < head; i++)
+        records[(size_t)(i - first)] = m_pRing[i & m_iMask];
+
+    u64 after = m_iHead.load(std::memory_order_acquire);
+    u64 valid = ((after + kMaxRecordsPerStep) > capacity) ? (after + kMaxRecordsPerStep - capacity) : 0;
+
+    if (valid > first)
+    {
+        u64 discard = std::min(valid, head) - first;
+        records.erase(records.begin(), records.begin() + (size_t)discard);
+        first += discard;
+    }
+
+    return first;
+}
+
+bool ExecutionTrace::Save(const char* szFilePath)
+{
+    std::vector<Record> records;
+    u64 first = Snapshot(records);
+
+    FILE* file = fopen(szFilePath, "wb");
+
+    if (!IsValidPointer(file))
+        return false;
+
+    FileHeader header;
+    header.magic = GS_TRACE_MAGIC;
+    header.version = GS_TRACE_VERSION;
+    header.record_size = sizeof(Record);
+    header.first_record = first;
+    header.record_count = records.size();
+    header.dropped_accesses = m_iDroppedAccesses;
+
+    bool ok = (fwrite(&header, sizeof(header), 1, file) == 1);
+
+    if (ok && !records.empty())
+        ok = (fwrite(&records[0], sizeof(Record), records.size(), file) == records.size());
+
+    fclose(file);
+
+    return ok;
+}
+
+void ExecutionTrace::ReadRegisters(u16* registers)
+{
+    Processor::ProcessorState* state = m_pProcessor->GetState();
+
+    registers[RegisterAF] = state->AF->GetValue();
+    registers[RegisterBC] = state->BC->GetValue();
+    registers[RegisterDE] = state->DE->GetValue();
+    registers[RegisterHL] = state->HL->GetValue();
+    registers[RegisterIX] = state->IX->GetValue();
+    registers[RegisterIY] = state->IY->GetValue();
+    registers[RegisterSP] = state->SP->GetValue();
+    registers[RegisterAF2] = state->AF2->GetValue();
+    registers[RegisterBC2] = state->BC2->GetValue();
+    registers[RegisterDE2] = state->DE2->GetValue();
+    registers[RegisterHL2] = state->HL2->GetValue();
+    registers[RegisterControl] = *state->I | (*state->IFF1 ? 0x0100 : 0) | (*state->IFF2 ? 0x0200 : 0) | (*state->Halt ? 0x0400 : 0);
+}
+
+void ExecutionTrace::WriteEvent(u8 type, u16 address, u32 value)
+{
+    Record* record = NextRecord();
+    record->event.type = type;
+    record->event.unused = 0;
+    record->event.address = address;
+    record->event.value = value;
+    record->event.timestamp = m_iCycles;
+}
+
+ExecutionTrace::Record* ExecutionTrace::NextRecord()
+{
+    Record* record = &m_pRing[m_iWrite & m_iMask];
+    m_iWrite++;
+    return record;
+}
+
+void ExecutionTrace::Publish()
+{
+    m_iHead.store(m_iWrite, std::memory_order_release);
+}
+
+void ExecutionTrace::CheckStartTrigger(Triggers trigger, u32 value)
+{
+    if (!m_bArmed || (m_StartTrigger != trigger) || (m_iStartValue != value))
+        return;
+
+    Start();
+    WriteEvent(RecordStart, (u16)trigger, value);
+    Publish();
+}
+
+void ExecutionTrace::CheckStopTrigger(Triggers trigger, u32 value)
+{
+    if (m_StopTrigger != trigger)
+        return;
+
+    // A stop frame may already be behind when recording starts late
+    if ((trigger == TriggerFrame) ? (value < m_iStopValue) : (value != m_iStopValue))
+        return;
+
+    WriteEvent(RecordStop, (u16)trigger, value);
+    Publish();
+    Stop();
+
+    // The window is recorded once, a start trigger that keeps matching
+    // must not overwrite it
+    m_bArmed = false;
+}
@@ -0,0 +1,229 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+
+#ifndef EXECUTIONTRACE_H
+#define	EXECUTIONTRACE_H
+
+#include <vector>
+#include <atomic>
+#include "definitions.h"
+
+class Processor;
+class Memory;
+
+#define GS_TRACE_MAGIC 0x52545347
+#define GS_TRACE_VERSION 1
+
+// Binary trace of the executed instructions. Every record is 16 bytes, in
+// host byte order, so a trace can be decoded from any record boundary: an
+// instruction is followed by the registers it changed and by its memory
+// and IO accesses. The ring is written by the emulation thread only and
+// can be copied from any other thread without locking.
+class ExecutionTrace
+{
+public:
+    enum RecordTypes
+    {
+        RecordNone,
+        RecordInstruction,
+        RecordRegisters,
+        RecordAccesses,
+        RecordInterrupt,
+        RecordFrame,
+        RecordStart,
+        RecordStop
+    };
+
+    enum Registers
+    {
+        RegisterAF,
+        RegisterBC,
+        RegisterDE,
+        RegisterHL,
+        RegisterIX,
+        RegisterIY,
+        RegisterSP,
+        RegisterAF2,
+        RegisterBC2,
+        RegisterDE2,
+        RegisterHL2,
+        RegisterControl,
+        RegisterCount
+    };
+
+    enum Accesses
+    {
+        AccessMemoryRead,
+        AccessMemoryWrite,
+        AccessIORead,
+        AccessIOWrite
+    };
+
+    enum Triggers
+    {
+        TriggerNone,
+        TriggerAddress,
+        TriggerFrame,
+        TriggerBreakpoint
+    };
+
+    enum InstructionFlags
+    {
+        FlagLengthMask = 0x07,
+        FlagHalted = 0x08,
+        FlagAccessesDropped = 0x10
+    };
+
+    union Record
+    {
+        u8 type;
+
+        // Bank is the 16KB ROM bank, as in the disassembler
+        struct
+        {
+            u8 type;
+            u8 flags;
+            u16 bank;
+            u16 pc;
+            u8 opcodes[4];
+            u16 cycles;
+            u32 timestamp;
+        } instruction;
+
+        // RegisterControl packs I, IFF1, IFF2 and HALT
+        struct
+        {
+            u8 type;
+            u8 count;
+            struct
+            {
+                u8 id;
+                u8 unused;
+                u16 value;
+            } entries[3];
+        } registers;
+
+        struct
+        {
+            u8 type;
+            u8 count;
+            struct
+            {
+                u8 kind;
+                u8 value;
+                u16 address;
+            } entries[3];
+        } accesses;
+
+        // Interrupt: address is the vector, value the return address.
+        // Frame: value is the frame number. Start and stop: address is the
+        // trigger and value its argument.
+        struct
+        {
+            u8 type;
+            u8 unused;
+            u16 address;
+            u32 value;
+            u64 timestamp;
+        } event;
+    };
+
+    struct FileHeader
+    {
+        u32 magic;
+        u16 version;
+        u16 record_size;
+        u64 first_record;
+        u64 record_count;
+        u64 dropped_accesses;
+    };
+
+public:
+    ExecutionTrace(Processor* pProcessor, Memory* pMemory, size_t records = GS_EXECUTION_TRACE_DEFAULT_RECORDS);
+    ~ExecutionTrace();
+    void Reset();
+    void SetStartTrigger(Triggers trigger, u32 value = 0);
+    void SetStopTrigger(Triggers trigger, u32 value = 0);
+    void Start();
+    void Stop();
+    bool IsRecording();
+    void BeginInstruction(u16 pc);
+    void EndInstruction(unsigned int cycles, bool continues = false);
+    void Fetch(u8 value);
+    void Access(u16 address, u8 kind, u8 value);
+    void Interrupt(u16 sp, u16 vector, unsigned int cycles);
+    void Frame();
+    void Breakpoint();
+    u64 GetRecordCount();
+    u64 GetDroppedAccesses();
+    u64 Snapshot(std::vector<Record>& records);
+    bool Save(const char* szFilePath);
+
+private:
+    struct stAccess
+    {
+        u8 kind;
+        u8 value;
+        u16 address;
+    };
+
+    static const int kMaxAccesses = 16;
+    static const int kMaxRecordsPerStep = 1 + ((RegisterCount + 2) / 3) + ((kMaxAccesses + 2) / 3);
+
+private:
+    void ReadRegisters(u16* registers);
+    void WriteEvent(u8 type, u16 address, u32 value);
+    Record* NextRecord();
+    void Publish();
+    void CheckStartTrigger(Triggers trigger, u32 value);
+    void CheckStopTrigger(Triggers trigger, u32 value);
+
+private:
+    Processor* m_pProcessor;
+    Memory* m_pMemory;
+    Record* m_pRing;
+    size_t m_iMask;
+    std::atomic<u64> m_iHead;
+    u64 m_iWrite;
+    u64 m_iCycles;
+    u64 m_iDroppedAccesses;
+    u32 m_iFrame;
+    bool m_bRecording;
+    bool m_bArmed;
+    bool m_bInInstruction;
+    bool m_bContinued;
+    bool m_bFullRegisters;
+    Triggers m_StartTrigger;
+    u32 m_iStartValue;
+    Triggers m_StopTrigger;
+    u32 m_iStopValue;
+    u16 m_iPC;
+    u16 m_iBank;
+    u32 m_iTimestamp;
+    unsigned int m_iPendingCycles;
+    u8 m_Opcodes[4];
+    int m_iOpcodeCount;
+    stAccess m_Accesses[kMaxAccesses];
+    int m_iAccessCount;
+    bool m_bAccessesDropped;
+    u16 m_Registers[RegisterCount];
+};
+
+#endif	/* EXECUTIONTRACE_H */
@@ -44,18 +44,14 @@ void GameGearIOPorts::Reset()
     m_Ports[5] = 0x00;
 }
 
-void GameGearIOPorts::SaveState(std::ostream& stream)
+void GameGearIOPorts::SaveState(StateWriter& writer)
 {
-    using namespace std;
-
-    stream.write(reinterpret_cast<const char*> (&m_Port3F), sizeof(m_Port3F));
-    stream.write(reinterpret_cast<const char*> (m_Ports), sizeof(m_Ports));
+    writer.Write(&m_Port3F, sizeof(m_Port3F));
+    writer.Write(m_Ports, sizeof(m_Ports));
 }
 
-void GameGearIOPorts::LoadState(std::istream& stream)
+void GameGearIOPorts::LoadState(StateReader& reader)
 {
-    using namespace std;
-
-    stream.read(reinterpret_cast<char*> (&m_Port3F), sizeof(m_Port3F));
-    stream.read(reinterpret_cast<char*> (m_Ports), sizeof(m_Ports));
+    reader.Read(&m_Port3F, sizeof(m_Port3F));
+    reader.Read(m_Ports, sizeof(m_Ports));
 }
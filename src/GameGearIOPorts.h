@@ -36,8 +36,8 @@ public:
     void Reset();
     virtual u8 DoInput(u8 port);
     virtual void DoOutput(u8 port, u8 value);
-    virtual void SaveState(std::ostream& stream);
-    virtual void LoadState(std::istream& stream);
+    virtual void SaveState(StateWriter& writer);
+    virtual void LoadState(StateReader& reader);
 
 private:
     Audio* m_pAudio;
@@ -17,6 +17,8 @@
  *
  */
 
+#include <chrono>
+#include <iomanip>
 #include "GearsystemCore.h"
 #include "Memory.h"
 #include "Processor.h"
@@ -24,30 +26,33 @@
 #include "Input.h"
 #include "Cartridge.h"
 #include "MemoryRule.h"
-#include "SegaMemoryRule.h"
-#include "CodemastersMemoryRule.h"
-#include "RomOnlyMemoryRule.h"
-#include "KoreanMemoryRule.h"
-#include "KoreanMSXSMS8000MemoryRule.h"
-#include "KoreanSMS32KB2000MemoryRule.h"
-#include "KoreanMSX32KB2000MemoryRule.h"
-#include "Korean2000XOR1FMemoryRule.h"
-#include "KoreanMSX8KB0300MemoryRule.h"
-#include "Korean0000XORFFMemoryRule.h"
-#include "KoreanFFFFHiComMemoryRule.h"
-#include "KoreanFFFEMemoryRule.h"
-#include "KoreanBFFCMemoryRule.h"
-#include "KoreanFFF3FFFCMemoryRule.h"
-#include "KoreanMDFFF5MemoryRule.h"
-#include "MSXMemoryRule.h"
-#include "JanggunMemoryRule.h"
-#include "Multi4PAKAllActionMemoryRule.h"
-#include "JumboDahjeeMemoryRule.h"
-#include "SG1000MemoryRule.h"
+#include "MapperMemoryRule.h"
 #include "SmsIOPorts.h"
 #include "GameGearIOPorts.h"
 #include "BootromMemoryRule.h"
 
+struct stStateChunkInfo
+{
+    u32 id;
+    u16 version;
+};
+
+static const stStateChunkInfo kStateChunks[] =
+{
+    { GS_STATE_CHUNK_RAM, GS_STATE_CHUNK_VERSION },
+    { GS_STATE_CHUNK_CPU, GS_STATE_CHUNK_VERSION },
+    { GS_STATE_CHUNK_PSG, GS_STATE_CHUNK_PSG_VERSION },
+    { GS_STATE_CHUNK_OPLL, GS_STATE_CHUNK_VERSION },
+    { GS_STATE_CHUNK_VRAM, GS_STATE_CHUNK_VERSION },
+    { GS_STATE_CHUNK_CRAM, GS_STATE_CHUNK_VERSION },
+    { GS_STATE_CHUNK_VDP, GS_STATE_CHUNK_VERSION },
+    { GS_STATE_CHUNK_INPUT, GS_STATE_CHUNK_VERSION },
+    { GS_STATE_CHUNK_MAPPER, GS_STATE_CHUNK_VERSION },
+    { GS_STATE_CHUNK_IO, GS_STATE_CHUNK_VERSION }
+};
+
+static const int kStateChunkCount = sizeof(kStateChunks) / sizeof(kStateChunks[0]);
+
 GearsystemCore::GearsystemCore()
 {
     InitPointer(m_pMemory);
@@ -56,29 +61,24 @@ GearsystemCore::GearsystemCore()
     InitPointer(m_pVideo);
     InitPointer(m_pInput);
     InitPointer(m_pCartridge);
-    InitPointer(m_pSegaMemoryRule);
-    InitPointer(m_pCodemastersMemoryRule);
-    InitPointer(m_pSG1000MemoryRule);
-    InitPointer(m_pRomOnlyMemoryRule);
-    InitPointer(m_pKoreanMemoryRule);
-    InitPointer(m_pKoreanMSXSMS8000MemoryRule);
-    InitPointer(m_pKoreanSMS32KB2000MemoryRule);
-    InitPointer(m_pKoreanMSX32KB2000MemoryRule);
-    InitPointer(m_pKorean2000XOR1FMemoryRule);
-    InitPointer(m_pKoreanMSX8KB0300MemoryRule);
-    InitPointer(m_pKorean0000XORFFMemoryRule);
-    InitPointer(m_pKoreanFFFFHiComMemoryRule);
-    InitPointer(m_pKoreanFFFEMemoryRule);
-    InitPointer(m_pKoreanBFFCMemoryRule);
-    InitPointer(m_pKoreanFFF3FFFCMemoryRule);
-    InitPointer(m_pKoreanMDFFF5MemoryRule);
-    InitPointer(m_pMSXMemoryRule);
-    InitPointer(m_pJanggunMemoryRule);
-    InitPointer(m_pMulti4PAKAllActionMemoryRule);
-    InitPointer(m_pJumboDahjeeMemoryRule);
+    InitPointer(m_pMapperMemoryRule);
     InitPointer(m_pSmsIOPorts);
     InitPointer(m_pGameGearIOPorts);
     InitPointer(m_pBootromMemoryRule);
+    InitPointer(m_pStateSizeRule);
+    InitPointer(m_pRunAheadCore);
+    InitPointer(m_pRunAheadState);
+    m_iStateSize = 0;
+    m_iRunAheadFrames = 0;
+    m_bRunAheadSecondInstance = false;
+    m_iRunAheadStateSize = 0;
+    memset(&m_RunAheadStats, 0, sizeof(m_RunAheadStats));
+    InitPointer(m_pForkState);
+    m_iForkStateSize = 0;
+    InitPointer(m_pStateHasher);
+    m_bProfiling = false;
+    m_ObservationFormat = GS_OBSERVATION_DISABLED;
+    memset(&m_Profile, 0, sizeof(m_Profile));
     m_bPaused = true;
     m_pixelFormat = GS_PIXEL_RGBA8888;
     m_GlassesConfig = GearsystemCore::GlassesBothEyes;
@@ -86,29 +86,14 @@ GearsystemCore::GearsystemCore()
 
 GearsystemCore::~GearsystemCore()
 {
+    SafeDelete(m_pRunAheadCore);
+    SafeDeleteArray(m_pRunAheadState);
+    SafeDeleteArray(m_pForkState);
+    SafeDelete(m_pStateHasher);
     SafeDelete(m_pBootromMemoryRule);
     SafeDelete(m_pGameGearIOPorts);
     SafeDelete(m_pSmsIOPorts);
-    SafeDelete(m_pRomOnlyMemoryRule);
-    SafeDelete(m_pCodemastersMemoryRule);
-    SafeDelete(m_pSG1000MemoryRule);
-    SafeDelete(m_pSegaMemoryRule);
-    SafeDelete(m_pKoreanMemoryRule);
-    SafeDelete(m_pKoreanMSXSMS8000MemoryRule);
-    SafeDelete(m_pKoreanSMS32KB2000MemoryRule);
-    SafeDelete(m_pKoreanMSX32KB2000MemoryRule);
-    SafeDelete(m_pKorean2000XOR1FMemoryRule);
-    SafeDelete(m_pKoreanMSX8KB0300MemoryRule);
-    SafeDelete(m_pKorean0000XORFFMemoryRule);
-    SafeDelete(m_pKoreanFFFFHiComMemoryRule);
-    SafeDelete(m_pKoreanFFFEMemoryRule);
-    SafeDelete(m_pKoreanBFFCMemoryRule);
-    SafeDelete(m_pKoreanFFF3FFFCMemoryRule);
-    SafeDelete(m_pKoreanMDFFF5MemoryRule);
-    SafeDelete(m_pMSXMemoryRule);
-    SafeDelete(m_pJanggunMemoryRule);
-    SafeDelete(m_pMulti4PAKAllActionMemoryRule);
-    SafeDelete(m_pJumboDahjeeMemoryRule);
+    SafeDelete(m_pMapperMemoryRule);
     SafeDelete(m_pCartridge);
     SafeDelete(m_pInput);
     SafeDelete(m_pVideo);
@@ -143,9 +128,23 @@ void GearsystemCore::Init(GS_Color_Format pixelFormat)
 }
 
 bool GearsystemCore::RunToVBlank(u8* pFrameBuffer, s16* pSampleBuffer, int* pSampleCount, bool step, bool stopOnBreakpoints)
+{
+    if ((m_iRunAheadFrames > 0) && !step && !m_bPaused && m_pCartridge->IsReady() && IsValidPointer(pFrameBuffer))
+        return RunAhead(pFrameBuffer, pSampleBuffer, pSampleCount, stopOnBreakpoints);
+    else
+        return RunFrame(pFrameBuffer, pSampleBuffer, pSampleCount, step, stopOnBreakpoints);
+}
+
+bool GearsystemCore::RunFrame(u8* pFrameBuffer, s16* pSampleBuffer, int* pSampleCount, bool step, bool stopOnBreakpoints)
 {
     bool breakpoint = false;
 
+    if (m_bProfiling && !step && !stopOnBreakpoints && !m_bPaused && m_pCartridge->IsReady())
+    {
+        RunProfiledFrame(pFrameBuffer, pSampleBuffer, pSampleCount);
+        return false;
+    }
+
     if (!m_bPaused && m_pCartridge->IsReady())
     {
         bool vblank = false;
@@ -176,11 +175,188 @@ bool GearsystemCore::RunToVBlank(u8* pFrameBuffer, s16* pSampleBuffer, int* pSam
 
         m_pAudio->EndFrame(pSampleBuffer, pSampleCount);
         RenderFrameBuffer(pFrameBuffer);
+
+#ifndef GEARSYSTEM_DISABLE_PROFILER
+        if (IsValidPointer(m_pProcessor->GetExecutionTrace()) && !m_pProcessor->IsInstrumentationSuspended() && !step && !breakpoint)
+            m_pProcessor->GetExecutionTrace()->Frame();
+#endif
     }
 
     return breakpoint;
 }
 
+// Same as RunFrame but accumulating the time spent in each subsystem. Timing
+// every instruction adds a fixed overhead, so the split is only meaningful
+// relative to other profiled runs.
+void GearsystemCore::RunProfiledFrame(u8* pFrameBuffer, s16* pSampleBuffer, int* pSampleCount)
+{
+    using namespace std::chrono;
+
+    bool vblank = false;
+    int totalClocks = 0;
+
+    while (!vblank)
+    {
+        steady_clock::time_point t0 = steady_clock::now();
+        unsigned int clockCycles = m_pProcessor->RunFor(1);
+        m_pAudio->Tick(clockCycles);
+        steady_clock::time_point t1 = steady_clock::now();
+        vblank = m_pVideo->Tick(clockCycles);
+        steady_clock::time_point t2 = steady_clock::now();
+
+        m_Profile.cpu_ns += duration_cast<nanoseconds>(t1 - t0).count();
+        m_Profile.video_ns += duration_cast<nanoseconds>(t2 - t1).count();
+
+        totalClocks += clockCycles;
+
+        if (totalClocks > 702240)
+            vblank = true;
+    }
+
+    steady_clock::time_point t0 = steady_clock::now();
+    m_pAudio->EndFrame(pSampleBuffer, pSampleCount);
+    steady_clock::time_point t1 = steady_clock::now();
+    RenderFrameBuffer(pFrameBuffer);
+    steady_clock::time_point t2 = steady_clock::now();
+
+    m_Profile.audio_ns += duration_cast<nanoseconds>(t1 - t0).count();
+    m_Profile.render_ns += duration_cast<nanoseconds>(t2 - t1).count();
+    m_Profile.frames++;
+
+#ifndef GEARSYSTEM_DISABLE_PROFILER
+    if (IsValidPointer(m_pProcessor->GetExecutionTrace()))
+        m_pProcessor->GetExecutionTrace()->Frame();
+#endif
+}
+
+// The real frame produces the audio and the state the next frame starts from.
+// Then the frames ahead run with the same inputs, audio and instrumentation
+// suspended and only the last one rendered, either on this core followed by a
+// restore, or on a second core that loads the state so this one never rewinds
+// its audio.
+bool GearsystemCore::RunAhead(u8* pFrameBuffer, s16* pSampleBuffer, int* pSampleCount, bool stopOnBreakpoints)
+{
+    using namespace std::chrono;
+
+    high_resolution_clock::time_point start = high_resolution_clock::now();
+
+    if (RunFrame(NULL, pSampleBuffer, pSampleCount, false, stopOnBreakpoints))
+    {
+        RenderFrameBuffer(pFrameBuffer);
+        return true;
+    }
+
+    high_resolution_clock::time_point frame_end = high_resolution_clock::now();
+
+    size_t size = GetStateSize();
+
+    if (size > m_iRunAheadStateSize)
+    {
+        SafeDeleteArray(m_pRunAheadState);
+        m_pRunAheadState = new u8[size];
+        m_iRunAheadStateSize = size;
+    }
+
+    if ((size == 0) || !SaveState(m_pRunAheadState, size))
+    {
+        RenderFrameBuffer(pFrameBuffer);
+        return false;
+    }
+
+    high_resolution_clock::time_point save_end = high_resolution_clock::now();
+
+    GearsystemCore* core = m_bRunAheadSecondInstance ? GetRunAheadInstance() : this;
+
+    if (!IsValidPointer(core) || ((core != this) && !core->RestoreState(m_pRunAheadState, size)))
+    {
+        RenderFrameBuffer(pFrameBuffer);
+        return false;
+    }
+
+    high_resolution_clock::time_point ahead_start = high_resolution_clock::now();
+
+    core->m_pAudio->SuspendOutput(true);
+    core->m_pProcessor->SuspendInstrumentation(true);
+
+    for (int i = 0; i < m_iRunAheadFrames; i++)
+    {
+        bool last = (i == (m_iRunAheadFrames - 1));
+        core->RunFrame(last ? pFrameBuffer : NULL, NULL, NULL, false, false);
+    }
+
+    core->m_pProcessor->SuspendInstrumentation(false);
+    core->m_pAudio->SuspendOutput(false);
+
+    high_resolution_clock::time_point ahead_end = high_resolution_clock::now();
+
+    if (core == this)
+        RestoreState(m_pRunAheadState, size);
+    else
+        core->InvalidateStateHash();
+
+    high_resolution_clock::time_point end = high_resolution_clock::now();
+
+    m_RunAheadStats.frames = m_iRunAheadFrames;
+    m_RunAheadStats.second_instance = (core != this);
+    m_RunAheadStats.state_size = size;
+    m_RunAheadStats.frame_us = static_cast<int>(duration_cast<microseconds>(frame_end - start).count());
+    m_RunAheadStats.save_us = static_cast<int>(duration_cast<microseconds>(save_end - frame_end).count());
+    m_RunAheadStats.ahead_us = static_cast<int>(duration_cast<microseconds>(ahead_end - ahead_start).count());
+    m_RunAheadStats.load_us = static_cast<int>(duration_cast<microseconds>((ahead_start - save_end) + (end - ahead_end)).count());
+    m_RunAheadStats.total_us = static_cast<int>(duration_cast<microseconds>(end - start).count());
+
+    if (m_RunAheadStats.average_total_us == 0)
+        m_RunAheadStats.average_total_us = m_RunAheadStats.total_us;
+    else
+        m_RunAheadStats.average_total_us = ((m_RunAheadStats.average_total_us * 15) + m_RunAheadStats.total_us) / 16;
+
+    m_RunAheadStats.budget_us = 1000000 / (m_pCartridge->IsPAL() ? 50 : 60);
+    m_RunAheadStats.budget_usage = static_cast<float>(m_RunAheadStats.average_total_us) / static_cast<float>(m_RunAheadStats.budget_us);
+
+    return false;
+}
+
+GearsystemCore* GearsystemCore::GetRunAheadInstance()
+{
+    if (!IsValidPointer(m_pRunAheadCore))
+    {
+        Cartridge::ForceConfiguration config;
+        config.type = m_pCartridge->GetType();
+        config.zone = m_pCartridge->GetZone();
+        config.region = m_pCartridge->IsPAL() ? Cartridge::CartridgePAL : Cartridge::CartridgeNTSC;
+        config.system = m_pCartridge->IsGameGear() ? Cartridge::CartridgeGG : (m_pCartridge->IsSG1000() ? Cartridge::CartridgeSG1000 : Cartridge::CartridgeSMS);
+
+        m_pRunAheadCore = new GearsystemCore();
+        m_pRunAheadCore->Init(m_pixelFormat);
+        m_pRunAheadCore->m_pProcessor->EnableDisassembler(false);
+
+        if (!m_pRunAheadCore->LoadROMFromBuffer(m_pCartridge->GetROM(), m_pCartridge->GetROMSize(), &config, m_pCartridge->GetFilePath()))
+        {
+            Log("Run-ahead instance failed to load the ROM");
+            SafeDelete(m_pRunAheadCore);
+            return NULL;
+        }
+    }
+
+    CopySettings(m_pRunAheadCore);
+
+    return m_pRunAheadCore;
+}
+
+void GearsystemCore::CopySettings(GearsystemCore* target)
+{
+    bool crosshair;
+    Video::LightPhaserCrosshairShape shape;
+    Video::LightPhaserCrosshairColor color;
+    m_pVideo->GetLightPhaserCrosshair(crosshair, shape, color);
+
+    target->m_pVideo->SetOverscan(m_pVideo->GetOverscan());
+    target->m_pVideo->SetHideLeftBar(m_pVideo->GetHideLeftBar());
+    target->m_pVideo->SetLightPhaserCrosshair(crosshair, shape, color);
+    target->m_GlassesConfig = m_GlassesConfig;
+    target->m_ObservationFormat = m_ObservationFormat;
+}
+
 bool GearsystemCore::LoadROM(const char* szFilePath, Cartridge::ForceConfiguration* config)
 {
     if (m_pCartridge->LoadFromFile(szFilePath))
@@ -229,6 +405,79 @@ bool GearsystemCore::LoadROMFromBuffer(const u8* buffer, int size, Cartridge::Fo
         return false;
 }
 
+GearsystemCore* GearsystemCore::Fork()
+{
+    if (!m_pCartridge->IsReady())
+        return NULL;
+
+    GearsystemCore* core = new GearsystemCore();
+    core->Init(m_pixelFormat);
+    core->m_pProcessor->EnableDisassembler(false);
+
+    if (!Fork(core))
+    {
+        SafeDelete(core);
+        return NULL;
+    }
+
+    return core;
+}
+
+// Copies the running machine into target. The ROM is shared, and so are RAM,
+// cartridge RAM, VRAM and the info buffer, page by page: each core copies a
+// page the first time it writes it, see SharedPages. The rest, CPU, sound
+// chips and registers, goes through a save state without those arrays. A
+// target that already runs this ROM is not reset, so reusing the same
+// targets avoids any allocation.
+bool GearsystemCore::Fork(GearsystemCore* target)
+{
+    if (!IsValidPointer(target) || (target == this) || !m_pCartridge->IsReady() || (m_pMemory->GetCurrentSlot() == Memory::BiosSlot))
+        return false;
+
+    Cartridge* cartridge = target->m_pCartridge;
+
+    if ((cartridge->GetROM() != m_pCartridge->GetROM()) || (cartridge->GetType() != m_pCartridge->GetType()) ||
+        (cartridge->GetZone() != m_pCartridge->GetZone()) || (cartridge->IsGameGear() != m_pCartridge->IsGameGear()) ||
+        (cartridge->IsSG1000() != m_pCartridge->IsSG1000()) || (cartridge->IsPAL() != m_pCartridge->IsPAL()) ||
+        !IsValidPointer(target->m_pMemory->GetCurrentRule()))
+    {
+        cartridge->ShareROM(*m_pCartridge);
+        target->Reset();
+        target->m_pMemory->ResetDisassembledMemory();
+        target->m_pMemory->LoadSlotsFromROM(cartridge->GetROM(), cartridge->GetROMSize());
+
+        if (!target->AddMemoryRules())
+            return false;
+    }
+
+    CopySettings(target);
+    target->m_bPaused = m_bPaused;
+
+    size_t size = GetStateSize();
+
+    if (size > m_iForkStateSize)
+    {
+        SafeDeleteArray(m_pForkState);
+        m_pForkState = new u8[size];
+        m_iForkStateSize = size;
+    }
+
+    StateWriter writer(m_pForkState, size);
+    writer.SkipPages();
+    SaveState(writer);
+
+    if (writer.IsOverflow() || !target->RestoreState(m_pForkState, writer.GetSize(), true))
+        return false;
+
+    m_pMemory->GetMapPages()->Share(*target->m_pMemory->GetMapPages());
+    m_pMemory->GetCurrentRule()->GetRAMPages()->Share(*target->m_pMemory->GetCurrentRule()->GetRAMPages());
+    m_pVideo->SharePages(target->m_pVideo);
+    target->m_pMemory->GetCurrentRule()->UpdatePages();
+    target->InvalidateStateHash();
+
+    return true;
+}
+
 void GearsystemCore::SaveMemoryDump()
 {
     if (m_pCartridge->IsReady() && (strlen(m_pCartridge->GetFilePath()) > 0))
@@ -248,11 +497,15 @@ void GearsystemCore::SaveMemoryDump()
     }
 }
 
+// Walks the whole ROM with the code/data log: logged opcodes are
+// disassembled, data is written as .db lines and unlogged bytes are skipped.
+// Banked code is shown as if mapped in slot 2.
 void GearsystemCore::SaveDisassembledROM()
 {
-    Memory::stDisassembleRecord** romMap = m_pMemory->GetDisassembledROMMemoryMap();
+    CodeDataLogger* cdl = m_pMemory->GetCodeDataLogger();
+    u32 size = cdl->GetSize(CodeDataLogger::RegionROM);
 
-    if (m_pCartridge->IsReady() && (strlen(m_pCartridge->GetFilePath()) > 0) && IsValidPointer(romMap))
+    if (m_pCartridge->IsReady() && (strlen(m_pCartridge->GetFilePath()) > 0) && (size > 0))
     {
         using namespace std;
 
@@ -267,13 +520,54 @@ void GearsystemCore::SaveDisassembledROM()
 
         if (myfile.is_open())
         {
-            for (int i = 0; i < 65536; i++)
+            u8* rom = m_pCartridge->GetROM();
+            u8* flags = cdl->GetMap(CodeDataLogger::RegionROM);
+            u32 i = 0;
+
+            while (i < size)
             {
-                if (IsValidPointer(romMap[i]) && (romMap[i]->name[0] != 0))
+                if (flags[i] & CodeDataLogger::FlagJumpTarget)
+                    myfile << "\n";
+
+                if (flags[i] & CodeDataLogger::FlagCode)
+                {
+                    u8 bytes[16];
+                    int count = 0;
+
+                    while ((count < 11) && ((i + count) < size) && ((rom[i + count] == 0xDD) || (rom[i + count] == 0xFD)))
+                    {
+                        bytes[count] = rom[i + count];
+                        count++;
+                    }
+
+                    for (int b = 0; b < 5; b++, count++)
+                        bytes[count] = ((i + count) < size) ? rom[i + count] : 0;
+
+                    u16 address = (i < 0x8000) ? i : (0x8000 | (i & 0x3FFF));
+                    char name[32];
+                    bool jump;
+                    u16 jumpAddress;
+                    int length = Processor::DisassembleOPCode(bytes, count, address, name, sizeof(name), jump, jumpAddress);
+
+                    myfile << "0x" << hex << i << "\t " << name << "\n";
+                    i += length;
+                }
+                else if (flags[i] & CodeDataLogger::FlagData)
                 {
-                    myfile << "0x" << hex << i << "\t " << romMap[i]->name << "\n";
-                    i += (romMap[i]->size - 1);
+                    myfile << "0x" << hex << i << "\t .db ";
+
+                    for (int b = 0; (b < 8) && (i < size) && ((flags[i] & (CodeDataLogger::FlagCode | CodeDataLogger::FlagData)) == CodeDataLogger::FlagData); b++, i++)
+                    {
+                        if ((b > 0) && (flags[i] & CodeDataLogger::FlagJumpTarget))
+                            break;
+
+                        myfile << (b > 0 ? "," : "") << "$" << setw(2) << setfill('0') << (int)rom[i];
+                    }
+
+                    myfile << "\n";
                 }
+                else
+                    i++;
             }
 
             myfile.close();
@@ -283,6 +577,36 @@ void GearsystemCore::SaveDisassembledROM()
     }
 }
 
+bool GearsystemCore::SaveCodeDataLog()
+{
+    if (!m_pCartridge->IsReady() || (strlen(m_pCartridge->GetFilePath()) == 0))
+        return false;
+
+    char path[512];
+
+    strcpy(path, m_pCartridge->GetFilePath());
+    strcat(path, ".cdl");
+
+    Log("Saving code/data log %s...", path);
+
+    return m_pMemory->GetCodeDataLogger()->Save(path);
+}
+
+bool GearsystemCore::LoadCodeDataLog()
+{
+    if (!m_pCartridge->IsReady() || (strlen(m_pCartridge->GetFilePath()) == 0))
+        return false;
+
+    char path[512];
+
+    strcpy(path, m_pCartridge->GetFilePath());
+    strcat(path, ".cdl");
+
+    Log("Loading code/data log %s...", path);
+
+    return m_pMemory->GetCodeDataLogger()->Load(path);
+}
+
 bool GearsystemCore::GetRuntimeInfo(GS_RuntimeInfo& runtime_info)
 {
     if (m_pCartridge->IsReady())
@@ -341,11 +665,72 @@ Video* GearsystemCore::GetVideo()
     return m_pVideo;
 }
 
+Input* GearsystemCore::GetInput()
+{
+    return m_pInput;
+}
+
 void GearsystemCore::SetGlassesConfig(GlassesConfig config)
 {
     m_GlassesConfig = config;
 }
 
+void GearsystemCore::SetObservationFormat(GS_Observation_Format format)
+{
+    m_ObservationFormat = format;
+}
+
+void GearsystemCore::GetObservationSize(int& width, int& height)
+{
+    m_pVideo->GetObservationSize(m_ObservationFormat, width, height);
+}
+
+void GearsystemCore::SetRunAhead(int frames, bool secondInstance)
+{
+    if (frames < 0)
+        frames = 0;
+    else if (frames > GS_RUNAHEAD_MAX_FRAMES)
+        frames = GS_RUNAHEAD_MAX_FRAMES;
+
+    if ((frames == m_iRunAheadFrames) && (secondInstance == m_bRunAheadSecondInstance))
+        return;
+
+    m_iRunAheadFrames = frames;
+    m_bRunAheadSecondInstance = secondInstance;
+    memset(&m_RunAheadStats, 0, sizeof(m_RunAheadStats));
+
+    if ((m_iRunAheadFrames == 0) || !secondInstance)
+        SafeDelete(m_pRunAheadCore);
+
+    if (m_iRunAheadFrames == 0)
+    {
+        SafeDeleteArray(m_pRunAheadState);
+        m_iRunAheadStateSize = 0;
+    }
+}
+
+int GearsystemCore::GetRunAheadFrames()
+{
+    return m_iRunAheadFrames;
+}
+
+bool GearsystemCore::GetRunAheadStats(GS_RunAheadStats& stats)
+{
+    stats = m_RunAheadStats;
+    return (m_iRunAheadFrames > 0);
+}
+
+void GearsystemCore::EnableProfiling(bool enable)
+{
+    m_bProfiling = enable;
+    memset(&m_Profile, 0, sizeof(m_Profile));
+}
+
+void GearsystemCore::GetProfile(GS_FrameProfile& profile)
+{
+    profile = m_Profile;
+}
+
 void GearsystemCore::KeyPressed(GS_Joypads joypad, GS_Keys key)
 {
     m_pInput->KeyPressed(joypad, key);
@@ -457,6 +842,7 @@ void GearsystemCore::ResetROMPreservingRAM(Cartridge::ForceConfiguration* config
             stream.seekg(0, stream.beg);
 
             m_pMemory->GetCurrentRule()->LoadRam(stream, size);
+            InvalidateStateHash();
         }
         else
         {
@@ -576,6 +962,8 @@ void GearsystemCore::LoadRam(const char* szPath, bool fullPath)
             s32 fileSize = (s32)file.tellg();
             file.seekg(0, file.beg);
 
+            InvalidateStateHash();
+
             if (m_pMemory->GetCurrentRule()->LoadRam(file, fileSize))
             {
                 Debug("RAM loaded");
@@ -619,10 +1007,6 @@ void GearsystemCore::SaveState(const char* szPath, int index)
 
     using namespace std;
 
-    size_t size;
-    SaveState(NULL, size);
-
-    u8* buffer = new u8[size];
     string path = "";
 
     if (IsValidPointer(szPath))
@@ -653,10 +1037,9 @@ void GearsystemCore::SaveState(const char* szPath, int index)
 
     ofstream file(sstm.str().c_str(), ios::out | ios::binary);
 
+    size_t size;
     SaveState(file, size);
 
-    SafeDeleteArray(buffer);
-
     file.close();
 
     Debug("Save state created");
@@ -670,71 +1053,183 @@ bool GearsystemCore::SaveState(u8* buffer, size_t& size)
         return false;
     }
 
-    bool ret = false;
+    if (!m_pCartridge->IsReady() || !IsValidPointer(m_pMemory->GetCurrentRule()))
+    {
+        Log("Invalid rom or memory rule.");
+        return false;
+    }
+
+    size_t state_size = GetStateSize();
 
-    if (m_pCartridge->IsReady() && IsValidPointer(m_pMemory->GetCurrentRule()))
+    if (!IsValidPointer(buffer))
     {
-        using namespace std;
+        size = state_size;
+        return true;
+    }
 
-        stringstream stream;
+    if (size < state_size)
+    {
+        Log("Save state buffer too small [%d bytes, %d needed]", size, state_size);
+        return false;
+    }
 
-        if (SaveState(stream, size))
-            ret = true;
+    StateWriter writer(buffer, state_size);
 
-        if (IsValidPointer(buffer))
-        {
-            Log("Saving state to buffer [%d bytes]...", size);
-            memcpy(buffer, stream.str().c_str(), size);
-            ret = true;
-        }
+    SaveState(writer);
+
+    if (writer.IsOverflow() || (writer.GetSize() != state_size))
+    {
+        Log("Save state size mismatch [%d bytes, %d expected]", writer.GetSize(), state_size);
+        return false;
     }
-    else
+
+    size = state_size;
+
+    return true;
+}
+
+bool GearsystemCore::SaveState(std::ostream& stream, size_t& size)
+{
+    size = GetStateSize();
+
+    if (size == 0)
+        return false;
+
+    u8* buffer = new u8[size];
+
+    bool ret = SaveState(buffer, size);
+
+    if (ret)
     {
-        Log("Invalid rom or memory rule.");
+        stream.write(reinterpret_cast<const char*> (buffer), size);
+        Debug("Save state size: %d", size);
     }
 
+    SafeDeleteArray(buffer);
+
     return ret;
 }
 
-bool GearsystemCore::SaveState(std::ostream& stream, size_t& size)
+size_t GearsystemCore::GetStateSize()
 {
-    if (m_pMemory->GetCurrentSlot() == Memory::BiosSlot)
+    if (!m_pCartridge->IsReady() || !IsValidPointer(m_pMemory->GetCurrentRule()))
+        return 0;
+
+    if ((m_iStateSize == 0) || (m_pStateSizeRule != m_pMemory->GetCurrentRule()))
     {
-        Debug("Save states disabled when running BIOS");
-        return false;
+        StateWriter counter(NULL, 0);
+        SaveState(counter);
+        m_iStateSize = counter.GetSize();
+        m_pStateSizeRule = m_pMemory->GetCurrentRule();
     }
 
-    if (m_pCartridge->IsReady() && IsValidPointer(m_pMemory->GetCurrentRule()))
+    return m_iStateSize;
+}
+
+u64 GearsystemCore::StateHash()
+{
+    GS_StateHash hash;
+    StateHash(hash);
+    return hash.low;
+}
+
+// Hashes the same chunks a save state holds, minus the video info buffer
+// which is only scratch for the line being rendered
+bool GearsystemCore::StateHash(GS_StateHash& hash)
+{
+    hash.low = 0;
+    hash.high = 0;
+
+    if (!m_pCartridge->IsReady() || !IsValidPointer(m_pMemory->GetCurrentRule()))
+        return false;
+
+    if (!IsValidPointer(m_pStateHasher))
+        m_pStateHasher = new StateHasher();
+
+    StateWriter writer(m_pStateHasher);
+    m_pStateHasher->Begin();
+
+    for (int i = 0; i < kStateChunkCount; i++)
     {
-        Debug("Gathering save state data...");
+        writer.Write(kStateChunks[i].id);
 
-        using namespace std;
+        if (kStateChunks[i].id == GS_STATE_CHUNK_VDP)
+            m_pVideo->SaveRegisters(writer);
+        else
+            SaveChunk(writer, kStateChunks[i].id);
+    }
 
-        m_pMemory->SaveState(stream);
-        m_pProcessor->SaveState(stream);
-        m_pAudio->SaveState(stream);
-        m_pVideo->SaveState(stream);
-        m_pInput->SaveState(stream);
-        m_pMemory->GetCurrentRule()->SaveState(stream);
-        m_pProcessor->GetIOPOrts()->SaveState(stream);
+    m_pStateHasher->End(hash);
 
-        size = static_cast<size_t>(stream.tellp());
-        size += (sizeof(u32) * 2);
+    return true;
+}
 
-        u32 header_magic = GS_SAVESTATE_MAGIC;
-        u32 header_size = static_cast<u32>(size);
+// Needed after writing memory through raw pointers, like debugger editors
+// or frontend memory maps, since dirty pages are only flagged by the buses
+void GearsystemCore::InvalidateStateHash()
+{
+    if (IsValidPointer(m_pStateHasher))
+        m_pStateHasher->Invalidate();
+}
 
-        stream.write(reinterpret_cast<const char*> (&header_magic), sizeof(header_magic));
-        stream.write(reinterpret_cast<const char*> (&header_size), sizeof(header_size));
+void GearsystemCore::SaveState(StateWriter& writer)
+{
+    GS_StateHeader header;
+    header.magic = GS_SAVESTATE_CONTAINER_MAGIC;
+    header.version = GS_SAVESTATE_VERSION;
+    header.chunk_count = 0;
+    header.size = 0;
+    header.rom_crc = m_pCartridge->GetCRC();
 
-        Log("Save state size: %d", static_cast<size_t>(stream.tellp()));
+    writer.Write(header);
 
-        return true;
+    for (int i = 0; i < kStateChunkCount; i++)
+    {
+        size_t chunk = writer.BeginChunk(kStateChunks[i].id, kStateChunks[i].version);
+        SaveChunk(writer, kStateChunks[i].id);
+        writer.EndChunk(chunk);
+        header.chunk_count++;
     }
 
-    Log("Invalid rom or memory rule.");
+    header.size = static_cast<u32>(writer.GetSize());
+    writer.Patch(0, &header, sizeof(header));
+}
 
-    return false;
+void GearsystemCore::SaveChunk(StateWriter& writer, u32 id)
+{
+    switch (id)
+    {
+        case GS_STATE_CHUNK_RAM:
+            m_pMemory->SaveState(writer);
+            break;
+        case GS_STATE_CHUNK_CPU:
+            m_pProcessor->SaveState(writer);
+            break;
+        case GS_STATE_CHUNK_PSG:
+            m_pAudio->SaveState(writer);
+            break;
+        case GS_STATE_CHUNK_OPLL:
+            m_pAudio->GetYM2413()->SaveState(writer);
+            break;
+        case GS_STATE_CHUNK_VRAM:
+            writer.WritePages(*m_pVideo->GetVRAMPages(), 0x4000, m_pVideo->GetVRAMDirtyPages());
+            break;
+        case GS_STATE_CHUNK_CRAM:
+            writer.Write(m_pVideo->GetCRAM(), 0x40);
+            break;
+        case GS_STATE_CHUNK_VDP:
+            m_pVideo->SaveState(writer);
+            break;
+        case GS_STATE_CHUNK_INPUT:
+            m_pInput->SaveState(writer);
+            break;
+        case GS_STATE_CHUNK_MAPPER:
+            m_pMemory->GetCurrentRule()->SaveState(writer);
+            break;
+        case GS_STATE_CHUNK_IO:
+            m_pProcessor->GetIOPOrts()->SaveState(writer);
+            break;
+    }
 }
 
 void GearsystemCore::LoadState(int index)
@@ -813,7 +1308,8 @@ void GearsystemCore::LoadState(const char* szPath, int index)
     file.close();
 }
 
-bool GearsystemCore::LoadState(const u8* buffer, size_t size)
+// Forcing loads a state created with another ROM
+bool GearsystemCore::LoadState(const u8* buffer, size_t size, bool force)
 {
     if (m_pMemory->GetCurrentSlot() == Memory::BiosSlot)
     {
@@ -821,78 +1317,245 @@ bool GearsystemCore::LoadState(const u8* buffer, size_t size)
         return false;
     }
 
-    if (m_pCartridge->IsReady() && IsValidPointer(m_pMemory->GetCurrentRule()) && (size > 0) && IsValidPointer(buffer))
+    if (!m_pCartridge->IsReady() || !IsValidPointer(m_pMemory->GetCurrentRule()) || !IsValidPointer(buffer))
     {
-        Debug("Gathering load state data [%d bytes]...", size);
+        Log("Invalid rom or memory rule");
+        return false;
+    }
 
-        using namespace std;
+    InvalidateStateHash();
 
-        stringstream stream;
+    if (StateContainer::IsContainer(buffer, size))
+        return LoadChunkedState(buffer, size, force);
+    else
+        return LoadLegacyState(buffer, size);
+}
 
-        stream.write(reinterpret_cast<const char*> (buffer), size);
+// Every section is checked against what its component reads before any of
+// them is loaded, a rejected state leaves the machine untouched
+bool GearsystemCore::LoadChunkedState(const u8* buffer, size_t size, bool force)
+{
+    StateContainer container;
 
-        return LoadState(stream);
+    if (!container.Open(buffer, size))
+    {
+        Log("Invalid save state container");
+        return false;
     }
 
-    Log("Invalid rom or memory rule.");
+    const GS_StateHeader* header = container.GetHeader();
 
-    return false;
-}
+    Debug("Load state version: %d, %d sections", header->version, header->chunk_count);
 
-bool GearsystemCore::LoadState(std::istream& stream)
-{
-    if (m_pMemory->GetCurrentSlot() == Memory::BiosSlot)
+    if (header->version > GS_SAVESTATE_VERSION)
     {
-        Debug("Save states disabled when running BIOS");
+        Log("Unsupported save state version %d", header->version);
         return false;
     }
 
-    if (m_pCartridge->IsReady() && IsValidPointer(m_pMemory->GetCurrentRule()))
+    if (header->rom_crc != m_pCartridge->GetCRC())
     {
-        using namespace std;
+        Log("Save state was created with a different ROM [CRC %08X]", header->rom_crc);
 
-        u32 header_magic = 0;
-        u32 header_size = 0;
+        if (!force)
+            return false;
+    }
 
-        stream.seekg(0, ios::end);
-        size_t size = static_cast<size_t>(stream.tellg());
-        stream.seekg(0, ios::beg);
+    const GS_StateChunk* chunks[kStateChunkCount];
 
-        Debug("Load state stream size: %d", size);
+    for (int i = 0; i < kStateChunkCount; i++)
+    {
+        chunks[i] = container.FindChunk(kStateChunks[i].id);
 
-        stream.seekg(size - (2 * sizeof(u32)), ios::beg);
-        stream.read(reinterpret_cast<char*> (&header_magic), sizeof(header_magic));
-        stream.read(reinterpret_cast<char*> (&header_size), sizeof(header_size));
-        stream.seekg(0, ios::beg);
+        if (!IsValidPointer(chunks[i]) || (chunks[i]->version > kStateChunks[i].version))
+        {
+            u32 id = kStateChunks[i].id;
+            Log("Missing or unsupported save state section '%c%c%c%c'", id & 0xFF, (id >> 8) & 0xFF, (id >> 16) & 0xFF, id >> 24);
+            return false;
+        }
 
-        Debug("Load state magic: 0x%08x", header_magic);
-        Debug("Load state size: %d", header_size);
+        size_t expected = GetChunkSize(chunks[i]->id, chunks[i]->version);
 
-        if ((header_size == size) && (header_magic == GS_SAVESTATE_MAGIC))
+        if (chunks[i]->size != expected)
         {
-            Log("Loading state...");
+            u32 id = kStateChunks[i].id;
+            Log("Save state section '%c%c%c%c' has %d bytes, %d expected", id & 0xFF, (id >> 8) & 0xFF, (id >> 16) & 0xFF, id >> 24, chunks[i]->size, (int)expected);
+            return false;
+        }
+    }
 
-            m_pMemory->LoadState(stream);
-            m_pProcessor->LoadState(stream);
-            m_pAudio->LoadState(stream);
-            m_pVideo->LoadState(stream);
-            m_pInput->LoadState(stream);
-            m_pMemory->GetCurrentRule()->LoadState(stream);
-            m_pProcessor->GetIOPOrts()->LoadState(stream);
+    Debug("Loading state...");
 
-            return true;
-        }
-        else
+    for (int i = 0; i < kStateChunkCount; i++)
+    {
+        StateReader reader(chunks[i]->data, chunks[i]->size);
+
+        LoadChunk(reader, kStateChunks[i].id, chunks[i]->version);
+
+        if (reader.IsOverflow())
         {
-            Log("Invalid save state size or header");
+            Log("Save state section truncated");
+            return false;
         }
     }
-    else
+
+    return true;
+}
+
+// Loads a state this core saved with its current configuration, so nothing
+// is checked. Unlike LoadState the state hash stays valid: the buses flagged
+// every page written since the save, and only those are hashed again.
+// Fork loads states without the paged arrays, skipPages leaves those alone.
+bool GearsystemCore::RestoreState(const u8* buffer, size_t size, bool skipPages)
+{
+    StateContainer container;
+
+    if (!container.Open(buffer, size))
+        return false;
+
+    for (int i = 0; i < kStateChunkCount; i++)
     {
-        Log("Invalid rom or memory rule");
+        const GS_StateChunk* chunk = container.FindChunk(kStateChunks[i].id);
+
+        if (!IsValidPointer(chunk))
+            return false;
+
+        StateReader reader(chunk->data, chunk->size);
+
+        if (skipPages)
+            reader.SkipPages();
+
+        LoadChunk(reader, chunk->id, chunk->version);
+
+        if (reader.IsOverflow())
+            return false;
     }
 
-    return false;
+    return true;
+}
+
+// Bytes the loader of a section reads, measured by saving it with the current
+// configuration unless the section is an older version
+size_t GearsystemCore::GetChunkSize(u32 id, u32 version)
+{
+    if (id == GS_STATE_CHUNK_PSG)
+        return m_pAudio->GetStateSize(version);
+
+    StateWriter counter(NULL, 0);
+    SaveChunk(counter, id);
+    return counter.GetSize();
+}
+
+void GearsystemCore::LoadChunk(StateReader& reader, u32 id, u16 version)
+{
+    switch (id)
+    {
+        case GS_STATE_CHUNK_RAM:
+            m_pMemory->LoadState(reader);
+            break;
+        case GS_STATE_CHUNK_CPU:
+            m_pProcessor->LoadState(reader);
+            break;
+        case GS_STATE_CHUNK_PSG:
+            m_pAudio->LoadState(reader, version);
+            break;
+        case GS_STATE_CHUNK_OPLL:
+            m_pAudio->GetYM2413()->LoadState(reader);
+            break;
+        case GS_STATE_CHUNK_VRAM:
+            if (!reader.IsSkippingPages())
+                reader.Read(m_pVideo->GetVRAM(), 0x4000);
+            break;
+        case GS_STATE_CHUNK_CRAM:
+            reader.Read(m_pVideo->GetCRAM(), 0x40);
+            break;
+        case GS_STATE_CHUNK_VDP:
+            m_pVideo->LoadState(reader);
+            break;
+        case GS_STATE_CHUNK_INPUT:
+            m_pInput->LoadState(reader);
+            break;
+        case GS_STATE_CHUNK_MAPPER:
+            m_pMemory->GetCurrentRule()->LoadState(reader);
+            break;
+        case GS_STATE_CHUNK_IO:
+            m_pProcessor->GetIOPOrts()->LoadState(reader);
+            break;
+    }
+}
+
+// States written before the chunked container: every component back to back
+// followed by a magic and size footer. Loading one and saving again upgrades it.
+bool GearsystemCore::LoadLegacyState(const u8* buffer, size_t size)
+{
+    if (size <= (2 * sizeof(u32)))
+    {
+        Log("Invalid save state size");
+        return false;
+    }
+
+    u32 header_magic = 0;
+    u32 header_size = 0;
+
+    memcpy(&header_magic, buffer + size - (2 * sizeof(u32)), sizeof(header_magic));
+    memcpy(&header_size, buffer + size - sizeof(u32), sizeof(header_size));
+
+    Debug("Load state magic: 0x%08x", header_magic);
+    Debug("Load state size: %d", header_size);
+
+    if ((header_size != size) || (header_magic != GS_SAVESTATE_MAGIC))
+    {
+        Log("Invalid save state size or header");
+        return false;
+    }
+
+    Debug("Loading legacy state...");
+
+    StateReader reader(buffer, size - (2 * sizeof(u32)));
+
+    m_pMemory->LoadState(reader);
+    m_pProcessor->LoadState(reader);
+    m_pAudio->LoadState(reader, 1);
+    m_pAudio->GetYM2413()->LoadState(reader);
+    m_pVideo->LoadLegacyState(reader);
+    m_pInput->LoadState(reader);
+    m_pMemory->GetCurrentRule()->LoadState(reader);
+    m_pProcessor->GetIOPOrts()->LoadState(reader);
+
+    if (reader.IsOverflow())
+    {
+        Log("Save state truncated");
+        return false;
+    }
+
+    return true;
+}
+
+bool GearsystemCore::LoadState(std::istream& stream, bool force)
+{
+    using namespace std;
+
+    stream.seekg(0, ios::end);
+    size_t size = static_cast<size_t>(stream.tellg());
+    stream.seekg(0, ios::beg);
+
+    Debug("Load state stream size: %d", size);
+
+    if ((size == 0) || stream.fail())
+    {
+        Log("Invalid save state stream");
+        return false;
+    }
+
+    u8* buffer = new u8[size];
+
+    stream.read(reinterpret_cast<char*> (buffer), size);
+
+    bool ret = LoadState(buffer, size, force);
+
+    SafeDeleteArray(buffer);
+
+    return ret;
 }
 
 void GearsystemCore::SetCheat(const char* szCheat)
@@ -901,8 +1564,13 @@ void GearsystemCore::SetCheat(const char* szCheat)
     if ((s.length() == 7) || (s.length() == 11))
     {
         m_pCartridge->SetGameGenieCheat(szCheat);
+        SafeDelete(m_pRunAheadCore);
+        InvalidateStateHash();
         if (m_pCartridge->IsReady())
+        {
             m_pMemory->LoadSlotsFromROM(m_pCartridge->GetROM(), m_pCartridge->GetROMSize());
+            m_pMapperMemoryRule->UpdateROM();
+        }
     }
     else
     {
@@ -914,8 +1582,13 @@ void GearsystemCore::ClearCheats()
 {
     m_pCartridge->ClearGameGenieCheats();
     m_pProcessor->ClearProActionReplayCheats();
+    SafeDelete(m_pRunAheadCore);
+    InvalidateStateHash();
     if (m_pCartridge->IsReady())
+    {
         m_pMemory->LoadSlotsFromROM(m_pCartridge->GetROM(), m_pCartridge->GetROMSize());
+        m_pMapperMemoryRule->UpdateROM();
+    }
 }
 
 void GearsystemCore::SetRamModificationCallback(RamChangedCallback callback)
@@ -925,28 +1598,9 @@ void GearsystemCore::SetRamModificationCallback(RamChangedCallback callback)
 
 void GearsystemCore::InitMemoryRules()
 {
-    m_pSG1000MemoryRule = new SG1000MemoryRule(m_pMemory, m_pCartridge, m_pInput);
-    m_pCodemastersMemoryRule = new CodemastersMemoryRule(m_pMemory, m_pCartridge, m_pInput);
-    m_pSegaMemoryRule = new SegaMemoryRule(m_pMemory, m_pCartridge, m_pInput);
-    m_pRomOnlyMemoryRule = new RomOnlyMemoryRule(m_pMemory, m_pCartridge, m_pInput);
-    m_pKoreanMemoryRule = new KoreanMemoryRule(m_pMemory, m_pCartridge, m_pInput);
-    m_pKoreanMSXSMS8000MemoryRule = new KoreanMSXSMS8000MemoryRule(m_pMemory, m_pCartridge, m_pInput);
-    m_pKoreanSMS32KB2000MemoryRule = new KoreanSMS32KB2000MemoryRule(m_pMemory, m_pCartridge, m_pInput);
-    m_pKoreanMSX32KB2000MemoryRule = new KoreanMSX32KB2000MemoryRule(m_pMemory, m_pCartridge, m_pInput);
-    m_pKorean2000XOR1FMemoryRule = new Korean2000XOR1FMemoryRule(m_pMemory, m_pCartridge, m_pInput);
-    m_pKoreanMSX8KB0300MemoryRule = new KoreanMSX8KB0300MemoryRule(m_pMemory, m_pCartridge, m_pInput);
-    m_pKorean0000XORFFMemoryRule = new Korean0000XORFFMemoryRule(m_pMemory, m_pCartridge, m_pInput);
-    m_pKoreanFFFFHiComMemoryRule = new KoreanFFFFHiComMemoryRule(m_pMemory, m_pCartridge, m_pInput);
-    m_pKoreanFFFEMemoryRule = new KoreanFFFEMemoryRule(m_pMemory, m_pCartridge, m_pInput);
-    m_pKoreanBFFCMemoryRule = new KoreanBFFCMemoryRule(m_pMemory, m_pCartridge, m_pInput);
-    m_pKoreanFFF3FFFCMemoryRule = new KoreanFFF3FFFCMemoryRule(m_pMemory, m_pCartridge, m_pInput);
-    m_pKoreanMDFFF5MemoryRule = new KoreanMDFFF5MemoryRule(m_pMemory, m_pCartridge, m_pInput);
-    m_pMSXMemoryRule = new MSXMemoryRule(m_pMemory, m_pCartridge, m_pInput);
-    m_pJanggunMemoryRule = new JanggunMemoryRule(m_pMemory, m_pCartridge, m_pInput);
-    m_pMulti4PAKAllActionMemoryRule = new Multi4PAKAllActionMemoryRule(m_pMemory, m_pCartridge, m_pInput);
-    m_pJumboDahjeeMemoryRule = new JumboDahjeeMemoryRule(m_pMemory, m_pCartridge, m_pInput);
+    m_pMapperMemoryRule = new MapperMemoryRule(m_pMemory, m_pCartridge, m_pInput);
     m_pBootromMemoryRule = new BootromMemoryRule(m_pMemory, m_pCartridge, m_pInput);
-    m_pMemory->SetCurrentRule(m_pRomOnlyMemoryRule);
+    m_pMemory->SetCurrentRule(m_pMapperMemoryRule);
     m_pMemory->SetBootromRule(m_pBootromMemoryRule);
     m_pProcessor->SetIOPOrts(m_pSmsIOPorts);
 }
@@ -955,76 +1609,9 @@ bool GearsystemCore::AddMemoryRules()
 {
     Cartridge::CartridgeTypes type = m_pCartridge->GetType();
 
-    bool notSupported = false;
+    bool notSupported = !m_pMapperMemoryRule->SetBoard(type);
 
-    switch (type)
-    {
-        case Cartridge::CartridgeRomOnlyMapper:
-            m_pMemory->SetCurrentRule(m_pRomOnlyMemoryRule);
-            break;
-        case Cartridge::CartridgeSegaMapper:
-            m_pMemory->SetCurrentRule(m_pSegaMemoryRule);
-            break;
-        case Cartridge::CartridgeCodemastersMapper:
-            m_pMemory->SetCurrentRule(m_pCodemastersMemoryRule);
-            break;
-        case Cartridge::CartridgeSG1000Mapper:
-            m_pMemory->SetCurrentRule(m_pSG1000MemoryRule);
-            break;
-        case Cartridge::CartridgeKoreanMapper:
-            m_pMemory->SetCurrentRule(m_pKoreanMemoryRule);
-            break;
-        case Cartridge::CartridgeKoreanMSXSMS8000Mapper:
-            m_pMemory->SetCurrentRule(m_pKoreanMSXSMS8000MemoryRule);
-            break;
-        case Cartridge::CartridgeKoreanSMS32KB2000Mapper:
-            m_pMemory->SetCurrentRule(m_pKoreanSMS32KB2000MemoryRule);
-            break;
-        case Cartridge::CartridgeKoreanMSX32KB2000Mapper:
-            m_pMemory->SetCurrentRule(m_pKoreanMSX32KB2000MemoryRule);
-            break;
-        case Cartridge::CartridgeKorean2000XOR1FMapper:
-            m_pMemory->SetCurrentRule(m_pKorean2000XOR1FMemoryRule);
-            break;
-        case Cartridge::CartridgeKoreanMSX8KB0300Mapper:
-            m_pMemory->SetCurrentRule(m_pKoreanMSX8KB0300MemoryRule);
-            break;
-        case Cartridge::CartridgeKorean0000XORFFMapper:
-            m_pMemory->SetCurrentRule(m_pKorean0000XORFFMemoryRule);
-            break;
-        case Cartridge::CartridgeKoreanFFFFHiComMapper:
-            m_pMemory->SetCurrentRule(m_pKoreanFFFFHiComMemoryRule);
-            break;
-        case Cartridge::CartridgeKoreanFFFEMapper:
-            m_pMemory->SetCurrentRule(m_pKoreanFFFEMemoryRule);
-            break;
-        case Cartridge::CartridgeKoreanBFFCMapper:
-            m_pMemory->SetCurrentRule(m_pKoreanBFFCMemoryRule);
-            break;
-        case Cartridge::CartridgeKoreanFFF3FFFCMapper:
-            m_pMemory->SetCurrentRule(m_pKoreanFFF3FFFCMemoryRule);
-            break;
-        case Cartridge::CartridgeKoreanMDFFF5Mapper:
-            m_pMemory->SetCurrentRule(m_pKoreanMDFFF5MemoryRule);
-            break;
-        case Cartridge::CartridgeMSXMapper:
-            m_pMemory->SetCurrentRule(m_pMSXMemoryRule);
-            break;
-        case Cartridge::CartridgeJanggunMapper:
-            m_pMemory->SetCurrentRule(m_pJanggunMemoryRule);
-            break;
-        case Cartridge::CartridgeMulti4PAKAllActionMapper:
-            m_pMemory->SetCurrentRule(m_pMulti4PAKAllActionMemoryRule);
-            break;
-        case Cartridge::CartridgeJumboDahjeeMapper:
-            m_pMemory->SetCurrentRule(m_pJumboDahjeeMemoryRule);
-            break;
-        case Cartridge::CartridgeNotSupported:
-            notSupported = true;
-            break;
-        default:
-            notSupported = true;
-    }
+    m_pMemory->SetCurrentRule(m_pMapperMemoryRule);
 
     if (m_pCartridge->IsGameGear())
     {
@@ -1047,34 +1634,21 @@ void GearsystemCore::Reset()
     m_pAudio->Reset(m_pCartridge->IsPAL());
     m_pVideo->Reset(m_pCartridge->IsGameGear(), m_pCartridge->IsPAL());
     m_pInput->Reset(m_pCartridge->IsGameGear());
-    m_pSegaMemoryRule->Reset();
-    m_pCodemastersMemoryRule->Reset();
-    m_pSG1000MemoryRule->Reset();
-    m_pRomOnlyMemoryRule->Reset();
-    m_pKoreanMemoryRule->Reset();
-    m_pKoreanMSXSMS8000MemoryRule->Reset();
-    m_pKoreanSMS32KB2000MemoryRule->Reset();
-    m_pKoreanMSX32KB2000MemoryRule->Reset();
-    m_pKorean2000XOR1FMemoryRule->Reset();
-    m_pKoreanMSX8KB0300MemoryRule->Reset();
-    m_pKorean0000XORFFMemoryRule->Reset();
-    m_pKoreanFFFFHiComMemoryRule->Reset();
-    m_pKoreanFFFEMemoryRule->Reset();
-    m_pKoreanBFFCMemoryRule->Reset();
-    m_pKoreanFFF3FFFCMemoryRule->Reset();
-    m_pKoreanMDFFF5MemoryRule->Reset();
-    m_pMSXMemoryRule->Reset();
-    m_pJanggunMemoryRule->Reset();
-    m_pMulti4PAKAllActionMemoryRule->Reset();
-    m_pJumboDahjeeMemoryRule->Reset();
+    m_pMapperMemoryRule->Reset();
     m_pBootromMemoryRule->Reset();
     m_pGameGearIOPorts->Reset();
     m_pSmsIOPorts->Reset();
+    InvalidateStateHash();
+    m_iStateSize = 0;
     m_bPaused = false;
+    SafeDelete(m_pRunAheadCore);
 }
 
 void GearsystemCore::RenderFrameBuffer(u8* finalFrameBuffer)
 {
+    if (!IsValidPointer(finalFrameBuffer))
+        return;
+
     if (m_pInput->IsPhaserEnabled())
     {
         Input::stPhaser* phaser = m_pInput->GetPhaser();
@@ -1091,6 +1665,12 @@ void GearsystemCore::RenderFrameBuffer(u8* finalFrameBuffer)
             return;
     }
 
+    if (m_ObservationFormat != GS_OBSERVATION_DISABLED)
+    {
+        m_pVideo->RenderObservation(finalFrameBuffer, m_ObservationFormat);
+        return;
+    }
+
     int size = GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN * GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN;
 
     switch (m_pixelFormat)
@@ -23,31 +23,13 @@
 #include "definitions.h"
 #include "Cartridge.h"
 #include "Video.h"
+#include "StateSerializer.h"
 
 class Memory;
 class Processor;
 class Audio;
 class Input;
-class SegaMemoryRule;
-class CodemastersMemoryRule;
-class RomOnlyMemoryRule;
-class SG1000MemoryRule;
-class KoreanMemoryRule;
-class KoreanMSXSMS8000MemoryRule;
-class KoreanSMS32KB2000MemoryRule;
-class KoreanMSX32KB2000MemoryRule;
-class Korean2000XOR1FMemoryRule;
-class KoreanMSX8KB0300MemoryRule;
-class Korean0000XORFFMemoryRule;
-class KoreanFFFFHiComMemoryRule;
-class KoreanFFFEMemoryRule;
-class KoreanBFFCMemoryRule;
-class KoreanFFF3FFFCMemoryRule;
-class KoreanMDFFF5MemoryRule;
-class MSXMemoryRule;
-class JanggunMemoryRule;
-class Multi4PAKAllActionMemoryRule;
-class JumboDahjeeMemoryRule;
+class MapperMemoryRule;
 class MemoryRule;
 class SmsIOPorts;
 class GameGearIOPorts;
@@ -70,8 +52,12 @@ public:
     bool RunToVBlank(u8* pFrameBuffer, s16* pSampleBuffer, int* pSampleCount, bool step = false, bool stopOnBreakpoints = false);
     bool LoadROM(const char* szFilePath, Cartridge::ForceConfiguration* config = NULL);
     bool LoadROMFromBuffer(const u8* buffer, int size, Cartridge::ForceConfiguration* config = NULL, const char* szFilePath = NULL);
+    GearsystemCore* Fork();
+    bool Fork(GearsystemCore* target);
     void SaveMemoryDump();
     void SaveDisassembledROM();
+    bool SaveCodeDataLog();
+    bool LoadCodeDataLog();
     bool GetRuntimeInfo(GS_RuntimeInfo& runtime_info);
     void KeyPressed(GS_Joypads joypad, GS_Keys key);
     void KeyReleased(GS_Joypads joypad, GS_Keys key);
@@ -96,8 +82,12 @@ public:
     bool SaveState(std::ostream& stream, size_t& size);
     void LoadState(int index);
     void LoadState(const char* szPath, int index);
-    bool LoadState(const u8* buffer, size_t size);
-    bool LoadState(std::istream& stream);
+    bool LoadState(const u8* buffer, size_t size, bool force = false);
+    bool LoadState(std::istream& stream, bool force = false);
+    size_t GetStateSize();
+    u64 StateHash();
+    bool StateHash(GS_StateHash& hash);
+    void InvalidateStateHash();
     void SetCheat(const char* szCheat);
     void ClearCheats();
     void SetRamModificationCallback(RamChangedCallback callback);
@@ -106,13 +96,33 @@ public:
     Processor* GetProcessor();
     Audio* GetAudio();
     Video* GetVideo();
+    Input* GetInput();
     void SetGlassesConfig(GlassesConfig config);
+    void SetObservationFormat(GS_Observation_Format format);
+    void GetObservationSize(int& width, int& height);
+    void SetRunAhead(int frames, bool secondInstance = false);
+    int GetRunAheadFrames();
+    bool GetRunAheadStats(GS_RunAheadStats& stats);
+    void EnableProfiling(bool enable);
+    void GetProfile(GS_FrameProfile& profile);
 
 private:
     void InitMemoryRules();
     bool AddMemoryRules();
     void Reset();
+    bool RunFrame(u8* pFrameBuffer, s16* pSampleBuffer, int* pSampleCount, bool step, bool stopOnBreakpoints);
+    void RunProfiledFrame(u8* pFrameBuffer, s16* pSampleBuffer, int* pSampleCount);
+    bool RunAhead(u8* pFrameBuffer, s16* pSampleBuffer, int* pSampleCount, bool stopOnBreakpoints);
+    GearsystemCore* GetRunAheadInstance();
+    void CopySettings(GearsystemCore* target);
     void RenderFrameBuffer(u8* finalFrameBuffer);
+    void SaveState(StateWriter& writer);
+    void SaveChunk(StateWriter& writer, u32 id);
+    void LoadChunk(StateReader& reader, u32 id, u16 version);
+    bool LoadChunkedState(const u8* buffer, size_t size, bool force);
+    bool RestoreState(const u8* buffer, size_t size, bool skipPages = false);
+    size_t GetChunkSize(u32 id, u32 version);
+    bool LoadLegacyState(const u8* buffer, size_t size);
 
 private:
     Memory* m_pMemory;
@@ -121,26 +131,7 @@ private:
     Video* m_pVideo;
     Input* m_pInput;
     Cartridge* m_pCartridge;
-    SegaMemoryRule* m_pSegaMemoryRule;
-    CodemastersMemoryRule* m_pCodemastersMemoryRule;
-    SG1000MemoryRule* m_pSG1000MemoryRule;
-    RomOnlyMemoryRule* m_pRomOnlyMemoryRule;
-    KoreanMemoryRule* m_pKoreanMemoryRule;
-    KoreanMSXSMS8000MemoryRule* m_pKoreanMSXSMS8000MemoryRule;
-    KoreanSMS32KB2000MemoryRule* m_pKoreanSMS32KB2000MemoryRule;
-    KoreanMSX32KB2000MemoryRule* m_pKoreanMSX32KB2000MemoryRule;
-    Korean2000XOR1FMemoryRule* m_pKorean2000XOR1FMemoryRule;
-    KoreanMSX8KB0300MemoryRule* m_pKoreanMSX8KB0300MemoryRule;
-    Korean0000XORFFMemoryRule* m_pKorean0000XORFFMemoryRule;
-    KoreanFFFFHiComMemoryRule* m_pKoreanFFFFHiComMemoryRule;
-    KoreanFFFEMemoryRule* m_pKoreanFFFEMemoryRule;
-    KoreanBFFCMemoryRule* m_pKoreanBFFCMemoryRule;
-    KoreanFFF3FFFCMemoryRule* m_pKoreanFFF3FFFCMemoryRule;
-    KoreanMDFFF5MemoryRule* m_pKoreanMDFFF5MemoryRule;
-    MSXMemoryRule* m_pMSXMemoryRule;
-    JanggunMemoryRule* m_pJanggunMemoryRule;
-    Multi4PAKAllActionMemoryRule* m_pMulti4PAKAllActionMemoryRule;
-    JumboDahjeeMemoryRule* m_pJumboDahjeeMemoryRule;
+    MapperMemoryRule* m_pMapperMemoryRule;
     SmsIOPorts* m_pSmsIOPorts;
     GameGearIOPorts* m_pGameGearIOPorts;
     BootromMemoryRule* m_pBootromMemoryRule;
@@ -148,6 +139,20 @@ private:
     RamChangedCallback m_pRamChangedCallback;
     GS_Color_Format m_pixelFormat;
     GlassesConfig m_GlassesConfig;
+    GS_Observation_Format m_ObservationFormat;
+    size_t m_iStateSize;
+    MemoryRule* m_pStateSizeRule;
+    int m_iRunAheadFrames;
+    bool m_bRunAheadSecondInstance;
+    GearsystemCore* m_pRunAheadCore;
+    u8* m_pRunAheadState;
+    size_t m_iRunAheadStateSize;
+    GS_RunAheadStats m_RunAheadStats;
+    u8* m_pForkState;
+    size_t m_iForkStateSize;
+    StateHasher* m_pStateHasher;
+    bool m_bProfiling;
+    GS_FrameProfile m_Profile;
 };
 
 #endif	/* CORE_H */
@@ -35,6 +35,9 @@ Input::Input(Processor* pProcessor, Video* pVideo)
     m_Phaser.y = 0;
     m_PhaserOffset.x = 0;
     m_PhaserOffset.y = 0;
+    m_bPaddle = false;
+    // Saved as a whole, padding included
+    memset(&m_Paddle, 0, sizeof(m_Paddle));
 }
 
 void Input::Init()
@@ -80,6 +83,11 @@ void Input::KeyReleased(GS_Joypads joypad, GS_Keys key)
         m_Joypad2 = SetBit(m_Joypad2, key);
 }
 
+u8 Input::GetJoypad(GS_Joypads joypad)
+{
+    return (joypad == Joypad_1) ? m_Joypad1 : m_Joypad2;
+}
+
 void Input::EnablePhaser(bool enable)
 {
     Debug("Light Phaser %s", enable ? "enabled" : "disabled");
@@ -116,7 +124,12 @@ void Input::EnablePaddle(bool enable)
 
 void Input::SetPaddle(float x)
 {
-    m_Paddle.x += x;
+    SetPaddlePosition(m_Paddle.x + x);
+}
+
+void Input::SetPaddlePosition(float x)
+{
+    m_Paddle.x = x;
     if (m_Paddle.x < 0.0f)
         m_Paddle.x = 0.0f;
     else if (m_Paddle.x > 255.0f)
@@ -125,6 +138,11 @@ void Input::SetPaddle(float x)
     m_Paddle.reg = (u8)floor(m_Paddle.x + 0.5f);
 }
 
+Input::stPaddle* Input::GetPaddle()
+{
+    return &m_Paddle;
+}
+
 bool Input::IsPaddleEnabled()
 {
     return m_bPaddle;
@@ -140,28 +158,24 @@ void Input::SetGlassesRegistry(u8 value)
     m_GlassesRegistry = value;
 }
 
-void Input::SaveState(std::ostream& stream)
+void Input::SaveState(StateWriter& writer)
 {
-    using namespace std;
-
-    stream.write(reinterpret_cast<const char*> (&m_Joypad1), sizeof(m_Joypad1));
-    stream.write(reinterpret_cast<const char*> (&m_Joypad2), sizeof(m_Joypad2));
-    stream.write(reinterpret_cast<const char*> (&m_GlassesRegistry), sizeof(m_GlassesRegistry));
-    stream.write(reinterpret_cast<const char*> (&m_bPhaser), sizeof(m_bPhaser));
-    stream.write(reinterpret_cast<const char*> (&m_Phaser), sizeof(m_Phaser));
-    stream.write(reinterpret_cast<const char*> (&m_bPaddle), sizeof(m_bPaddle));
-    stream.write(reinterpret_cast<const char*> (&m_Paddle), sizeof(m_Paddle));
+    writer.Write(&m_Joypad1, sizeof(m_Joypad1));
+    writer.Write(&m_Joypad2, sizeof(m_Joypad2));
+    writer.Write(&m_GlassesRegistry, sizeof(m_GlassesRegistry));
+    writer.Write(&m_bPhaser, sizeof(m_bPhaser));
+    writer.Write(&m_Phaser, sizeof(m_Phaser));
+    writer.Write(&m_bPaddle, sizeof(m_bPaddle));
+    writer.Write(&m_Paddle, sizeof(m_Paddle));
 }
 
-void Input::LoadState(std::istream& stream)
+void Input::LoadState(StateReader& reader)
 {
-    using namespace std;
-
-    stream.read(reinterpret_cast<char*> (&m_Joypad1), sizeof(m_Joypad1));
-    stream.read(reinterpret_cast<char*> (&m_Joypad2), sizeof(m_Joypad2));
-    stream.read(reinterpret_cast<char*> (&m_GlassesRegistry), sizeof(m_GlassesRegistry));
-    stream.read(reinterpret_cast<char*> (&m_bPhaser), sizeof(m_bPhaser));
-    stream.read(reinterpret_cast<char*> (&m_Phaser), sizeof(m_Phaser));
-    stream.read(reinterpret_cast<char*> (&m_bPaddle), sizeof(m_bPaddle));
-    stream.read(reinterpret_cast<char*> (&m_Paddle), sizeof(m_Paddle));
+    reader.Read(&m_Joypad1, sizeof(m_Joypad1));
+    reader.Read(&m_Joypad2, sizeof(m_Joypad2));
+    reader.Read(&m_GlassesRegistry, sizeof(m_GlassesRegistry));
+    reader.Read(&m_bPhaser, sizeof(m_bPhaser));
+    reader.Read(&m_Phaser, sizeof(m_Phaser));
+    reader.Read(&m_bPaddle, sizeof(m_bPaddle));
+    reader.Read(&m_Paddle, sizeof(m_Paddle));
 }
@@ -21,6 +21,7 @@
 #define	INPUT_H
 
 #include "definitions.h"
+#include "StateSerializer.h"
 
 class Memory;
 class Processor;
@@ -48,6 +49,7 @@ public:
     void Reset(bool bGameGear);
     void KeyPressed(GS_Joypads joypad, GS_Keys key);
     void KeyReleased(GS_Joypads joypad, GS_Keys key);
+    u8 GetJoypad(GS_Joypads joypad);
     void EnablePhaser(bool enable);
     void SetPhaser(int x, int y);
     void SetPhaserOffset(int x, int y);
@@ -55,14 +57,16 @@ public:
     bool IsPhaserEnabled();
     void EnablePaddle(bool enable);
     void SetPaddle(float x);
+    void SetPaddlePosition(float x);
+    stPaddle* GetPaddle();
     bool IsPaddleEnabled();
     u8 GetPortDC();
     u8 GetPortDD();
     u8 GetPort00();
     u8 GetGlassesRegistry();
     void SetGlassesRegistry(u8 value);
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream);
+    void SaveState(StateWriter& writer);
+    void LoadState(StateReader& reader);
 
 private:
     Processor* m_pProccesor;
@@ -0,0 +1,1013 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include "MapperMemoryRule.h"
+#include "Memory.h"
+#include "Cartridge.h"
+#include "Input.h"
+
+#define MAPPER_16K_REGIONS { 0, 0, 1, 1, 2, 2 }
+#define MAPPER_8K_REGIONS { 0, 1, 2, 3, 4, 5 }
+#define MAPPER_MAP_REGIONS { RegionMap, RegionMap, RegionMap, RegionMap, RegionMap, RegionMap }
+#define MAPPER_8K_STATE { { StateBanks, 0, 6 }, { StateBankAddresses, 0, 6 } }
+
+const MapperMemoryRule::Board MapperMemoryRule::kBoards[] =
+{
+    {
+        Cartridge::CartridgeRomOnlyMapper, 3, 0x4000, 0x4000, { 0, 1, 2 }, MAPPER_MAP_REGIONS,
+        0, 0, 0, RAMAreaMirrored, PagesFromMap, 0,
+        { },
+        { },
+        NULL
+    },
+    {
+        Cartridge::CartridgeSegaMapper, 3, 0x4000, 0x4000, { 0, 1, 2 }, MAPPER_16K_REGIONS,
+        0x8000, 0x8000, 0x4000, RAMAreaMirrored, PagesFromBankAddresses, BoardFirstKBFixed | BoardBatteryRAM,
+        {
+            { 0xFFFF, 0xFFFC, { }, &MapperMemoryRule::SegaRAMControl, 0 },
+            { 0xFFFF, 0xFFFD, { { 0, 0xFF, 0, 0, 0, 0, 0, 0 } }, NULL, 0 },
+            { 0xFFFF, 0xFFFE, { { 1, 0xFF, 0, 0, 0, 0, 0, 0 } }, NULL, 0 },
+            { 0xFFFF, 0xFFFF, { { 2, 0xFF, 0, 0, 0, 0, 0, 0 } }, NULL, 0 },
+            { 0xFFFC, 0xFFF8, { }, &MapperMemoryRule::SegaGlasses, 0 }
+        },
+        { { StateRAM, 0, 0 }, { StateBanks, 0, 3 }, { StateBankAddresses, 0, 3 }, { StateRAMBankStart, 0, 0 }, { StateRAMEnabled, 0, 0 }, { StatePersistRAM, 0, 0 } },
+        NULL
+    },
+    {
+        Cartridge::CartridgeCodemastersMapper, 3, 0x4000, 0x4000, { 0, 1, 0 }, MAPPER_16K_REGIONS,
+        0x2000, 0xA000, 0x2000, RAMAreaMirrored, PagesFromMap, 0,
+        {
+            { 0xFFFF, 0x0000, { { 0, 0xFF, 0, 0, 0, 0, 0, 0 } }, NULL, 0 },
+            { 0xFFFF, 0x4000, { { 1, 0xFF, 0, 0, 0, 0, 0, 0 } }, &MapperMemoryRule::CodemastersRAMControl, 0 },
+            { 0xFFFF, 0x8000, { { 2, 0xFF, 0, 0, 0, 0, 0, 0 } }, NULL, 0 }
+        },
+        { { StateBanks, 0, 3 }, { StateBankAddresses, 0, 3 }, { StateRAM, 0, 0 }, { StateRAMEnabled, 0, 0 } },
+        NULL
+    },
+    {
+        Cartridge::CartridgeSG1000Mapper, 3, 0x4000, 0x4000, { 0, 1, 2 }, MAPPER_MAP_REGIONS,
+        0, 0, 0, RAMAreaPlain, PagesFromMap, BoardSG1000,
+        { },
+        { },
+        NULL
+    },
+    {
+        Cartridge::CartridgeKoreanMapper, 3, 0x4000, 0x4000, { 0, 1, 2 }, MAPPER_16K_REGIONS,
+        0, 0, 0, RAMAreaMirrored, PagesFromBankAddresses, 0,
+        {
+            { 0xFFFF, 0xA000, { { 2, 0xFF, 0, 0, 0, 0, 0, 0 } }, NULL, 0 }
+        },
+        { { StateBanks, 2, 1 }, { StateBankAddresses, 2, 1 } },
+        NULL
+    },
+    {
+        Cartridge::CartridgeKoreanMSXSMS8000Mapper, 6, 0x2000, 0x2000, { 0x3C, 0x3C, 1, 0, 3, 2 }, MAPPER_8K_REGIONS,
+        0, 0, 0, RAMAreaMirrored, PagesFromBankAddresses, Board8kBanks,
+        {
+            { 0xFFFF, 0x8000, { }, &MapperMemoryRule::KoreanMSXSMS8000Register, 0 }
+        },
+        { { StateBanks, 0, 6 }, { StateBankAddresses, 0, 6 }, { StateRegister8, 0, 1 } },
+        NULL
+    },
+    {
+        Cartridge::CartridgeKoreanSMS32KB2000Mapper, 3, 0x4000, 0x4000, { 0, 1, 0 }, MAPPER_16K_REGIONS,
+        0, 0, 0, RAMAreaMirrored, PagesFromBanks, 0,
+        {
+            { 0xFFFF, 0x2000, { { 0, 0xFF, 0, 1, 0, 0, 0, 0 }, { 1, 0xFF, 0, 1, 1, 0, 0, 0 }, { 2, 0xFF, 0, 1, 0, 0, 0, 0 } }, NULL, 0 }
+        },
+        { { StateBankAddresses, 0, 3 }, { StateBanks, 0, 3 } },
+        NULL
+    },
+    {
+        Cartridge::CartridgeKoreanMSX32KB2000Mapper, 3, 0x4000, 0x4000, { 0, 1, 2 }, MAPPER_16K_REGIONS,
+        0, 0, 0, RAMAreaMirrored, PagesFromBanks, 0,
+        {
+            { 0xFFFF, 0x2000, { { 1, 0xFF, 0, 1, 1, 0, 0, 0 }, { 2, 0xFF, 0, 1, 2, 0, 0, 0 } }, NULL, 0 }
+        },
+        { { StateBankAddresses, 0, 3 }, { StateBanks, 0, 3 } },
+        NULL
+    },
+    {
+        Cartridge::CartridgeKorean2000XOR1FMapper, 6, 0x2000, 0x2000, { 0, 0, 0x60, 0x61, 0x62, 0x63 }, MAPPER_8K_REGIONS,
+        0, 0, 0, RAMAreaMirrored, PagesFromBankAddresses, Board8kBanks,
+        {
+            { 0x6000, 0x2000, { { 2, 0xFF, 0x1F, 0, 0, 0x00, 0, 0 }, { 3, 0xFF, 0x1F, 0, 0, 0x01, 0, 0 }, { 4, 0xFF, 0x1F, 0, 0, 0x02, 0, 0 }, { 5, 0xFF, 0x1F, 0, 0, 0x03, 0, 0 } }, NULL, 0 }
+        },
+        MAPPER_8K_STATE,
+        NULL
+    },
+    {
+        Cartridge::CartridgeKoreanMSX8KB0300Mapper, 6, 0x2000, 0x2000, { 0, 1, 2, 3, 4, 5 }, MAPPER_8K_REGIONS,
+        0, 0, 0, RAMAreaMirrored, PagesFromBankAddresses, Board8kBanks,
+        {
+            { 0xFF00, 0x0000, { { 4, 0xFF, 0, 0, 0, 0, 0, 0 } }, NULL, 0 },
+            { 0xFF00, 0x0100, { { 2, 0xFF, 0, 0, 0, 0, 0, 0 } }, NULL, 0 },
+            { 0xFF00, 0x0200, { { 1, 0xFF, 0, 0, 0, 0, 0, 0 }, { 5, 0xFF, 0, 0, 0, 0, 0, 0 } }, NULL, 0 },
+            { 0xFF00, 0x0300, { { 3, 0xFF, 0, 0, 0, 0, 0, 0 } }, NULL, 0 }
+        },
+        { { StateBankAddresses, 0, 6 }, { StateBanks, 0, 6 } },
+        NULL
+    },
+    {
+        Cartridge::CartridgeKorean0000XORFFMapper, 6, 0x2000, 0x2000, { 0, 1, 2, 3, 4, 5 }, MAPPER_8K_REGIONS,
+        0, 0, 0, RAMAreaMirrored, PagesFromBankAddresses, Board8kBanks,
+        {
+            { 0xFFFF, 0x0000, { }, &MapperMemoryRule::Korean0000XORFFRegister, 0 }
+        },
+        MAPPER_8K_STATE,
+        NULL
+    },
+    {
+        Cartridge::CartridgeKoreanFFFFHiComMapper, 3, 0x4000, 0x4000, { 0, 1, 0 }, MAPPER_16K_REGIONS,
+        0, 0, 0, RAMAreaMirrored, PagesFromBankAddresses, 0,
+        {
+            { 0xFFFF, 0xFFFF, { { 0, 0xFF, 0, 1, 0, 0, 0, 0 }, { 1, 0xFF, 0, 1, 0, 0, 1, 0 } }, NULL, 0 }
+        },
+        { { StateBankAddresses, 0, 3 }, { StateBanks, 0, 3 } },
+        NULL
+    },
+    {
+        Cartridge::CartridgeKoreanFFFEMapper, 6, 0x2000, 0x2000, { 0, 1, 2, 3, 0x3F, 0x3F }, MAPPER_8K_REGIONS,
+        0, 0, 0, RAMAreaMirrored, PagesFromBankAddresses, Board8kBanks,
+        {
+            { 0xFFFF, 0xFFFE, { }, &MapperMemoryRule::KoreanFFFERegister, RegisterOnly }
+        },
+        MAPPER_8K_STATE,
+        NULL
+    },
+    {
+        Cartridge::CartridgeKoreanBFFCMapper, 6, 0x2000, 0x2000, { 0, 1, 2, 3, 4, 5 }, MAPPER_8K_REGIONS,
+        0, 0, 0, RAMAreaMirrored, PagesFromBankAddresses, Board8kBanks,
+        {
+            { 0xFFFF, 0xBFFC, { }, &MapperMemoryRule::KoreanBFFCRegister, 0 }
+        },
+        MAPPER_8K_STATE,
+        NULL
+    },
+    {
+        Cartridge::CartridgeKoreanFFF3FFFCMapper, 6, 0x2000, 0x2000, { 0, 1, 0, 1, 0, 0 }, MAPPER_8K_REGIONS,
+        0, 0, 0, RAMAreaMirrored, PagesFromBankAddresses, Board8kBanks,
+        {
+            { 0xBFFF, 0xBFF3, { }, &MapperMemoryRule::KoreanFFF3FFFCRegister, 0 },
+            { 0xBFFF, 0xBFFC, { }, &MapperMemoryRule::KoreanFFF3FFFCRegister, 0 }
+        },
+        { { StateBanks, 0, 6 }, { StateBankAddresses, 0, 6 }, { StateRegisters, 0, 2 } },
+        &MapperMemoryRule::KoreanFFF3FFFCReset
+    },
+    {
+        Cartridge::CartridgeKoreanMDFFF5Mapper, 6, 0x2000, 0x2000, { 0, 1, 2, 3, 2, 3 }, MAPPER_8K_REGIONS,
+        0, 0, 0, RAMAreaMirrored, PagesFromBankAddresses, Board8kBanks,
+        {
+            { 0xBFEF, 0xBFE5, { }, &MapperMemoryRule::KoreanMDFFF5Register, 0 },
+            { 0xBFEF, 0xBFEE, { }, &MapperMemoryRule::KoreanMDFFF5Register, 0 },
+            { 0xBFEF, 0xBFEF, { }, &MapperMemoryRule::KoreanMDFFF5Register, 0 }
+        },
+        { { StateBanks, 0, 6 }, { StateBankAddresses, 0, 6 }, { StateRegisters, 0, 1 } },
+        NULL
+    },
+    {
+        Cartridge::CartridgeMSXMapper, 3, 0x2000, 0x2000, { 0, 0, 0, 0 }, { RegionFixed, RegionFixed, 2, 3, 0, 1 },
+        0, 0, 0, RAMAreaMirrored, PagesFromBankAddresses, BoardNemesis,
+        {
+            { 0xFFFF, 0x0000, { { 0, 0xFF, 0, 0, 0, 0, 0, BankUnmasked } }, NULL, 0 },
+            { 0xFFFF, 0x0001, { { 1, 0xFF, 0, 0, 0, 0, 0, BankUnmasked } }, NULL, 0 },
+            { 0xFFFF, 0x0002, { { 2, 0xFF, 0, 0, 0, 0, 0, BankUnmasked } }, NULL, 0 },
+            { 0xFFFF, 0x0003, { { 3, 0xFF, 0, 0, 0, 0, 0, BankUnmasked } }, NULL, 0 }
+        },
+        { { StateBanks, 0, 4 }, { StateBankAddresses, 0, 4 } },
+        NULL
+    },
+    {
+        Cartridge::CartridgeJanggunMapper, 4, 0x2000, 0x4000, { 0, 1, 2, 3 }, { RegionFixed, RegionFixed, 0, 1, 2, 3 },
+        0, 0, 0, RAMAreaMirrored, PagesFromBankAddresses, BoardReverseBits,
+        {
+            { 0xFFFF, 0x4000, { { 0, 0x3F, 0, 0, 0, 0, 0, BankUnmasked } }, NULL, 0 },
+            { 0xFFFF, 0x6000, { { 1, 0x3F, 0, 0, 0, 0, 0, BankUnmasked } }, NULL, 0 },
+            { 0xFFFF, 0x8000, { { 2, 0x3F, 0, 0, 0, 0, 0, BankUnmasked } }, NULL, 0 },
+            { 0xFFFF, 0xA000, { { 3, 0x3F, 0, 0, 0, 0, 0, BankUnmasked } }, NULL, 0 },
+            { 0xFFFF, 0xFFFE, { { 0, 0x3F, 0, 1, 0, 0, 0, BankUnmasked }, { 1, 0x3F, 0, 1, 2, 0, 0, BankUnmasked } }, &MapperMemoryRule::JanggunReverse, 0 },
+            { 0xFFFF, 0xFFFF, { { 2, 0x3F, 0, 1, 0, 0, 0, BankUnmasked }, { 3, 0x3F, 0, 1, 2, 0, 0, BankUnmasked } }, &MapperMemoryRule::JanggunReverse, 0 }
+        },
+        { { StateBanks, 0, 4 }, { StateBankAddresses, 0, 4 } },
+        NULL
+    },
+    {
+        Cartridge::CartridgeMulti4PAKAllActionMapper, 3, 0x4000, 0x4000, { 0, 1, 2 }, MAPPER_16K_REGIONS,
+        0, 0, 0, RAMAreaMirrored, PagesFromBanks, 0,
+        {
+            { 0xFFFF, 0x3FFE, { { 0, 0xFF, 0, 0, 0, 0, 0, BankRawValue } }, NULL, 0 },
+            { 0xFFFF, 0x7FFF, { { 1, 0xFF, 0, 0, 0, 0, 0, BankRawValue } }, NULL, 0 },
+            { 0xFFFF, 0xBFFF, { }, &MapperMemoryRule::Multi4PAKRegister, 0 }
+        },
+        { { StateBankAddresses, 0, 3 }, { StateBanks, 0, 3 } },
+        NULL
+    },
+    {
+        Cartridge::CartridgeJumboDahjeeMapper, 3, 0x4000, 0x4000, { 0, 1, 2 }, MAPPER_MAP_REGIONS,
+        0x2000, 0x2000, 0x2000, RAMArea1KB, PagesFromMap, BoardRAMAlwaysMapped,
+        { },
+        { },
+        NULL
+    }
+};
+
+MapperMemoryRule::MapperMemoryRule(Memory* pMemory, Cartridge* pCartridge, Input* pInput) : MemoryRule(pMemory, pCartridge, pInput)
+{
+    m_pBoard = &kBoards[0];
+    m_pRAM = new u8[0x8000];
+    m_RAMPages.Init(m_pRAM, 0x8000);
+    InitPointer(m_pReversedROM);
+    m_iReversedROMSize = 0;
+    SetBoard(Cartridge::CartridgeRomOnlyMapper);
+}
+
+MapperMemoryRule::~MapperMemoryRule()
+{
+    SafeDeleteArray(m_pRAM);
+    SafeDeleteArray(m_pReversedROM);
+}
+
+bool MapperMemoryRule::SetBoard(Cartridge::CartridgeTypes type)
+{
+    const Board* board = NULL;
+
+    for (size_t i = 0; i < (sizeof(kBoards) / sizeof(kBoards[0])); i++)
+    {
+        if (kBoards[i].type == type)
+        {
+            board = &kBoards[i];
+            break;
+        }
+    }
+
+    if (!IsValidPointer(board))
+        return false;
+
+    m_pBoard = board;
+
+    for (int page = 0; page < 64; page++)
+    {
+        m_bRegisterPages[page] = false;
+
+        for (int r = 0; (r < 6) && (m_pBoard->registers[r].address_mask != 0); r++)
+        {
+            const BoardRegister& reg = m_pBoard->registers[r];
+
+            for (int address = page << 10; address < ((page + 1) << 10); address++)
+            {
+                if ((address & reg.address_mask) == reg.address)
+                {
+                    m_bRegisterPages[page] = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    Reset();
+
+    return true;
+}
+
+// Call when the cartridge ROM has been patched or moved
+void MapperMemoryRule::UpdateROM()
+{
+    m_bReversedROMValid = false;
+    UpdatePages();
+}
+
+u8 MapperMemoryRule::PerformRead(u16 address)
+{
+    return Read(address);
+}
+
+void MapperMemoryRule::PerformWrite(u16 address, u8 value)
+{
+    Write(address, value);
+}
+
+void MapperMemoryRule::Write(u16 address, u8 value)
+{
+    int page = address >> 10;
+
+    if (!m_bRegisterPages[page] || !WriteRegister(address, value))
+    {
+        switch (m_WriteTargets[page])
+        {
+            case WriteRAM:
+            {
+                // RAM + RAM mirror
+                m_pMemory->Load(address, value);
+                m_pMemory->Load(address ^ 0x2000, value);
+                break;
+            }
+            case WriteMap:
+            {
+                m_pMemory->Load(address, value);
+                break;
+            }
+            case WriteMap1KB:
+            {
+                m_pMemory->Load(0xC000 + (address & 0x3FF), value);
+                break;
+            }
+            case WriteCartRAM:
+            {
+                u8* pRAM = m_pWritePages[page] + (address & 0x3FF);
+                int ram_page = static_cast<int>((pRAM - m_pRAM) >> GS_SHARED_PAGE_SHIFT);
+                if (m_RAMPages.IsShared(ram_page) && m_RAMPages.Own(ram_page))
+                    UpdatePages();
+                *pRAM = value;
+                m_RamDirtyPages[(pRAM - m_pRAM) >> GS_STATE_HASH_PAGE_SHIFT] = 1;
+                break;
+            }
+            default:
+            {
+                Debug("--> ** Attempting to write on ROM address $%X %X", address, value);
+            }
+        }
+    }
+
+    if (m_iPersistRAM < 0)
+        m_iPersistRAM = 0;
+}
+
+void MapperMemoryRule::Reset()
+{
+    for (int i = 0; i < 6; i++)
+    {
+        m_iBank[i] = m_pBoard->reset_bank[i];
+        m_iBankAddress[i] = m_iBank[i] * m_pBoard->reset_bank_size;
+    }
+
+    for (int i = 0; i < 4; i++)
+        m_bReverse[i] = false;
+
+    m_iRegister[0] = 0;
+    m_iRegister[1] = 0;
+    m_RAMBankStartAddress = 0;
+    m_bRAMEnabled = (m_pBoard->flags & BoardRAMAlwaysMapped) != 0;
+    m_iPersistRAM = -1;
+    m_bReversedROMValid = false;
+
+    // Banks past the end of the ROM wrap inside its padded storage
+    m_iROMMask = 0x4000;
+    while (m_iROMMask < m_pCartridge->GetROMSize())
+        m_iROMMask <<= 1;
+    m_iROMMask--;
+
+    OwnRAMPages();
+    memset(m_pRAM, 0, 0x8000);
+    memset(m_RamDirtyPages, 1, sizeof(m_RamDirtyPages));
+
+    if (IsValidPointer(m_pBoard->reset))
+        (this->*m_pBoard->reset)();
+
+    UpdatePages();
+}
+
+void MapperMemoryRule::SaveRam(std::ostream & file)
+{
+    if (!(m_pBoard->flags & BoardBatteryRAM))
+        return;
+
+    Debug("MapperMemoryRule save RAM...");
+
+    OwnRAMPages();
+    file.write(reinterpret_cast<const char*> (m_pRAM), m_pBoard->ram_size);
+
+    Debug("MapperMemoryRule save RAM done");
+}
+
+bool MapperMemoryRule::LoadRam(std::istream & file, s32 fileSize)
+{
+    if (!(m_pBoard->flags & BoardBatteryRAM))
+        return false;
+
+    Debug("MapperMemoryRule load RAM...");
+
+    if ((fileSize > 0) && (fileSize != m_pBoard->ram_size))
+    {
+        Log("MapperMemoryRule incorrect size. Expected: %d Found: %d", m_pBoard->ram_size, fileSize);
+        return false;
+    }
+
+    OwnRAMPages();
+
+    for (int i = 0; i < m_pBoard->ram_size; i++)
+    {
+        u8 ram_byte = 0;
+        file.read(reinterpret_cast<char*> (&ram_byte), 1);
+        m_pRAM[i] = ram_byte;
+    }
+
+    Debug("MapperMemoryRule load RAM done");
+
+    return true;
+}
+
+bool MapperMemoryRule::PersistedRAM()
+{
+    return (m_pBoard->flags & BoardBatteryRAM) && (m_iPersistRAM == 1);
+}
+
+size_t MapperMemoryRule::GetRamSize()
+{
+    if (!(m_pBoard->flags & BoardBatteryRAM) || (m_iPersistRAM == 0))
+        return 0;
+    else
+        return m_pBoard->ram_size;
+}
+
+u8* MapperMemoryRule::GetRamBanks()
+{
+    OwnRAMPages();
+
+    if (m_pBoard->flags & BoardBatteryRAM)
+        return (m_iPersistRAM == 0) ? NULL : m_pRAM;
+    else
+        return ((m_pBoard->ram_size > 0) && m_bRAMEnabled) ? m_pRAM : NULL;
+}
+
+int MapperMemoryRule::GetRamBank()
+{
+    return m_RAMBankStartAddress == 0x4000 ? 1 : 0;
+}
+
+u8* MapperMemoryRule::GetPage(int index)
+{
+    if ((index < 0) || (index >= m_pBoard->bank_count))
+        return NULL;
+
+    switch (m_pBoard->pages)
+    {
+        case PagesFromMap:
+            return m_pMemory->GetMemoryMap() + (0x4000 * index);
+        case PagesFromBanks:
+            return m_pCartridge->GetROM() + (m_iBank[index] * m_pBoard->bank_size);
+        default:
+            if (m_bRAMEnabled && (m_pBoard->ram_size > 0) && (m_pBoard->ram_window == (0x4000 * index)))
+            {
+                OwnRAMPages();
+                return m_pRAM + m_RAMBankStartAddress;
+            }
+            return m_pCartridge->GetROM() + m_iBankAddress[index];
+    }
+}
+
+int MapperMemoryRule::GetBank(int index)
+{
+    if ((index < 0) || (index >= m_pBoard->bank_count))
+        return 0;
+
+    return m_iBank[index];
+}
+
+bool MapperMemoryRule::Has8kBanks()
+{
+    return (m_pBoard->flags & Board8kBanks) != 0;
+}
+
+void MapperMemoryRule::SaveState(StateWriter& writer)
+{
+    for (int i = 0; (i < 7) && (m_pBoard->state[i].type != StateEnd); i++)
+    {
+        const StateField& field = m_pBoard->state[i];
+
+        switch (field.type)
+        {
+            case StateBanks:
+                writer.Write(m_iBank + field.first, field.count * sizeof(int));
+                break;
+            case StateBankAddresses:
+                writer.Write(m_iBankAddress + field.first, field.count * sizeof(int));
+                break;
+            case StateRAM:
+                writer.WritePages(m_RAMPages, m_pBoard->ram_size, m_RamDirtyPages);
+                break;
+            case StateRAMBankStart:
+                writer.Write(&m_RAMBankStartAddress, sizeof(m_RAMBankStartAddress));
+                break;
+            case StateRAMEnabled:
+                writer.Write(&m_bRAMEnabled, sizeof(m_bRAMEnabled));
+                break;
+            case StatePersistRAM:
+                writer.Write(&m_iPersistRAM, sizeof(m_iPersistRAM));
+                break;
+            case StateRegisters:
+                writer.Write(m_iRegister + field.first, field.count * sizeof(int));
+                break;
+            case StateRegister8:
+            {
+                u8 reg = static_cast<u8>(m_iRegister[field.first]);
+                writer.Write(&reg, sizeof(reg));
+                break;
+            }
+        }
+    }
+}
+
+void MapperMemoryRule::LoadState(StateReader& reader)
+{
+    for (int i = 0; (i < 7) && (m_pBoard->state[i].type != StateEnd); i++)
+    {
+        const StateField& field = m_pBoard->state[i];
+
+        switch (field.type)
+        {
+            case StateBanks:
+                reader.Read(m_iBank + field.first, field.count * sizeof(int));
+                break;
+            case StateBankAddresses:
+                reader.Read(m_iBankAddress + field.first, field.count * sizeof(int));
+                break;
+            case StateRAM:
+                if (!reader.IsSkippingPages())
+                {
+                    OwnRAMPages();
+                    reader.Read(m_pRAM, m_pBoard->ram_size);
+                }
+                break;
+            case StateRAMBankStart:
+                reader.Read(&m_RAMBankStartAddress, sizeof(m_RAMBankStartAddress));
+                break;
+            case StateRAMEnabled:
+                reader.Read(&m_bRAMEnabled, sizeof(m_bRAMEnabled));
+                break;
+            case StatePersistRAM:
+                reader.Read(&m_iPersistRAM, sizeof(m_iPersistRAM));
+                break;
+            case StateRegisters:
+                reader.Read(m_iRegister + field.first, field.count * sizeof(int));
+                break;
+            case StateRegister8:
+            {
+                u8 reg = 0;
+                reader.Read(&reg, sizeof(reg));
+                m_iRegister[field.first] = reg;
+                break;
+            }
+        }
+    }
+
+    UpdatePages();
+}
+
+bool MapperMemoryRule::WriteRegister(u16 address, u8 value)
+{
+    bool matched = false;
+    bool consumed = false;
+
+    for (int r = 0; (r < 6) && (m_pBoard->registers[r].address_mask != 0); r++)
+    {
+        const BoardRegister& reg = m_pBoard->registers[r];
+
+        if ((address & reg.address_mask) != reg.address)
+            continue;
+
+        Debug("--> ** Writing to register $%X %X", address, value);
+
+        for (int b = 0; (b < 4) && (reg.banks[b].value_mask != 0); b++)
+            WriteBank(reg.banks[b], value);
+
+        if (IsValidPointer(reg.handler))
+            (this->*reg.handler)(address, value);
+
+        matched = true;
+        consumed |= (reg.flags & RegisterOnly) != 0;
+    }
+
+    if (matched)
+        UpdatePages();
+
+    return consumed;
+}
+
+void MapperMemoryRule::WriteBank(const BankWrite& bank, u8 value)
+{
+    int raw = (((value & bank.value_mask) ^ bank.value_xor) << bank.shift) + bank.add;
+    int mapped = (bank.flags & BankUnmasked) ? raw : (raw & BankMask());
+
+    mapped = (mapped ^ bank.post_xor) + bank.post_add;
+
+    m_iBank[bank.bank] = (bank.flags & BankRawValue) ? raw : mapped;
+    m_iBankAddress[bank.bank] = mapped * m_pBoard->bank_size;
+}
+
+void MapperMemoryRule::SetBank(int index, int bank)
+{
+    m_iBank[index] = bank;
+    m_iBankAddress[index] = bank * m_pBoard->bank_size;
+}
+
+// Call when the banks change or when pages shared with a fork move
+void MapperMemoryRule::UpdatePages()
+{
+    u8* pMap = m_pMemory->GetMapPages()->GetData();
+    u8* pROM = m_pCartridge->GetROM();
+
+    for (int region = 0; region < 6; region++)
+    {
+        int bank = m_pBoard->region[region];
+        int address = region * 0x2000;
+        u8* pSource;
+
+        if ((bank == RegionMap) || !IsValidPointer(pROM))
+            pSource = pMap + address;
+        else if (bank == RegionFixed)
+            pSource = pROM + address;
+        else
+        {
+            int offset = (m_pBoard->bank_size == 0x4000) ? (address & 0x2000) : 0;
+            pSource = pROM + ((m_iBankAddress[bank] + offset) & m_iROMMask);
+
+            if ((m_pBoard->flags & BoardReverseBits) && m_bReverse[region >> 1])
+                pSource = ReversedROM(pSource);
+        }
+
+        MapPages(address, 0x2000, pSource, WriteROM);
+    }
+
+    if (m_pBoard->flags & BoardFirstKBFixed)
+        MapPages(0x0000, 0x400, pMap, WriteROM);
+
+    // Nemesis
+    if ((m_pBoard->flags & BoardNemesis) && IsValidPointer(pROM) && (m_pCartridge->GetCRC() == 0xE316C06D))
+        MapPages(0x0000, 0x2000, pROM + m_pCartridge->GetROMSize() - 0x2000, WriteROM);
+
+    if (m_pBoard->flags & BoardSG1000)
+    {
+        // May contain some RAM
+        MapPages(0x3000, 0x1000, pMap + 0x3000, WriteMap);
+        if (!m_pCartridge->HasRAMWithoutBattery())
+            MapPages(0x4000, 0x4000, pMap, WriteROM);
+        MapPages(0x8000, 0x4000, pMap + 0x8000, WriteMap);
+    }
+
+    if ((m_pBoard->ram_size > 0) && m_bRAMEnabled)
+        MapPages(m_pBoard->ram_window, m_pBoard->ram_window_size, m_pRAM + m_RAMBankStartAddress, WriteCartRAM);
+
+    switch (m_pBoard->ram_area)
+    {
+        case RAMAreaPlain:
+            MapPages(0xC000, 0x4000, pMap + 0xC000, WriteMap);
+            break;
+        case RAMArea1KB:
+            for (int address = 0xC000; address < 0x10000; address += 0x400)
+                MapPages(address, 0x400, pMap + 0xC000, WriteMap1KB);
+            break;
+        default:
+            MapPages(0xC000, 0x4000, pMap + 0xC000, WriteRAM);
+    }
+
+#ifndef GEARSYSTEM_DISABLE_DISASSEMBLER
+    UpdateCodeDataLogger(pMap, pROM);
+#endif
+
+    MapSharedPages(m_pMemory->GetMapPages());
+    MapSharedPages(&m_RAMPages);
+}
+
+// Until a forked core writes a shared page it reads the page from the
+// block, writes always go to its own array
+void MapperMemoryRule::MapSharedPages(const SharedPages* pPages)
+{
+    if (!pPages->IsShared())
+        return;
+
+    const u8* pData = pPages->GetData();
+
+    for (int i = 0; i < 64; i++)
+    {
+        if ((m_pReadPages[i] < pData) || (m_pReadPages[i] >= (pData + pPages->GetSize())))
+            continue;
+
+        size_t offset = static_cast<size_t>(m_pReadPages[i] - pData);
+        m_pReadPages[i] = pPages->GetPage(static_cast<int>(offset >> GS_SHARED_PAGE_SHIFT)) + (offset & GS_SHARED_PAGE_MASK);
+    }
+}
+
+void MapperMemoryRule::OwnRAMPages()
+{
+    if (m_RAMPages.OwnAll())
+        UpdatePages();
+}
+
+// Boards without a mapper run from the slots copied into the memory map,
+// the log wants those pages as ROM
+void MapperMemoryRule::UpdateCodeDataLogger(u8* pMap, u8* pROM)
+{
+    const u8* pages[64];
+    int romSize = m_pCartridge->GetROMSize();
+
+    for (int i = 0; i < 64; i++)
+    {
+        pages[i] = m_pReadPages[i];
+
+        if ((m_WriteTargets[i] != WriteROM) || !IsValidPointer(pROM) || (pages[i] < pMap) || (pages[i] >= (pMap + 0xC000)))
+            continue;
+
+        int offset = (int)(pages[i] - pMap);
+
+        if (offset < romSize)
+            pages[i] = pROM + offset;
+    }
+
+    m_pMemory->GetCodeDataLogger()->UpdatePages(pages, pROM, romSize, m_pCartridge->GetCRC(), pMap + 0xC000);
+}
+
+void MapperMemoryRule::MapPages(u16 address, int size, u8* pSource, u8 target)
+{
+    int first = address >> 10;
+    int count = size >> 10;
+
+    for (int i = 0; i < count; i++)
+    {
+        m_pReadPages[first + i] = pSource + (i << 10);
+        m_pWritePages[first + i] = pSource + (i << 10);
+        m_WriteTargets[first + i] = target;
+    }
+}
+
+// Bit reversed copy of the ROM, so reversed banks stay plain page reads
+u8* MapperMemoryRule::ReversedROM(u8* pSource)
+{
+    u8* pROM = m_pCartridge->GetROM();
+    int size = m_iROMMask + 1;
+
+    if (!m_bReversedROMValid)
+    {
+        if (size > m_iReversedROMSize)
+        {
+            SafeDeleteArray(m_pReversedROM);
+            m_pReversedROM = new u8[size];
+            m_iReversedROMSize = size;
+        }
+
+        for (int i = 0; i < size; i++)
+            m_pReversedROM[i] = ReverseBits(pROM[i]);
+
+        m_bReversedROMValid = true;
+    }
+
+    return m_pReversedROM + (pSource - pROM);
+}
+
+int MapperMemoryRule::BankMask()
+{
+    if (m_pBoard->bank_size == 0x4000)
+        return m_pCartridge->GetROMBankCount() - 1;
+    else
+        return m_pCartridge->GetROMBankCount8k() - 1;
+}
+
+void MapperMemoryRule::SegaRAMControl(u16, u8 value)
+{
+    m_RAMBankStartAddress = IsSetBit(value, 2) ? 0x4000 : 0x0000;
+    m_bRAMEnabled = IsSetBit(value, 3);
+    if (m_bRAMEnabled && !m_pCartridge->HasRAMWithoutBattery())
+        m_iPersistRAM = 1;
+}
+
+void MapperMemoryRule::SegaGlasses(u16, u8 value)
+{
+    m_pInput->SetGlassesRegistry(value);
+}
+
+void MapperMemoryRule::CodemastersRAMControl(u16, u8 value)
+{
+    m_bRAMEnabled = ((value & 0x80) != 0) && m_pCartridge->HasRAMWithoutBattery();
+}
+
+void MapperMemoryRule::KoreanMSXSMS8000Register(u16, u8 value)
+{
+    int mask = BankMask();
+
+    if (m_iRegister[0] == 0xFF)
+        value ^= 0x22;
+
+    m_iRegister[0] = value;
+
+    if (value & 0x80)
+    {
+        SetBank(0, (value ^ 0x03) & mask);
+        SetBank(1, (value ^ 0x02) & mask);
+    }
+    else
+    {
+        SetBank(0, 0x3C & mask);
+        SetBank(1, 0x3C & mask);
+    }
+
+    SetBank(2, (value ^ 0x01) & mask);
+    SetBank(3, (value ^ 0x00) & mask);
+    SetBank(4, (value ^ 0x03) & mask);
+    SetBank(5, (value ^ 0x02) & mask);
+}
+
+void MapperMemoryRule::Korean0000XORFFRegister(u16, u8 value)
+{
+    if ((value & 0xF0) == 0xF0)
+    {
+        SetBank(2, 2);
+        SetBank(3, 3);
+        SetBank(4, 2);
+        SetBank(5, 3);
+    }
+    else
+    {
+        int mask = BankMask();
+        int segment = ((value ^ 0xF0) & 0xF0) >> 2;
+
+        for (int i = 0; i < 4; i++)
+            SetBank(2 + i, (segment + i) & mask);
+    }
+}
+
+void MapperMemoryRule::KoreanFFFERegister(u16, u8 value)
+{
+    int mask = BankMask();
+
+    if ((value & 0x40) == 0x40)
+    {
+        SetBank(0, (((value & 0x1E) * 2) + 0) & mask);
+        SetBank(1, (((value & 0x1E) * 2) + 1) & mask);
+        SetBank(2, ((((value & 0x1E) + 1) * 2) + 0) & mask);
+        SetBank(3, ((((value & 0x1E) + 1) * 2) + 1) & mask);
+    }
+    else
+    {
+        SetBank(0, 0);
+        SetBank(1, 1);
+        SetBank(2, (((value & 0x1F) * 2) + 0) & mask);
+        SetBank(3, (((value & 0x1F) * 2) + 1) & mask);
+    }
+
+    if ((value & 0x60) == 0x20)
+    {
+        SetBank(4, (((value & 0x1F) * 2) + 1) & mask);
+        SetBank(5, (((value & 0x1F) * 2) + 0) & mask);
+    }
+    else
+    {
+        SetBank(4, 0x3F);
+        SetBank(5, 0x3F);
+    }
+}
+
+void MapperMemoryRule::KoreanBFFCRegister(u16, u8 value)
+{
+    int mask = BankMask();
+    int lower = ((value & 0x80) != 0) ? 0x20 : (value & ((value & 0x40) ? 0x3F : 0x3E));
+    int upper = ((value & 0xC0) == 0x00) ? ((value & 0x3E) | 1) : (value & 0x3F);
+
+    SetBank(0, (lower * 2) & mask);
+    SetBank(1, m_iBank[0] + 1);
+    SetBank(2, (upper * 2) & mask);
+    SetBank(3, m_iBank[2] + 1);
+
+    if ((value & 0xC0) == 0xC0)
+    {
+        SetBank(4, m_iBank[3]);
+        SetBank(5, m_iBank[2]);
+    }
+    else
+    {
+        SetBank(4, ((0x3F * 2) + 1) & mask);
+        SetBank(5, m_iBank[4]);
+    }
+}
+
+void MapperMemoryRule::KoreanFFF3FFFCRegister(u16 address, u8 value)
+{
+    if ((address | 0x4000) == 0xFFF3)
+        m_iRegister[0] = value;
+    else
+        m_iRegister[1] = value;
+
+    int page0 = ((m_iRegister[1] & 0x10) * 8) + ((m_iRegister[0] & 0x3E) * 2);
+    int page1 = page0 + 1;
+    int page2 = page0 + 2;
+    int page3 = page0 + 3;
+    int odd = m_iRegister[0] & 0x01;
+    int mask = BankMask();
+    int pages[6];
+
+    switch (m_iRegister[1] & 0xE0)
+    {
+        case 0x00:
+        {
+            int p[6] = { odd ? page2 : page0, odd ? page3 : page1, odd ? page2 : page0, odd ? page3 : page1, 0xFF, 0xFF };
+            memcpy(pages, p, sizeof(pages));
+            break;
+        }
+        case 0x20:
+        {
+            int p[6] = { page0, page1, page2, page3, 0xFF, 0xFF };
+            memcpy(pages, p, sizeof(pages));
+            break;
+        }
+        case 0x40:
+        {
+            int p[6] = { 0x80, 0x81, odd ? page2 : page0, odd ? page3 : page1, 0xFF, 0xFF };
+            memcpy(pages, p, sizeof(pages));
+            break;
+        }
+        case 0x60:
+        {
+            int p[6] = { 0x80, 0x81, 0xFE, 0xFF, odd ? page2 : page0, odd ? page3 : page1 };
+            memcpy(pages, p, sizeof(pages));
+            break;
+        }
+        case 0x80:
+        {
+            int p[6] = { 0x80, 0x81, odd ? page2 : page0, odd ? page3 : page1, odd ? page3 : page1, odd ? page2 : page0 };
+            memcpy(pages, p, sizeof(pages));
+            break;
+        }
+        case 0xA0:
+        {
+            int p[6] = { 0x80, 0x81, odd ? page2 : page0, odd ? page3 : page1, odd ? page0 : page2, odd ? page1 : page3 };
+            memcpy(pages, p, sizeof(pages));
+            break;
+        }
+        default:
+        {
+            int p[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+            memcpy(pages, p, sizeof(pages));
+            break;
+        }
+    }
+
+    for (int i = 0; i < 6; i++)
+        SetBank(i, pages[i] & mask);
+}
+
+void MapperMemoryRule::KoreanFFF3FFFCReset()
+{
+    SetBank(4, 0xFF & BankMask());
+    SetBank(5, 0xFF & BankMask());
+}
+
+void MapperMemoryRule::KoreanMDFFF5Register(u16 address, u8 value)
+{
+    int mask = BankMask();
+    int register_mask = (m_iRegister[0] >= 0x10) ? 0x1F : 0x0F;
+
+    switch (address | 0x4010)
+    {
+        case 0xFFF5:
+        {
+            int bank = value << 2;
+            m_iRegister[0] = value;
+            SetBank(0, bank & mask);
+            SetBank(1, (bank + 1) & mask);
+            SetBank(2, (bank + 2) & mask);
+            SetBank(3, (bank + 3) & mask);
+            SetBank(4, (bank + 2) & mask);
+            SetBank(5, (bank + 3) & mask);
+            break;
+        }
+        case 0xFFFE:
+        {
+            int bank = (m_iRegister[0] << 2) + ((value & register_mask) << 1);
+            SetBank(2, bank & mask);
+            SetBank(3, (bank + 1) & mask);
+            break;
+        }
+        case 0xFFFF:
+        {
+            int bank = (m_iRegister[0] << 2) + ((value & register_mask) << 1);
+            SetBank(4, bank & mask);
+            SetBank(5, (bank + 1) & mask);
+            break;
+        }
+    }
+}
+
+void MapperMemoryRule::JanggunReverse(u16 address, u8 value)
+{
+    m_bReverse[(address == 0xFFFE) ? 1 : 2] = IsSetBit(value, 6);
+}
+
+void MapperMemoryRule::Multi4PAKRegister(u16, u8 value)
+{
+    m_iBank[2] = value;
+    m_iBankAddress[2] = 0x4000 * (((m_iBank[0] & 0x30) + value) & (m_pCartridge->GetROMBankCount() - 1));
+}
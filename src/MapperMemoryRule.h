@@ -0,0 +1,227 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef MAPPERMEMORYRULE_H
+#define	MAPPERMEMORYRULE_H
+
+#include "MemoryRule.h"
+#include "Cartridge.h"
+
+// Every cartridge board is a row in kBoards: bank layout, bank registers with
+// their value transforms, cartridge RAM and save state layout. Reads go
+// through a 1KB page table that is rebuilt whenever a register changes.
+class MapperMemoryRule : public MemoryRule
+{
+public:
+    typedef void (MapperMemoryRule::*RegisterHandler)(u16 address, u8 value);
+    typedef void (MapperMemoryRule::*ResetHandler)();
+
+    enum BoardFlags
+    {
+        Board8kBanks = 0x01,
+        BoardFirstKBFixed = 0x02,
+        BoardBatteryRAM = 0x04,
+        BoardRAMAlwaysMapped = 0x08,
+        BoardSG1000 = 0x10,
+        BoardReverseBits = 0x20,
+        BoardNemesis = 0x40
+    };
+
+    enum BoardRegions
+    {
+        RegionFixed = -1,
+        RegionMap = -2
+    };
+
+    enum BoardRAMAreas
+    {
+        RAMAreaMirrored,
+        RAMAreaPlain,
+        RAMArea1KB
+    };
+
+    enum BoardPages
+    {
+        PagesFromMap,
+        PagesFromBankAddresses,
+        PagesFromBanks
+    };
+
+    enum BankFlags
+    {
+        BankUnmasked = 0x01,
+        BankRawValue = 0x02
+    };
+
+    enum RegisterFlags
+    {
+        RegisterOnly = 0x01
+    };
+
+    enum StateFields
+    {
+        StateEnd,
+        StateBanks,
+        StateBankAddresses,
+        StateRAM,
+        StateRAMBankStart,
+        StateRAMEnabled,
+        StatePersistRAM,
+        StateRegisters,
+        StateRegister8
+    };
+
+    // bank = ((((value & mask) ^ xor) << shift) + add), masked to the ROM,
+    // then (bank ^ post_xor) + post_add
+    struct BankWrite
+    {
+        s8 bank;
+        u8 value_mask;
+        u8 value_xor;
+        u8 shift;
+        u8 add;
+        u8 post_xor;
+        u8 post_add;
+        u8 flags;
+    };
+
+    struct BoardRegister
+    {
+        u16 address_mask;
+        u16 address;
+        BankWrite banks[4];
+        RegisterHandler handler;
+        u8 flags;
+    };
+
+    struct StateField
+    {
+        u8 type;
+        u8 first;
+        u8 count;
+    };
+
+    struct Board
+    {
+        Cartridge::CartridgeTypes type;
+        int bank_count;
+        int bank_size;
+        int reset_bank_size;
+        int reset_bank[6];
+        s8 region[6];
+        int ram_size;
+        u16 ram_window;
+        u16 ram_window_size;
+        u8 ram_area;
+        u8 pages;
+        u8 flags;
+        BoardRegister registers[6];
+        StateField state[7];
+        ResetHandler reset;
+    };
+
+public:
+    MapperMemoryRule(Memory* pMemory, Cartridge* pCartridge, Input* pInput);
+    virtual ~MapperMemoryRule();
+    bool SetBoard(Cartridge::CartridgeTypes type);
+    void UpdateROM();
+    u8 Read(u16 address);
+    void Write(u16 address, u8 value);
+    virtual u8 PerformRead(u16 address);
+    virtual void PerformWrite(u16 address, u8 value);
+    virtual void Reset();
+    virtual void SaveRam(std::ostream &file);
+    virtual bool LoadRam(std::istream &file, s32 fileSize);
+    virtual bool PersistedRAM();
+    virtual size_t GetRamSize();
+    virtual u8* GetRamBanks();
+    virtual int GetRamBank();
+    virtual u8* GetPage(int index);
+    virtual int GetBank(int index);
+    virtual bool Has8kBanks();
+    virtual void SaveState(StateWriter& writer);
+    virtual void LoadState(StateReader& reader);
+    void UpdatePages();
+    SharedPages* GetRAMPages();
+
+private:
+    enum WriteTargets
+    {
+        WriteROM,
+        WriteRAM,
+        WriteMap,
+        WriteMap1KB,
+        WriteCartRAM
+    };
+
+    bool WriteRegister(u16 address, u8 value);
+    void WriteBank(const BankWrite& bank, u8 value);
+    void SetBank(int index, int bank);
+    void MapPages(u16 address, int size, u8* pSource, u8 target);
+    void MapSharedPages(const SharedPages* pPages);
+    void OwnRAMPages();
+    void UpdateCodeDataLogger(u8* pMap, u8* pROM);
+    u8* ReversedROM(u8* pSource);
+    int BankMask();
+    void SegaRAMControl(u16 address, u8 value);
+    void SegaGlasses(u16 address, u8 value);
+    void CodemastersRAMControl(u16 address, u8 value);
+    void KoreanMSXSMS8000Register(u16 address, u8 value);
+    void Korean0000XORFFRegister(u16 address, u8 value);
+    void KoreanFFFERegister(u16 address, u8 value);
+    void KoreanBFFCRegister(u16 address, u8 value);
+    void KoreanFFF3FFFCRegister(u16 address, u8 value);
+    void KoreanFFF3FFFCReset();
+    void KoreanMDFFF5Register(u16 address, u8 value);
+    void JanggunReverse(u16 address, u8 value);
+    void Multi4PAKRegister(u16 address, u8 value);
+
+private:
+    static const Board kBoards[];
+    const Board* m_pBoard;
+    const u8* m_pReadPages[64];
+    u8* m_pWritePages[64];
+    u8 m_WriteTargets[64];
+    bool m_bRegisterPages[64];
+    int m_iBank[6];
+    int m_iBankAddress[6];
+    int m_iRegister[2];
+    int m_iROMMask;
+    u8* m_pRAM;
+    SharedPages m_RAMPages;
+    u16 m_RAMBankStartAddress;
+    bool m_bRAMEnabled;
+    int m_iPersistRAM;
+    bool m_bReverse[4];
+    u8* m_pReversedROM;
+    int m_iReversedROMSize;
+    bool m_bReversedROMValid;
+};
+
+inline u8 MapperMemoryRule::Read(u16 address)
+{
+    return m_pReadPages[address >> 10][address & 0x3FF];
+}
+
+inline SharedPages* MapperMemoryRule::GetRAMPages()
+{
+    return &m_RAMPages;
+}
+
+#endif	/* MAPPERMEMORYRULE_H */
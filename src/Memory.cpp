@@ -31,6 +31,7 @@ Memory::Memory()
     InitPointer(m_pDisassembledMap);
     InitPointer(m_pDisassembledROMMap);
     InitPointer(m_pRunToBreakpoint);
+    m_pCodeDataLogger = new CodeDataLogger();
     InitPointer(m_pBootromSMS);
     InitPointer(m_pBootromGG);
     m_bBootromSMSEnabled = false;
@@ -44,6 +45,8 @@ Memory::Memory()
     m_iBootromBankCountSMS = 1;
     m_iBootromBankCountGG = 1;
     m_bIOEnabled = true;
+    m_bInstrumentationSuspended = false;
+    memset(m_DirtyPages, 1, sizeof(m_DirtyPages));
 }
 
 Memory::~Memory()
@@ -52,6 +55,7 @@ Memory::~Memory()
     InitPointer(m_pCurrentMemoryRule);
     SafeDeleteArray(m_pBootromSMS);
     SafeDeleteArray(m_pBootromGG);
+    SafeDelete(m_pCodeDataLogger);
 
     if (IsValidPointer(m_pDisassembledROMMap))
     {
@@ -80,23 +84,37 @@ void Memory::SetProcessor(Processor* pProcessor)
 void Memory::Init()
 {
     m_pMap = new u8[0x10000];
+    m_MapPages.Init(m_pMap, 0x10000);
+    m_BreakpointsCPU.clear();
+    m_BreakpointsMem.clear();
+    UpdateBreakpoints();
+    InitPointer(m_pRunToBreakpoint);
+    Reset(false);
+}
+
+// The debugger maps take tens of MB, so they are only created the first time
+// the disassembler or the debugger asks for them
+void Memory::InitDisassembledMaps()
+{
 #ifndef GEARSYSTEM_DISABLE_DISASSEMBLER
-    m_pDisassembledMap = new stDisassembleRecord*[0x10000];
-    for (int i = 0; i < 0x10000; i++)
+    if (!IsValidPointer(m_pDisassembledMap))
     {
-        InitPointer(m_pDisassembledMap[i]);
+        m_pDisassembledMap = new stDisassembleRecord*[0x10000];
+        for (int i = 0; i < 0x10000; i++)
+        {
+            InitPointer(m_pDisassembledMap[i]);
+        }
     }
 
-    m_pDisassembledROMMap = new stDisassembleRecord*[MAX_ROM_SIZE];
-    for (int i = 0; i < MAX_ROM_SIZE; i++)
+    if (!IsValidPointer(m_pDisassembledROMMap))
     {
-        InitPointer(m_pDisassembledROMMap[i]);
+        m_pDisassembledROMMap = new stDisassembleRecord*[MAX_ROM_SIZE];
+        for (int i = 0; i < MAX_ROM_SIZE; i++)
+        {
+            InitPointer(m_pDisassembledROMMap[i]);
+        }
     }
 #endif
-    m_BreakpointsCPU.clear();
-    m_BreakpointsMem.clear();
-    InitPointer(m_pRunToBreakpoint);
-    Reset(false);
 }
 
 void Memory::Reset(bool bGameGear)
@@ -105,6 +123,9 @@ void Memory::Reset(bool bGameGear)
     m_MediaSlot = IsBootromEnabled() ? BiosSlot : CartridgeSlot;
     m_DesiredMediaSlot = IsBootromEnabled() ? m_StoredMediaSlot : CartridgeSlot;
     m_bIOEnabled = true;
+    m_pCodeDataLogger->SetMapped(m_MediaSlot == m_DesiredMediaSlot);
+
+    OwnMapPages();
 
     for (int i = 0; i < 0x10000; i++)
     {
@@ -115,7 +136,7 @@ void Memory::Reset(bool bGameGear)
         ResetRomDisassembledMemory();
 }
 
-void Memory::SetCurrentRule(MemoryRule* pRule)
+void Memory::SetCurrentRule(MapperMemoryRule* pRule)
 {
     m_pCurrentMemoryRule = pRule;
 }
@@ -125,18 +146,37 @@ void Memory::SetBootromRule(MemoryRule* pRule)
     m_pBootromMemoryRule = pRule;
 }
 
-MemoryRule* Memory::GetCurrentRule()
+MapperMemoryRule* Memory::GetCurrentRule()
 {
     return m_pCurrentMemoryRule;
 }
 
+// Callers may keep the pointer and write through it, so a forked map is
+// copied back in full first
 u8* Memory::GetMemoryMap()
 {
+    OwnMapPages();
     return m_pMap;
 }
 
+// The mapper reads pages a fork shares in place, it has to follow them
+// when they are copied back into the map
+void Memory::OwnMapPage(int page)
+{
+    if (m_MapPages.Own(page) && IsValidPointer(m_pCurrentMemoryRule))
+        m_pCurrentMemoryRule->UpdatePages();
+}
+
+void Memory::OwnMapPages()
+{
+    if (m_MapPages.OwnAll() && IsValidPointer(m_pCurrentMemoryRule))
+        m_pCurrentMemoryRule->UpdatePages();
+}
+
 void Memory::LoadSlotsFromROM(u8* pTheROM, int size)
 {
+    OwnMapPages();
+
     // loads the first 48KB only (bank 0, 1 and 2)
     int i;
     for (i = 0; ((i < 0xC000) && (i < size)); i++)
@@ -148,7 +188,7 @@ void Memory::LoadSlotsFromROM(u8* pTheROM, int size)
 
 void Memory::MemoryDump(const char* szFilePath)
 {
-    if (!IsValidPointer(m_pDisassembledMap))
+    if (!IsValidPointer(GetDisassembledMemoryMap()))
         return;
 
     using namespace std;
@@ -166,7 +206,7 @@ void Memory::MemoryDump(const char* szFilePath)
             }
             else
             {
-                myfile << "0x" << hex << i << "\t [0x" << hex << (int) m_pMap[i] << "]\n";
+                myfile << "0x" << hex << i << "\t [0x" << hex << (int) Retrieve(static_cast<u16>(i)) << "]\n";
             }
         }
 
@@ -174,20 +214,21 @@ void Memory::MemoryDump(const char* szFilePath)
     }
 }
 
-void Memory::SaveState(std::ostream& stream)
+void Memory::SaveState(StateWriter& writer)
 {
-    using namespace std;
-
-    stream.write(reinterpret_cast<const char*> (m_pMap), 0x10000);
-    stream.write(reinterpret_cast<const char*> (&m_bIOEnabled), sizeof (m_bIOEnabled));
+    writer.WritePages(m_MapPages, 0x10000, m_DirtyPages);
+    writer.Write(&m_bIOEnabled, sizeof (m_bIOEnabled));
 }
 
-void Memory::LoadState(std::istream& stream)
+void Memory::LoadState(StateReader& reader)
 {
-    using namespace std;
+    if (!reader.IsSkippingPages())
+    {
+        OwnMapPages();
+        reader.Read(m_pMap, 0x10000);
+    }
 
-    stream.read(reinterpret_cast<char*> (m_pMap), 0x10000);
-    stream.read(reinterpret_cast<char*> (&m_bIOEnabled), sizeof (m_bIOEnabled));
+    reader.Read(&m_bIOEnabled, sizeof (m_bIOEnabled));
 }
 
 std::vector<Memory::stDisassembleRecord*>* Memory::GetBreakpointsCPU()
@@ -200,6 +241,72 @@ std::vector<Memory::stMemoryBreakpoint>* Memory::GetBreakpointsMem()
     return &m_BreakpointsMem;
 }
 
+// Call after changing the breakpoint vectors, the CPU and memory access
+// paths only look at the maps rebuilt here
+void Memory::UpdateBreakpoints()
+{
+    memset(m_BreakpointsMemMap, 0, sizeof(m_BreakpointsMemMap));
+    memset(m_BreakpointsCPUMap, 0, sizeof(m_BreakpointsCPUMap));
+
+    std::size_t size = m_BreakpointsMem.size();
+
+    for (std::size_t b = 0; b < size; b++)
+    {
+        stMemoryBreakpoint& breakpoint = m_BreakpointsMem[b];
+        u8 flags = (breakpoint.read ? BreakpointRead : 0) | (breakpoint.write ? BreakpointWrite : 0) | (breakpoint.execute ? BreakpointExecute : 0);
+        int last = breakpoint.range ? breakpoint.address2 : breakpoint.address1;
+
+        for (int address = breakpoint.address1; address <= last; address++)
+            m_BreakpointsMemMap[address] |= flags;
+    }
+
+    // Records keep the CPU address they were disassembled at, and banks are
+    // 8KB aligned, so the low 13 bits are the same wherever the bank is mapped
+    size = m_BreakpointsCPU.size();
+
+    for (std::size_t b = 0; b < size; b++)
+    {
+        if (IsValidPointer(m_BreakpointsCPU[b]))
+            m_BreakpointsCPUMap[m_BreakpointsCPU[b]->address & 0x1FFF] = 1;
+    }
+
+    // The execution trace sees every access through HitBreakpoint
+    if (IsValidPointer(m_pProcessor) && IsValidPointer(m_pProcessor->GetExecutionTrace()))
+    {
+        for (int address = 0; address < 0x10000; address++)
+            m_BreakpointsMemMap[address] |= BreakpointRead | BreakpointWrite;
+    }
+}
+
+bool Memory::IsBreakpointCPU(stDisassembleRecord* pRecord, u16 address)
+{
+    if (!m_BreakpointsCPUMap[address & 0x1FFF])
+        return false;
+
+    std::size_t size = m_BreakpointsCPU.size();
+
+    for (std::size_t b = 0; b < size; b++)
+    {
+        if (m_BreakpointsCPU[b] == pRecord)
+            return true;
+    }
+
+    return false;
+}
+
+bool Memory::IsBreakpointExecute(u16 address)
+{
+    if (!(m_BreakpointsMemMap[address] & BreakpointExecute))
+        return false;
+
+    return MatchBreakpoints(address, BreakpointExecute, Peek(address));
+}
+
+std::vector<Memory::stBreakpointTrace>* Memory::GetBreakpointTraces()
+{
+    return &m_BreakpointTraces;
+}
+
 Memory::stDisassembleRecord* Memory::GetRunToBreakpoint()
 {
     return m_pRunToBreakpoint;
@@ -354,6 +461,7 @@ void Memory::SetPort3E(u8 port3E)
     if (oldSlot != m_MediaSlot)
     {
         ResetRomDisassembledMemory();
+        m_pCodeDataLogger->SetMapped(m_MediaSlot == m_DesiredMediaSlot);
     }
 }
 
@@ -377,47 +485,93 @@ Memory::MediaSlots Memory::GetCurrentSlot()
     return m_MediaSlot;
 }
 
-void Memory::CheckBreakpoints(u16 address, bool write)
+void Memory::HitBreakpoint(u16 address, u8 access, u8 value)
 {
+    if (m_bInstrumentationSuspended)
+        return;
+
+    bool fetch = (access & BreakpointFetch) != 0;
+    access &= ~BreakpointFetch;
+
+    if (access == BreakpointRead)
+        value = Peek(address);
+
+    ExecutionTrace* trace = m_pProcessor->GetExecutionTrace();
+
+    if (IsValidPointer(trace))
+    {
+        if (fetch)
+            trace->Fetch(value);
+        else
+            trace->Access(address, (access == BreakpointRead) ? ExecutionTrace::AccessMemoryRead : ExecutionTrace::AccessMemoryWrite, value);
+    }
+
+    if (MatchBreakpoints(address, access, value))
+        m_pProcessor->RequestMemoryBreakpoint();
+}
+
+// Only reached when the breakpoint map has a hit, so conditions are never
+// evaluated for addresses without breakpoints. Tracepoints log and go on.
+bool Memory::MatchBreakpoints(u16 address, u8 access, u8 value)
+{
+    bool hit = false;
     std::size_t size = m_BreakpointsMem.size();
 
     for (std::size_t b = 0; b < size; b++)
     {
-        if (write && !m_BreakpointsMem[b].write)
-            continue;
+        stMemoryBreakpoint& breakpoint = m_BreakpointsMem[b];
 
-        if (!write && !m_BreakpointsMem[b].read)
+        if ((access == BreakpointRead) && !breakpoint.read)
+            continue;
+        if ((access == BreakpointWrite) && !breakpoint.write)
+            continue;
+        if ((access == BreakpointExecute) && !breakpoint.execute)
             continue;
 
-        bool proceed = false;
-
-        if (m_BreakpointsMem[b].range)
-        {
-            if ((address >= m_BreakpointsMem[b].address1) && (address <= m_BreakpointsMem[b].address2))
-            {
-                proceed = true;
-            }
-        }
-        else
+        if (breakpoint.range)
         {
-            if (m_BreakpointsMem[b].address1 == address)
-            {
-                proceed = true;
-            }
+            if ((address < breakpoint.address1) || (address > breakpoint.address2))
+                continue;
         }
+        else if (address != breakpoint.address1)
+            continue;
+
+        if (!breakpoint.condition.IsEmpty() && !breakpoint.condition.Evaluate(m_pProcessor, this, address, value))
+            continue;
 
-        if (proceed)
+        if (breakpoint.trace)
         {
-            m_pProcessor->RequestMemoryBreakpoint();
-            break;
+            if (m_BreakpointTraces.size() >= GS_BREAKPOINT_TRACE_SIZE)
+                m_BreakpointTraces.erase(m_BreakpointTraces.begin(), m_BreakpointTraces.begin() + (GS_BREAKPOINT_TRACE_SIZE / 4));
+
+            stBreakpointTrace trace;
+            trace.pc = m_pProcessor->GetInstructionAddress();
+            trace.address = address;
+            trace.value = value;
+            trace.access = access;
+            m_BreakpointTraces.push_back(trace);
         }
+        else
+            hit = true;
     }
+
+    return hit;
+}
+
+// Breakpoints, tracepoints, the trace and the code/data log ignore the
+// accesses while suspended
+void Memory::SuspendInstrumentation(bool suspend)
+{
+    m_bInstrumentationSuspended = suspend;
+    m_pCodeDataLogger->Suspend(suspend);
 }
 
 void Memory::ResetDisassembledMemory()
 {
     #ifndef GEARSYSTEM_DISABLE_DISASSEMBLER
 
+    m_pCodeDataLogger->Clear();
+
     if (IsValidPointer(m_pDisassembledROMMap))
     {
         for (int i = 0; i < MAX_ROM_SIZE; i++)
@@ -441,6 +595,7 @@ void Memory::ResetRomDisassembledMemory()
     #ifndef GEARSYSTEM_DISABLE_DISASSEMBLER
 
     m_BreakpointsCPU.clear();
+    UpdateBreakpoints();
 
     if (IsValidPointer(m_pDisassembledROMMap))
     {
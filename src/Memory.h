@@ -21,8 +21,11 @@
 #define	MEMORY_H
 
 #include "definitions.h"
+#include "StateSerializer.h"
 #include "log.h"
-#include "MemoryRule.h"
+#include "MapperMemoryRule.h"
+#include "DebugExpression.h"
+#include "CodeDataLogger.h"
 #include <vector>
 
 class Processor;
@@ -49,6 +52,25 @@ public:
         bool read;
         bool write;
         bool range;
+        bool execute;
+        bool trace;
+        DebugExpression condition;
+    };
+
+    enum BreakpointFlags
+    {
+        BreakpointRead = 0x01,
+        BreakpointWrite = 0x02,
+        BreakpointExecute = 0x04,
+        BreakpointFetch = 0x08
+    };
+
+    struct stBreakpointTrace
+    {
+        u16 pc;
+        u16 address;
+        u8 value;
+        u8 access;
     };
 
     enum MediaSlots
@@ -66,22 +88,30 @@ public:
     void SetProcessor(Processor* pProcessor);
     void Init();
     void Reset(bool bGameGear);
-    void SetCurrentRule(MemoryRule* pRule);
+    void SetCurrentRule(MapperMemoryRule* pRule);
     void SetBootromRule(MemoryRule* pRule);
-    MemoryRule* GetCurrentRule();
+    MapperMemoryRule* GetCurrentRule();
     u8* GetMemoryMap();
+    SharedPages* GetMapPages();
     u8 Read(u16 address);
+    u8 FetchOPCode(u16 address);
+    u8 FetchOperand(u16 address);
     void Write(u16 address, u8 value);
+    u8 Peek(u16 address);
     u8 Retrieve(u16 address);
     void Load(u16 address, u8 value);
     stDisassembleRecord** GetDisassembledMemoryMap();
     stDisassembleRecord** GetDisassembledROMMemoryMap();
     void LoadSlotsFromROM(u8* pTheROM, int size);
     void MemoryDump(const char* szFilePath);
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream);
+    void SaveState(StateWriter& writer);
+    void LoadState(StateReader& reader);
     std::vector<stDisassembleRecord*>* GetBreakpointsCPU();
     std::vector<stMemoryBreakpoint>* GetBreakpointsMem();
+    void UpdateBreakpoints();
+    bool IsBreakpointCPU(stDisassembleRecord* pRecord, u16 address);
+    bool IsBreakpointExecute(u16 address);
+    std::vector<stBreakpointTrace>* GetBreakpointTraces();
     stDisassembleRecord* GetRunToBreakpoint();
     void SetRunToBreakpoint(stDisassembleRecord* pBreakpoint);
     void EnableBootromSMS(bool enable);
@@ -97,20 +127,33 @@ public:
     MediaSlots GetCurrentSlot();
     void ResetDisassembledMemory();
     void ResetRomDisassembledMemory();
+    CodeDataLogger* GetCodeDataLogger();
+    void SuspendInstrumentation(bool suspend);
 
 private:
     void LoadBootroom(const char* szFilePath, bool gg);
-    void CheckBreakpoints(u16 address, bool write);
+    void CheckBreakpoints(u16 address, u8 access, u8 value);
+    u8 Fetch(u16 address, u8 flag);
+    void HitBreakpoint(u16 address, u8 access, u8 value);
+    bool MatchBreakpoints(u16 address, u8 access, u8 value);
+    void InitDisassembledMaps();
+    void OwnMapPage(int page);
+    void OwnMapPages();
 
 private:
     Processor* m_pProcessor;
-    MemoryRule* m_pCurrentMemoryRule;
+    MapperMemoryRule* m_pCurrentMemoryRule;
     MemoryRule* m_pBootromMemoryRule;
     u8* m_pMap;
+    SharedPages m_MapPages;
     stDisassembleRecord** m_pDisassembledMap;
     stDisassembleRecord** m_pDisassembledROMMap;
+    CodeDataLogger* m_pCodeDataLogger;
     std::vector<stDisassembleRecord*> m_BreakpointsCPU;
     std::vector<stMemoryBreakpoint> m_BreakpointsMem;
+    u8 m_BreakpointsMemMap[0x10000];
+    u8 m_BreakpointsCPUMap[0x2000];
+    std::vector<stBreakpointTrace> m_BreakpointTraces;
     stDisassembleRecord* m_pRunToBreakpoint;
     bool m_bBootromSMSEnabled;
     bool m_bBootromGGEnabled;
@@ -125,6 +168,8 @@ private:
     int m_iBootromBankCountSMS;
     int m_iBootromBankCountGG;
     bool m_bIOEnabled;
+    bool m_bInstrumentationSuspended;
+    u8 m_DirtyPages[0x10000 >> GS_STATE_HASH_PAGE_SHIFT];
 };
 
 #include "Memory_inline.h"
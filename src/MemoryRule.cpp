@@ -24,6 +24,7 @@ MemoryRule::MemoryRule(Memory* pMemory, Cartridge* pCartridge, Input* pInput)
     m_pMemory = pMemory;
     m_pCartridge = pCartridge;
     m_pInput = pInput;
+    memset(m_RamDirtyPages, 1, sizeof(m_RamDirtyPages));
 }
 
 MemoryRule::~MemoryRule()
@@ -79,10 +80,10 @@ bool MemoryRule::Has8kBanks()
     return false;
 }
 
-void MemoryRule::SaveState(std::ostream&)
+void MemoryRule::SaveState(StateWriter&)
 {
 }
 
-void MemoryRule::LoadState(std::istream&)
+void MemoryRule::LoadState(StateReader&)
 {
 }
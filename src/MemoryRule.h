@@ -21,6 +21,7 @@
 #define	MEMORYRULE_H
 
 #include "definitions.h"
+#include "StateSerializer.h"
 
 class Memory;
 class Cartridge;
@@ -44,14 +45,15 @@ public:
     virtual u8* GetPage(int index);
     virtual int GetBank(int index);
     virtual bool Has8kBanks();
-    virtual void SaveState(std::ostream& stream);
-    virtual void LoadState(std::istream& stream);
+    virtual void SaveState(StateWriter& writer);
+    virtual void LoadState(StateReader& reader);
 
 protected:
     Memory* m_pMemory;
     Cartridge* m_pCartridge;
     Input* m_pInput;
     RamChangedCallback m_pRamChangedCallback;
+    u8 m_RamDirtyPages[0x8000 >> GS_STATE_HASH_PAGE_SHIFT];
 };
 
 #endif	/* MEMORYRULE_H */
@@ -20,14 +20,49 @@
 #ifndef MEMORY_INLINE_H
 #define	MEMORY_INLINE_H
 
+inline void Memory::CheckBreakpoints(u16 address, u8 access, u8 value)
+{
+    if (m_BreakpointsMemMap[address] & access)
+        HitBreakpoint(address, access, value);
+}
+
 inline u8 Memory::Read(u16 address)
 {
     #ifndef GEARSYSTEM_DISABLE_DISASSEMBLER
-    CheckBreakpoints(address, false);
+    CheckBreakpoints(address, BreakpointRead, 0);
+    m_pCodeDataLogger->Read(address);
     #endif
 
+    return Peek(address);
+}
+
+// Instruction fetches, the code/data log and the execution trace tell them
+// apart from data reads
+inline u8 Memory::FetchOPCode(u16 address)
+{
+    return Fetch(address, CodeDataLogger::FlagCode);
+}
+
+inline u8 Memory::FetchOperand(u16 address)
+{
+    return Fetch(address, CodeDataLogger::FlagOperand);
+}
+
+inline u8 Memory::Fetch(u16 address, u8 flag)
+{
+    #ifndef GEARSYSTEM_DISABLE_DISASSEMBLER
+    CheckBreakpoints(address, BreakpointRead | BreakpointFetch, 0);
+    m_pCodeDataLogger->Fetch(address, flag);
+    #endif
+
+    return Peek(address);
+}
+
+// Reads without triggering breakpoints, for the debugger
+inline u8 Memory::Peek(u16 address)
+{
     if (m_MediaSlot == m_DesiredMediaSlot)
-        return m_pCurrentMemoryRule->PerformRead(address);
+        return m_pCurrentMemoryRule->Read(address);
 
     if (m_MediaSlot == BiosSlot)
         return m_pBootromMemoryRule->PerformRead(address);
@@ -41,11 +76,12 @@ inline u8 Memory::Read(u16 address)
 inline void Memory::Write(u16 address, u8 value)
 {
     #ifndef GEARSYSTEM_DISABLE_DISASSEMBLER
-    CheckBreakpoints(address, true);
+    CheckBreakpoints(address, BreakpointWrite, value);
+    m_pCodeDataLogger->Write(address);
     #endif
 
     if (m_MediaSlot == m_DesiredMediaSlot)
-        m_pCurrentMemoryRule->PerformWrite(address, value);
+        m_pCurrentMemoryRule->Write(address, value);
     else if (m_MediaSlot == BiosSlot)
         m_pBootromMemoryRule->PerformWrite(address, value);
     else if (address >= 0xC000)
@@ -54,23 +90,43 @@ inline void Memory::Write(u16 address, u8 value)
 
 inline u8 Memory::Retrieve(u16 address)
 {
-    return m_pMap[address];
+    return m_MapPages.Read(address);
 }
 
 inline void Memory::Load(u16 address, u8 value)
 {
+    if (m_MapPages.IsShared(address >> GS_SHARED_PAGE_SHIFT))
+        OwnMapPage(address >> GS_SHARED_PAGE_SHIFT);
+
     m_pMap[address] = value;
+    m_DirtyPages[address >> GS_STATE_HASH_PAGE_SHIFT] = 1;
 }
 
 inline Memory::stDisassembleRecord** Memory::GetDisassembledMemoryMap()
 {
+    if (!IsValidPointer(m_pDisassembledMap))
+        InitDisassembledMaps();
+
     return m_pDisassembledMap;
 }
 
 inline Memory::stDisassembleRecord** Memory::GetDisassembledROMMemoryMap()
 {
+    if (!IsValidPointer(m_pDisassembledROMMap))
+        InitDisassembledMaps();
+
     return m_pDisassembledROMMap;
 }
 
+inline SharedPages* Memory::GetMapPages()
+{
+    return &m_MapPages;
+}
+
+inline CodeDataLogger* Memory::GetCodeDataLogger()
+{
+    return m_pCodeDataLogger;
+}
+
 #endif	/* MEMORY_INLINE_H */
 
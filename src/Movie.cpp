@@ -0,0 +1,612 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <fstream>
+#include "Movie.h"
+#include "log.h"
+#include "GearsystemCore.h"
+#include "Input.h"
+#include "miniz/miniz.h"
+
+#define MOVIE_INPUT_JOYPAD1 0x01
+#define MOVIE_INPUT_JOYPAD2 0x02
+#define MOVIE_INPUT_PHASER 0x04
+#define MOVIE_INPUT_PADDLE 0x08
+#define MOVIE_INPUT_RUN 0x80
+#define MOVIE_MAX_RUN 128
+#define MOVIE_MAX_STATE_SIZE (16 * 1024 * 1024)
+#define MOVIE_MAX_FRAMES (60 * 60 * 60 * 24)
+
+static const GS_Keys kMovieKeys[] = { Key_Up, Key_Down, Key_Left, Key_Right, Key_1, Key_2, Key_Start };
+
+// Field by field, the struct has padding
+static u8 MovieInputChanges(const GS_MovieFrame& frame, const GS_MovieFrame& previous)
+{
+    u8 control = 0;
+
+    control |= (frame.joypad[0] != previous.joypad[0]) ? MOVIE_INPUT_JOYPAD1 : 0;
+    control |= (frame.joypad[1] != previous.joypad[1]) ? MOVIE_INPUT_JOYPAD2 : 0;
+    control |= ((frame.phaser_x != previous.phaser_x) || (frame.phaser_y != previous.phaser_y)) ? MOVIE_INPUT_PHASER : 0;
+    control |= (memcmp(&frame.paddle, &previous.paddle, sizeof(float)) != 0) ? MOVIE_INPUT_PADDLE : 0;
+
+    return control;
+}
+
+// Bytes left in the stream, or -1 when it can not seek
+static s64 MovieStreamRemaining(std::istream& stream)
+{
+    std::streampos position = stream.tellg();
+
+    if (position < 0)
+        return -1;
+
+    stream.seekg(0, std::ios::end);
+    std::streampos end = stream.tellg();
+    stream.seekg(position);
+
+    if ((end < 0) || stream.fail())
+    {
+        stream.clear();
+        stream.seekg(position);
+        return -1;
+    }
+
+    return static_cast<s64>(end - position);
+}
+
+Movie::Movie(GearsystemCore* pCore)
+{
+    m_pCore = pCore;
+    m_Mode = MovieStopped;
+    m_iFrame = 0;
+    m_iDesyncFrame = -1;
+    memset(&m_Header, 0, sizeof(m_Header));
+}
+
+Movie::~Movie()
+{
+}
+
+bool Movie::StartRecording(int keyframeInterval)
+{
+    Cartridge* cartridge = m_pCore->GetCartridge();
+
+    if (!cartridge->IsReady() || (keyframeInterval < 0))
+        return false;
+
+    Clear();
+
+    Input* input = m_pCore->GetInput();
+
+    m_Header.magic = GS_MOVIE_MAGIC;
+    m_Header.version = GS_MOVIE_VERSION;
+    m_Header.flags = 0;
+    m_Header.flags |= cartridge->IsGameGear() ? GS_MOVIE_FLAG_GAME_GEAR : 0;
+    m_Header.flags |= cartridge->IsSG1000() ? GS_MOVIE_FLAG_SG1000 : 0;
+    m_Header.flags |= cartridge->IsPAL() ? GS_MOVIE_FLAG_PAL : 0;
+    m_Header.flags |= input->IsPhaserEnabled() ? GS_MOVIE_FLAG_PHASER : 0;
+    m_Header.flags |= input->IsPaddleEnabled() ? GS_MOVIE_FLAG_PADDLE : 0;
+    m_Header.rom_crc = cartridge->GetCRC();
+    m_Header.keyframe_interval = keyframeInterval;
+    m_Header.type = static_cast<u8>(cartridge->GetType());
+    m_Header.zone = static_cast<u8>(cartridge->GetZone());
+
+    m_Mode = MovieRecording;
+
+    Log("Movie recording started, keyframe every %d frames", keyframeInterval);
+
+    return true;
+}
+
+bool Movie::StartPlayback()
+{
+    if (m_Keyframes.empty() || (m_Keyframes[0].info.frame != 0))
+    {
+        Log("Movie has nothing to play");
+        return false;
+    }
+
+    Cartridge* cartridge = m_pCore->GetCartridge();
+
+    if (!cartridge->IsReady() || (cartridge->GetCRC() != m_Header.rom_crc))
+    {
+        Log("Movie recorded with a different ROM: %08X", m_Header.rom_crc);
+        return false;
+    }
+
+    if (!LoadKeyframe(m_Keyframes[0]))
+        return false;
+
+    m_Mode = MoviePlaying;
+    m_iFrame = 0;
+    m_iDesyncFrame = -1;
+
+    Log("Movie playback started, %d frames", GetFrameCount());
+
+    return true;
+}
+
+void Movie::Stop()
+{
+    m_Mode = MovieStopped;
+}
+
+// Call once per frame, after the frontend input and right before running
+// the frame. Recording captures the input, playback replaces it.
+bool Movie::Update()
+{
+    if (m_Mode == MovieRecording)
+    {
+        GS_MovieFrame frame;
+        CaptureFrame(frame);
+        m_Frames.push_back(frame);
+
+        int interval = m_Header.keyframe_interval;
+
+        if ((m_iFrame == 0) || ((interval > 0) && ((m_iFrame % interval) == 0)))
+        {
+            if (!CaptureKeyframe())
+            {
+                m_Frames.pop_back();
+                return false;
+            }
+        }
+
+        m_iFrame++;
+        return true;
+    }
+    else if (m_Mode == MoviePlaying)
+    {
+        if (m_iFrame >= GetFrameCount())
+        {
+            Stop();
+            return false;
+        }
+
+        ApplyFrame(m_Frames[m_iFrame]);
+
+        int interval = m_Header.keyframe_interval;
+        size_t index = (interval > 0) ? (m_iFrame / interval) : 0;
+
+        if ((m_iDesyncFrame < 0) && (index < m_Keyframes.size()) && (m_Keyframes[index].info.frame == (u32)m_iFrame))
+        {
+            GS_StateHash hash;
+            m_pCore->StateHash(hash);
+
+            if ((hash.low != m_Keyframes[index].info.hash.low) || (hash.high != m_Keyframes[index].info.hash.high))
+            {
+                m_iDesyncFrame = m_iFrame;
+                Log("Movie desync detected at frame %d", m_iFrame);
+            }
+        }
+
+        m_iFrame++;
+        return true;
+    }
+
+    return false;
+}
+
+// Loads the nearest keyframe and replays up to the frame without video or
+// audio output. Seeking while recording drops everything after the frame.
+bool Movie::Seek(int frame)
+{
+    if ((m_Mode == MovieStopped) || (frame < 0) || (frame > GetFrameCount()) || m_Keyframes.empty())
+        return false;
+
+    size_t index = m_Keyframes.size() - 1;
+
+    while ((index > 0) && (m_Keyframes[index].info.frame > (u32)frame))
+        index--;
+
+    if (!LoadKeyframe(m_Keyframes[index]))
+        return false;
+
+    bool paused = m_pCore->IsPaused();
+
+    if (paused)
+        m_pCore->Pause(false);
+
+    for (int i = m_Keyframes[index].info.frame; i < frame; i++)
+    {
+        ApplyFrame(m_Frames[i]);
+        m_pCore->RunToVBlank(NULL, NULL, NULL);
+    }
+
+    if (paused)
+        m_pCore->Pause(true);
+
+    if (m_Mode == MovieRecording)
+    {
+        m_Frames.resize(frame);
+
+        while (!m_Keyframes.empty() && (m_Keyframes.back().info.frame >= (u32)frame))
+            m_Keyframes.pop_back();
+    }
+
+    m_iFrame = frame;
+
+    return true;
+}
+
+Movie::MovieMode Movie::GetMode()
+{
+    return m_Mode;
+}
+
+int Movie::GetFrame()
+{
+    return m_iFrame;
+}
+
+int Movie::GetFrameCount()
+{
+    return static_cast<int>(m_Frames.size());
+}
+
+int Movie::GetKeyframeCount()
+{
+    return static_cast<int>(m_Keyframes.size());
+}
+
+int Movie::GetDesyncFrame()
+{
+    return m_iDesyncFrame;
+}
+
+bool Movie::Save(const char* szFilePath)
+{
+    using namespace std;
+
+    ofstream file(szFilePath, ios::out | ios::binary);
+
+    if (!file.is_open())
+    {
+        Log("Unable to create movie file %s", szFilePath);
+        return false;
+    }
+
+    return Save(file);
+}
+
+bool Movie::Save(std::ostream& stream)
+{
+    if (m_Keyframes.empty())
+        return false;
+
+    std::vector<u8> input;
+    EncodeInput(input);
+
+    GS_MovieHeader header = m_Header;
+    header.frame_count = static_cast<u32>(m_Frames.size());
+    header.keyframe_count = static_cast<u32>(m_Keyframes.size());
+    header.input_size = static_cast<u32>(input.size());
+
+    stream.write(reinterpret_cast<const char*> (&header), sizeof(header));
+
+    if (!input.empty())
+        stream.write(reinterpret_cast<const char*> (&input[0]), input.size());
+
+    for (size_t i = 0; i < m_Keyframes.size(); i++)
+    {
+        stream.write(reinterpret_cast<const char*> (&m_Keyframes[i].info), sizeof(GS_MovieKeyframe));
+        stream.write(reinterpret_cast<const char*> (&m_Keyframes[i].data[0]), m_Keyframes[i].data.size());
+    }
+
+    Debug("Movie saved: %d frames, %d keyframes, %d input bytes", header.frame_count, header.keyframe_count, header.input_size);
+
+    return !stream.fail();
+}
+
+bool Movie::Load(const char* szFilePath)
+{
+    using namespace std;
+
+    ifstream file(szFilePath, ios::in | ios::binary);
+
+    if (!file.is_open())
+    {
+        Log("Unable to open movie file %s", szFilePath);
+        return false;
+    }
+
+    return Load(file);
+}
+
+bool Movie::Load(std::istream& stream)
+{
+    Clear();
+
+    GS_MovieHeader header;
+    stream.read(reinterpret_cast<char*> (&header), sizeof(header));
+
+    if (stream.fail() || (header.magic != GS_MOVIE_MAGIC) || (header.version != GS_MOVIE_VERSION))
+    {
+        Log("Invalid movie file");
+        return false;
+    }
+
+    // Every input byte holds at most one run of frames and every keyframe
+    // takes at least its header, so a sane header fits in the stream
+    s64 remaining = MovieStreamRemaining(stream);
+    u64 keyframe_bytes = static_cast<u64>(header.keyframe_count) * (sizeof(GS_MovieKeyframe) + 1);
+
+    if ((header.frame_count > MOVIE_MAX_FRAMES) || (header.keyframe_count > (header.frame_count + 1)) ||
+        (header.frame_count > (static_cast<u64>(header.input_size) * MOVIE_MAX_RUN)) ||
+        (header.input_size > (static_cast<u64>(header.frame_count) * sizeof(GS_MovieFrame) * 2)) ||
+        ((remaining >= 0) && ((header.input_size + keyframe_bytes) > static_cast<u64>(remaining))))
+    {
+        Log("Invalid movie header: %u frames, %u keyframes, %u input bytes", header.frame_count, header.keyframe_count, header.input_size);
+        return false;
+    }
+
+    std::vector<u8> input(header.input_size);
+
+    if (!input.empty())
+        stream.read(reinterpret_cast<char*> (&input[0]), input.size());
+
+    if (stream.fail() || !DecodeInput(input.empty() ? NULL : &input[0], input.size(), header.frame_count))
+    {
+        Log("Invalid movie input data");
+        Clear();
+        return false;
+    }
+
+    for (u32 i = 0; i < header.keyframe_count; i++)
+    {
+        Keyframe keyframe;
+        stream.read(reinterpret_cast<char*> (&keyframe.info), sizeof(GS_MovieKeyframe));
+
+        if (stream.fail() || (keyframe.info.frame > header.frame_count) || (keyframe.info.size == 0) ||
+            (keyframe.info.size > MOVIE_MAX_STATE_SIZE) || (keyframe.info.state_size > MOVIE_MAX_STATE_SIZE))
+        {
+            Log("Invalid movie keyframe %d", i);
+            Clear();
+            return false;
+        }
+
+        remaining = MovieStreamRemaining(stream);
+
+        if ((remaining >= 0) && (keyframe.info.size > static_cast<u64>(remaining)))
+        {
+            Log("Truncated movie keyframe %d", i);
+            Clear();
+            return false;
+        }
+
+        keyframe.data.resize(keyframe.info.size);
+        stream.read(reinterpret_cast<char*> (&keyframe.data[0]), keyframe.info.size);
+
+        if (stream.fail())
+        {
+            Log("Truncated movie keyframe %d", i);
+            Clear();
+            return false;
+        }
+
+        m_Keyframes.push_back(keyframe);
+    }
+
+    m_Header = header;
+
+    Debug("Movie loaded: %d frames, %d keyframes", header.frame_count, header.keyframe_count);
+
+    return true;
+}
+
+void Movie::Clear()
+{
+    m_Mode = MovieStopped;
+    m_Frames.clear();
+    m_Keyframes.clear();
+    m_iFrame = 0;
+    m_iDesyncFrame = -1;
+    memset(&m_Header, 0, sizeof(m_Header));
+}
+
+void Movie::CaptureFrame(GS_MovieFrame& frame)
+{
+    Input* input = m_pCore->GetInput();
+
+    memset(&frame, 0, sizeof(frame));
+
+    // Joypad registers are active low, the movie stores pressed keys as set bits
+    frame.joypad[0] = ~input->GetJoypad(Joypad_1) & 0x7F;
+    frame.joypad[1] = ~input->GetJoypad(Joypad_2) & 0x7F;
+    frame.phaser_x = static_cast<s16>(input->GetPhaser()->x);
+    frame.phaser_y = static_cast<s16>(input->GetPhaser()->y);
+    frame.paddle = input->GetPaddle()->x;
+}
+
+// Pointer devices go first, so a trigger press latches the new position
+void Movie::ApplyFrame(const GS_MovieFrame& frame)
+{
+    Input* input = m_pCore->GetInput();
+
+    input->SetPhaser(frame.phaser_x, frame.phaser_y);
+    input->SetPaddlePosition(frame.paddle);
+
+    for (int pad = 0; pad < 2; pad++)
+    {
+        GS_Joypads joypad = static_cast<GS_Joypads>(pad);
+        u8 pressed = ~input->GetJoypad(joypad) & 0x7F;
+
+        if (pressed == frame.joypad[pad])
+            continue;
+
+        for (int i = 0; i < 7; i++)
+        {
+            bool now = IsSetBit(frame.joypad[pad], kMovieKeys[i]);
+
+            if (now == IsSetBit(pressed, kMovieKeys[i]))
+                continue;
+
+            if (now)
+                input->KeyPressed(joypad, kMovieKeys[i]);
+            else
+                input->KeyReleased(joypad, kMovieKeys[i]);
+        }
+    }
+}
+
+bool Movie::CaptureKeyframe()
+{
+    size_t size = m_pCore->GetStateSize();
+
+    if (size == 0)
+        return false;
+
+    m_State.resize(size);
+
+    if (!m_pCore->SaveState(&m_State[0], size))
+        return false;
+
+    Keyframe keyframe;
+    mz_ulong compressed = mz_compressBound(static_cast<mz_ulong>(size));
+    keyframe.data.resize(compressed);
+
+    if (mz_compress2(&keyframe.data[0], &compressed, &m_State[0], static_cast<mz_ulong>(size), MZ_BEST_SPEED) != MZ_OK)
+        return false;
+
+    keyframe.data.resize(compressed);
+    keyframe.info.frame = m_iFrame;
+    keyframe.info.size = static_cast<u32>(compressed);
+    keyframe.info.state_size = static_cast<u32>(size);
+    keyframe.info.reserved = 0;
+    m_pCore->StateHash(keyframe.info.hash);
+
+    m_Keyframes.push_back(keyframe);
+
+    return true;
+}
+
+bool Movie::LoadKeyframe(const Keyframe& keyframe)
+{
+    m_State.resize(keyframe.info.state_size);
+    mz_ulong size = keyframe.info.state_size;
+
+    if ((size == 0) || (mz_uncompress(&m_State[0], &size, &keyframe.data[0], keyframe.info.size) != MZ_OK) || (size != keyframe.info.state_size))
+    {
+        Log("Invalid movie keyframe at frame %d", keyframe.info.frame);
+        return false;
+    }
+
+    return m_pCore->LoadState(&m_State[0], size);
+}
+
+// Every frame is a control byte with the fields that changed, followed by
+// those fields. Runs of unchanged frames take a single byte.
+void Movie::EncodeInput(std::vector<u8>& output)
+{
+    GS_MovieFrame previous;
+    memset(&previous, 0, sizeof(previous));
+
+    size_t i = 0;
+
+    while (i < m_Frames.size())
+    {
+        const GS_MovieFrame& frame = m_Frames[i];
+        u8 control = MovieInputChanges(frame, previous);
+
+        if (control == 0)
+        {
+            int run = 1;
+
+            while ((run < MOVIE_MAX_RUN) && ((i + run) < m_Frames.size()) && (MovieInputChanges(m_Frames[i + run], previous) == 0))
+                run++;
+
+            output.push_back(static_cast<u8>(MOVIE_INPUT_RUN | (run - 1)));
+            i += run;
+            continue;
+        }
+
+        output.push_back(control);
+
+        if (control & MOVIE_INPUT_JOYPAD1)
+            output.push_back(frame.joypad[0]);
+        if (control & MOVIE_INPUT_JOYPAD2)
+            output.push_back(frame.joypad[1]);
+        if (control & MOVIE_INPUT_PHASER)
+        {
+            const u8* p = reinterpret_cast<const u8*>(&frame.phaser_x);
+            output.insert(output.end(), p, p + sizeof(s16));
+            p = reinterpret_cast<const u8*>(&frame.phaser_y);
+            output.insert(output.end(), p, p + sizeof(s16));
+        }
+        if (control & MOVIE_INPUT_PADDLE)
+        {
+            const u8* p = reinterpret_cast<const u8*>(&frame.paddle);
+            output.insert(output.end(), p, p + sizeof(float));
+        }
+
+        previous = frame;
+        i++;
+    }
+}
+
+bool Movie::DecodeInput(const u8* data, size_t size, u32 frameCount)
+{
+    GS_MovieFrame frame;
+    memset(&frame, 0, sizeof(frame));
+
+    m_Frames.reserve(frameCount);
+
+    size_t position = 0;
+
+    while ((position < size) && (m_Frames.size() < frameCount))
+    {
+        u8 control = data[position++];
+
+        if (control & MOVIE_INPUT_RUN)
+        {
+            int run = (control & 0x7F) + 1;
+
+            for (int i = 0; (i < run) && (m_Frames.size() < frameCount); i++)
+                m_Frames.push_back(frame);
+
+            continue;
+        }
+
+        size_t needed = ((control & MOVIE_INPUT_JOYPAD1) ? 1 : 0) + ((control & MOVIE_INPUT_JOYPAD2) ? 1 : 0) +
+                ((control & MOVIE_INPUT_PHASER) ? 2 * sizeof(s16) : 0) + ((control & MOVIE_INPUT_PADDLE) ? sizeof(float) : 0);
+
+        if (position + needed > size)
+            return false;
+
+        if (control & MOVIE_INPUT_JOYPAD1)
+            frame.joypad[0] = data[position++];
+        if (control & MOVIE_INPUT_JOYPAD2)
+            frame.joypad[1] = data[position++];
+        if (control & MOVIE_INPUT_PHASER)
+        {
+            memcpy(&frame.phaser_x, data + position, sizeof(s16));
+            memcpy(&frame.phaser_y, data + position + sizeof(s16), sizeof(s16));
+            position += 2 * sizeof(s16);
+        }
+        if (control & MOVIE_INPUT_PADDLE)
+        {
+            memcpy(&frame.paddle, data + position, sizeof(float));
+            position += sizeof(float);
+        }
+
+        m_Frames.push_back(frame);
+    }
+
+    return m_Frames.size() == frameCount;
+}
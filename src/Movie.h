@@ -0,0 +1,129 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef MOVIE_H
+#define	MOVIE_H
+
+#include <vector>
+#include <iostream>
+#include "definitions.h"
+
+class GearsystemCore;
+
+#define GS_MOVIE_MAGIC 0x564D5347
+#define GS_MOVIE_VERSION 1
+#define GS_MOVIE_DEFAULT_KEYFRAME_INTERVAL 600
+
+#define GS_MOVIE_FLAG_GAME_GEAR 0x01
+#define GS_MOVIE_FLAG_SG1000 0x02
+#define GS_MOVIE_FLAG_PAL 0x04
+#define GS_MOVIE_FLAG_PHASER 0x08
+#define GS_MOVIE_FLAG_PADDLE 0x10
+
+// File layout: the header, the encoded input of every frame and then each
+// keyframe as a GS_MovieKeyframe followed by its deflated save state. All
+// fields are native endian, like save states.
+struct GS_MovieHeader
+{
+    u32 magic;
+    u16 version;
+    u16 flags;
+    u32 rom_crc;
+    u32 frame_count;
+    u32 keyframe_interval;
+    u32 keyframe_count;
+    u32 input_size;
+    u8 type;
+    u8 zone;
+    u16 reserved;
+};
+
+struct GS_MovieKeyframe
+{
+    u32 frame;
+    u32 size;
+    u32 state_size;
+    u32 reserved;
+    GS_StateHash hash;
+};
+
+struct GS_MovieFrame
+{
+    u8 joypad[2];
+    s16 phaser_x;
+    s16 phaser_y;
+    float paddle;
+};
+
+class Movie
+{
+public:
+    enum MovieMode
+    {
+        MovieStopped,
+        MovieRecording,
+        MoviePlaying
+    };
+
+public:
+    Movie(GearsystemCore* pCore);
+    ~Movie();
+    bool StartRecording(int keyframeInterval = GS_MOVIE_DEFAULT_KEYFRAME_INTERVAL);
+    bool StartPlayback();
+    void Stop();
+    bool Update();
+    bool Seek(int frame);
+    MovieMode GetMode();
+    int GetFrame();
+    int GetFrameCount();
+    int GetKeyframeCount();
+    int GetDesyncFrame();
+    bool Save(const char* szFilePath);
+    bool Save(std::ostream& stream);
+    bool Load(const char* szFilePath);
+    bool Load(std::istream& stream);
+
+private:
+    struct Keyframe
+    {
+        GS_MovieKeyframe info;
+        std::vector<u8> data;
+    };
+
+private:
+    void Clear();
+    void CaptureFrame(GS_MovieFrame& frame);
+    void ApplyFrame(const GS_MovieFrame& frame);
+    bool CaptureKeyframe();
+    bool LoadKeyframe(const Keyframe& keyframe);
+    void EncodeInput(std::vector<u8>& output);
+    bool DecodeInput(const u8* data, size_t size, u32 frameCount);
+
+private:
+    GearsystemCore* m_pCore;
+    MovieMode m_Mode;
+    GS_MovieHeader m_Header;
+    std::vector<GS_MovieFrame> m_Frames;
+    std::vector<Keyframe> m_Keyframes;
+    std::vector<u8> m_State;
+    int m_iFrame;
+    int m_iDesyncFrame;
+};
+
+#endif	/* MOVIE_H */
@@ -23,12 +23,18 @@
 #include "opcode_timing.h"
 #include "opcode_names.h"
 #include "IOPorts.h"
+#include "CodeProfiler.h"
+#include "ExecutionTrace.h"
 
 Processor::Processor(Memory* pMemory)
 {
     m_pMemory = pMemory;
     m_pMemory->SetProcessor(this);
     InitPointer(m_pIOPorts);
+    InitPointer(m_pCodeProfiler);
+    InitPointer(m_pExecutionTrace);
+    m_bInstrumented = false;
+    m_bInstrumentationSuspended = false;
     InitOPCodeFunctors();
     m_bIFF1 = false;
     m_bIFF2 = false;
@@ -42,10 +48,13 @@ Processor::Processor(Memory* pMemory)
     m_bNMIRequested = false;
     m_bPrefixedCBOpcode = false;
     m_PrefixedCBValue = 0;
+    m_CurrentPrefix = 0x00;
     m_bInputLastCycle = false;
     m_ProActionReplayList.clear();
     m_bBreakpointHit = false;
     m_bRequestMemBreakpoint = false;
+    m_InstructionAddress = 0;
+    m_bDisassemblerEnabled = true;
 
     m_ProcessorState.AF = &AF;
     m_ProcessorState.BC = &BC;
@@ -71,10 +80,13 @@ Processor::Processor(Memory* pMemory)
 
 Processor::~Processor()
 {
+    SafeDelete(m_pCodeProfiler);
+    SafeDelete(m_pExecutionTrace);
 }
 
 void Processor::Init()
 {
+    m_pMemory->GetCodeDataLogger()->Enable(m_bDisassemblerEnabled);
     Reset();
 }
 
@@ -107,10 +119,17 @@ void Processor::Reset()
     m_bNMIRequested = false;
     m_bPrefixedCBOpcode = false;
     m_PrefixedCBValue = 0;
+    m_CurrentPrefix = 0x00;
     m_bInputLastCycle = false;
     m_ProActionReplayList.clear();
     m_bBreakpointHit = false;
     m_bRequestMemBreakpoint = false;
+    m_InstructionAddress = 0;
+
+    if (IsValidPointer(m_pCodeProfiler))
+        m_pCodeProfiler->Reset();
+    if (IsValidPointer(m_pExecutionTrace))
+        m_pExecutionTrace->Reset();
 }
 
 void Processor::SetIOPOrts(IOPorts* pIOPorts)
@@ -145,6 +164,10 @@ unsigned int Processor::RunFor(unsigned int tstates)
                 m_iTStates += 11;
                 IncreaseR();
                 WZ.SetValue(PC.GetValue());
+#ifndef GEARSYSTEM_DISABLE_PROFILER
+                if (m_bInstrumented)
+                    InstrumentInterrupt(0x0066);
+#endif
                 DisassembleNextOpcode();
                 return m_iTStates;
             }
@@ -159,6 +182,10 @@ unsigned int Processor::RunFor(unsigned int tstates)
                 IncreaseR();
                 WZ.SetValue(PC.GetValue());
                 UpdateProActionReplay();
+#ifndef GEARSYSTEM_DISABLE_PROFILER
+                if (m_bInstrumented)
+                    InstrumentInterrupt(0x0038);
+#endif
                 DisassembleNextOpcode();
                 return m_iTStates;
             }
@@ -166,7 +193,18 @@ unsigned int Processor::RunFor(unsigned int tstates)
             m_bAfterEI = false;
         }
 
+        m_InstructionAddress = PC.GetValue();
+#ifndef GEARSYSTEM_DISABLE_DISASSEMBLER
+        m_pMemory->GetCodeDataLogger()->Execute(m_InstructionAddress);
+#endif
+#ifndef GEARSYSTEM_DISABLE_PROFILER
+        if (m_bInstrumented)
+            ExecuteInstrumentedOPCode();
+        else
+            ExecuteOPCode();
+#else
         ExecuteOPCode();
+#endif
         DisassembleNextOpcode();
 
         executed += m_iTStates;
@@ -233,8 +271,7 @@ void Processor::ExecuteOPCode()
             if (IsPrefixedInstruction())
             {
                 m_bPrefixedCBOpcode = true;
-                m_PrefixedCBValue = m_pMemory->Read(PC.GetValue());
-                PC.Increment();
+                m_PrefixedCBValue = FetchArg8();
             }
             else
                 IncreaseR();
@@ -293,8 +330,8 @@ void Processor::InvalidOPCode()
 #ifdef DEBUG_GEARSYSTEM
     u16 opcode_address = PC.GetValue() - 1;
     u16 prefix_address = PC.GetValue() - 2;
-    u8 opcode = m_pMemory->Read(opcode_address);
-    u8 prefix = m_pMemory->Read(prefix_address);
+    u8 opcode = m_pMemory->Peek(opcode_address);
+    u8 prefix = m_pMemory->Peek(prefix_address);
 
     switch (prefix)
     {
@@ -320,7 +357,7 @@ void Processor::UndocumentedOPCode()
 {
 #ifdef DEBUG_GEARSYSTEM
     u16 opcode_address = PC.GetValue() - 1;
-    u8 opcode = m_pMemory->Read(opcode_address);
+    u8 opcode = m_pMemory->Peek(opcode_address);
 
     Debug("--> ** UNDOCUMENTED OP Code (%X) at $%.4X -- %s", opcode, opcode_address, kOPCodeNames[opcode]);
 #endif
@@ -329,11 +366,28 @@ void Processor::UndocumentedOPCode()
 void Processor::DisassembleNextOpcode()
 {
 #ifndef GEARSYSTEM_DISABLE_DISASSEMBLER
+    if (!m_bDisassemblerEnabled)
+        return;
+
     if (Disassemble(PC.GetValue()) || m_bRequestMemBreakpoint)
+    {
         m_bBreakpointHit = true;
+
+        if (IsValidPointer(m_pExecutionTrace) && !m_bInstrumentationSuspended)
+            m_pExecutionTrace->Breakpoint();
+    }
 #endif
 }
 
+// Cores that are never inspected (batches, run-ahead) can skip the per
+// instruction disassembly, and with it the debugger maps, CPU breakpoints
+// and the code/data log
+void Processor::EnableDisassembler(bool enable)
+{
+    m_bDisassemblerEnabled = enable;
+    m_pMemory->GetCodeDataLogger()->Enable(enable);
+}
+
 bool Processor::Disassemble(u16 address)
 {
     Memory::stDisassembleRecord** memoryMap = m_pMemory->GetDisassembledMemoryMap();
@@ -408,7 +462,7 @@ bool Processor::Disassemble(u16 address)
 
     for (int i = 0; i < maxSize; i++)
     {
-        opcodes[i] = m_pMemory->Read(address + i);
+        opcodes[i] = m_pMemory->Peek(address + i);
 
         if (opcodes[i] != map[offset]->opcodes[i])
             changed = true;
@@ -419,65 +473,21 @@ bool Processor::Disassemble(u16 address)
         map[offset]->bank = bank;
         map[offset]->address = address;
 
-        std::vector<u8> bytes; 
+        std::vector<u8> bytes;
         u16 opcode_temp_addr = address;
-        u8 opcode_temp = m_pMemory->Read(opcode_temp_addr);
-        u8 ddfd_mod = 0;
-        int first = 0;
+        u8 opcode_temp = m_pMemory->Peek(opcode_temp_addr);
 
         while ((opcode_temp == 0xDD) || (opcode_temp == 0xFD))
         {
-            ddfd_mod = opcode_temp;
             bytes.push_back(opcode_temp);
             opcode_temp_addr++;
-            first++;
-            opcode_temp = m_pMemory->Read(opcode_temp_addr);
+            opcode_temp = m_pMemory->Peek(opcode_temp_addr);
         }
 
         for (int i = 0; i < 5; i++)
-            bytes.push_back(m_pMemory->Read(opcode_temp_addr + i));
-
-        u8 opcode = bytes[first];
-        stOPCodeInfo info;
+            bytes.push_back(m_pMemory->Peek(opcode_temp_addr + i));
 
-        bool prefixed = false;
-
-        if (opcode == 0xCB)
-        {
-            prefixed = true;
-            if (ddfd_mod == 0xDD)
-            {
-                opcode = bytes[first + 2];
-                info = kOPCodeDDCBNames[opcode];
-            }
-            else if (ddfd_mod == 0xFD)
-            {
-                opcode = bytes[first + 2];
-                info = kOPCodeFDCBNames[opcode];
-            }
-            else
-            {
-                opcode = bytes[first + 1];
-                info = kOPCodeCBNames[opcode];
-            }
-        }
-        else if (opcode == 0xED)
-        {
-            prefixed = true;
-            opcode = bytes[first + 1];
-            info = kOPCodeEDNames[opcode];
-        }
-        else
-        {
-            if (ddfd_mod == 0xDD)
-                info = kOPCodeDDNames[opcode];
-            else if (ddfd_mod == 0xFD)
-                info = kOPCodeFDNames[opcode];
-            else
-                info = kOPCodeNames[opcode];
-        }
-
-        map[offset]->size = info.size + (first > 1 ? (first - 1) : 0);
+        map[offset]->size = DisassembleOPCode(&bytes[0], (int)bytes.size(), address, map[offset]->name, sizeof(map[offset]->name), map[offset]->jump, map[offset]->jump_address);
         map[offset]->bytes[0] = 0;
 
         for (int i = 0; i < (int)bytes.size(); i++)
@@ -497,43 +507,10 @@ bool Processor::Disassemble(u16 address)
             if (i < 4)
                 map[offset]->opcodes[i] = bytes[i];
         }
-
-        first += prefixed ? 1 : 0;
-
-        switch (info.type)
-        {
-            case 0:
-                strcpy(map[offset]->name, info.name);
-                break;
-            case 1:
-                snprintf(map[offset]->name, sizeof(map[offset]->name), info.name, bytes[first]);
-                break;
-            case 2:
-                snprintf(map[offset]->name, sizeof(map[offset]->name), info.name, bytes[first + 1]);
-                break;
-            case 3:
-                map[offset]->jump = true;
-                map[offset]->jump_address = (bytes[first + 2] << 8) | bytes[first + 1];
-                snprintf(map[offset]->name, sizeof(map[offset]->name), info.name, map[offset]->jump_address);
-                break;
-            case 4:
-                snprintf(map[offset]->name, sizeof(map[offset]->name), info.name, (s8)bytes[first + 1]);
-                break;
-            case 5:
-                map[offset]->jump = true;
-                map[offset]->jump_address = address + info.size + (s8)bytes[first + 1];
-                snprintf(map[offset]->name, sizeof(map[offset]->name), info.name, map[offset]->jump_address, (s8)bytes[first + 1]);
-                break;
-            case 6:
-                snprintf(map[offset]->name, sizeof(map[offset]->name), info.name, (s8)bytes[first + 1], bytes[first + 2]);
-                break;
-            default:
-                strcpy(map[offset]->name, "PARSE ERROR");
-        }
     }
 
+    bool execute = m_pMemory->IsBreakpointExecute(address);
     Memory::stDisassembleRecord* runtobreakpoint = m_pMemory->GetRunToBreakpoint();
-    std::vector<Memory::stDisassembleRecord*>* breakpoints = m_pMemory->GetBreakpointsCPU();
 
     if (IsValidPointer(runtobreakpoint))
     {
@@ -545,20 +522,87 @@ bool Processor::Disassemble(u16 address)
         else
             return false;
     }
+    else
+        return execute || m_pMemory->IsBreakpointCPU(map[offset], address);
+}
+
+// Decodes the instruction at the start of bytes, which holds any DD/FD
+// prefixes followed by at least five more bytes. Returns its size.
+int Processor::DisassembleOPCode(const u8* bytes, int count, u16 address, char* name, size_t size, bool& jump, u16& jumpAddress)
+{
+    u8 ddfd_mod = 0;
+    int first = 0;
+
+    while ((first < (count - 5)) && ((bytes[first] == 0xDD) || (bytes[first] == 0xFD)))
+        ddfd_mod = bytes[first++];
+
+    u8 opcode = bytes[first];
+    stOPCodeInfo info;
+
+    bool prefixed = false;
+
+    if (opcode == 0xCB)
+    {
+        prefixed = true;
+        if (ddfd_mod == 0xDD)
+            info = kOPCodeDDCBNames[bytes[first + 2]];
+        else if (ddfd_mod == 0xFD)
+            info = kOPCodeFDCBNames[bytes[first + 2]];
+        else
+            info = kOPCodeCBNames[bytes[first + 1]];
+    }
+    else if (opcode == 0xED)
+    {
+        prefixed = true;
+        info = kOPCodeEDNames[bytes[first + 1]];
+    }
     else
     {
-        std::size_t size = breakpoints->size();
+        if (ddfd_mod == 0xDD)
+            info = kOPCodeDDNames[opcode];
+        else if (ddfd_mod == 0xFD)
+            info = kOPCodeFDNames[opcode];
+        else
+            info = kOPCodeNames[opcode];
+    }
 
-        for (std::size_t b = 0; b < size; b++)
-        {
-            if ((*breakpoints)[b] == map[offset])
-            {
-                return true;
-            }
-        }
+    int instructionSize = info.size + (first > 1 ? (first - 1) : 0);
+
+    first += prefixed ? 1 : 0;
+    jump = false;
+
+    switch (info.type)
+    {
+        case 0:
+            snprintf(name, size, "%s", info.name);
+            break;
+        case 1:
+            snprintf(name, size, info.name, bytes[first]);
+            break;
+        case 2:
+            snprintf(name, size, info.name, bytes[first + 1]);
+            break;
+        case 3:
+            jump = true;
+            jumpAddress = (bytes[first + 2] << 8) | bytes[first + 1];
+            snprintf(name, size, info.name, jumpAddress);
+            break;
+        case 4:
+            snprintf(name, size, info.name, (s8)bytes[first + 1]);
+            break;
+        case 5:
+            jump = true;
+            jumpAddress = address + info.size + (s8)bytes[first + 1];
+            snprintf(name, size, info.name, jumpAddress, (s8)bytes[first + 1]);
+            break;
+        case 6:
+            snprintf(name, size, info.name, (s8)bytes[first + 1], bytes[first + 2]);
+            break;
+        default:
+            snprintf(name, size, "PARSE ERROR");
     }
 
-    return false;
+    return instructionSize;
 }
 
 bool Processor::BreakpointHit()
@@ -576,10 +620,91 @@ void Processor::RequestMemoryBreakpoint()
     m_bRequestMemBreakpoint = true;
 }
 
-void Processor::SaveState(std::ostream& stream)
+u16 Processor::GetInstructionAddress()
+{
+    return m_InstructionAddress;
+}
+
+// The profiler and the trace only exist while enabled, so the cost when
+// both are disabled is a flag test per instruction, or nothing with
+// GEARSYSTEM_DISABLE_PROFILER
+void Processor::EnableCodeProfiler(bool enable)
+{
+    if (enable && !IsValidPointer(m_pCodeProfiler))
+        m_pCodeProfiler = new CodeProfiler(m_pMemory);
+    else if (!enable)
+        SafeDelete(m_pCodeProfiler);
+
+    m_bInstrumented = !m_bInstrumentationSuspended && (IsValidPointer(m_pCodeProfiler) || IsValidPointer(m_pExecutionTrace));
+}
+
+CodeProfiler* Processor::GetCodeProfiler()
+{
+    return m_pCodeProfiler;
+}
+
+void Processor::EnableExecutionTrace(bool enable, size_t records)
 {
-    using namespace std;
+    if (enable && !IsValidPointer(m_pExecutionTrace))
+        m_pExecutionTrace = new ExecutionTrace(this, m_pMemory, records);
+    else if (!enable)
+        SafeDelete(m_pExecutionTrace);
 
+    m_bInstrumented = !m_bInstrumentationSuspended && (IsValidPointer(m_pCodeProfiler) || IsValidPointer(m_pExecutionTrace));
+
+    // Memory accesses reach the trace through the breakpoint map
+    m_pMemory->UpdateBreakpoints();
+}
+
+ExecutionTrace* Processor::GetExecutionTrace()
+{
+    return m_pExecutionTrace;
+}
+
+// Speculative frames, as the ones run ahead, must not reach the profiler
+// or the trace
+void Processor::SuspendInstrumentation(bool suspend)
+{
+    m_bInstrumentationSuspended = suspend;
+    m_bInstrumented = !suspend && (IsValidPointer(m_pCodeProfiler) || IsValidPointer(m_pExecutionTrace));
+    m_pMemory->SuspendInstrumentation(suspend);
+}
+
+bool Processor::IsInstrumentationSuspended()
+{
+    return m_bInstrumentationSuspended;
+}
+
+void Processor::ExecuteInstrumentedOPCode()
+{
+    u16 pc = PC.GetValue();
+    u16 sp = SP.GetValue();
+
+    if (IsValidPointer(m_pCodeProfiler))
+        m_pCodeProfiler->BeginInstruction(pc);
+    if (IsValidPointer(m_pExecutionTrace))
+        m_pExecutionTrace->BeginInstruction(pc);
+
+    ExecuteOPCode();
+
+    unsigned int cycles = m_iTStates + m_iInjectedTStates;
+
+    if (IsValidPointer(m_pCodeProfiler))
+        m_pCodeProfiler->EndInstruction(sp, PC.GetValue(), SP.GetValue(), cycles);
+    if (IsValidPointer(m_pExecutionTrace))
+        m_pExecutionTrace->EndInstruction(cycles, m_bInputLastCycle);
+}
+
+void Processor::InstrumentInterrupt(u16 vector)
+{
+    if (IsValidPointer(m_pCodeProfiler))
+        m_pCodeProfiler->Interrupt(SP.GetValue(), vector, m_iTStates);
+    if (IsValidPointer(m_pExecutionTrace))
+        m_pExecutionTrace->Interrupt(SP.GetValue(), vector, m_iTStates);
+}
+
+void Processor::SaveState(StateWriter& writer)
+{
     u16 af = AF.GetValue();
     u16 bc = BC.GetValue();
     u16 de = DE.GetValue();
@@ -596,59 +721,57 @@ void Processor::SaveState(std::ostream& stream)
     u8 i = I;
     u8 r = R;
 
-    stream.write(reinterpret_cast<const char*> (&af), sizeof(af));
-    stream.write(reinterpret_cast<const char*> (&bc), sizeof(bc));
-    stream.write(reinterpret_cast<const char*> (&de), sizeof(de));
-    stream.write(reinterpret_cast<const char*> (&hl), sizeof(hl));
-    stream.write(reinterpret_cast<const char*> (&af2), sizeof(af2));
-    stream.write(reinterpret_cast<const char*> (&bc2), sizeof(bc2));
-    stream.write(reinterpret_cast<const char*> (&de2), sizeof(de2));
-    stream.write(reinterpret_cast<const char*> (&hl2), sizeof(hl2));
-    stream.write(reinterpret_cast<const char*> (&sp), sizeof(sp));
-    stream.write(reinterpret_cast<const char*> (&pc), sizeof(pc));
-    stream.write(reinterpret_cast<const char*> (&ix), sizeof(ix));
-    stream.write(reinterpret_cast<const char*> (&iy), sizeof(iy));
-    stream.write(reinterpret_cast<const char*> (&wz), sizeof(wz));
-    stream.write(reinterpret_cast<const char*> (&i), sizeof(i));
-    stream.write(reinterpret_cast<const char*> (&r), sizeof(r));
-
-    stream.write(reinterpret_cast<const char*> (&m_bIFF1), sizeof(m_bIFF1));
-    stream.write(reinterpret_cast<const char*> (&m_bIFF2), sizeof(m_bIFF2));
-    stream.write(reinterpret_cast<const char*> (&m_bHalt), sizeof(m_bHalt));
-    stream.write(reinterpret_cast<const char*> (&m_bBranchTaken), sizeof(m_bBranchTaken));
-    stream.write(reinterpret_cast<const char*> (&m_iTStates), sizeof(m_iTStates));
-    stream.write(reinterpret_cast<const char*> (&m_bAfterEI), sizeof(m_bAfterEI));
-    stream.write(reinterpret_cast<const char*> (&m_iInterruptMode), sizeof(m_iInterruptMode));
-    stream.write(reinterpret_cast<const char*> (&m_CurrentPrefix), sizeof(m_CurrentPrefix));
-    stream.write(reinterpret_cast<const char*> (&m_bINTRequested), sizeof(m_bINTRequested));
-    stream.write(reinterpret_cast<const char*> (&m_bNMIRequested), sizeof(m_bNMIRequested));
-    stream.write(reinterpret_cast<const char*> (&m_bPrefixedCBOpcode), sizeof(m_bPrefixedCBOpcode));
-    stream.write(reinterpret_cast<const char*> (&m_PrefixedCBValue), sizeof(m_PrefixedCBValue));
-    stream.write(reinterpret_cast<const char*> (&m_bInputLastCycle), sizeof(m_bInputLastCycle));
+    writer.Write(&af, sizeof(af));
+    writer.Write(&bc, sizeof(bc));
+    writer.Write(&de, sizeof(de));
+    writer.Write(&hl, sizeof(hl));
+    writer.Write(&af2, sizeof(af2));
+    writer.Write(&bc2, sizeof(bc2));
+    writer.Write(&de2, sizeof(de2));
+    writer.Write(&hl2, sizeof(hl2));
+    writer.Write(&sp, sizeof(sp));
+    writer.Write(&pc, sizeof(pc));
+    writer.Write(&ix, sizeof(ix));
+    writer.Write(&iy, sizeof(iy));
+    writer.Write(&wz, sizeof(wz));
+    writer.Write(&i, sizeof(i));
+    writer.Write(&r, sizeof(r));
+
+    writer.Write(&m_bIFF1, sizeof(m_bIFF1));
+    writer.Write(&m_bIFF2, sizeof(m_bIFF2));
+    writer.Write(&m_bHalt, sizeof(m_bHalt));
+    writer.Write(&m_bBranchTaken, sizeof(m_bBranchTaken));
+    writer.Write(&m_iTStates, sizeof(m_iTStates));
+    writer.Write(&m_bAfterEI, sizeof(m_bAfterEI));
+    writer.Write(&m_iInterruptMode, sizeof(m_iInterruptMode));
+    writer.Write(&m_CurrentPrefix, sizeof(m_CurrentPrefix));
+    writer.Write(&m_bINTRequested, sizeof(m_bINTRequested));
+    writer.Write(&m_bNMIRequested, sizeof(m_bNMIRequested));
+    writer.Write(&m_bPrefixedCBOpcode, sizeof(m_bPrefixedCBOpcode));
+    writer.Write(&m_PrefixedCBValue, sizeof(m_PrefixedCBValue));
+    writer.Write(&m_bInputLastCycle, sizeof(m_bInputLastCycle));
 }
 
-void Processor::LoadState(std::istream& stream)
+void Processor::LoadState(StateReader& reader)
 {
-    using namespace std;
-
-    u16 af, bc, de, hl, af2, bc2, de2, hl2, sp, pc, ix, iy, wz;
-    u8 i, r;
-
-    stream.read(reinterpret_cast<char*> (&af), sizeof(af));
-    stream.read(reinterpret_cast<char*> (&bc), sizeof(bc));
-    stream.read(reinterpret_cast<char*> (&de), sizeof(de));
-    stream.read(reinterpret_cast<char*> (&hl), sizeof(hl));
-    stream.read(reinterpret_cast<char*> (&af2), sizeof(af2));
-    stream.read(reinterpret_cast<char*> (&bc2), sizeof(bc2));
-    stream.read(reinterpret_cast<char*> (&de2), sizeof(de2));
-    stream.read(reinterpret_cast<char*> (&hl2), sizeof(hl2));
-    stream.read(reinterpret_cast<char*> (&sp), sizeof(sp));
-    stream.read(reinterpret_cast<char*> (&pc), sizeof(pc));
-    stream.read(reinterpret_cast<char*> (&ix), sizeof(ix));
-    stream.read(reinterpret_cast<char*> (&iy), sizeof(iy));
-    stream.read(reinterpret_cast<char*> (&wz), sizeof(wz));
-    stream.read(reinterpret_cast<char*> (&i), sizeof(i));
-    stream.read(reinterpret_cast<char*> (&r), sizeof(r));
+    u16 af = 0, bc = 0, de = 0, hl = 0, af2 = 0, bc2 = 0, de2 = 0, hl2 = 0, sp = 0, pc = 0, ix = 0, iy = 0, wz = 0;
+    u8 i = 0, r = 0;
+
+    reader.Read(&af, sizeof(af));
+    reader.Read(&bc, sizeof(bc));
+    reader.Read(&de, sizeof(de));
+    reader.Read(&hl, sizeof(hl));
+    reader.Read(&af2, sizeof(af2));
+    reader.Read(&bc2, sizeof(bc2));
+    reader.Read(&de2, sizeof(de2));
+    reader.Read(&hl2, sizeof(hl2));
+    reader.Read(&sp, sizeof(sp));
+    reader.Read(&pc, sizeof(pc));
+    reader.Read(&ix, sizeof(ix));
+    reader.Read(&iy, sizeof(iy));
+    reader.Read(&wz, sizeof(wz));
+    reader.Read(&i, sizeof(i));
+    reader.Read(&r, sizeof(r));
 
     AF.SetValue(af);
     BC.SetValue(bc);
@@ -666,19 +789,19 @@ void Processor::LoadState(std::istream& stream)
     I = i;
     R = r;
 
-    stream.read(reinterpret_cast<char*> (&m_bIFF1), sizeof(m_bIFF1));
-    stream.read(reinterpret_cast<char*> (&m_bIFF2), sizeof(m_bIFF2));
-    stream.read(reinterpret_cast<char*> (&m_bHalt), sizeof(m_bHalt));
-    stream.read(reinterpret_cast<char*> (&m_bBranchTaken), sizeof(m_bBranchTaken));
-    stream.read(reinterpret_cast<char*> (&m_iTStates), sizeof(m_iTStates));
-    stream.read(reinterpret_cast<char*> (&m_bAfterEI), sizeof(m_bAfterEI));
-    stream.read(reinterpret_cast<char*> (&m_iInterruptMode), sizeof(m_iInterruptMode));
-    stream.read(reinterpret_cast<char*> (&m_CurrentPrefix), sizeof(m_CurrentPrefix));
-    stream.read(reinterpret_cast<char*> (&m_bINTRequested), sizeof(m_bINTRequested));
-    stream.read(reinterpret_cast<char*> (&m_bNMIRequested), sizeof(m_bNMIRequested));
-    stream.read(reinterpret_cast<char*> (&m_bPrefixedCBOpcode), sizeof(m_bPrefixedCBOpcode));
-    stream.read(reinterpret_cast<char*> (&m_PrefixedCBValue), sizeof(m_PrefixedCBValue));
-    stream.read(reinterpret_cast<char*> (&m_bInputLastCycle), sizeof(m_bInputLastCycle));
+    reader.Read(&m_bIFF1, sizeof(m_bIFF1));
+    reader.Read(&m_bIFF2, sizeof(m_bIFF2));
+    reader.Read(&m_bHalt, sizeof(m_bHalt));
+    reader.Read(&m_bBranchTaken, sizeof(m_bBranchTaken));
+    reader.Read(&m_iTStates, sizeof(m_iTStates));
+    reader.Read(&m_bAfterEI, sizeof(m_bAfterEI));
+    reader.Read(&m_iInterruptMode, sizeof(m_iInterruptMode));
+    reader.Read(&m_CurrentPrefix, sizeof(m_CurrentPrefix));
+    reader.Read(&m_bINTRequested, sizeof(m_bINTRequested));
+    reader.Read(&m_bNMIRequested, sizeof(m_bNMIRequested));
+    reader.Read(&m_bPrefixedCBOpcode, sizeof(m_bPrefixedCBOpcode));
+    reader.Read(&m_PrefixedCBValue, sizeof(m_PrefixedCBValue));
+    reader.Read(&m_bInputLastCycle, sizeof(m_bInputLastCycle));
 }
 
 void Processor::SetProActionReplayCheat(const char* szCheat)
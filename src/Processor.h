@@ -22,10 +22,13 @@
 
 #include <list>
 #include "definitions.h"
+#include "StateSerializer.h"
 #include "SixteenBitRegister.h"
 #include "Memory.h"
 
 class IOPorts;
+class CodeProfiler;
+class ExecutionTrace;
 
 class Processor
 {
@@ -65,16 +68,25 @@ public:
     void RequestNMI();
     void SetIOPOrts(IOPorts* pIOPorts);
     IOPorts* GetIOPOrts();
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream);
+    void SaveState(StateWriter& writer);
+    void LoadState(StateReader& reader);
     void SetProActionReplayCheat(const char* szCheat);
     void ClearProActionReplayCheats();
     ProcessorState* GetState();
     bool Disassemble(u16 address);
+    static int DisassembleOPCode(const u8* bytes, int count, u16 address, char* name, size_t size, bool& jump, u16& jumpAddress);
     void DisassembleNextOpcode();
+    void EnableDisassembler(bool enable);
     bool BreakpointHit();
     void RequestMemoryBreakpoint();
+    u16 GetInstructionAddress();
     bool Halted();
+    void EnableCodeProfiler(bool enable);
+    CodeProfiler* GetCodeProfiler();
+    void EnableExecutionTrace(bool enable, size_t records = GS_EXECUTION_TRACE_DEFAULT_RECORDS);
+    ExecutionTrace* GetExecutionTrace();
+    void SuspendInstrumentation(bool suspend);
+    bool IsInstrumentationSuspended();
 
 private:
     typedef void (Processor::*OPCptr) (void);
@@ -114,6 +126,12 @@ private:
     bool m_bInputLastCycle;
     bool m_bBreakpointHit;
     bool m_bRequestMemBreakpoint;
+    u16 m_InstructionAddress;
+    bool m_bDisassemblerEnabled;
+    CodeProfiler* m_pCodeProfiler;
+    ExecutionTrace* m_pExecutionTrace;
+    bool m_bInstrumented;
+    bool m_bInstrumentationSuspended;
 
     struct ProActionReplayCode
     {
@@ -126,8 +144,13 @@ private:
 
 private:
     u8 FetchOPCode();
+    u8 FetchArg8();
     u16 FetchArg16();
     void ExecuteOPCode();
+    void ExecuteInstrumentedOPCode();
+    void InstrumentInterrupt(u16 vector);
+    u8 PortInput(u8 port);
+    void PortOutput(u8 port, u8 value);
     void LeaveHalt();
     void ClearAllFlags();
     void ToggleZeroFlagFromResult(u16 result);
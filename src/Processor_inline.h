@@ -24,23 +24,50 @@
 #include "SixteenBitRegister.h"
 #include "Processor.h"
 #include "IOPorts.h"
+#include "ExecutionTrace.h"
 
 inline u8 Processor::FetchOPCode()
 {
-    u8 opcode = m_pMemory->Read(PC.GetValue());
+    u8 opcode = m_pMemory->FetchOPCode(PC.GetValue());
     PC.Increment();
     return opcode;
 }
 
+inline u8 Processor::FetchArg8()
+{
+    u8 value = m_pMemory->FetchOperand(PC.GetValue());
+    PC.Increment();
+    return value;
+}
+
 inline u16 Processor::FetchArg16()
 {
     u16 pc = PC.GetValue();
-    u8 l = m_pMemory->Read(pc);
-    u8 h = m_pMemory->Read(pc + 1);
+    u8 l = m_pMemory->FetchOperand(pc);
+    u8 h = m_pMemory->FetchOperand(pc + 1);
     PC.SetValue(pc + 2);
     return (h << 8) | l;
 }
 
+inline u8 Processor::PortInput(u8 port)
+{
+    u8 value = m_pIOPorts->DoInput(port);
+#ifndef GEARSYSTEM_DISABLE_PROFILER
+    if (IsValidPointer(m_pExecutionTrace))
+        m_pExecutionTrace->Access(port, ExecutionTrace::AccessIORead, value);
+#endif
+    return value;
+}
+
+inline void Processor::PortOutput(u8 port, u8 value)
+{
+#ifndef GEARSYSTEM_DISABLE_PROFILER
+    if (IsValidPointer(m_pExecutionTrace))
+        m_pExecutionTrace->Access(port, ExecutionTrace::AccessIOWrite, value);
+#endif
+    m_pIOPorts->DoOutput(port, value);
+}
+
 inline void Processor::LeaveHalt()
 {
     if (m_bHalt)
@@ -170,8 +197,7 @@ inline u16 Processor::GetEffectiveAddress()
             }
             else
             {
-                address += static_cast<s8> (m_pMemory->Read(PC.GetValue()));
-                PC.Increment();
+                address += static_cast<s8> (FetchArg8());
                 WZ.SetValue(address);
             }
             return address;
@@ -185,8 +211,7 @@ inline u16 Processor::GetEffectiveAddress()
             }
             else
             {
-                address += static_cast<s8> (m_pMemory->Read(PC.GetValue()));
-                PC.Increment();
+                address += static_cast<s8> (FetchArg8());
                 WZ.SetValue(address);
             }
             return address;
@@ -317,8 +342,8 @@ inline void Processor::OPCodes_CALL_nn_Conditional(bool condition)
 
 inline void Processor::OPCodes_JP_nn()
 {
-    u8 l = m_pMemory->Read(PC.GetValue());
-    u8 h = m_pMemory->Read(PC.GetValue() + 1);
+    u8 l = m_pMemory->FetchOperand(PC.GetValue());
+    u8 h = m_pMemory->FetchOperand(PC.GetValue() + 1);
     u16 address = (h << 8) | l;
     PC.SetValue(address);
     WZ.SetValue(address);
@@ -326,8 +351,8 @@ inline void Processor::OPCodes_JP_nn()
 
 inline void Processor::OPCodes_JP_nn_Conditional(bool condition)
 {
-    u8 l = m_pMemory->Read(PC.GetValue());
-    u8 h = m_pMemory->Read(PC.GetValue() + 1);
+    u8 l = m_pMemory->FetchOperand(PC.GetValue());
+    u8 h = m_pMemory->FetchOperand(PC.GetValue() + 1);
     u16 address = (h << 8) | l;
     if (condition)
     {
@@ -345,7 +370,7 @@ inline void Processor::OPCodes_JP_nn_Conditional(bool condition)
 inline void Processor::OPCodes_JR_n()
 {
     u16 pc = PC.GetValue();
-    PC.SetValue(pc + 1 + (static_cast<s8> (m_pMemory->Read(pc))));
+    PC.SetValue(pc + 1 + (static_cast<s8> (m_pMemory->FetchOperand(pc))));
 }
 
 inline void Processor::OPCodes_JR_n_conditional(bool condition)
@@ -356,7 +381,10 @@ inline void Processor::OPCodes_JR_n_conditional(bool condition)
         m_bBranchTaken = true;
     }
     else
-        PC.Increment();
+    {
+        // The displacement is read even if the jump is not taken
+        FetchArg8();
+    }
 }
 
 inline void Processor::OPCodes_RET()
@@ -376,7 +404,7 @@ inline void Processor::OPCodes_RET_Conditional(bool condition)
 
 inline void Processor::OPCodes_IN_C(u8* reg)
 {
-    u8 result = m_pIOPorts->DoInput(BC.GetLow());
+    u8 result = PortInput(BC.GetLow());
     if (IsValidPointer(reg))
         *reg = result;
     IsSetFlag(FLAG_CARRY) ? SetFlag(FLAG_CARRY) : ClearAllFlags();
@@ -389,7 +417,7 @@ inline void Processor::OPCodes_IN_C(u8* reg)
 inline void Processor::OPCodes_INI()
 {
     WZ.SetValue(BC.GetValue() + 1);
-    u8 result = m_pIOPorts->DoInput(BC.GetLow());
+    u8 result = PortInput(BC.GetLow());
     m_pMemory->Write(HL.GetValue(), result);
     OPCodes_DEC(BC.GetHighRegister());
     HL.Increment();
@@ -416,7 +444,7 @@ inline void Processor::OPCodes_INI()
 inline void Processor::OPCodes_IND()
 {
     WZ.SetValue(BC.GetValue() - 1);
-    u8 result = m_pIOPorts->DoInput(BC.GetLow());
+    u8 result = PortInput(BC.GetLow());
     m_pMemory->Write(HL.GetValue(), result);
     OPCodes_DEC(BC.GetHighRegister());
     HL.Decrement();
@@ -442,13 +470,13 @@ inline void Processor::OPCodes_IND()
 
 inline void Processor::OPCodes_OUT_C(u8* reg)
 {
-    m_pIOPorts->DoOutput(BC.GetLow(), *reg);
+    PortOutput(BC.GetLow(), *reg);
 }
 
 inline void Processor::OPCodes_OUTI()
 {
     u8 result = m_pMemory->Read(HL.GetValue());
-    m_pIOPorts->DoOutput(BC.GetLow(), result);
+    PortOutput(BC.GetLow(), result);
     OPCodes_DEC(BC.GetHighRegister());
     WZ.SetValue(BC.GetValue() + 1);
     HL.Increment();
@@ -475,7 +503,7 @@ inline void Processor::OPCodes_OUTI()
 inline void Processor::OPCodes_OUTD()
 {
     u8 result = m_pMemory->Read(HL.GetValue());
-    m_pIOPorts->DoOutput(BC.GetLow(), result);
+    PortOutput(BC.GetLow(), result);
     OPCodes_DEC(BC.GetHighRegister());
     WZ.SetValue(BC.GetValue() - 1);
     HL.Decrement();
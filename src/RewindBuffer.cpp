@@ -0,0 +1,462 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <chrono>
+#include "RewindBuffer.h"
+#include "log.h"
+#include "GearsystemCore.h"
+
+// Zero runs shorter than this are cheaper to store inside a literal run
+#define REWIND_MIN_ZERO_RUN 8
+
+static inline u64 GetTimeNs()
+{
+    using namespace std::chrono;
+    return static_cast<u64>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+}
+
+static inline u8* WriteVarint(u8* dest, u32 value)
+{
+    while (value >= 0x80)
+    {
+        *dest++ = static_cast<u8>(value | 0x80);
+        value >>= 7;
+    }
+
+    *dest++ = static_cast<u8>(value);
+    return dest;
+}
+
+static inline const u8* ReadVarint(const u8* src, const u8* end, u32& value)
+{
+    value = 0;
+
+    for (int shift = 0; (src < end) && (shift < 32); shift += 7)
+    {
+        u8 byte = *src++;
+        value |= static_cast<u32>(byte & 0x7F) << shift;
+
+        if (!(byte & 0x80))
+            return src;
+    }
+
+    return NULL;
+}
+
+RewindBuffer::RewindBuffer(GearsystemCore* pCore)
+{
+    m_pCore = pCore;
+    InitPointer(m_pRing);
+    InitPointer(m_pSnapshots);
+    InitPointer(m_pTopState);
+    InitPointer(m_pNewState);
+    InitPointer(m_pEncodeBuffer);
+    m_iBudget = 0;
+    m_iMaxSnapshots = 0;
+    m_iStateSize = 0;
+    m_iFrameInterval = 1;
+    m_iKeyframeInterval = GS_REWIND_DEFAULT_KEYFRAME_INTERVAL;
+    Reset();
+}
+
+RewindBuffer::~RewindBuffer()
+{
+    SafeDeleteArray(m_pRing);
+    SafeDeleteArray(m_pSnapshots);
+    FreeStateBuffers();
+}
+
+void RewindBuffer::Init(size_t budget, int frameInterval, int keyframeInterval)
+{
+    if (budget != m_iBudget)
+    {
+        SafeDeleteArray(m_pRing);
+        SafeDeleteArray(m_pSnapshots);
+
+        m_iBudget = budget;
+        m_iMaxSnapshots = static_cast<int>(budget / 256) + 1;
+        m_pRing = new u8[m_iBudget];
+        m_pSnapshots = new Snapshot[m_iMaxSnapshots];
+    }
+
+    m_iFrameInterval = (frameInterval < 1) ? 1 : frameInterval;
+    m_iKeyframeInterval = (keyframeInterval < 1) ? 1 : keyframeInterval;
+
+    Reset();
+}
+
+void RewindBuffer::Reset()
+{
+    m_iHead = 0;
+    m_iUsed = 0;
+    m_iFirstSnapshot = 0;
+    m_iSnapshotCount = 0;
+    m_iKeyframeCount = 0;
+    m_bHasTopState = false;
+    m_iFrameCounter = 0;
+    m_iSinceKeyframe = 0;
+    m_iCaptureCount = 0;
+    m_iCaptureTime = 0;
+    m_iLastCaptureTime = 0;
+    m_iLastStepTime = 0;
+    m_iRawBytes = 0;
+    m_iStoredBytes = 0;
+    m_iLastSnapshotSize = 0;
+}
+
+// Call once per emulated frame. Every m_iFrameInterval frames the state is
+// serialized and the previous one is stored as a backwards delta against it,
+// so the newest state always stays uncompressed and one step back is a
+// single sparse XOR.
+bool RewindBuffer::Capture()
+{
+    if (!IsValidPointer(m_pRing))
+        return false;
+
+    if (++m_iFrameCounter < m_iFrameInterval)
+        return false;
+
+    m_iFrameCounter = 0;
+
+    u64 start = GetTimeNs();
+
+    size_t size = m_pCore->GetStateSize();
+
+    if (size == 0)
+        return false;
+
+    if (size != m_iStateSize)
+    {
+        Reset();
+
+        if (!AllocateStateBuffers(size))
+            return false;
+    }
+
+    if (!m_pCore->SaveState(m_pNewState, size))
+        return false;
+
+    if (m_bHasTopState)
+    {
+        bool keyframe = (m_iSinceKeyframe >= m_iKeyframeInterval);
+        size_t encoded = Encode(keyframe ? NULL : m_pNewState, m_pTopState, m_pEncodeBuffer);
+
+        if (Store(m_pEncodeBuffer, static_cast<u32>(encoded), keyframe))
+        {
+            m_iSinceKeyframe = keyframe ? 0 : m_iSinceKeyframe + 1;
+            m_iRawBytes += m_iStateSize;
+            m_iStoredBytes += encoded;
+            m_iLastSnapshotSize = static_cast<u32>(encoded);
+        }
+    }
+
+    u8* swap = m_pTopState;
+    m_pTopState = m_pNewState;
+    m_pNewState = swap;
+    m_bHasTopState = true;
+
+    m_iLastCaptureTime = GetTimeNs() - start;
+    m_iCaptureTime += m_iLastCaptureTime;
+    m_iCaptureCount++;
+
+    return true;
+}
+
+// Restores the state captured 'snapshots' captures ago. Deltas are applied
+// from the newest one down, unless a keyframe sits between the target and
+// the newest snapshot, in which case decoding starts from that keyframe.
+bool RewindBuffer::StepBack(int snapshots)
+{
+    if (!m_bHasTopState || (m_iSnapshotCount == 0) || (snapshots < 1))
+        return false;
+
+    u64 start = GetTimeNs();
+
+    if (snapshots > m_iSnapshotCount)
+        snapshots = m_iSnapshotCount;
+
+    int target = m_iSnapshotCount - snapshots;
+    int begin = m_iSnapshotCount - 1;
+
+    for (int i = target; i < m_iSnapshotCount; i++)
+    {
+        if (GetSnapshot(i)->keyframe)
+        {
+            begin = i;
+            break;
+        }
+    }
+
+    for (int i = begin; i >= target; i--)
+    {
+        if (!Decode(GetSnapshot(i), m_pTopState))
+        {
+            Log("Rewind buffer corrupted");
+            Reset();
+            return false;
+        }
+    }
+
+    for (int i = m_iSnapshotCount - 1; i >= target; i--)
+    {
+        Snapshot* snapshot = GetSnapshot(i);
+        m_iHead = snapshot->offset;
+        m_iUsed -= snapshot->size;
+        if (snapshot->keyframe)
+            m_iKeyframeCount--;
+    }
+
+    m_iSnapshotCount = target;
+    m_iFrameCounter = 0;
+    m_iSinceKeyframe = 0;
+
+    if (m_iSnapshotCount == 0)
+    {
+        m_iHead = 0;
+        m_iFirstSnapshot = 0;
+    }
+
+    bool ret = m_pCore->LoadState(m_pTopState, m_iStateSize);
+
+    m_iLastStepTime = GetTimeNs() - start;
+
+    return ret;
+}
+
+int RewindBuffer::GetSnapshotCount()
+{
+    return m_iSnapshotCount;
+}
+
+int RewindBuffer::GetFrameInterval()
+{
+    return m_iFrameInterval;
+}
+
+void RewindBuffer::GetStats(RewindStats& stats)
+{
+    stats.memory_budget = m_iBudget;
+    stats.memory_used = m_iUsed;
+    stats.state_size = m_iStateSize;
+    stats.snapshot_count = m_iSnapshotCount;
+    stats.keyframe_count = m_iKeyframeCount;
+    stats.frames_available = m_iSnapshotCount * m_iFrameInterval;
+    stats.last_capture_us = m_iLastCaptureTime / 1000.0f;
+    stats.average_capture_us = (m_iCaptureCount > 0) ? (m_iCaptureTime / 1000.0f) / m_iCaptureCount : 0.0f;
+    stats.last_step_us = m_iLastStepTime / 1000.0f;
+    stats.last_snapshot_size = m_iLastSnapshotSize;
+    stats.compression_ratio = (m_iStoredBytes > 0) ? static_cast<float>(m_iRawBytes) / m_iStoredBytes : 0.0f;
+}
+
+bool RewindBuffer::AllocateStateBuffers(size_t stateSize)
+{
+    FreeStateBuffers();
+
+    m_iStateSize = stateSize;
+    m_pTopState = new u8[stateSize];
+    m_pNewState = new u8[stateSize];
+    m_pEncodeBuffer = new u8[stateSize + (stateSize / 8) + 64];
+
+    return true;
+}
+
+void RewindBuffer::FreeStateBuffers()
+{
+    SafeDeleteArray(m_pTopState);
+    SafeDeleteArray(m_pNewState);
+    SafeDeleteArray(m_pEncodeBuffer);
+    m_iStateSize = 0;
+}
+
+RewindBuffer::Snapshot* RewindBuffer::GetSnapshot(int index)
+{
+    return &m_pSnapshots[(m_iFirstSnapshot + index) % m_iMaxSnapshots];
+}
+
+void RewindBuffer::EvictOldest()
+{
+    Snapshot* oldest = GetSnapshot(0);
+
+    m_iUsed -= oldest->size;
+    if (oldest->keyframe)
+        m_iKeyframeCount--;
+
+    m_iFirstSnapshot = (m_iFirstSnapshot + 1) % m_iMaxSnapshots;
+    m_iSnapshotCount--;
+
+    if (m_iSnapshotCount == 0)
+    {
+        m_iHead = 0;
+        m_iFirstSnapshot = 0;
+    }
+}
+
+// Snapshots are never split, the ring wraps early instead. Older snapshots
+// always lie ahead of the head in address order, so evicting from the oldest
+// end frees the space in the right order.
+bool RewindBuffer::Store(const u8* data, u32 size, bool keyframe)
+{
+    if (size > m_iBudget)
+    {
+        Log("Rewind snapshot larger than the buffer [%d bytes]", size);
+        Reset();
+        return false;
+    }
+
+    if (m_iSnapshotCount == m_iMaxSnapshots)
+        EvictOldest();
+
+    size_t position = m_iHead;
+
+    if (position + size > m_iBudget)
+    {
+        while ((m_iSnapshotCount > 0) && (GetSnapshot(0)->offset >= m_iHead))
+            EvictOldest();
+
+        position = 0;
+    }
+
+    while ((m_iSnapshotCount > 0) && (GetSnapshot(0)->offset >= position) && (GetSnapshot(0)->offset < position + size))
+        EvictOldest();
+
+    memcpy(m_pRing + position, data, size);
+
+    Snapshot* snapshot = &m_pSnapshots[(m_iFirstSnapshot + m_iSnapshotCount) % m_iMaxSnapshots];
+    snapshot->offset = position;
+    snapshot->size = size;
+    snapshot->keyframe = keyframe;
+
+    m_iSnapshotCount++;
+    m_iHead = position + size;
+    m_iUsed += size;
+    if (keyframe)
+        m_iKeyframeCount++;
+
+    return true;
+}
+
+// Encodes 'state' XOR 'base' as pairs of (zero run, literal run) lengths,
+// each followed by the literal bytes. A NULL 'base' encodes 'state' as is,
+// which is how keyframes are stored.
+size_t RewindBuffer::Encode(const u8* base, const u8* state, u8* dest)
+{
+    const size_t size = m_iStateSize;
+    u8* out = dest;
+    size_t i = 0;
+
+    while (i < size)
+    {
+        size_t zero_start = i;
+
+        if (IsValidPointer(base))
+        {
+            while ((i + 8 <= size) && (memcmp(base + i, state + i, 8) == 0))
+                i += 8;
+            while ((i < size) && (base[i] == state[i]))
+                i++;
+        }
+        else
+        {
+            while ((i < size) && (state[i] == 0))
+                i++;
+        }
+
+        if (i == size)
+            break;
+
+        size_t literal_start = i;
+        size_t zeros = 0;
+
+        while ((i < size) && (zeros < REWIND_MIN_ZERO_RUN))
+        {
+            u8 value = IsValidPointer(base) ? (base[i] ^ state[i]) : state[i];
+            zeros = (value == 0) ? zeros + 1 : 0;
+            i++;
+        }
+
+        i -= zeros;
+
+        out = WriteVarint(out, static_cast<u32>(literal_start - zero_start));
+        out = WriteVarint(out, static_cast<u32>(i - literal_start));
+
+        if (IsValidPointer(base))
+        {
+            for (size_t j = literal_start; j < i; j++)
+                *out++ = base[j] ^ state[j];
+        }
+        else
+        {
+            memcpy(out, state + literal_start, i - literal_start);
+            out += i - literal_start;
+        }
+    }
+
+    // Snapshots always take some room so ring offsets stay strictly ordered
+    if (out == dest)
+    {
+        out = WriteVarint(out, 0);
+        out = WriteVarint(out, 0);
+    }
+
+    return out - dest;
+}
+
+bool RewindBuffer::Decode(const Snapshot* snapshot, u8* state)
+{
+    const u8* src = m_pRing + snapshot->offset;
+    const u8* end = src + snapshot->size;
+    size_t position = 0;
+
+    while (src < end)
+    {
+        u32 zeros = 0;
+        u32 literals = 0;
+
+        src = ReadVarint(src, end, zeros);
+        if (!IsValidPointer(src))
+            return false;
+        src = ReadVarint(src, end, literals);
+        if (!IsValidPointer(src))
+            return false;
+
+        if ((position + zeros + literals > m_iStateSize) || (literals > static_cast<size_t>(end - src)))
+            return false;
+
+        if (snapshot->keyframe)
+        {
+            memset(state + position, 0, zeros);
+            position += zeros;
+            memcpy(state + position, src, literals);
+        }
+        else
+        {
+            position += zeros;
+            for (u32 j = 0; j < literals; j++)
+                state[position + j] ^= src[j];
+        }
+
+        position += literals;
+        src += literals;
+    }
+
+    if (snapshot->keyframe && (position < m_iStateSize))
+        memset(state + position, 0, m_iStateSize - position);
+
+    return true;
+}
@@ -0,0 +1,101 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef REWINDBUFFER_H
+#define	REWINDBUFFER_H
+
+#include "definitions.h"
+
+class GearsystemCore;
+
+struct RewindStats
+{
+    size_t memory_budget;
+    size_t memory_used;
+    size_t state_size;
+    int snapshot_count;
+    int keyframe_count;
+    int frames_available;
+    float last_capture_us;
+    float average_capture_us;
+    float last_step_us;
+    u32 last_snapshot_size;
+    float compression_ratio;
+};
+
+class RewindBuffer
+{
+public:
+    RewindBuffer(GearsystemCore* pCore);
+    ~RewindBuffer();
+    void Init(size_t budget = GS_REWIND_DEFAULT_BUFFER_SIZE, int frameInterval = 1, int keyframeInterval = GS_REWIND_DEFAULT_KEYFRAME_INTERVAL);
+    void Reset();
+    bool Capture();
+    bool StepBack(int snapshots = 1);
+    int GetSnapshotCount();
+    int GetFrameInterval();
+    void GetStats(RewindStats& stats);
+
+private:
+    struct Snapshot
+    {
+        size_t offset;
+        u32 size;
+        bool keyframe;
+    };
+
+private:
+    bool AllocateStateBuffers(size_t stateSize);
+    void FreeStateBuffers();
+    Snapshot* GetSnapshot(int index);
+    void EvictOldest();
+    bool Store(const u8* data, u32 size, bool keyframe);
+    size_t Encode(const u8* base, const u8* state, u8* dest);
+    bool Decode(const Snapshot* snapshot, u8* state);
+
+private:
+    GearsystemCore* m_pCore;
+    u8* m_pRing;
+    size_t m_iBudget;
+    size_t m_iHead;
+    size_t m_iUsed;
+    Snapshot* m_pSnapshots;
+    int m_iMaxSnapshots;
+    int m_iFirstSnapshot;
+    int m_iSnapshotCount;
+    int m_iKeyframeCount;
+    u8* m_pTopState;
+    u8* m_pNewState;
+    u8* m_pEncodeBuffer;
+    size_t m_iStateSize;
+    bool m_bHasTopState;
+    int m_iFrameInterval;
+    int m_iFrameCounter;
+    int m_iKeyframeInterval;
+    int m_iSinceKeyframe;
+    u64 m_iCaptureCount;
+    u64 m_iCaptureTime;
+    u64 m_iLastCaptureTime;
+    u64 m_iLastStepTime;
+    u64 m_iRawBytes;
+    u64 m_iStoredBytes;
+    u32 m_iLastSnapshotSize;
+};
+
+#endif	/* REWINDBUFFER_H */
@@ -0,0 +1,550 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <set>
+#include <ctype.h>
+#if defined(_WIN32)
+    #define WIN32_LEAN_AND_MEAN
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <sys/stat.h>
+    #include <dirent.h>
+#endif
+#include "RomLibrary.h"
+#include "Cartridge.h"
+#include "log.h"
+#include "miniz/miniz.h"
+
+RomLibrary::RomLibrary()
+{
+    memset(&m_Stats, 0, sizeof(m_Stats));
+}
+
+RomLibrary::~RomLibrary()
+{
+}
+
+void RomLibrary::Init(int threads)
+{
+    m_Scheduler.Init(threads);
+}
+
+static std::string LowerExtension(const char* path)
+{
+    std::string fn(path);
+    std::string::size_type dot = fn.find_last_of(".");
+
+    if (dot == std::string::npos)
+        return std::string();
+
+    std::string extension = fn.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), (int(*)(int)) tolower);
+
+    return extension;
+}
+
+static bool IsROMExtension(const std::string& extension)
+{
+    return (extension == "sms") || (extension == "gg") || (extension == "sg") || (extension == "mv");
+}
+
+bool RomLibrary::IsROMFile(const char* path)
+{
+    std::string extension = LowerExtension(path);
+
+    return IsROMExtension(extension) || (extension == "zip");
+}
+
+static bool CompareEntries(const RomLibrary::Entry& a, const RomLibrary::Entry& b)
+{
+    return a.path < b.path;
+}
+
+bool RomLibrary::Scan(const char* root, bool recursive)
+{
+    using namespace std;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    memset(&m_Stats, 0, sizeof(m_Stats));
+
+    string dir(root);
+
+    while ((dir.size() > 1) && ((dir[dir.size() - 1] == '/') || (dir[dir.size() - 1] == '\\')))
+        dir.erase(dir.size() - 1);
+
+    vector<File> files;
+
+    if (!ListFiles(dir, recursive, files))
+    {
+        Log("RomLibrary: unable to scan %s", root);
+        return false;
+    }
+
+    m_Stats.files = static_cast<int>(files.size());
+
+    set<string> found;
+    m_Pending.clear();
+
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        found.insert(files[i].path);
+
+        map<string, int>::const_iterator it = m_Index.find(files[i].path);
+
+        if ((it != m_Index.end()) && (m_Entries[it->second].size == files[i].size) && (m_Entries[it->second].mtime == files[i].mtime))
+        {
+            m_Stats.cached++;
+            continue;
+        }
+
+        Entry entry;
+        entry.path = files[i].path;
+        entry.size = files[i].size;
+        entry.mtime = files[i].mtime;
+        entry.crc = 0;
+        entry.rom_size = 0;
+        entry.game_gear = false;
+        entry.sg1000 = false;
+        entry.valid = false;
+        InitPointer(entry.db);
+        m_Pending.push_back(entry);
+    }
+
+    // Drop the entries of this root that are gone, leaving subdirectories
+    // alone when the scan is not recursive
+    string prefix = dir + "/";
+    vector<Entry> kept;
+
+    for (size_t i = 0; i < m_Entries.size(); i++)
+    {
+        const string& path = m_Entries[i].path;
+        bool inside = (path.compare(0, prefix.size(), prefix) == 0) &&
+                      (recursive || (path.find_first_of("/\\", prefix.size()) == string::npos));
+
+        if (inside && (found.find(path) == found.end()))
+            m_Stats.removed++;
+        else
+            kept.push_back(m_Entries[i]);
+    }
+
+    m_Entries.swap(kept);
+
+    if (!m_Pending.empty())
+    {
+        if (m_Scheduler.GetThreadCount() == 0)
+            m_Scheduler.Init();
+
+        m_Scheduler.Run(static_cast<int>(m_Pending.size()), HashTask, this);
+    }
+
+    m_Index.clear();
+
+    for (size_t i = 0; i < m_Entries.size(); i++)
+        m_Index[m_Entries[i].path] = static_cast<int>(i);
+
+    for (size_t i = 0; i < m_Pending.size(); i++)
+    {
+        const Entry& entry = m_Pending[i];
+
+        m_Stats.hashed++;
+        m_Stats.bytes += entry.size;
+
+        if (!entry.valid)
+            m_Stats.failed++;
+
+        map<string, int>::const_iterator it = m_Index.find(entry.path);
+
+        if (it != m_Index.end())
+            m_Entries[it->second] = entry;
+        else
+            m_Entries.push_back(entry);
+    }
+
+    m_Pending.clear();
+
+    sort(m_Entries.begin(), m_Entries.end(), CompareEntries);
+
+    m_Index.clear();
+
+    for (size_t i = 0; i < m_Entries.size(); i++)
+        m_Index[m_Entries[i].path] = static_cast<int>(i);
+
+    m_Stats.seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    return true;
+}
+
+int RomLibrary::GetEntryCount() const
+{
+    return static_cast<int>(m_Entries.size());
+}
+
+const RomLibrary::Entry& RomLibrary::GetEntry(int index) const
+{
+    return m_Entries[index];
+}
+
+const RomLibrary::Entry* RomLibrary::FindEntry(const char* path) const
+{
+    std::map<std::string, int>::const_iterator it = m_Index.find(path);
+
+    if (it == m_Index.end())
+        return NULL;
+
+    return &m_Entries[it->second];
+}
+
+const RomLibrary::Stats& RomLibrary::GetStats() const
+{
+    return m_Stats;
+}
+
+void RomLibrary::HashTask(int index, void* userdata)
+{
+    RomLibrary* library = static_cast<RomLibrary*>(userdata);
+    HashEntry(library->m_Pending[index]);
+}
+
+// Same rules as Cartridge::LoadFromStorage: a 512 byte header is skipped and
+// any other size that is not a multiple of 1 KB is not a ROM
+static bool ROMImageOffset(u64 size, u64& offset)
+{
+    offset = ((size % 1024) == 512) ? 512 : 0;
+
+    if ((offset == 0) && ((size % 1024) != 0))
+        return false;
+
+    return (size > offset) && (size <= (MAX_ROM_SIZE + 512));
+}
+
+void RomLibrary::HashEntry(Entry& entry)
+{
+    std::string extension = LowerExtension(entry.path.c_str());
+
+    if (extension == "zip")
+    {
+        entry.valid = HashZipEntry(entry);
+    }
+    else
+    {
+        entry.game_gear = (extension == "gg");
+        entry.sg1000 = (extension == "sg" || extension == "mv");
+
+        u64 offset = 0;
+        FILE* file = NULL;
+
+        if (ROMImageOffset(entry.size, offset))
+            file = fopen(entry.path.c_str(), "rb");
+
+        if (IsValidPointer(file))
+        {
+            u8 buffer[0x10000];
+            u64 remaining = entry.size - offset;
+            u32 crc = 0;
+
+            if (fseek(file, static_cast<long>(offset), SEEK_SET) == 0)
+            {
+                while (remaining > 0)
+                {
+                    size_t chunk = static_cast<size_t>(std::min(remaining, static_cast<u64>(sizeof(buffer))));
+
+                    if (fread(buffer, 1, chunk, file) != chunk)
+                        break;
+
+                    crc = CalculateCRC32(crc, buffer, static_cast<int>(chunk));
+                    remaining -= chunk;
+                }
+            }
+
+            fclose(file);
+
+            entry.valid = (remaining == 0);
+            entry.crc = crc;
+            entry.rom_size = static_cast<int>(entry.size - offset);
+        }
+    }
+
+    if (entry.valid)
+    {
+        entry.db = Cartridge::FindDBEntry(entry.crc);
+
+        if (IsValidPointer(entry.db) && (entry.db->mapper == GS_DB_SG1000_MAPPER))
+            entry.sg1000 = true;
+    }
+}
+
+// The central directory already has the CRC of every entry, so archives are
+// only inflated when the ROM inside has a header to skip
+bool RomLibrary::HashZipEntry(Entry& entry)
+{
+    mz_zip_archive zip_archive;
+    memset(&zip_archive, 0, sizeof (zip_archive));
+
+    if (!mz_zip_reader_init_file(&zip_archive, entry.path.c_str(), 0))
+        return false;
+
+    bool ok = false;
+
+    for (unsigned int i = 0; i < mz_zip_reader_get_num_files(&zip_archive); i++)
+    {
+        mz_zip_archive_file_stat file_stat;
+
+        if (!mz_zip_reader_file_stat(&zip_archive, i, &file_stat))
+            break;
+
+        std::string extension = LowerExtension(file_stat.m_filename);
+
+        if (!IsROMExtension(extension))
+            continue;
+
+        entry.game_gear = (extension == "gg");
+        entry.sg1000 = (extension == "sg" || extension == "mv");
+
+        u64 offset = 0;
+
+        if (!ROMImageOffset(file_stat.m_uncomp_size, offset))
+            break;
+
+        entry.rom_size = static_cast<int>(file_stat.m_uncomp_size - offset);
+
+        if (offset == 0)
+        {
+            entry.crc = file_stat.m_crc32;
+            ok = true;
+        }
+        else
+        {
+            std::vector<u8> data(static_cast<size_t>(file_stat.m_uncomp_size));
+
+            if (mz_zip_reader_extract_to_mem(&zip_archive, i, &data[0], data.size(), 0))
+            {
+                entry.crc = CalculateCRC32(0, &data[offset], entry.rom_size);
+                ok = true;
+            }
+        }
+
+        break;
+    }
+
+    mz_zip_reader_end(&zip_archive);
+
+    return ok;
+}
+
+bool RomLibrary::ListFiles(const std::string& dir, bool recursive, std::vector<File>& files)
+{
+#if defined(_WIN32)
+    WIN32_FIND_DATAA find_data;
+    HANDLE handle = FindFirstFileA((dir + "/*").c_str(), &find_data);
+
+    if (handle == INVALID_HANDLE_VALUE)
+        return false;
+
+    do
+    {
+        std::string name(find_data.cFileName);
+
+        if ((name == ".") || (name == ".."))
+            continue;
+
+        std::string path = dir + "/" + name;
+
+        if (find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY)
+        {
+            if (recursive)
+                ListFiles(path, recursive, files);
+        }
+        else if (IsROMFile(name.c_str()))
+        {
+            File file;
+            file.path = path;
+            file.size = (static_cast<u64>(find_data.nFileSizeHigh) << 32) | find_data.nFileSizeLow;
+            file.mtime = static_cast<s64>((static_cast<u64>(find_data.ftLastWriteTime.dwHighDateTime) << 32) | find_data.ftLastWriteTime.dwLowDateTime);
+            files.push_back(file);
+        }
+    }
+    while (FindNextFileA(handle, &find_data));
+
+    FindClose(handle);
+#else
+    DIR* handle = opendir(dir.c_str());
+
+    if (!IsValidPointer(handle))
+        return false;
+
+    struct dirent* dir_entry;
+
+    while ((dir_entry = readdir(handle)) != NULL)
+    {
+        std::string name(dir_entry->d_name);
+
+        if ((name == ".") || (name == ".."))
+            continue;
+
+        std::string path = dir + "/" + name;
+        struct stat st;
+
+        if (stat(path.c_str(), &st) != 0)
+            continue;
+
+        if (S_ISDIR(st.st_mode))
+        {
+            if (recursive)
+                ListFiles(path, recursive, files);
+        }
+        else if (S_ISREG(st.st_mode) && IsROMFile(name.c_str()))
+        {
+            File file;
+            file.path = path;
+            file.size = static_cast<u64>(st.st_size);
+#if defined(__APPLE__)
+            file.mtime = static_cast<s64>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#elif defined(__linux__)
+            file.mtime = static_cast<s64>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#else
+            file.mtime = static_cast<s64>(st.st_mtime) * 1000000000;
+#endif
+            files.push_back(file);
+        }
+    }
+
+    closedir(handle);
+#endif
+
+    return true;
+}
+
+static bool WriteValue(FILE* file, const void* data, size_t size)
+{
+    return fwrite(data, 1, size, file) == size;
+}
+
+static bool ReadValue(FILE* file, void* data, size_t size)
+{
+    return fread(data, 1, size, file) == size;
+}
+
+// Native endian, like save states. The database fields are looked up again
+// on load, so a newer game_db.h applies without rehashing.
+bool RomLibrary::SaveCache(const char* path)
+{
+    std::string temp = std::string(path) + ".tmp";
+    FILE* file = fopen(temp.c_str(), "wb");
+
+    if (!IsValidPointer(file))
+    {
+        Log("RomLibrary: unable to write %s", temp.c_str());
+        return false;
+    }
+
+    u32 header[3] = { GS_LIBRARY_CACHE_MAGIC, GS_LIBRARY_CACHE_VERSION, static_cast<u32>(m_Entries.size()) };
+    bool ok = WriteValue(file, header, sizeof(header));
+
+    for (size_t i = 0; ok && (i < m_Entries.size()); i++)
+    {
+        const Entry& entry = m_Entries[i];
+        u32 length = static_cast<u32>(entry.path.size());
+        s32 rom_size = entry.rom_size;
+        u8 flags = (entry.valid ? 0x01 : 0) | (entry.game_gear ? 0x02 : 0) | (entry.sg1000 ? 0x04 : 0);
+
+        ok = WriteValue(file, &length, sizeof(length)) && WriteValue(file, entry.path.data(), length) &&
+             WriteValue(file, &entry.size, sizeof(entry.size)) && WriteValue(file, &entry.mtime, sizeof(entry.mtime)) &&
+             WriteValue(file, &entry.crc, sizeof(entry.crc)) && WriteValue(file, &rom_size, sizeof(rom_size)) &&
+             WriteValue(file, &flags, sizeof(flags));
+    }
+
+    ok = (fclose(file) == 0) && ok;
+
+#if defined(_WIN32)
+    if (ok)
+        remove(path);
+#endif
+
+    if (!ok || (rename(temp.c_str(), path) != 0))
+    {
+        Log("RomLibrary: unable to write %s", path);
+        remove(temp.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+bool RomLibrary::LoadCache(const char* path)
+{
+    m_Entries.clear();
+    m_Index.clear();
+
+    FILE* file = fopen(path, "rb");
+
+    if (!IsValidPointer(file))
+        return false;
+
+    u32 header[3];
+    bool ok = ReadValue(file, header, sizeof(header)) && (header[0] == GS_LIBRARY_CACHE_MAGIC) && (header[1] == GS_LIBRARY_CACHE_VERSION);
+
+    for (u32 i = 0; ok && (i < header[2]); i++)
+    {
+        Entry entry;
+        u32 length = 0;
+        s32 rom_size = 0;
+        u8 flags = 0;
+
+        ok = ReadValue(file, &length, sizeof(length)) && (length > 0) && (length < 0x10000);
+
+        if (ok)
+        {
+            entry.path.resize(length);
+            ok = ReadValue(file, &entry.path[0], length) &&
+                 ReadValue(file, &entry.size, sizeof(entry.size)) && ReadValue(file, &entry.mtime, sizeof(entry.mtime)) &&
+                 ReadValue(file, &entry.crc, sizeof(entry.crc)) && ReadValue(file, &rom_size, sizeof(rom_size)) &&
+                 ReadValue(file, &flags, sizeof(flags));
+        }
+
+        if (ok)
+        {
+            entry.rom_size = rom_size;
+            entry.valid = (flags & 0x01) != 0;
+            entry.game_gear = (flags & 0x02) != 0;
+            entry.sg1000 = (flags & 0x04) != 0;
+            entry.db = entry.valid ? Cartridge::FindDBEntry(entry.crc) : NULL;
+            m_Entries.push_back(entry);
+        }
+    }
+
+    fclose(file);
+
+    if (!ok)
+    {
+        Log("RomLibrary: invalid cache %s", path);
+        m_Entries.clear();
+        return false;
+    }
+
+    std::sort(m_Entries.begin(), m_Entries.end(), CompareEntries);
+
+    for (size_t i = 0; i < m_Entries.size(); i++)
+        m_Index[m_Entries[i].path] = static_cast<int>(i);
+
+    return true;
+}
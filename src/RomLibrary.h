@@ -0,0 +1,98 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef ROMLIBRARY_H
+#define	ROMLIBRARY_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include "definitions.h"
+#include "game_db.h"
+#include "BatchScheduler.h"
+
+#define GS_LIBRARY_CACHE_MAGIC 0x424C5347
+#define GS_LIBRARY_CACHE_VERSION 1
+
+// Indexes directories of ROM files by CRC. Files are hashed in parallel and
+// the results are kept in a cache keyed by (path, size, mtime), so a rescan
+// only reads the files that changed.
+class RomLibrary
+{
+public:
+    struct Entry
+    {
+        std::string path;
+        u64 size;
+        s64 mtime;
+        u32 crc;
+        int rom_size;
+        bool game_gear;
+        bool sg1000;
+        bool valid;
+        const GS_GameDBEntry* db;
+    };
+
+    struct Stats
+    {
+        int files;
+        int hashed;
+        int cached;
+        int removed;
+        int failed;
+        u64 bytes;
+        double seconds;
+    };
+
+public:
+    RomLibrary();
+    ~RomLibrary();
+    void Init(int threads = 0);
+    bool LoadCache(const char* path);
+    bool SaveCache(const char* path);
+    bool Scan(const char* root, bool recursive = true);
+    int GetEntryCount() const;
+    const Entry& GetEntry(int index) const;
+    const Entry* FindEntry(const char* path) const;
+    const Stats& GetStats() const;
+    static bool IsROMFile(const char* path);
+
+private:
+    struct File
+    {
+        std::string path;
+        u64 size;
+        s64 mtime;
+    };
+
+private:
+    static void HashTask(int index, void* userdata);
+    static bool ListFiles(const std::string& dir, bool recursive, std::vector<File>& files);
+    static void HashEntry(Entry& entry);
+    static bool HashZipEntry(Entry& entry);
+
+private:
+    BatchScheduler m_Scheduler;
+    std::vector<Entry> m_Entries;
+    std::map<std::string, int> m_Index;
+    std::vector<Entry> m_Pending;
+    Stats m_Stats;
+};
+
+#endif	/* ROMLIBRARY_H */
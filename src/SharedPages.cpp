@@ -0,0 +1,139 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include "SharedPages.h"
+
+SharedPages::SharedPages()
+{
+    InitPointer(m_pData);
+    m_iSize = 0;
+    m_iPageCount = 0;
+    m_iSharedCount = 0;
+    InitPointer(m_pBlocks);
+    InitPointer(m_pReadPages);
+}
+
+SharedPages::~SharedPages()
+{
+    for (int i = 0; i < m_iPageCount; i++)
+    {
+        if (IsValidPointer(m_pBlocks[i]))
+            ReleaseBlock(m_pBlocks[i]);
+    }
+
+    SafeDeleteArray(m_pBlocks);
+    SafeDeleteArray(m_pReadPages);
+}
+
+void SharedPages::Init(u8* data, size_t size)
+{
+    m_pData = data;
+    m_iSize = size;
+    m_iPageCount = static_cast<int>((size + GS_SHARED_PAGE_SIZE - 1) >> GS_SHARED_PAGE_SHIFT);
+    m_iSharedCount = 0;
+    m_pBlocks = new stBlock*[m_iPageCount];
+    m_pReadPages = new const u8*[m_iPageCount];
+
+    for (int i = 0; i < m_iPageCount; i++)
+    {
+        InitPointer(m_pBlocks[i]);
+        m_pReadPages[i] = m_pData + (static_cast<size_t>(i) << GS_SHARED_PAGE_SHIFT);
+    }
+}
+
+// Pages the owner wrote since it shared them are still in its array, those
+// are released without a copy
+bool SharedPages::Own(int page)
+{
+    stBlock* block = m_pBlocks[page];
+
+    if (!IsValidPointer(block))
+        return false;
+
+    u8* data = m_pData + (static_cast<size_t>(page) << GS_SHARED_PAGE_SHIFT);
+    bool moved = (m_pReadPages[page] != data);
+
+    if (moved)
+    {
+        memcpy(data, block->data, GetPageSize(page));
+        m_pReadPages[page] = data;
+    }
+
+    InitPointer(m_pBlocks[page]);
+    m_iSharedCount--;
+    ReleaseBlock(block);
+
+    return moved;
+}
+
+bool SharedPages::OwnAll()
+{
+    bool moved = false;
+
+    for (int i = 0; (i < m_iPageCount) && (m_iSharedCount > 0); i++)
+        moved |= Own(i);
+
+    return moved;
+}
+
+// Pages shared before are not copied again, so sharing the same source many
+// times only costs a reference per page
+void SharedPages::Share(SharedPages& target)
+{
+    if ((&target == this) || (target.m_iSize != m_iSize))
+        return;
+
+    for (int i = 0; i < m_iPageCount; i++)
+    {
+        stBlock* block = m_pBlocks[i];
+
+        if (!IsValidPointer(block))
+        {
+            block = new stBlock();
+            block->references = 1;
+            memcpy(block->data, m_pReadPages[i], GetPageSize(i));
+            m_pBlocks[i] = block;
+            m_iSharedCount++;
+        }
+
+        if (target.m_pBlocks[i] == block)
+            continue;
+
+        if (IsValidPointer(target.m_pBlocks[i]))
+            ReleaseBlock(target.m_pBlocks[i]);
+        else
+            target.m_iSharedCount++;
+
+        block->references++;
+        target.m_pBlocks[i] = block;
+        target.m_pReadPages[i] = block->data;
+    }
+}
+
+void SharedPages::ReleaseBlock(stBlock* block)
+{
+    if (--block->references == 0)
+        delete block;
+}
+
+size_t SharedPages::GetPageSize(int page) const
+{
+    size_t offset = static_cast<size_t>(page) << GS_SHARED_PAGE_SHIFT;
+    return ((m_iSize - offset) < GS_SHARED_PAGE_SIZE) ? (m_iSize - offset) : GS_SHARED_PAGE_SIZE;
+}
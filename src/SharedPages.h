@@ -0,0 +1,101 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef SHAREDPAGES_H
+#define	SHAREDPAGES_H
+
+#include <atomic>
+#include "definitions.h"
+
+#define GS_SHARED_PAGE_SHIFT 10
+#define GS_SHARED_PAGE_SIZE (1 << GS_SHARED_PAGE_SHIFT)
+#define GS_SHARED_PAGE_MASK (GS_SHARED_PAGE_SIZE - 1)
+
+// Copy on write for the arrays forked cores share, in pages as large as the
+// mapper ones. Sharing freezes the pages of the source into refcounted
+// blocks. The target reads those blocks until it writes a page, which is
+// then copied back into its own array. Writers call Own first, and a true
+// result means the page moved, so cached page pointers must be rebuilt.
+class SharedPages
+{
+public:
+    SharedPages();
+    ~SharedPages();
+    void Init(u8* data, size_t size);
+    u8* GetData() const;
+    size_t GetSize() const;
+    bool IsShared() const;
+    bool IsShared(int page) const;
+    const u8* GetPage(int page) const;
+    u8 Read(u32 address) const;
+    bool Own(int page);
+    bool OwnAll();
+    void Share(SharedPages& target);
+
+private:
+    struct stBlock
+    {
+        std::atomic<int> references;
+        u8 data[GS_SHARED_PAGE_SIZE];
+    };
+
+private:
+    static void ReleaseBlock(stBlock* block);
+    size_t GetPageSize(int page) const;
+
+private:
+    u8* m_pData;
+    size_t m_iSize;
+    int m_iPageCount;
+    int m_iSharedCount;
+    stBlock** m_pBlocks;
+    const u8** m_pReadPages;
+};
+
+inline u8* SharedPages::GetData() const
+{
+    return m_pData;
+}
+
+inline size_t SharedPages::GetSize() const
+{
+    return m_iSize;
+}
+
+inline bool SharedPages::IsShared() const
+{
+    return m_iSharedCount > 0;
+}
+
+inline bool SharedPages::IsShared(int page) const
+{
+    return (m_iSharedCount > 0) && IsValidPointer(m_pBlocks[page]);
+}
+
+inline const u8* SharedPages::GetPage(int page) const
+{
+    return m_pReadPages[page];
+}
+
+inline u8 SharedPages::Read(u32 address) const
+{
+    return m_pReadPages[address >> GS_SHARED_PAGE_SHIFT][address & GS_SHARED_PAGE_MASK];
+}
+
+#endif	/* SHAREDPAGES_H */
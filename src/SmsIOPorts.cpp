@@ -39,16 +39,12 @@ void SmsIOPorts::Reset()
     m_Port3F = 0xFF;
 }
 
-void SmsIOPorts::SaveState(std::ostream& stream)
+void SmsIOPorts::SaveState(StateWriter& writer)
 {
-    using namespace std;
-
-    stream.write(reinterpret_cast<const char*> (&m_Port3F), sizeof(m_Port3F));
+    writer.Write(&m_Port3F, sizeof(m_Port3F));
 }
 
-void SmsIOPorts::LoadState(std::istream& stream)
+void SmsIOPorts::LoadState(StateReader& reader)
 {
-    using namespace std;
-
-    stream.read(reinterpret_cast<char*> (&m_Port3F), sizeof(m_Port3F));
+    reader.Read(&m_Port3F, sizeof(m_Port3F));
 }
@@ -37,8 +37,8 @@ public:
     void Reset();
     u8 DoInput(u8 port);
     void DoOutput(u8 port, u8 value);
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream);
+    void SaveState(StateWriter& writer);
+    void LoadState(StateReader& reader);
 
 private:
     Audio* m_pAudio;
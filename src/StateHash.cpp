@@ -0,0 +1,270 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#include "StateHash.h"
+
+// xxHash64, the 128 bit hash runs it with two seeds
+#define HASH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define HASH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define HASH_PRIME64_3 0x165667B19E3779F9ULL
+#define HASH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define HASH_PRIME64_5 0x27D4EB2F165667C5ULL
+#define HASH_HIGH_SEED 0x9E3779B97F4A7C15ULL
+
+static inline u64 HashRotate(u64 value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline u64 HashRead64(const u8* data)
+{
+    u64 value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static inline u32 HashRead32(const u8* data)
+{
+    u32 value;
+    memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+static inline u64 HashRound(u64 acc, u64 input)
+{
+    acc += input * HASH_PRIME64_2;
+    acc = HashRotate(acc, 31);
+    return acc * HASH_PRIME64_1;
+}
+
+static inline u64 HashMerge(u64 acc, u64 value)
+{
+    acc ^= HashRound(0, value);
+    return (acc * HASH_PRIME64_1) + HASH_PRIME64_4;
+}
+
+StateHasher::StateHasher()
+{
+    InitPointer(m_pStream);
+    m_iStreamSize = 0;
+    m_iStreamCapacity = 0;
+    m_iRegionCount = 0;
+}
+
+StateHasher::~StateHasher()
+{
+    for (int i = 0; i < m_iRegionCount; i++)
+        SafeDeleteArray(m_Regions[i].pages);
+
+    SafeDeleteArray(m_pStream);
+}
+
+void StateHasher::Invalidate()
+{
+    for (int i = 0; i < m_iRegionCount; i++)
+        m_Regions[i].valid = false;
+}
+
+void StateHasher::Begin()
+{
+    m_iStreamSize = 0;
+
+    for (int i = 0; i < m_iRegionCount; i++)
+        m_Regions[i].used = false;
+}
+
+void StateHasher::Update(const void* data, size_t size)
+{
+    Append(data, size);
+}
+
+// Hash pages are smaller than shared pages, each one is read from the array
+// or from the block a fork shares
+void StateHasher::UpdatePages(const SharedPages& pages, size_t size, u8* dirty)
+{
+    stRegion* region = GetRegion(pages.GetData(), size);
+
+    if (!IsValidPointer(region))
+    {
+        for (size_t offset = 0; offset < size; offset += GS_SHARED_PAGE_SIZE)
+        {
+            size_t length = ((size - offset) < GS_SHARED_PAGE_SIZE) ? (size - offset) : GS_SHARED_PAGE_SIZE;
+            Append(pages.GetPage(static_cast<int>(offset >> GS_SHARED_PAGE_SHIFT)), length);
+        }
+        return;
+    }
+
+    int page_count = static_cast<int>((size + GS_STATE_HASH_PAGE_SIZE - 1) >> GS_STATE_HASH_PAGE_SHIFT);
+
+    for (int i = 0; i < page_count; i++)
+    {
+        if (region->valid && IsValidPointer(dirty) && !dirty[i])
+            continue;
+
+        size_t offset = static_cast<size_t>(i) << GS_STATE_HASH_PAGE_SHIFT;
+        size_t length = ((size - offset) < GS_STATE_HASH_PAGE_SIZE) ? (size - offset) : GS_STATE_HASH_PAGE_SIZE;
+        const u8* data = pages.GetPage(static_cast<int>(offset >> GS_SHARED_PAGE_SHIFT)) + (offset & GS_SHARED_PAGE_MASK);
+
+        Hash128(data, length, region->pages[i]);
+
+        if (IsValidPointer(dirty))
+            dirty[i] = 0;
+    }
+
+    region->valid = true;
+    region->used = true;
+
+    Append(region->pages, sizeof(GS_StateHash) * page_count);
+}
+
+void StateHasher::End(GS_StateHash& hash)
+{
+    Hash128(m_pStream, m_iStreamSize, hash);
+
+    // Regions missing from this pass belong to arrays that are gone, like
+    // the RAM of a mapper no longer in use
+    int count = 0;
+
+    for (int i = 0; i < m_iRegionCount; i++)
+    {
+        if (m_Regions[i].used)
+            m_Regions[count++] = m_Regions[i];
+        else
+            SafeDeleteArray(m_Regions[i].pages);
+    }
+
+    m_iRegionCount = count;
+}
+
+u64 StateHasher::Hash64(const void* data, size_t size, u64 seed)
+{
+    const u8* p = static_cast<const u8*>(data);
+    const u8* end = p + size;
+    u64 hash;
+
+    if (size >= 32)
+    {
+        const u8* limit = end - 32;
+        u64 v1 = seed + HASH_PRIME64_1 + HASH_PRIME64_2;
+        u64 v2 = seed + HASH_PRIME64_2;
+        u64 v3 = seed;
+        u64 v4 = seed - HASH_PRIME64_1;
+
+        do
+        {
+            v1 = HashRound(v1, HashRead64(p));
+            v2 = HashRound(v2, HashRead64(p + 8));
+            v3 = HashRound(v3, HashRead64(p + 16));
+            v4 = HashRound(v4, HashRead64(p + 24));
+            p += 32;
+        }
+        while (p <= limit);
+
+        hash = HashRotate(v1, 1) + HashRotate(v2, 7) + HashRotate(v3, 12) + HashRotate(v4, 18);
+        hash = HashMerge(hash, v1);
+        hash = HashMerge(hash, v2);
+        hash = HashMerge(hash, v3);
+        hash = HashMerge(hash, v4);
+    }
+    else
+    {
+        hash = seed + HASH_PRIME64_5;
+    }
+
+    hash += static_cast<u64>(size);
+
+    while (p + 8 <= end)
+    {
+        hash ^= HashRound(0, HashRead64(p));
+        hash = (HashRotate(hash, 27) * HASH_PRIME64_1) + HASH_PRIME64_4;
+        p += 8;
+    }
+
+    if (p + 4 <= end)
+    {
+        hash ^= static_cast<u64>(HashRead32(p)) * HASH_PRIME64_1;
+        hash = (HashRotate(hash, 23) * HASH_PRIME64_2) + HASH_PRIME64_3;
+        p += 4;
+    }
+
+    while (p < end)
+    {
+        hash ^= (*p) * HASH_PRIME64_5;
+        hash = HashRotate(hash, 11) * HASH_PRIME64_1;
+        p++;
+    }
+
+    hash ^= hash >> 33;
+    hash *= HASH_PRIME64_2;
+    hash ^= hash >> 29;
+    hash *= HASH_PRIME64_3;
+    hash ^= hash >> 32;
+
+    return hash;
+}
+
+void StateHasher::Hash128(const void* data, size_t size, GS_StateHash& hash)
+{
+    hash.low = Hash64(data, size, 0);
+    hash.high = Hash64(data, size, HASH_HIGH_SEED);
+}
+
+StateHasher::stRegion* StateHasher::GetRegion(const u8* data, size_t size)
+{
+    for (int i = 0; i < m_iRegionCount; i++)
+    {
+        if ((m_Regions[i].data == data) && (m_Regions[i].size == size))
+            return &m_Regions[i];
+    }
+
+    if (m_iRegionCount == GS_STATE_HASH_MAX_REGIONS)
+        return NULL;
+
+    stRegion* region = &m_Regions[m_iRegionCount++];
+    region->data = data;
+    region->size = size;
+    region->pages = new GS_StateHash[(size + GS_STATE_HASH_PAGE_SIZE - 1) >> GS_STATE_HASH_PAGE_SHIFT];
+    region->valid = false;
+    region->used = false;
+
+    return region;
+}
+
+void StateHasher::Append(const void* data, size_t size)
+{
+    if (m_iStreamSize + size > m_iStreamCapacity)
+    {
+        size_t capacity = (m_iStreamCapacity > 0) ? m_iStreamCapacity : 0x4000;
+
+        while (capacity < m_iStreamSize + size)
+            capacity *= 2;
+
+        u8* stream = new u8[capacity];
+
+        if (m_iStreamSize > 0)
+            memcpy(stream, m_pStream, m_iStreamSize);
+
+        SafeDeleteArray(m_pStream);
+        m_pStream = stream;
+        m_iStreamCapacity = capacity;
+    }
+
+    memcpy(m_pStream + m_iStreamSize, data, size);
+    m_iStreamSize += size;
+}
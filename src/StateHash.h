@@ -0,0 +1,68 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef STATEHASH_H
+#define	STATEHASH_H
+
+#include "definitions.h"
+#include "SharedPages.h"
+
+#define GS_STATE_HASH_PAGE_SHIFT 8
+#define GS_STATE_HASH_PAGE_SIZE (1 << GS_STATE_HASH_PAGE_SHIFT)
+#define GS_STATE_HASH_MAX_REGIONS 8
+
+// Hashes the stream a StateWriter produces. Large arrays are hashed in
+// pages and only pages flagged in their dirty map are hashed again, the
+// cached page digests take their place in the stream.
+class StateHasher
+{
+public:
+    StateHasher();
+    ~StateHasher();
+    void Invalidate();
+    void Begin();
+    void Update(const void* data, size_t size);
+    void UpdatePages(const SharedPages& pages, size_t size, u8* dirty);
+    void End(GS_StateHash& hash);
+    static u64 Hash64(const void* data, size_t size, u64 seed);
+    static void Hash128(const void* data, size_t size, GS_StateHash& hash);
+
+private:
+    struct stRegion
+    {
+        const u8* data;
+        size_t size;
+        GS_StateHash* pages;
+        bool valid;
+        bool used;
+    };
+
+private:
+    stRegion* GetRegion(const u8* data, size_t size);
+    void Append(const void* data, size_t size);
+
+private:
+    u8* m_pStream;
+    size_t m_iStreamSize;
+    size_t m_iStreamCapacity;
+    stRegion m_Regions[GS_STATE_HASH_MAX_REGIONS];
+    int m_iRegionCount;
+};
+
+#endif	/* STATEHASH_H */
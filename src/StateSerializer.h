@@ -0,0 +1,413 @@
+/*
+ * Gearsystem - Sega Master System / Game Gear Emulator
+ * Copyright (C) 2013  Ignacio Sanchez
+
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * any later version.
+
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see http://www.gnu.org/licenses/
+ *
+ */
+
+#ifndef STATESERIALIZER_H
+#define	STATESERIALIZER_H
+
+#include <stddef.h>
+#include "definitions.h"
+#include "StateHash.h"
+#include "SharedPages.h"
+
+#define GS_STATE_CHUNK_ID(a, b, c, d) ((u32)(a) | ((u32)(b) << 8) | ((u32)(c) << 16) | ((u32)(d) << 24))
+
+#define GS_STATE_CHUNK_CPU GS_STATE_CHUNK_ID('C', 'P', 'U', ' ')
+#define GS_STATE_CHUNK_RAM GS_STATE_CHUNK_ID('R', 'A', 'M', ' ')
+#define GS_STATE_CHUNK_VRAM GS_STATE_CHUNK_ID('V', 'R', 'A', 'M')
+#define GS_STATE_CHUNK_CRAM GS_STATE_CHUNK_ID('C', 'R', 'A', 'M')
+#define GS_STATE_CHUNK_VDP GS_STATE_CHUNK_ID('V', 'D', 'P', ' ')
+#define GS_STATE_CHUNK_PSG GS_STATE_CHUNK_ID('P', 'S', 'G', ' ')
+#define GS_STATE_CHUNK_OPLL GS_STATE_CHUNK_ID('O', 'P', 'L', 'L')
+#define GS_STATE_CHUNK_INPUT GS_STATE_CHUNK_ID('I', 'N', 'P', 'T')
+#define GS_STATE_CHUNK_MAPPER GS_STATE_CHUNK_ID('M', 'A', 'P', 'R')
+#define GS_STATE_CHUNK_IO GS_STATE_CHUNK_ID('I', 'O', ' ', ' ')
+
+#define GS_STATE_CHUNK_VERSION 1
+#define GS_STATE_CHUNK_PSG_VERSION 3
+#define GS_STATE_MAX_CHUNKS 64
+#define GS_STATE_CHUNK_ALIGNMENT 8
+
+// Container layout: a 16 byte header followed by chunks, each one a 16 byte
+// header plus its payload padded to GS_STATE_CHUNK_ALIGNMENT. All fields are
+// native endian, like the component payloads themselves.
+struct GS_StateHeader
+{
+    u32 magic;
+    u16 version;
+    u16 chunk_count;
+    u32 size;
+    u32 rom_crc;
+};
+
+struct GS_StateChunkHeader
+{
+    u32 id;
+    u32 version;
+    u32 size;
+    u32 reserved;
+};
+
+struct GS_StateChunk
+{
+    u32 id;
+    u32 version;
+    u32 size;
+    const u8* data;
+};
+
+class StateWriter
+{
+public:
+    StateWriter(u8* buffer, size_t size);
+    explicit StateWriter(StateHasher* hasher);
+    void Write(const void* data, size_t size);
+    template <typename T> void Write(const T& value);
+    void WritePages(const SharedPages& pages, size_t size, u8* dirty);
+    void SkipPages();
+    void Patch(size_t position, const void* data, size_t size);
+    size_t BeginChunk(u32 id, u32 version);
+    void EndChunk(size_t position);
+    size_t GetSize() const;
+    bool IsOverflow() const;
+
+private:
+    u8* m_pBuffer;
+    StateHasher* m_pHasher;
+    size_t m_iCapacity;
+    size_t m_iPosition;
+    bool m_bOverflow;
+    bool m_bSkipPages;
+};
+
+class StateReader
+{
+public:
+    StateReader(const u8* buffer, size_t size);
+    void Read(void* data, size_t size);
+    template <typename T> void Read(T& value);
+    void Skip(size_t size);
+    void SkipPages();
+    bool IsSkippingPages() const;
+    const u8* GetPointer() const;
+    size_t GetPosition() const;
+    size_t GetRemaining() const;
+    bool IsOverflow() const;
+
+private:
+    const u8* m_pBuffer;
+    size_t m_iSize;
+    size_t m_iPosition;
+    bool m_bOverflow;
+    bool m_bSkipPages;
+};
+
+class StateContainer
+{
+public:
+    StateContainer();
+    static bool IsContainer(const u8* buffer, size_t size);
+    bool Open(const u8* buffer, size_t size);
+    const GS_StateHeader* GetHeader() const;
+    int GetChunkCount() const;
+    const GS_StateChunk* GetChunk(int index) const;
+    const GS_StateChunk* FindChunk(u32 id) const;
+
+private:
+    GS_StateHeader m_Header;
+    GS_StateChunk m_Chunks[GS_STATE_MAX_CHUNKS];
+    int m_iChunkCount;
+};
+
+// A writer without buffer only counts bytes, which is how state sizes are measured
+inline StateWriter::StateWriter(u8* buffer, size_t size)
+{
+    m_pBuffer = buffer;
+    InitPointer(m_pHasher);
+    m_iCapacity = size;
+    m_iPosition = 0;
+    m_bOverflow = false;
+    m_bSkipPages = false;
+}
+
+inline StateWriter::StateWriter(StateHasher* hasher)
+{
+    InitPointer(m_pBuffer);
+    m_pHasher = hasher;
+    m_iCapacity = 0;
+    m_iPosition = 0;
+    m_bOverflow = false;
+    m_bSkipPages = false;
+}
+
+inline void StateWriter::Write(const void* data, size_t size)
+{
+    if (IsValidPointer(m_pBuffer))
+    {
+        if (m_iPosition + size > m_iCapacity)
+        {
+            m_bOverflow = true;
+            return;
+        }
+
+        memcpy(m_pBuffer + m_iPosition, data, size);
+    }
+    else if (IsValidPointer(m_pHasher))
+    {
+        m_pHasher->Update(data, size);
+    }
+
+    m_iPosition += size;
+}
+
+template <typename T>
+inline void StateWriter::Write(const T& value)
+{
+    Write(&value, sizeof(T));
+}
+
+// Arrays with a dirty map of GS_STATE_HASH_PAGE_SIZE pages, so hashing
+// only revisits the pages written since the last hash
+inline void StateWriter::WritePages(const SharedPages& pages, size_t size, u8* dirty)
+{
+    if (m_bSkipPages)
+        return;
+
+    if (IsValidPointer(m_pHasher))
+    {
+        m_pHasher->UpdatePages(pages, size, dirty);
+        m_iPosition += size;
+        return;
+    }
+
+    for (size_t offset = 0; offset < size; offset += GS_SHARED_PAGE_SIZE)
+    {
+        size_t length = ((size - offset) < GS_SHARED_PAGE_SIZE) ? (size - offset) : GS_SHARED_PAGE_SIZE;
+        Write(pages.GetPage(static_cast<int>(offset >> GS_SHARED_PAGE_SHIFT)), length);
+    }
+}
+
+// Leaves the paged arrays out, a fork shares them instead of copying
+inline void StateWriter::SkipPages()
+{
+    m_bSkipPages = true;
+}
+
+inline void StateWriter::Patch(size_t position, const void* data, size_t size)
+{
+    if (IsValidPointer(m_pBuffer) && (position + size <= m_iCapacity))
+        memcpy(m_pBuffer + position, data, size);
+}
+
+inline size_t StateWriter::BeginChunk(u32 id, u32 version)
+{
+    size_t position = m_iPosition;
+
+    GS_StateChunkHeader header;
+    header.id = id;
+    header.version = version;
+    header.size = 0;
+    header.reserved = 0;
+    Write(header);
+
+    return position;
+}
+
+inline void StateWriter::EndChunk(size_t position)
+{
+    u32 size = static_cast<u32>(m_iPosition - position - sizeof(GS_StateChunkHeader));
+    Patch(position + offsetof(GS_StateChunkHeader, size), &size, sizeof(size));
+
+    static const u8 padding[GS_STATE_CHUNK_ALIGNMENT] = { };
+    size_t remainder = m_iPosition % GS_STATE_CHUNK_ALIGNMENT;
+
+    if (remainder != 0)
+        Write(padding, GS_STATE_CHUNK_ALIGNMENT - remainder);
+}
+
+inline size_t StateWriter::GetSize() const
+{
+    return m_iPosition;
+}
+
+inline bool StateWriter::IsOverflow() const
+{
+    return m_bOverflow;
+}
+
+inline StateReader::StateReader(const u8* buffer, size_t size)
+{
+    m_pBuffer = buffer;
+    m_iSize = size;
+    m_iPosition = 0;
+    m_bOverflow = false;
+    m_bSkipPages = false;
+}
+
+inline void StateReader::Read(void* data, size_t size)
+{
+    if (m_iPosition + size > m_iSize)
+    {
+        m_bOverflow = true;
+        m_iPosition = m_iSize;
+        return;
+    }
+
+    memcpy(data, m_pBuffer + m_iPosition, size);
+    m_iPosition += size;
+}
+
+template <typename T>
+inline void StateReader::Read(T& value)
+{
+    Read(&value, sizeof(T));
+}
+
+inline void StateReader::Skip(size_t size)
+{
+    if (m_iPosition + size > m_iSize)
+    {
+        m_bOverflow = true;
+        m_iPosition = m_iSize;
+        return;
+    }
+
+    m_iPosition += size;
+}
+
+// For states written with StateWriter::SkipPages, the loaders leave their
+// paged arrays alone
+inline void StateReader::SkipPages()
+{
+    m_bSkipPages = true;
+}
+
+inline bool StateReader::IsSkippingPages() const
+{
+    return m_bSkipPages;
+}
+
+inline const u8* StateReader::GetPointer() const
+{
+    return m_pBuffer + m_iPosition;
+}
+
+inline size_t StateReader::GetPosition() const
+{
+    return m_iPosition;
+}
+
+inline size_t StateReader::GetRemaining() const
+{
+    return m_iSize - m_iPosition;
+}
+
+inline bool StateReader::IsOverflow() const
+{
+    return m_bOverflow;
+}
+
+inline StateContainer::StateContainer()
+{
+    memset(&m_Header, 0, sizeof(m_Header));
+    m_iChunkCount = 0;
+}
+
+inline bool StateContainer::IsContainer(const u8* buffer, size_t size)
+{
+    if (!IsValidPointer(buffer) || (size < sizeof(GS_StateHeader)))
+        return false;
+
+    u32 magic = 0;
+    memcpy(&magic, buffer, sizeof(magic));
+
+    return magic == GS_SAVESTATE_CONTAINER_MAGIC;
+}
+
+// Indexes the chunks in place, so the buffer may be a mapped file and must
+// outlive the container. Chunk data pointers are never copied.
+inline bool StateContainer::Open(const u8* buffer, size_t size)
+{
+    m_iChunkCount = 0;
+
+    if (!IsContainer(buffer, size))
+        return false;
+
+    memcpy(&m_Header, buffer, sizeof(m_Header));
+
+    if ((m_Header.size != size) || (m_Header.version == 0) || (m_Header.chunk_count > GS_STATE_MAX_CHUNKS))
+        return false;
+
+    size_t position = sizeof(GS_StateHeader);
+
+    for (int i = 0; i < m_Header.chunk_count; i++)
+    {
+        GS_StateChunkHeader chunk_header;
+
+        if (position + sizeof(chunk_header) > size)
+            return false;
+
+        memcpy(&chunk_header, buffer + position, sizeof(chunk_header));
+        position += sizeof(chunk_header);
+
+        if (chunk_header.size > size - position)
+            return false;
+
+        GS_StateChunk& chunk = m_Chunks[m_iChunkCount++];
+        chunk.id = chunk_header.id;
+        chunk.version = chunk_header.version;
+        chunk.size = chunk_header.size;
+        chunk.data = buffer + position;
+
+        position += chunk_header.size;
+        position = (position + GS_STATE_CHUNK_ALIGNMENT - 1) & ~static_cast<size_t>(GS_STATE_CHUNK_ALIGNMENT - 1);
+    }
+
+    return position == size;
+}
+
+inline const GS_StateHeader* StateContainer::GetHeader() const
+{
+    return &m_Header;
+}
+
+inline int StateContainer::GetChunkCount() const
+{
+    return m_iChunkCount;
+}
+
+inline const GS_StateChunk* StateContainer::GetChunk(int index) const
+{
+    if ((index < 0) || (index >= m_iChunkCount))
+        return NULL;
+
+    return &m_Chunks[index];
+}
+
+inline const GS_StateChunk* StateContainer::FindChunk(u32 id) const
+{
+    for (int i = 0; i < m_iChunkCount; i++)
+    {
+        if (m_Chunks[i].id == id)
+            return &m_Chunks[i];
+    }
+
+    return NULL;
+}
+
+#endif	/* STATESERIALIZER_H */
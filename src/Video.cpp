@@ -22,6 +22,62 @@
 #include "Processor.h"
 #include "Cartridge.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define GS_OBSERVATION_SSE2
+#endif
+
+static inline void ObservationAccumulate(u16* sums, const u8* row, int width)
+{
+    int x = 0;
+
+#ifdef GS_OBSERVATION_SSE2
+    const __m128i zero = _mm_setzero_si128();
+
+    for (; x + 16 <= width; x += 16)
+    {
+        __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+        __m128i lo = _mm_loadu_si128(reinterpret_cast<__m128i*>(sums + x));
+        __m128i hi = _mm_loadu_si128(reinterpret_cast<__m128i*>(sums + x + 8));
+        lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(pixels, zero));
+        hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(pixels, zero));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + x), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(sums + x + 8), hi);
+    }
+#endif
+
+    for (; x < width; x++)
+        sums[x] += row[x];
+}
+
+// 2x2 box filter as two rounded averages, so both paths give the same bytes
+static inline void ObservationHalve(u8* dst, const u8* row0, const u8* row1, int dstWidth)
+{
+    int x = 0;
+
+#ifdef GS_OBSERVATION_SSE2
+    const __m128i low_mask = _mm_set1_epi16(0x00FF);
+
+    for (; x + 16 <= dstWidth; x += 16)
+    {
+        __m128i a = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + (x * 2))),
+                                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + (x * 2))));
+        __m128i b = _mm_avg_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + (x * 2) + 16)),
+                                 _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + (x * 2) + 16)));
+        a = _mm_avg_epu16(_mm_and_si128(a, low_mask), _mm_srli_epi16(a, 8));
+        b = _mm_avg_epu16(_mm_and_si128(b, low_mask), _mm_srli_epi16(b, 8));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x), _mm_packus_epi16(a, b));
+    }
+#endif
+
+    for (; x < dstWidth; x++)
+    {
+        int left = (row0[x * 2] + row1[x * 2] + 1) >> 1;
+        int right = (row0[(x * 2) + 1] + row1[(x * 2) + 1] + 1) >> 1;
+        dst[x] = (left + right + 1) >> 1;
+    }
+}
+
 Video::Video(Memory* pMemory, Processor* pProcessor, Cartridge* pCartridge)
 {
     m_pMemory = pMemory;
@@ -31,6 +87,7 @@ Video::Video(Memory* pMemory, Processor* pProcessor, Cartridge* pCartridge)
     InitPointer(m_pFrameBuffer);
     InitPointer(m_pVdpVRAM);
     InitPointer(m_pVdpCRAM);
+    memset(m_VRAMDirtyPages, 1, sizeof(m_VRAMDirtyPages));
     m_bFirstByteInSequence = false;
     for (int i = 0; i < 16; i++)
         m_VdpRegister[i] = 0;
@@ -47,6 +104,8 @@ Video::Video(Memory* pMemory, Processor* pProcessor, Cartridge* pCartridge)
     m_bGameGear = false;
     m_iLinesPerFrame = 0;
     m_bPAL = false;
+    // Saved as a whole, padding included
+    memset(&m_Phaser, 0, sizeof(m_Phaser));
     m_Phaser.x = 0;
     m_Phaser.y = 0;
     m_Phaser.enabled = false;
@@ -83,7 +142,9 @@ void Video::Init()
 {
     m_pFrameBuffer = new u16[GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN * GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN];
     m_pInfoBuffer = new u8[GS_RESOLUTION_MAX_WIDTH * GS_LINES_PER_FRAME_PAL];
+    m_InfoPages.Init(m_pInfoBuffer, GS_RESOLUTION_MAX_WIDTH * GS_LINES_PER_FRAME_PAL);
     m_pVdpVRAM = new u8[0x4000];
+    m_VRAMPages.Init(m_pVdpVRAM, 0x4000);
     m_pVdpCRAM = new u8[0x40];
     InitPalettes(kSG1000_palette_888_normal,
         m_SG1000_palette_565_rgb_normal,
@@ -95,6 +156,7 @@ void Video::Init()
         m_SG1000_palette_555_rgb_sms,
         m_SG1000_palette_565_bgr_sms,
         m_SG1000_palette_555_bgr_sms);
+    InitObservationTables();
     Reset(false, false);
 }
 
@@ -116,6 +178,9 @@ void Video::Reset(bool bGameGear, bool bPAL)
 
     for (int i = 0; i < (GS_RESOLUTION_MAX_WIDTH_WITH_OVERSCAN * GS_RESOLUTION_MAX_HEIGHT_WITH_OVERSCAN); i++)
         m_pFrameBuffer[i] = 0;
+    m_InfoPages.OwnAll();
+    m_VRAMPages.OwnAll();
+
     for (int i = 0; i < (GS_RESOLUTION_MAX_WIDTH * GS_LINES_PER_FRAME_PAL); i++)
         m_pInfoBuffer[i] = 0;
     for (int i = 0; i < 0x4000; i++)
@@ -384,7 +449,10 @@ u8 Video::GetDataPort()
 {
     m_bFirstByteInSequence = true;
     u8 ret = m_VdpBuffer;
-    m_VdpBuffer = m_pVdpVRAM[m_VdpAddress];
+#ifndef GEARSYSTEM_DISABLE_DISASSEMBLER
+    m_pMemory->GetCodeDataLogger()->VRAMRead(m_VdpAddress);
+#endif
+    m_VdpBuffer = ReadVRAM(m_VdpAddress);
     m_VdpAddress = (m_VdpAddress + 1) & 0x3FFF;
     return ret;
 }
@@ -414,9 +482,19 @@ void Video::WriteData(u8 data)
     m_VdpBuffer = data;
 
     if (m_VdpCode == 0x03)
+    {
         m_pVdpCRAM[m_VdpAddress & (m_bGameGear ? 0x3F : 0x1F)] = data;
+    }
     else
+    {
+#ifndef GEARSYSTEM_DISABLE_DISASSEMBLER
+        m_pMemory->GetCodeDataLogger()->VRAMWrite(m_VdpAddress);
+#endif
+        if (m_VRAMPages.IsShared(m_VdpAddress >> GS_SHARED_PAGE_SHIFT))
+            m_VRAMPages.Own(m_VdpAddress >> GS_SHARED_PAGE_SHIFT);
         m_pVdpVRAM[m_VdpAddress] = data;
+        m_VRAMDirtyPages[m_VdpAddress >> GS_STATE_HASH_PAGE_SHIFT] = 1;
+    }
 
     m_VdpAddress = (m_VdpAddress + 1) & 0x3FFF;
 }
@@ -439,7 +517,10 @@ void Video::WriteControl(u8 data)
         {
             case 0x00:
             {
-                m_VdpBuffer = m_pVdpVRAM[m_VdpAddress];
+#ifndef GEARSYSTEM_DISABLE_DISASSEMBLER
+                m_pMemory->GetCodeDataLogger()->VRAMRead(m_VdpAddress);
+#endif
+                m_VdpBuffer = ReadVRAM(m_VdpAddress);
                 m_VdpAddress = (m_VdpAddress + 1) & 0x3FFF;
                 break;
             }
@@ -470,6 +551,12 @@ void Video::ScanLine(int line)
     int next_line = line + 1;
     next_line %= m_iLinesPerFrame;
 
+    if (m_InfoPages.IsShared())
+    {
+        OwnInfoLine(line);
+        OwnInfoLine(next_line);
+    }
+
     if (!m_bTMS9918)
     {
         ParseSpritesSMSGG(next_line);
@@ -515,6 +602,17 @@ void Video::ScanLine(int line)
     }
 }
 
+// A line only touches its own part of the info buffer, which starts at the
+// narrower SMS/GG stride and ends before the next full width line
+void Video::OwnInfoLine(int line)
+{
+    int first = (line * (m_iScreenWidth - m_iHideLeftBarOffset)) >> GS_SHARED_PAGE_SHIFT;
+    int last = (((line + 1) * m_iScreenWidth) - 1) >> GS_SHARED_PAGE_SHIFT;
+
+    for (int page = first; page <= last; page++)
+        m_InfoPages.Own(page);
+}
+
 void Video::RenderBackgroundSMSGG(int line)
 {
     int y_offset = m_bExtendedMode224 ? GS_RESOLUTION_GG_Y_OFFSET_EXTENDED : GS_RESOLUTION_GG_Y_OFFSET;
@@ -574,8 +672,8 @@ void Video::RenderBackgroundSMSGG(int line)
                 int tile_x_offset = map_x & 7;
 
                 int tile_addr = map_address + (((tile_y << 5) + tile_x) << 1);
-                int tile_index = m_pVdpVRAM[tile_addr];
-                int tile_info = m_pVdpVRAM[tile_addr + 1];
+                int tile_index = ReadVRAM(tile_addr);
+                int tile_info = ReadVRAM(tile_addr + 1);
                 if (IsSetBit(tile_info, 0))
                     tile_index = (tile_index | 0x0100) & 0x1FF;
 
@@ -591,10 +689,10 @@ void Video::RenderBackgroundSMSGG(int line)
                 if (hflip)
                     tile_pixel_x = tile_x_offset;
 
-                palette_color = ((m_pVdpVRAM[tile_data_addr] >> tile_pixel_x) & 0x01) +
-                        (((m_pVdpVRAM[tile_data_addr + 1] >> tile_pixel_x) & 0x01) << 1) +
-                        (((m_pVdpVRAM[tile_data_addr + 2] >> tile_pixel_x) & 0x01) << 2) +
-                        (((m_pVdpVRAM[tile_data_addr + 3] >> tile_pixel_x) & 0x01) << 3) +
+                palette_color = ((ReadVRAM(tile_data_addr) >> tile_pixel_x) & 0x01) +
+                        (((ReadVRAM(tile_data_addr + 1) >> tile_pixel_x) & 0x01) << 1) +
+                        (((ReadVRAM(tile_data_addr + 2) >> tile_pixel_x) & 0x01) << 2) +
+                        (((ReadVRAM(tile_data_addr + 3) >> tile_pixel_x) & 0x01) << 3) +
                         palette_offset;
 
                 bool final_priority = priority && ((palette_color - palette_offset) != 0);
@@ -631,12 +729,12 @@ void Video::ParseSpritesSMSGG(int line)
     {
         int sprite_index = sprite_table_address + sprite;
 
-        if (!m_bExtendedMode224 && (m_pVdpVRAM[sprite_index] == 0xD0))
+        if (!m_bExtendedMode224 && (ReadVRAM(sprite_index) == 0xD0))
         {
             break;
         }
 
-        int sprite_y = m_pVdpVRAM[sprite_index] + 1;
+        int sprite_y = ReadVRAM(sprite_index) + 1;
         int sprite_height = IsSetBit(m_VdpRegister[1], 1) ? 16 : 8;
         bool sprite_zoom = IsSetBit(m_VdpRegister[1], 0);
         if (sprite_zoom)
@@ -704,18 +802,18 @@ void Video::RenderSpritesSMSGG(int line)
         u16 sprite_info_address = sprite_table_address_2 + (sprite << 1);
         int sprite_index = sprite_table_address + sprite;
 
-        int sprite_y = m_pVdpVRAM[sprite_index] + 1;
+        int sprite_y = ReadVRAM(sprite_index) + 1;
 
         if ((sprite_y > 240) && (sprite_y <= 256) && (line < max_height))
         {
             sprite_y -= 256;
         }
 
-        int sprite_x = m_pVdpVRAM[sprite_info_address] - sprite_shift;
+        int sprite_x = ReadVRAM(sprite_info_address) - sprite_shift;
         if (sprite_x >= GS_RESOLUTION_MAX_WIDTH)
             continue;
 
-        int sprite_tile = m_pVdpVRAM[sprite_info_address + 1];
+        int sprite_tile = ReadVRAM(sprite_info_address + 1);
         sprite_tile &= sprite_height_16 ? 0xFE : 0xFF;
         int sprite_tile_addr = sprite_tiles_address + (sprite_tile << 5) +  (((line - sprite_y) >> (sprite_zoom ? 1 : 0)) << 2);
 
@@ -741,10 +839,10 @@ void Video::RenderSpritesSMSGG(int line)
             else
                 tile_pixel_x = 15 - tile_x_adjusted;
 
-            int palette_color = ((m_pVdpVRAM[sprite_tile_addr] >> tile_pixel_x) & 0x01) +
-                    (((m_pVdpVRAM[sprite_tile_addr + 1] >> tile_pixel_x) & 0x01) << 1) +
-                    (((m_pVdpVRAM[sprite_tile_addr + 2] >> tile_pixel_x) & 0x01) << 2) +
-                    (((m_pVdpVRAM[sprite_tile_addr + 3] >> tile_pixel_x) & 0x01) << 3);
+            int palette_color = ((ReadVRAM(sprite_tile_addr) >> tile_pixel_x) & 0x01) +
+                    (((ReadVRAM(sprite_tile_addr + 1) >> tile_pixel_x) & 0x01) << 1) +
+                    (((ReadVRAM(sprite_tile_addr + 2) >> tile_pixel_x) & 0x01) << 2) +
+                    (((ReadVRAM(sprite_tile_addr + 3) >> tile_pixel_x) & 0x01) << 3);
             if (palette_color == 0)
                 continue;
 
@@ -809,8 +907,8 @@ void Video::RenderBackgroundTMS9918(int line)
             {
                 int tile_number = (tile_y * 40) + tile_x;
                 int name_tile_addr = name_table_addr + tile_number;
-                int name_tile = m_pVdpVRAM[name_tile_addr];
-                u8 pattern_line = m_pVdpVRAM[pattern_table_addr + (name_tile << 3) + tile_y_offset];
+                int name_tile = ReadVRAM(name_tile_addr);
+                u8 pattern_line = ReadVRAM(pattern_table_addr + (name_tile << 3) + tile_y_offset);
 
                 int screen_offset = line_offset + (tile_x * 6) + 8;
 
@@ -841,14 +939,14 @@ void Video::RenderBackgroundTMS9918(int line)
     {
         int tile_number = (tile_y << 5) + tile_x;
         int name_tile_addr = name_table_addr + tile_number;
-        int name_tile = m_pVdpVRAM[name_tile_addr];
+        int name_tile = ReadVRAM(name_tile_addr);
         u8 pattern_line = 0;
         u8 color_line = 0;
 
         if (m_iTMS9918Mode == 3)
         {
             int offset_color = pattern_table_addr + (name_tile << 3) + ((tile_y & 0x03) << 1) + (line & 0x04 ? 1 : 0);
-            color_line = m_pVdpVRAM[offset_color];
+            color_line = ReadVRAM(offset_color);
 
             int left_color = color_line >> 4;
             int right_color = color_line & 0x0F;
@@ -875,14 +973,14 @@ void Video::RenderBackgroundTMS9918(int line)
         }
         else if (m_iTMS9918Mode == 0)
         {
-            pattern_line = m_pVdpVRAM[pattern_table_addr + (name_tile << 3) + tile_y_offset];
-            color_line = m_pVdpVRAM[color_table_addr + (name_tile >> 3)];
+            pattern_line = ReadVRAM(pattern_table_addr + (name_tile << 3) + tile_y_offset);
+            color_line = ReadVRAM(color_table_addr + (name_tile >> 3));
         }
         else if (m_iTMS9918Mode == 2)
         {
             name_tile += region;
-            pattern_line = m_pVdpVRAM[pattern_table_addr + ((name_tile & region_mask) << 3) + tile_y_offset];
-            color_line = m_pVdpVRAM[color_table_addr + ((name_tile & color_mask) << 3) + tile_y_offset];
+            pattern_line = ReadVRAM(pattern_table_addr + ((name_tile & region_mask) << 3) + tile_y_offset);
+            color_line = ReadVRAM(color_table_addr + ((name_tile & color_mask) << 3) + tile_y_offset);
         }
 
         int fg_color = color_line >> 4;
@@ -916,7 +1014,7 @@ void Video::RenderSpritesTMS9918(int line)
 
     for (int sprite = 0; sprite <= max_sprite; sprite++)
     {
-        if (m_pVdpVRAM[sprite_attribute_addr + (sprite << 2)] == 0xD0)
+        if (ReadVRAM(sprite_attribute_addr + (sprite << 2)) == 0xD0)
         {
             max_sprite = sprite - 1;
             break;
@@ -926,7 +1024,7 @@ void Video::RenderSpritesTMS9918(int line)
     for (int sprite = 0; sprite <= max_sprite; sprite++)
     {
         int sprite_attribute_offset = sprite_attribute_addr + (sprite << 2);
-        int sprite_y = (m_pVdpVRAM[sprite_attribute_offset] + 1) & 0xFF;
+        int sprite_y = (ReadVRAM(sprite_attribute_offset) + 1) & 0xFF;
 
         if (sprite_y >= 0xE0)
             sprite_y = -(0x100 - sprite_y);
@@ -941,18 +1039,18 @@ void Video::RenderSpritesTMS9918(int line)
             m_VdpStatus = (m_VdpStatus & 0xE0) | sprite;
         }
 
-        int sprite_color = m_pVdpVRAM[sprite_attribute_offset + 3] & 0x0F;
+        int sprite_color = ReadVRAM(sprite_attribute_offset + 3) & 0x0F;
 
         if (sprite_color == 0)
             continue;
 
-        int sprite_shift = (m_pVdpVRAM[sprite_attribute_offset + 3] & 0x80) ? 32 : 0;
-        int sprite_x = m_pVdpVRAM[sprite_attribute_offset + 1] - sprite_shift;
+        int sprite_shift = (ReadVRAM(sprite_attribute_offset + 3) & 0x80) ? 32 : 0;
+        int sprite_x = ReadVRAM(sprite_attribute_offset + 1) - sprite_shift;
 
         if (sprite_x >= GS_RESOLUTION_MAX_WIDTH)
             continue;
 
-        int sprite_tile = m_pVdpVRAM[sprite_attribute_offset + 2];
+        int sprite_tile = ReadVRAM(sprite_attribute_offset + 2);
         sprite_tile &= IsSetBit(m_VdpRegister[1], 1) ? 0xFC : 0xFF;
 
         int sprite_line_addr = sprite_pattern_addr + (sprite_tile << 3) + ((line - sprite_y ) >> (sprite_zoom ? 1 : 0));
@@ -972,9 +1070,9 @@ void Video::RenderSpritesTMS9918(int line)
             int tile_x_adjusted = tile_x >> (sprite_zoom ? 1 : 0);
 
             if (tile_x_adjusted < 8)
-                sprite_pixel = IsSetBit(m_pVdpVRAM[sprite_line_addr], 7 - tile_x_adjusted);
+                sprite_pixel = IsSetBit(ReadVRAM(sprite_line_addr), 7 - tile_x_adjusted);
             else
-                sprite_pixel = IsSetBit(m_pVdpVRAM[sprite_line_addr + 16], 15 - tile_x_adjusted);
+                sprite_pixel = IsSetBit(ReadVRAM(sprite_line_addr + 16), 15 - tile_x_adjusted);
 
             if (sprite_pixel && (sprite_count < 5))
             {
@@ -1191,6 +1289,161 @@ void Video::Render16bit(u16* srcFrameBuffer, u8* dstFrameBuffer, GS_Color_Format
     }
 }
 
+void Video::GetObservationSize(GS_Observation_Format format, int& width, int& height)
+{
+    switch (format)
+    {
+        case GS_OBSERVATION_LUMINANCE_84X84:
+            width = 84;
+            height = 84;
+            break;
+        case GS_OBSERVATION_LUMINANCE_128X96:
+            width = 128;
+            height = 96;
+            break;
+        default:
+            width = m_iScreenWidth - m_iHideLeftBarOffset;
+            if (m_bGameGear)
+                height = GS_RESOLUTION_GG_HEIGHT;
+            else
+                height = m_bExtendedMode224 ? GS_RESOLUTION_SMS_HEIGHT_EXTENDED : GS_RESOLUTION_SMS_HEIGHT;
+            break;
+    }
+}
+
+// Observations are one byte per pixel, converted straight from the VDP
+// output without overscan. Palette mode gives the hardware color (RGB222,
+// Game Gear colors are reduced to it) or the TMS9918 color index.
+void Video::RenderObservation(u8* dstBuffer, GS_Observation_Format format)
+{
+    int width, height;
+    GetObservationSize(GS_OBSERVATION_LUMINANCE, width, height);
+
+    u16 mask;
+    const u8* table = GetObservationTable(format != GS_OBSERVATION_PALETTE, mask);
+
+    switch (format)
+    {
+        case GS_OBSERVATION_PALETTE:
+        case GS_OBSERVATION_LUMINANCE:
+            ObservationRow(m_pFrameBuffer, dstBuffer, table, mask, width * height);
+            break;
+        case GS_OBSERVATION_LUMINANCE_84X84:
+            RenderObservationScaled(dstBuffer, table, mask, width, height, 84, 84);
+            break;
+        case GS_OBSERVATION_LUMINANCE_128X96:
+            if ((width == 256) && (height == 192))
+                RenderObservationHalf(dstBuffer, table, mask, width, height);
+            else
+                RenderObservationScaled(dstBuffer, table, mask, width, height, 128, 96);
+            break;
+        default:
+            break;
+    }
+}
+
+void Video::InitObservationTables()
+{
+    for (int i = 0; i < 64; i++)
+    {
+        int red = k2bitTo8bit[i & 0x03];
+        int green = k2bitTo8bit[(i >> 2) & 0x03];
+        int blue = k2bitTo8bit[(i >> 4) & 0x03];
+
+        m_ObservationPaletteSMS[i] = i;
+        m_ObservationLuminanceSMS[i] = ((red * 299) + (green * 587) + (blue * 114) + 500) / 1000;
+    }
+
+    for (int i = 0; i < 4096; i++)
+    {
+        int red = i & 0x0F;
+        int green = (i >> 4) & 0x0F;
+        int blue = (i >> 8) & 0x0F;
+
+        m_ObservationPaletteGG[i] = (red >> 2) | ((green >> 2) << 2) | ((blue >> 2) << 4);
+        m_ObservationLuminanceGG[i] = ((k4bitTo8bit[red] * 299) + (k4bitTo8bit[green] * 587) + (k4bitTo8bit[blue] * 114) + 500) / 1000;
+    }
+
+    for (int i = 0, j = 0; i < 16; i++, j += 3)
+    {
+        m_ObservationLuminanceSG1000Normal[i] = ((kSG1000_palette_888_normal[j] * 299) + (kSG1000_palette_888_normal[j + 1] * 587) + (kSG1000_palette_888_normal[j + 2] * 114) + 500) / 1000;
+        m_ObservationLuminanceSG1000SMS[i] = ((kSG1000_palette_888_sms[j] * 299) + (kSG1000_palette_888_sms[j + 1] * 587) + (kSG1000_palette_888_sms[j + 2] * 114) + 500) / 1000;
+    }
+}
+
+const u8* Video::GetObservationTable(bool luminance, u16& mask)
+{
+    if (m_bTMS9918)
+    {
+        mask = 0x0F;
+        if (!luminance)
+            return m_ObservationPaletteSMS;
+        return m_pCartridge->IsSG1000() ? m_ObservationLuminanceSG1000Normal : m_ObservationLuminanceSG1000SMS;
+    }
+    else if (m_bGameGear)
+    {
+        mask = 0x0FFF;
+        return luminance ? m_ObservationLuminanceGG : m_ObservationPaletteGG;
+    }
+    else
+    {
+        mask = 0x3F;
+        return luminance ? m_ObservationLuminanceSMS : m_ObservationPaletteSMS;
+    }
+}
+
+void Video::ObservationRow(const u16* src, u8* dst, const u8* table, u16 mask, int width)
+{
+    for (int x = 0; x < width; x++)
+        dst[x] = table[src[x] & mask];
+}
+
+void Video::RenderObservationScaled(u8* dstBuffer, const u8* table, u16 mask, int width, int height, int dstWidth, int dstHeight)
+{
+    u8* row = m_ObservationRows[0];
+
+    for (int dst_y = 0; dst_y < dstHeight; dst_y++)
+    {
+        int y0 = (dst_y * height) / dstHeight;
+        int y1 = ((dst_y + 1) * height) / dstHeight;
+
+        memset(m_ObservationSums, 0, width * sizeof(u16));
+
+        for (int y = y0; y < y1; y++)
+        {
+            ObservationRow(m_pFrameBuffer + (y * width), row, table, mask, width);
+            ObservationAccumulate(m_ObservationSums, row, width);
+        }
+
+        u8* dst = dstBuffer + (dst_y * dstWidth);
+
+        for (int dst_x = 0; dst_x < dstWidth; dst_x++)
+        {
+            int x0 = (dst_x * width) / dstWidth;
+            int x1 = ((dst_x + 1) * width) / dstWidth;
+            int area = (x1 - x0) * (y1 - y0);
+            int sum = 0;
+
+            for (int x = x0; x < x1; x++)
+                sum += m_ObservationSums[x];
+
+            dst[dst_x] = (sum + (area >> 1)) / area;
+        }
+    }
+}
+
+void Video::RenderObservationHalf(u8* dstBuffer, const u8* table, u16 mask, int width, int height)
+{
+    int dst_width = width >> 1;
+
+    for (int y = 0; y < height; y += 2)
+    {
+        ObservationRow(m_pFrameBuffer + (y * width), m_ObservationRows[0], table, mask, width);
+        ObservationRow(m_pFrameBuffer + ((y + 1) * width), m_ObservationRows[1], table, mask, width);
+        ObservationHalve(dstBuffer + ((y >> 1) * dst_width), m_ObservationRows[0], m_ObservationRows[1], dst_width);
+    }
+}
+
 void Video::SetOverscan(Overscan overscan)
 {
     m_Overscan = overscan;
@@ -1336,6 +1589,13 @@ void Video::SetLightPhaserCrosshair(bool enable, LightPhaserCrosshairShape shape
     m_LightPhaserCrosshairColor = color;
 }
 
+void Video::GetLightPhaserCrosshair(bool& enable, LightPhaserCrosshairShape& shape, LightPhaserCrosshairColor& color)
+{
+    enable = m_bLightPhaserCrosshair;
+    shape = m_LightPhaserCrosshairShape;
+    color = m_LightPhaserCrosshairColor;
+}
+
 void Video::InitPalettes(const u8* src, u16* dest_565_rgb, u16* dest_555_rgb, u16* dest_565_bgr, u16* dest_555_bgr)
 {
     for (int i=0,j=0; i<16; i++,j+=3)
@@ -1391,78 +1651,103 @@ void Video::CheckPhaser()
     }
 }
 
-void Video::SaveState(std::ostream& stream)
+// A fork reads VRAM and the info buffer from the pages of this VDP until it
+// writes them
+void Video::SharePages(Video* pTarget)
 {
-    using namespace std;
-
-    stream.write(reinterpret_cast<const char*> (m_pInfoBuffer), GS_RESOLUTION_MAX_WIDTH * GS_LINES_PER_FRAME_PAL);
-    stream.write(reinterpret_cast<const char*> (m_pVdpVRAM), 0x4000);
-    stream.write(reinterpret_cast<const char*> (m_pVdpCRAM), 0x40);
-    stream.write(reinterpret_cast<const char*> (&m_bFirstByteInSequence), sizeof(m_bFirstByteInSequence));
-    stream.write(reinterpret_cast<const char*> (m_VdpRegister), sizeof(m_VdpRegister));
-    stream.write(reinterpret_cast<const char*> (&m_VdpCode), sizeof(m_VdpCode));
-    stream.write(reinterpret_cast<const char*> (&m_VdpBuffer), sizeof(m_VdpBuffer));
-    stream.write(reinterpret_cast<const char*> (&m_VdpAddress), sizeof(m_VdpAddress));
-    stream.write(reinterpret_cast<const char*> (&m_iVCounter), sizeof(m_iVCounter));
-    stream.write(reinterpret_cast<const char*> (&m_iHCounter), sizeof(m_iHCounter));
-    stream.write(reinterpret_cast<const char*> (&m_iCycleCounter), sizeof(m_iCycleCounter));
-    stream.write(reinterpret_cast<const char*> (&m_VdpStatus), sizeof(m_VdpStatus));
-    stream.write(reinterpret_cast<const char*> (&m_iVdpRegister10Counter), sizeof(m_iVdpRegister10Counter));
-    stream.write(reinterpret_cast<const char*> (&m_ScrollX), sizeof(m_ScrollX));
-    stream.write(reinterpret_cast<const char*> (&m_ScrollY), sizeof(m_ScrollY));
-    stream.write(reinterpret_cast<const char*> (&m_iLinesPerFrame), sizeof(m_iLinesPerFrame));
+    m_VRAMPages.Share(pTarget->m_VRAMPages);
+    m_InfoPages.Share(pTarget->m_InfoPages);
+}
+
+void Video::SaveState(StateWriter& writer)
+{
+    SaveRegisters(writer);
+    writer.WritePages(m_InfoPages, GS_RESOLUTION_MAX_WIDTH * GS_LINES_PER_FRAME_PAL, NULL);
+}
+
+void Video::SaveRegisters(StateWriter& writer)
+{
+    writer.Write(&m_bFirstByteInSequence, sizeof(m_bFirstByteInSequence));
+    writer.Write(m_VdpRegister, sizeof(m_VdpRegister));
+    writer.Write(&m_VdpCode, sizeof(m_VdpCode));
+    writer.Write(&m_VdpBuffer, sizeof(m_VdpBuffer));
+    writer.Write(&m_VdpAddress, sizeof(m_VdpAddress));
+    writer.Write(&m_iVCounter, sizeof(m_iVCounter));
+    writer.Write(&m_iHCounter, sizeof(m_iHCounter));
+    writer.Write(&m_iCycleCounter, sizeof(m_iCycleCounter));
+    writer.Write(&m_VdpStatus, sizeof(m_VdpStatus));
+    writer.Write(&m_iVdpRegister10Counter, sizeof(m_iVdpRegister10Counter));
+    writer.Write(&m_ScrollX, sizeof(m_ScrollX));
+    writer.Write(&m_ScrollY, sizeof(m_ScrollY));
+    writer.Write(&m_iLinesPerFrame, sizeof(m_iLinesPerFrame));
     bool bogus = false;
-    stream.write(reinterpret_cast<const char*> (&bogus), sizeof(bogus));
-    stream.write(reinterpret_cast<const char*> (&m_bExtendedMode224), sizeof(m_bExtendedMode224));
-    stream.write(reinterpret_cast<const char*> (&m_LineEvents), sizeof(m_LineEvents));
-    stream.write(reinterpret_cast<const char*> (&m_iRenderLine), sizeof(m_iRenderLine));
-
-    stream.write(reinterpret_cast<const char*> (&m_bGameGear), sizeof(m_bGameGear));
-    stream.write(reinterpret_cast<const char*> (&m_bPAL), sizeof(m_bPAL));
-    stream.write(reinterpret_cast<const char*> (&m_iScreenWidth), sizeof(m_iScreenWidth));
-    stream.write(reinterpret_cast<const char*> (&m_bTMS9918), sizeof(m_bTMS9918));
-    stream.write(reinterpret_cast<const char*> (&m_iTMS9918Mode), sizeof(m_iTMS9918Mode));
-    stream.write(reinterpret_cast<const char*> (&m_Timing), sizeof(m_Timing));
-    stream.write(reinterpret_cast<const char*> (&m_NextLineSprites), sizeof(m_NextLineSprites));
-    stream.write(reinterpret_cast<const char*> (&m_bDisplayEnabled), sizeof(m_bDisplayEnabled));
-    stream.write(reinterpret_cast<const char*> (&m_bSpriteOvrRequest), sizeof(m_bSpriteOvrRequest));
-    stream.write(reinterpret_cast<const char*> (&m_Phaser), sizeof(m_Phaser));
+    writer.Write(&bogus, sizeof(bogus));
+    writer.Write(&m_bExtendedMode224, sizeof(m_bExtendedMode224));
+    writer.Write(&m_LineEvents, sizeof(m_LineEvents));
+    writer.Write(&m_iRenderLine, sizeof(m_iRenderLine));
+
+    writer.Write(&m_bGameGear, sizeof(m_bGameGear));
+    writer.Write(&m_bPAL, sizeof(m_bPAL));
+    writer.Write(&m_iScreenWidth, sizeof(m_iScreenWidth));
+    writer.Write(&m_bTMS9918, sizeof(m_bTMS9918));
+    writer.Write(&m_iTMS9918Mode, sizeof(m_iTMS9918Mode));
+    writer.Write(&m_Timing, sizeof(m_Timing));
+    writer.Write(&m_NextLineSprites, sizeof(m_NextLineSprites));
+    writer.Write(&m_bDisplayEnabled, sizeof(m_bDisplayEnabled));
+    writer.Write(&m_bSpriteOvrRequest, sizeof(m_bSpriteOvrRequest));
+    writer.Write(&m_Phaser, sizeof(m_Phaser));
+}
+
+void Video::LoadState(StateReader& reader)
+{
+    LoadRegisters(reader);
+
+    if (!reader.IsSkippingPages())
+    {
+        m_InfoPages.OwnAll();
+        reader.Read(m_pInfoBuffer, GS_RESOLUTION_MAX_WIDTH * GS_LINES_PER_FRAME_PAL);
+    }
+}
+
+void Video::LoadLegacyState(StateReader& reader)
+{
+    m_InfoPages.OwnAll();
+    m_VRAMPages.OwnAll();
+    reader.Read(m_pInfoBuffer, GS_RESOLUTION_MAX_WIDTH * GS_LINES_PER_FRAME_PAL);
+    reader.Read(m_pVdpVRAM, 0x4000);
+    reader.Read(m_pVdpCRAM, 0x40);
+    LoadRegisters(reader);
 }
 
-void Video::LoadState(std::istream& stream)
+void Video::LoadRegisters(StateReader& reader)
 {
-    using namespace std;
-
-    stream.read(reinterpret_cast<char*> (m_pInfoBuffer), GS_RESOLUTION_MAX_WIDTH * GS_LINES_PER_FRAME_PAL);
-    stream.read(reinterpret_cast<char*> (m_pVdpVRAM), 0x4000);
-    stream.read(reinterpret_cast<char*> (m_pVdpCRAM), 0x40);
-    stream.read(reinterpret_cast<char*> (&m_bFirstByteInSequence), sizeof(m_bFirstByteInSequence));
-    stream.read(reinterpret_cast<char*> (m_VdpRegister), sizeof(m_VdpRegister));
-    stream.read(reinterpret_cast<char*> (&m_VdpCode), sizeof(m_VdpCode));
-    stream.read(reinterpret_cast<char*> (&m_VdpBuffer), sizeof(m_VdpBuffer));
-    stream.read(reinterpret_cast<char*> (&m_VdpAddress), sizeof(m_VdpAddress));
-    stream.read(reinterpret_cast<char*> (&m_iVCounter), sizeof(m_iVCounter));
-    stream.read(reinterpret_cast<char*> (&m_iHCounter), sizeof(m_iHCounter));
-    stream.read(reinterpret_cast<char*> (&m_iCycleCounter), sizeof(m_iCycleCounter));
-    stream.read(reinterpret_cast<char*> (&m_VdpStatus), sizeof(m_VdpStatus));
-    stream.read(reinterpret_cast<char*> (&m_iVdpRegister10Counter), sizeof(m_iVdpRegister10Counter));
-    stream.read(reinterpret_cast<char*> (&m_ScrollX), sizeof(m_ScrollX));
-    stream.read(reinterpret_cast<char*> (&m_ScrollY), sizeof(m_ScrollY));
-    stream.read(reinterpret_cast<char*> (&m_iLinesPerFrame), sizeof(m_iLinesPerFrame));
+    reader.Read(&m_bFirstByteInSequence, sizeof(m_bFirstByteInSequence));
+    reader.Read(m_VdpRegister, sizeof(m_VdpRegister));
+    reader.Read(&m_VdpCode, sizeof(m_VdpCode));
+    reader.Read(&m_VdpBuffer, sizeof(m_VdpBuffer));
+    reader.Read(&m_VdpAddress, sizeof(m_VdpAddress));
+    reader.Read(&m_iVCounter, sizeof(m_iVCounter));
+    reader.Read(&m_iHCounter, sizeof(m_iHCounter));
+    reader.Read(&m_iCycleCounter, sizeof(m_iCycleCounter));
+    reader.Read(&m_VdpStatus, sizeof(m_VdpStatus));
+    reader.Read(&m_iVdpRegister10Counter, sizeof(m_iVdpRegister10Counter));
+    reader.Read(&m_ScrollX, sizeof(m_ScrollX));
+    reader.Read(&m_ScrollY, sizeof(m_ScrollY));
+    reader.Read(&m_iLinesPerFrame, sizeof(m_iLinesPerFrame));
     bool bogus;
-    stream.read(reinterpret_cast<char*> (&bogus), sizeof(bogus));
-    stream.read(reinterpret_cast<char*> (&m_bExtendedMode224), sizeof(m_bExtendedMode224));
-    stream.read(reinterpret_cast<char*> (&m_LineEvents), sizeof(m_LineEvents));
-    stream.read(reinterpret_cast<char*> (&m_iRenderLine), sizeof(m_iRenderLine));
-
-    stream.read(reinterpret_cast<char*> (&m_bGameGear), sizeof(m_bGameGear));
-    stream.read(reinterpret_cast<char*> (&m_bPAL), sizeof(m_bPAL));
-    stream.read(reinterpret_cast<char*> (&m_iScreenWidth), sizeof(m_iScreenWidth));
-    stream.read(reinterpret_cast<char*> (&m_bTMS9918), sizeof(m_bTMS9918));
-    stream.read(reinterpret_cast<char*> (&m_iTMS9918Mode), sizeof(m_iTMS9918Mode));
-    stream.read(reinterpret_cast<char*> (&m_Timing), sizeof(m_Timing));
-    stream.read(reinterpret_cast<char*> (&m_NextLineSprites), sizeof(m_NextLineSprites));
-    stream.read(reinterpret_cast<char*> (&m_bDisplayEnabled), sizeof(m_bDisplayEnabled));
-    stream.read(reinterpret_cast<char*> (&m_bSpriteOvrRequest), sizeof(m_bSpriteOvrRequest));
-    stream.read(reinterpret_cast<char*> (&m_Phaser), sizeof(m_Phaser));
+    reader.Read(&bogus, sizeof(bogus));
+    reader.Read(&m_bExtendedMode224, sizeof(m_bExtendedMode224));
+    reader.Read(&m_LineEvents, sizeof(m_LineEvents));
+    reader.Read(&m_iRenderLine, sizeof(m_iRenderLine));
+
+    reader.Read(&m_bGameGear, sizeof(m_bGameGear));
+    reader.Read(&m_bPAL, sizeof(m_bPAL));
+    reader.Read(&m_iScreenWidth, sizeof(m_iScreenWidth));
+    reader.Read(&m_bTMS9918, sizeof(m_bTMS9918));
+    reader.Read(&m_iTMS9918Mode, sizeof(m_iTMS9918Mode));
+    reader.Read(&m_Timing, sizeof(m_Timing));
+    reader.Read(&m_NextLineSprites, sizeof(m_NextLineSprites));
+    reader.Read(&m_bDisplayEnabled, sizeof(m_bDisplayEnabled));
+    reader.Read(&m_bSpriteOvrRequest, sizeof(m_bSpriteOvrRequest));
+    reader.Read(&m_Phaser, sizeof(m_Phaser));
 }
@@ -21,6 +21,7 @@
 #define	VIDEO_H
 
 #include "definitions.h"
+#include "StateSerializer.h"
 
 class Memory;
 class Processor;
@@ -77,9 +78,13 @@ public:
     void WriteData(u8 data);
     void WriteControl(u8 data);
     void LatchHCounter();
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream);
+    void SaveState(StateWriter& writer);
+    void SaveRegisters(StateWriter& writer);
+    void LoadState(StateReader& reader);
+    void LoadLegacyState(StateReader& reader);
     u8* GetVRAM();
+    SharedPages* GetVRAMPages();
+    u8* GetVRAMDirtyPages();
     u8* GetCRAM();
     u8* GetRegisters();
     int GetTMS9918Mode();
@@ -96,8 +101,14 @@ public:
     bool IsPhaserDetected();
     void DrawPhaserCrosshair(int x, int y);
     void SetLightPhaserCrosshair(bool enable, LightPhaserCrosshairShape shape, LightPhaserCrosshairColor color);
+    void GetLightPhaserCrosshair(bool& enable, LightPhaserCrosshairShape& shape, LightPhaserCrosshairColor& color);
+    void GetObservationSize(GS_Observation_Format format, int& width, int& height);
+    void RenderObservation(u8* dstBuffer, GS_Observation_Format format);
+    void SharePages(Video* pTarget);
 
 private:
+    u8 ReadVRAM(int address);
+    void OwnInfoLine(int line);
     void ScanLine(int line);
     void RenderBackgroundSMSGG(int line);
     void RenderBackgroundTMS9918(int line);
@@ -107,14 +118,23 @@ private:
     void InitPalettes(const u8* src, u16* dest_565_rgb, u16* dest_555_rgb, u16* dest_565_bgr, u16* dest_555_bgr);
     int CalculateVideoMode();
     void CheckPhaser();
+    void LoadRegisters(StateReader& reader);
+    void InitObservationTables();
+    const u8* GetObservationTable(bool luminance, u16& mask);
+    void RenderObservationScaled(u8* dstBuffer, const u8* table, u16 mask, int width, int height, int dstWidth, int dstHeight);
+    void RenderObservationHalf(u8* dstBuffer, const u8* table, u16 mask, int width, int height);
+    void ObservationRow(const u16* src, u8* dst, const u8* table, u16 mask, int width);
 
 private:
     Memory* m_pMemory;
     Processor* m_pProcessor;
     Cartridge* m_pCartridge;
     u8* m_pInfoBuffer;
+    SharedPages m_InfoPages;
     u16* m_pFrameBuffer;
     u8* m_pVdpVRAM;
+    SharedPages m_VRAMPages;
+    u8 m_VRAMDirtyPages[0x4000 >> GS_STATE_HASH_PAGE_SHIFT];
     u8* m_pVdpCRAM;
     bool m_bFirstByteInSequence;
     u8 m_VdpRegister[16];
@@ -191,13 +211,44 @@ private:
     u16 m_SG1000_palette_555_rgb_sms[16];
     u16 m_SG1000_palette_565_bgr_sms[16];
     u16 m_SG1000_palette_555_bgr_sms[16];
+
+    u8 m_ObservationPaletteSMS[64];
+    u8 m_ObservationLuminanceSMS[64];
+    u8 m_ObservationPaletteGG[4096];
+    u8 m_ObservationLuminanceGG[4096];
+    u8 m_ObservationLuminanceSG1000Normal[16];
+    u8 m_ObservationLuminanceSG1000SMS[16];
+    u8 m_ObservationRows[2][GS_RESOLUTION_MAX_WIDTH];
+    u16 m_ObservationSums[GS_RESOLUTION_MAX_WIDTH];
 };
 
+// Callers may keep the pointer and write through it, so forked VRAM is
+// copied back in full first
 inline u8* Video::GetVRAM()
 {
+    m_VRAMPages.OwnAll();
     return m_pVdpVRAM;
 }
 
+inline SharedPages* Video::GetVRAMPages()
+{
+    return &m_VRAMPages;
+}
+
+// VRAM addresses wrap at 16KB. Only forks that still share VRAM pay for the
+// page lookup
+inline u8 Video::ReadVRAM(int address)
+{
+    if (m_VRAMPages.IsShared())
+        return m_VRAMPages.Read(address & 0x3FFF);
+    return m_pVdpVRAM[address & 0x3FFF];
+}
+
+inline u8* Video::GetVRAMDirtyPages()
+{
+    return m_VRAMDirtyPages;
+}
+
 inline u8* Video::GetCRAM()
 {
     return m_pVdpCRAM;
@@ -40,8 +40,18 @@ YM2413::~YM2413()
     SafeDeleteArray(m_pBuffer);
 }
 
+static bool InitTables()
+{
+    OPLL_initTables();
+    return true;
+}
+
 void YM2413::Init(int clockRate)
 {
+    // Function local statics are initialized once even with several threads
+    static const bool tables = InitTables();
+    (void)tables;
+
     m_pBuffer = new s16[GS_AUDIO_BUFFER_SIZE];
     m_pOPLL = OPLL_new();
     OPLL_setChipType(m_pOPLL, 0);
@@ -162,110 +172,114 @@ void YM2413::Sync()
     m_ElapsedCycles = 0;
 }
 
-void YM2413::SaveState(std::ostream& stream)
+void YM2413::SaveState(StateWriter& writer)
 {
-    stream.write(reinterpret_cast<const char*>(&m_iCycleCounter), sizeof(int));
-    stream.write(reinterpret_cast<const char*>(&m_iSampleCounter), sizeof(int));
-    stream.write(reinterpret_cast<const char*>(&m_iBufferIndex), sizeof(int));
-    stream.write(reinterpret_cast<const char*>(&m_ElapsedCycles), sizeof(int));
-    stream.write(reinterpret_cast<const char*>(&m_iClockRate), sizeof(int));
-    stream.write(reinterpret_cast<const char*>(&m_RegisterF2), sizeof(u8));
-    stream.write(reinterpret_cast<const char*>(m_pBuffer), sizeof(s16) * GS_AUDIO_BUFFER_SIZE);
-    stream.write(reinterpret_cast<const char*>(&m_CurrentSample), sizeof(m_CurrentSample));
-    stream.write(reinterpret_cast<const char*>(&m_bEnabled), sizeof(m_bEnabled));
-    stream.write(reinterpret_cast<const char*>(&m_pOPLL->chip_type), sizeof(m_pOPLL->chip_type));
-    stream.write(reinterpret_cast<const char*>(&m_pOPLL->adr), sizeof(m_pOPLL->adr));
-    stream.write(reinterpret_cast<const char*>(m_pOPLL->reg), sizeof(m_pOPLL->reg));
-    stream.write(reinterpret_cast<const char*>(&m_pOPLL->test_flag), sizeof(m_pOPLL->test_flag));
-    stream.write(reinterpret_cast<const char*>(&m_pOPLL->slot_key_status), sizeof(m_pOPLL->slot_key_status));
-    stream.write(reinterpret_cast<const char*>(&m_pOPLL->rhythm_mode), sizeof(m_pOPLL->rhythm_mode));
-    stream.write(reinterpret_cast<const char*>(&m_pOPLL->eg_counter), sizeof(m_pOPLL->eg_counter));
-    stream.write(reinterpret_cast<const char*>(&m_pOPLL->pm_phase), sizeof(m_pOPLL->pm_phase));
-    stream.write(reinterpret_cast<const char*>(&m_pOPLL->am_phase), sizeof(m_pOPLL->am_phase));
-    stream.write(reinterpret_cast<const char*>(&m_pOPLL->lfo_am), sizeof(m_pOPLL->lfo_am));
-    stream.write(reinterpret_cast<const char*>(&m_pOPLL->noise), sizeof(m_pOPLL->noise));
-    stream.write(reinterpret_cast<const char*>(&m_pOPLL->short_noise), sizeof(m_pOPLL->short_noise));
-    stream.write(reinterpret_cast<const char*>(m_pOPLL->patch_number), sizeof(m_pOPLL->patch_number));
-    stream.write(reinterpret_cast<const char*>(m_pOPLL->patch), sizeof(m_pOPLL->patch));
-    stream.write(reinterpret_cast<const char*>(&m_pOPLL->mask), sizeof(m_pOPLL->mask));
-    stream.write(reinterpret_cast<const char*>(m_pOPLL->ch_out), sizeof(m_pOPLL->ch_out));
-    stream.write(reinterpret_cast<const char*>(m_pOPLL->mix_out), sizeof(m_pOPLL->mix_out));
+    OPLL_syncIdle(m_pOPLL);
+
+    writer.Write(&m_iCycleCounter, sizeof(int));
+    writer.Write(&m_iSampleCounter, sizeof(int));
+    writer.Write(&m_iBufferIndex, sizeof(int));
+    writer.Write(&m_ElapsedCycles, sizeof(int));
+    writer.Write(&m_iClockRate, sizeof(int));
+    writer.Write(&m_RegisterF2, sizeof(u8));
+    writer.Write(m_pBuffer, sizeof(s16) * GS_AUDIO_BUFFER_SIZE);
+    writer.Write(&m_CurrentSample, sizeof(m_CurrentSample));
+    writer.Write(&m_bEnabled, sizeof(m_bEnabled));
+    writer.Write(&m_pOPLL->chip_type, sizeof(m_pOPLL->chip_type));
+    writer.Write(&m_pOPLL->adr, sizeof(m_pOPLL->adr));
+    writer.Write(m_pOPLL->reg, sizeof(m_pOPLL->reg));
+    writer.Write(&m_pOPLL->test_flag, sizeof(m_pOPLL->test_flag));
+    writer.Write(&m_pOPLL->slot_key_status, sizeof(m_pOPLL->slot_key_status));
+    writer.Write(&m_pOPLL->rhythm_mode, sizeof(m_pOPLL->rhythm_mode));
+    writer.Write(&m_pOPLL->eg_counter, sizeof(m_pOPLL->eg_counter));
+    writer.Write(&m_pOPLL->pm_phase, sizeof(m_pOPLL->pm_phase));
+    writer.Write(&m_pOPLL->am_phase, sizeof(m_pOPLL->am_phase));
+    writer.Write(&m_pOPLL->lfo_am, sizeof(m_pOPLL->lfo_am));
+    writer.Write(&m_pOPLL->noise, sizeof(m_pOPLL->noise));
+    writer.Write(&m_pOPLL->short_noise, sizeof(m_pOPLL->short_noise));
+    writer.Write(m_pOPLL->patch_number, sizeof(m_pOPLL->patch_number));
+    writer.Write(m_pOPLL->patch, sizeof(m_pOPLL->patch));
+    writer.Write(&m_pOPLL->mask, sizeof(m_pOPLL->mask));
+    writer.Write(m_pOPLL->ch_out, sizeof(m_pOPLL->ch_out));
+    writer.Write(m_pOPLL->mix_out, sizeof(m_pOPLL->mix_out));
     for (int i = 0; i < 18; i++)
     {
-        stream.write(reinterpret_cast<const char*>(&m_pOPLL->slot[i].number), sizeof(m_pOPLL->slot[i].number));
-        stream.write(reinterpret_cast<const char*>(&m_pOPLL->slot[i].type), sizeof(m_pOPLL->slot[i].type));
-        stream.write(reinterpret_cast<const char*>(m_pOPLL->slot[i].output), sizeof(m_pOPLL->slot[i].output));
-        stream.write(reinterpret_cast<const char*>(&m_pOPLL->slot[i].pg_phase), sizeof(m_pOPLL->slot[i].pg_phase));
-        stream.write(reinterpret_cast<const char*>(&m_pOPLL->slot[i].pg_out), sizeof(m_pOPLL->slot[i].pg_out));
-        stream.write(reinterpret_cast<const char*>(&m_pOPLL->slot[i].pg_keep), sizeof(m_pOPLL->slot[i].pg_keep));
-        stream.write(reinterpret_cast<const char*>(&m_pOPLL->slot[i].blk_fnum), sizeof(m_pOPLL->slot[i].blk_fnum));
-        stream.write(reinterpret_cast<const char*>(&m_pOPLL->slot[i].fnum), sizeof(m_pOPLL->slot[i].fnum));
-        stream.write(reinterpret_cast<const char*>(&m_pOPLL->slot[i].blk), sizeof(m_pOPLL->slot[i].blk));
-        stream.write(reinterpret_cast<const char*>(&m_pOPLL->slot[i].eg_state), sizeof(m_pOPLL->slot[i].eg_state));
-        stream.write(reinterpret_cast<const char*>(&m_pOPLL->slot[i].volume), sizeof(m_pOPLL->slot[i].volume));
-        stream.write(reinterpret_cast<const char*>(&m_pOPLL->slot[i].key_flag), sizeof(m_pOPLL->slot[i].key_flag));
-        stream.write(reinterpret_cast<const char*>(&m_pOPLL->slot[i].sus_flag), sizeof(m_pOPLL->slot[i].sus_flag));
-        stream.write(reinterpret_cast<const char*>(&m_pOPLL->slot[i].tll), sizeof(m_pOPLL->slot[i].tll));
-        stream.write(reinterpret_cast<const char*>(&m_pOPLL->slot[i].rks), sizeof(m_pOPLL->slot[i].rks));
-        stream.write(reinterpret_cast<const char*>(&m_pOPLL->slot[i].eg_rate_h), sizeof(m_pOPLL->slot[i].eg_rate_h));
-        stream.write(reinterpret_cast<const char*>(&m_pOPLL->slot[i].eg_rate_l), sizeof(m_pOPLL->slot[i].eg_rate_l));
-        stream.write(reinterpret_cast<const char*>(&m_pOPLL->slot[i].eg_shift), sizeof(m_pOPLL->slot[i].eg_shift));
-        stream.write(reinterpret_cast<const char*>(&m_pOPLL->slot[i].eg_out), sizeof(m_pOPLL->slot[i].eg_out));
-        stream.write(reinterpret_cast<const char*>(&m_pOPLL->slot[i].update_requests), sizeof(m_pOPLL->slot[i].update_requests));
+        writer.Write(&m_pOPLL->slot[i].number, sizeof(m_pOPLL->slot[i].number));
+        writer.Write(&m_pOPLL->slot[i].type, sizeof(m_pOPLL->slot[i].type));
+        writer.Write(m_pOPLL->slot[i].output, sizeof(m_pOPLL->slot[i].output));
+        writer.Write(&m_pOPLL->slot[i].pg_phase, sizeof(m_pOPLL->slot[i].pg_phase));
+        writer.Write(&m_pOPLL->slot[i].pg_out, sizeof(m_pOPLL->slot[i].pg_out));
+        writer.Write(&m_pOPLL->slot[i].pg_keep, sizeof(m_pOPLL->slot[i].pg_keep));
+        writer.Write(&m_pOPLL->slot[i].blk_fnum, sizeof(m_pOPLL->slot[i].blk_fnum));
+        writer.Write(&m_pOPLL->slot[i].fnum, sizeof(m_pOPLL->slot[i].fnum));
+        writer.Write(&m_pOPLL->slot[i].blk, sizeof(m_pOPLL->slot[i].blk));
+        writer.Write(&m_pOPLL->slot[i].eg_state, sizeof(m_pOPLL->slot[i].eg_state));
+        writer.Write(&m_pOPLL->slot[i].volume, sizeof(m_pOPLL->slot[i].volume));
+        writer.Write(&m_pOPLL->slot[i].key_flag, sizeof(m_pOPLL->slot[i].key_flag));
+        writer.Write(&m_pOPLL->slot[i].sus_flag, sizeof(m_pOPLL->slot[i].sus_flag));
+        writer.Write(&m_pOPLL->slot[i].tll, sizeof(m_pOPLL->slot[i].tll));
+        writer.Write(&m_pOPLL->slot[i].rks, sizeof(m_pOPLL->slot[i].rks));
+        writer.Write(&m_pOPLL->slot[i].eg_rate_h, sizeof(m_pOPLL->slot[i].eg_rate_h));
+        writer.Write(&m_pOPLL->slot[i].eg_rate_l, sizeof(m_pOPLL->slot[i].eg_rate_l));
+        writer.Write(&m_pOPLL->slot[i].eg_shift, sizeof(m_pOPLL->slot[i].eg_shift));
+        writer.Write(&m_pOPLL->slot[i].eg_out, sizeof(m_pOPLL->slot[i].eg_out));
+        writer.Write(&m_pOPLL->slot[i].update_requests, sizeof(m_pOPLL->slot[i].update_requests));
     }
 }
 
-void YM2413::LoadState(std::istream& stream)
+void YM2413::LoadState(StateReader& reader)
 {
-    stream.read(reinterpret_cast<char*>(&m_iCycleCounter), sizeof(int));
-    stream.read(reinterpret_cast<char*>(&m_iSampleCounter), sizeof(int));
-    stream.read(reinterpret_cast<char*>(&m_iBufferIndex), sizeof(int));
-    stream.read(reinterpret_cast<char*>(&m_ElapsedCycles), sizeof(int));
-    stream.read(reinterpret_cast<char*>(&m_iClockRate), sizeof(int));
-    stream.read(reinterpret_cast<char*>(&m_RegisterF2), sizeof(u8));
-    stream.read(reinterpret_cast<char*>(m_pBuffer), sizeof(s16) * GS_AUDIO_BUFFER_SIZE);
-    stream.read(reinterpret_cast<char*>(&m_CurrentSample), sizeof(m_CurrentSample));
-    stream.read(reinterpret_cast<char*>(&m_bEnabled), sizeof(m_bEnabled));
-    stream.read(reinterpret_cast<char*>(&m_pOPLL->chip_type), sizeof(m_pOPLL->chip_type));
-    stream.read(reinterpret_cast<char*>(&m_pOPLL->adr), sizeof(m_pOPLL->adr));
-    stream.read(reinterpret_cast<char*>(m_pOPLL->reg), sizeof(m_pOPLL->reg));
-    stream.read(reinterpret_cast<char*>(&m_pOPLL->test_flag), sizeof(m_pOPLL->test_flag));
-    stream.read(reinterpret_cast<char*>(&m_pOPLL->slot_key_status), sizeof(m_pOPLL->slot_key_status));
-    stream.read(reinterpret_cast<char*>(&m_pOPLL->rhythm_mode), sizeof(m_pOPLL->rhythm_mode));
-    stream.read(reinterpret_cast<char*>(&m_pOPLL->eg_counter), sizeof(m_pOPLL->eg_counter));
-    stream.read(reinterpret_cast<char*>(&m_pOPLL->pm_phase), sizeof(m_pOPLL->pm_phase));
-    stream.read(reinterpret_cast<char*>(&m_pOPLL->am_phase), sizeof(m_pOPLL->am_phase));
-    stream.read(reinterpret_cast<char*>(&m_pOPLL->lfo_am), sizeof(m_pOPLL->lfo_am));
-    stream.read(reinterpret_cast<char*>(&m_pOPLL->noise), sizeof(m_pOPLL->noise));
-    stream.read(reinterpret_cast<char*>(&m_pOPLL->short_noise), sizeof(m_pOPLL->short_noise));
-    stream.read(reinterpret_cast<char*>(m_pOPLL->patch_number), sizeof(m_pOPLL->patch_number));
-    stream.read(reinterpret_cast<char*>(m_pOPLL->patch), sizeof(m_pOPLL->patch));
-    stream.read(reinterpret_cast<char*>(&m_pOPLL->mask), sizeof(m_pOPLL->mask));
-    stream.read(reinterpret_cast<char*>(m_pOPLL->ch_out), sizeof(m_pOPLL->ch_out));
-    stream.read(reinterpret_cast<char*>(m_pOPLL->mix_out), sizeof(m_pOPLL->mix_out));
+    OPLL_syncIdle(m_pOPLL);
+
+    reader.Read(&m_iCycleCounter, sizeof(int));
+    reader.Read(&m_iSampleCounter, sizeof(int));
+    reader.Read(&m_iBufferIndex, sizeof(int));
+    reader.Read(&m_ElapsedCycles, sizeof(int));
+    reader.Read(&m_iClockRate, sizeof(int));
+    reader.Read(&m_RegisterF2, sizeof(u8));
+    reader.Read(m_pBuffer, sizeof(s16) * GS_AUDIO_BUFFER_SIZE);
+    reader.Read(&m_CurrentSample, sizeof(m_CurrentSample));
+    reader.Read(&m_bEnabled, sizeof(m_bEnabled));
+    reader.Read(&m_pOPLL->chip_type, sizeof(m_pOPLL->chip_type));
+    reader.Read(&m_pOPLL->adr, sizeof(m_pOPLL->adr));
+    reader.Read(m_pOPLL->reg, sizeof(m_pOPLL->reg));
+    reader.Read(&m_pOPLL->test_flag, sizeof(m_pOPLL->test_flag));
+    reader.Read(&m_pOPLL->slot_key_status, sizeof(m_pOPLL->slot_key_status));
+    reader.Read(&m_pOPLL->rhythm_mode, sizeof(m_pOPLL->rhythm_mode));
+    reader.Read(&m_pOPLL->eg_counter, sizeof(m_pOPLL->eg_counter));
+    reader.Read(&m_pOPLL->pm_phase, sizeof(m_pOPLL->pm_phase));
+    reader.Read(&m_pOPLL->am_phase, sizeof(m_pOPLL->am_phase));
+    reader.Read(&m_pOPLL->lfo_am, sizeof(m_pOPLL->lfo_am));
+    reader.Read(&m_pOPLL->noise, sizeof(m_pOPLL->noise));
+    reader.Read(&m_pOPLL->short_noise, sizeof(m_pOPLL->short_noise));
+    reader.Read(m_pOPLL->patch_number, sizeof(m_pOPLL->patch_number));
+    reader.Read(m_pOPLL->patch, sizeof(m_pOPLL->patch));
+    reader.Read(&m_pOPLL->mask, sizeof(m_pOPLL->mask));
+    reader.Read(m_pOPLL->ch_out, sizeof(m_pOPLL->ch_out));
+    reader.Read(m_pOPLL->mix_out, sizeof(m_pOPLL->mix_out));
     for (int i = 0; i < 18; i++)
     {
-        stream.read(reinterpret_cast<char*>(&m_pOPLL->slot[i].number), sizeof(m_pOPLL->slot[i].number));
-        stream.read(reinterpret_cast<char*>(&m_pOPLL->slot[i].type), sizeof(m_pOPLL->slot[i].type));
-        stream.read(reinterpret_cast<char*>(m_pOPLL->slot[i].output), sizeof(m_pOPLL->slot[i].output));
-        stream.read(reinterpret_cast<char*>(&m_pOPLL->slot[i].pg_phase), sizeof(m_pOPLL->slot[i].pg_phase));
-        stream.read(reinterpret_cast<char*>(&m_pOPLL->slot[i].pg_out), sizeof(m_pOPLL->slot[i].pg_out));
-        stream.read(reinterpret_cast<char*>(&m_pOPLL->slot[i].pg_keep), sizeof(m_pOPLL->slot[i].pg_keep));
-        stream.read(reinterpret_cast<char*>(&m_pOPLL->slot[i].blk_fnum), sizeof(m_pOPLL->slot[i].blk_fnum));
-        stream.read(reinterpret_cast<char*>(&m_pOPLL->slot[i].fnum), sizeof(m_pOPLL->slot[i].fnum));
-        stream.read(reinterpret_cast<char*>(&m_pOPLL->slot[i].blk), sizeof(m_pOPLL->slot[i].blk));
-        stream.read(reinterpret_cast<char*>(&m_pOPLL->slot[i].eg_state), sizeof(m_pOPLL->slot[i].eg_state));
-        stream.read(reinterpret_cast<char*>(&m_pOPLL->slot[i].volume), sizeof(m_pOPLL->slot[i].volume));
-        stream.read(reinterpret_cast<char*>(&m_pOPLL->slot[i].key_flag), sizeof(m_pOPLL->slot[i].key_flag));
-        stream.read(reinterpret_cast<char*>(&m_pOPLL->slot[i].sus_flag), sizeof(m_pOPLL->slot[i].sus_flag));
-        stream.read(reinterpret_cast<char*>(&m_pOPLL->slot[i].tll), sizeof(m_pOPLL->slot[i].tll));
-        stream.read(reinterpret_cast<char*>(&m_pOPLL->slot[i].rks), sizeof(m_pOPLL->slot[i].rks));
-        stream.read(reinterpret_cast<char*>(&m_pOPLL->slot[i].eg_rate_h), sizeof(m_pOPLL->slot[i].eg_rate_h));
-        stream.read(reinterpret_cast<char*>(&m_pOPLL->slot[i].eg_rate_l), sizeof(m_pOPLL->slot[i].eg_rate_l));
-        stream.read(reinterpret_cast<char*>(&m_pOPLL->slot[i].eg_shift), sizeof(m_pOPLL->slot[i].eg_shift));
-        stream.read(reinterpret_cast<char*>(&m_pOPLL->slot[i].eg_out), sizeof(m_pOPLL->slot[i].eg_out));
-        stream.read(reinterpret_cast<char*>(&m_pOPLL->slot[i].update_requests), sizeof(m_pOPLL->slot[i].update_requests));
+        reader.Read(&m_pOPLL->slot[i].number, sizeof(m_pOPLL->slot[i].number));
+        reader.Read(&m_pOPLL->slot[i].type, sizeof(m_pOPLL->slot[i].type));
+        reader.Read(m_pOPLL->slot[i].output, sizeof(m_pOPLL->slot[i].output));
+        reader.Read(&m_pOPLL->slot[i].pg_phase, sizeof(m_pOPLL->slot[i].pg_phase));
+        reader.Read(&m_pOPLL->slot[i].pg_out, sizeof(m_pOPLL->slot[i].pg_out));
+        reader.Read(&m_pOPLL->slot[i].pg_keep, sizeof(m_pOPLL->slot[i].pg_keep));
+        reader.Read(&m_pOPLL->slot[i].blk_fnum, sizeof(m_pOPLL->slot[i].blk_fnum));
+        reader.Read(&m_pOPLL->slot[i].fnum, sizeof(m_pOPLL->slot[i].fnum));
+        reader.Read(&m_pOPLL->slot[i].blk, sizeof(m_pOPLL->slot[i].blk));
+        reader.Read(&m_pOPLL->slot[i].eg_state, sizeof(m_pOPLL->slot[i].eg_state));
+        reader.Read(&m_pOPLL->slot[i].volume, sizeof(m_pOPLL->slot[i].volume));
+        reader.Read(&m_pOPLL->slot[i].key_flag, sizeof(m_pOPLL->slot[i].key_flag));
+        reader.Read(&m_pOPLL->slot[i].sus_flag, sizeof(m_pOPLL->slot[i].sus_flag));
+        reader.Read(&m_pOPLL->slot[i].tll, sizeof(m_pOPLL->slot[i].tll));
+        reader.Read(&m_pOPLL->slot[i].rks, sizeof(m_pOPLL->slot[i].rks));
+        reader.Read(&m_pOPLL->slot[i].eg_rate_h, sizeof(m_pOPLL->slot[i].eg_rate_h));
+        reader.Read(&m_pOPLL->slot[i].eg_rate_l, sizeof(m_pOPLL->slot[i].eg_rate_l));
+        reader.Read(&m_pOPLL->slot[i].eg_shift, sizeof(m_pOPLL->slot[i].eg_shift));
+        reader.Read(&m_pOPLL->slot[i].eg_out, sizeof(m_pOPLL->slot[i].eg_out));
+        reader.Read(&m_pOPLL->slot[i].update_requests, sizeof(m_pOPLL->slot[i].update_requests));
     }
 
-    OPLL_forceRefresh(m_pOPLL);
+    OPLL_refreshPatches(m_pOPLL);
 }
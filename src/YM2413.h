@@ -2,6 +2,7 @@
 #define YM2413_H
 
 #include "definitions.h"
+#include "StateSerializer.h"
 #include "log.h"
 #include "audio/emu2413/emu2413.h"
 
@@ -19,8 +20,8 @@ public:
     void Tick(unsigned int clockCycles);
     int EndFrame(s16* pSampleBuffer);
     void Enable(bool bEnabled);
-    void SaveState(std::ostream& stream);
-    void LoadState(std::istream& stream);
+    void SaveState(StateWriter& writer);
+    void LoadState(StateReader& reader);
 
 private:
     void Sync();
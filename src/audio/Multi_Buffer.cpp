@@ -76,6 +76,18 @@ void Tracked_Blip_Buffer::clear()
 	Blip_Buffer::clear();
 }
 
+void Tracked_Blip_Buffer::save_state( blip_buffer_state_t* out, blip_long* non_silence )
+{
+	Blip_Buffer::save_state( out );
+	*non_silence = last_non_silence;
+}
+
+void Tracked_Blip_Buffer::load_state( blip_buffer_state_t const& in, blip_long non_silence )
+{
+	Blip_Buffer::load_state( in );
+	last_non_silence = non_silence;
+}
+
 void Tracked_Blip_Buffer::end_frame( blip_time_t t )
 {
 	Blip_Buffer::end_frame( t );
@@ -163,6 +175,20 @@ void Stereo_Buffer::clear()
 		bufs [i].clear();
 }
 
+void Stereo_Buffer::save_state( stereo_buffer_state_t* out )
+{
+	for ( int i = bufs_size; --i >= 0; )
+		bufs [i].save_state( &out->bufs [i], &out->last_non_silence [i] );
+	out->samples_read = mixer.samples_read;
+}
+
+void Stereo_Buffer::load_state( stereo_buffer_state_t const& in )
+{
+	for ( int i = bufs_size; --i >= 0; )
+		bufs [i].load_state( in.bufs [i], in.last_non_silence [i] );
+	mixer.samples_read = in.samples_read;
+}
+
 void Stereo_Buffer::end_frame( blip_time_t time )
 {
 	for ( int i = bufs_size; --i >= 0; )
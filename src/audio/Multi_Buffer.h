@@ -113,6 +113,8 @@ public:
 		Tracked_Blip_Buffer();
 		void clear();
 		void end_frame( blip_time_t );
+		void save_state( blip_buffer_state_t* out, blip_long* non_silence );
+		void load_state( blip_buffer_state_t const& in, blip_long non_silence );
 	private:
 		blip_long last_non_silence;
 		void remove_( long );
@@ -130,6 +132,13 @@ public:
 		void mix_stereo( blip_sample_t* out, int pair_count );
 	};
 
+struct stereo_buffer_state_t
+{
+	blip_buffer_state_t bufs [3];
+	blip_long last_non_silence [3];
+	blargg_long samples_read;
+};
+
 // Uses three buffers (one for center) and outputs stereo sample pairs.
 class Stereo_Buffer : public Multi_Buffer {
 public:
@@ -152,6 +161,11 @@ public:
 	long samples_avail() const { return (bufs [0].samples_avail() - mixer.samples_read) * 2; }
 	long read_samples( blip_sample_t*, long );
 
+	// Saves and loads high-pass filter and delta tails of all buffers, so
+	// output continues seamlessly. All samples must have been read first.
+	void save_state( stereo_buffer_state_t* out );
+	void load_state( stereo_buffer_state_t const& in );
+
 private:
 	enum { bufs_size = 3 };
 	typedef Tracked_Blip_Buffer buf_t;
@@ -327,3 +327,64 @@ void Sms_Apu::write_data( blip_time_t time, int data )
 		noise.shifter = 0x8000;
 	}
 }
+
+void Sms_Apu::save_state( sms_apu_state_t* out ) const
+{
+	for ( int i = 0; i < osc_count; i++ )
+	{
+		Sms_Osc const& osc = *oscs [i];
+		out->delay [i] = osc.delay;
+		out->last_amp [i] = osc.last_amp;
+		out->volume [i] = osc.volume;
+		out->output_select [i] = osc.output_select;
+	}
+	
+	for ( int i = 0; i < 3; i++ )
+	{
+		out->period [i] = squares [i].period;
+		out->phase [i] = squares [i].phase;
+	}
+	
+	out->noise_period = 3;
+	for ( int i = 0; i < 3; i++ )
+	{
+		if ( noise.period == &noise_periods [i] )
+			out->noise_period = i;
+	}
+	
+	out->noise_shifter = noise.shifter;
+	out->noise_feedback = noise.feedback;
+	out->latch = latch;
+	out->last_time = last_time;
+	out->ggstereo = ggstereo_save;
+}
+
+void Sms_Apu::load_state( sms_apu_state_t const& in )
+{
+	for ( int i = 0; i < osc_count; i++ )
+	{
+		Sms_Osc& osc = *oscs [i];
+		osc.delay = in.delay [i];
+		osc.last_amp = in.last_amp [i];
+		osc.volume = in.volume [i];
+		osc.output_select = in.output_select [i] & 3;
+		osc.output = osc.outputs [osc.output_select];
+	}
+	
+	for ( int i = 0; i < 3; i++ )
+	{
+		squares [i].period = in.period [i];
+		squares [i].phase = in.phase [i] & 1;
+	}
+	
+	if ( (unsigned) in.noise_period < 3 )
+		noise.period = &noise_periods [in.noise_period];
+	else
+		noise.period = &squares [2].period;
+	
+	noise.shifter = in.noise_shifter;
+	noise.feedback = in.noise_feedback;
+	latch = in.latch;
+	last_time = in.last_time;
+	ggstereo_save = in.ggstereo;
+}
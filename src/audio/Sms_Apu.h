@@ -6,6 +6,23 @@
 
 #include "Sms_Oscs.h"
 
+// Oscillator state, independent of the assigned outputs
+struct sms_apu_state_t
+{
+	int delay [4];
+	int last_amp [4];
+	int volume [4];
+	int output_select [4];
+	int period [3];
+	int phase [3];
+	int noise_period; // 0-2 = fixed periods, 3 = square 3 period
+	unsigned noise_shifter;
+	unsigned noise_feedback;
+	int latch;
+	int last_time;
+	unsigned ggstereo;
+};
+
 class Sms_Apu {
 public:
 	// Set overall volume of all oscillators, where 1.0 is full volume
@@ -41,6 +58,12 @@ public:
 	// Run all oscillators up to specified time, end current frame, then
 	// start a new frame at time 0.
 	void end_frame( blip_time_t );
+	
+	// Save/load oscillator state. Loading keeps the current outputs and
+	// doesn't add any transition to them, so a state saved and loaded
+	// against the same buffer continues seamlessly.
+	void save_state( sms_apu_state_t* ) const;
+	void load_state( sms_apu_state_t const& );
 
 public:
 	Sms_Apu();
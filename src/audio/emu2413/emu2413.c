@@ -756,12 +756,16 @@ static inline void calc_envelope(OPLL_SLOT *slot, OPLL_SLOT *buddy, uint16_t eg_
 }
 
 static void update_slots(OPLL *opll) {
+  const uint32_t idle = opll->idle_slot_mask;
   int i;
   opll->eg_counter++;
 
   for (i = 0; i < 18; i++) {
     OPLL_SLOT *slot = &opll->slot[i];
     OPLL_SLOT *buddy = NULL;
+    if (BIT(idle, i)) {
+      continue;
+    }
     if (slot->type == 0) {
       buddy = &opll->slot[i + 1];
     }
@@ -776,6 +780,42 @@ static void update_slots(OPLL *opll) {
   }
 }
 
+/* phase increment of a slot for a given column of pm_table, same as calc_phase */
+static inline uint32_t phase_increment(OPLL_SLOT *slot, int pm_index) {
+  const int8_t pm = slot->patch->PM ? pm_table[(slot->fnum >> 6) & 7][pm_index] : 0;
+  return (((slot->fnum & 0x1ff) * 2 + pm) * ml_table[slot->patch->ML]) << slot->blk >> 2;
+}
+
+/* advance the phase of a skipped slot as if calc_phase had been called for pm_phase start+1 ... start+count */
+static void skip_phase(OPLL_SLOT *slot, uint32_t start, uint32_t count) {
+  uint32_t n[8];
+  uint32_t rem = count & 8191;
+  uint32_t p = start + 1;
+  uint32_t phase = slot->pg_phase;
+  int k;
+
+  for (k = 0; k < 8; k++) {
+    n[k] = (count >> 13) << 10;
+  }
+
+  while (rem) {
+    uint32_t run = 1024 - (p & 1023);
+    if (run > rem) {
+      run = rem;
+    }
+    n[(p >> 10) & 7] += run;
+    p += run;
+    rem -= run;
+  }
+
+  for (k = 0; k < 8; k++) {
+    phase += phase_increment(slot, k) * n[k];
+  }
+
+  slot->pg_phase = phase & (DP_WIDTH - 1);
+  slot->pg_out = slot->pg_phase >> DP_BASE_BITS;
+}
+
 /* output: -4095...4095 */
 static inline int16_t lookup_exp_table(uint16_t i) {
   /* from andete's expression */
@@ -859,6 +899,110 @@ static inline int16_t calc_slot_hat(OPLL *opll) {
   return to_linear(slot->wave_table[phase], slot, 0);
 }
 
+/* a key-off modulator whose envelope and state can not change any more */
+static inline int is_frozen_mod(OPLL_SLOT *slot) {
+  if (slot->key_flag || slot->update_requests || slot->eg_rate_h) {
+    return 0;
+  }
+
+  switch (slot->eg_state) {
+  case ATTACK:
+    return slot->eg_out != 0;
+  case DECAY:
+    return (slot->eg_out >> 3) != slot->patch->SL;
+  case DAMP:
+    return slot->eg_out < EG_MAX;
+  default:
+    return 1;
+  }
+}
+
+/* a key-off carrier fully attenuated in release, its output stays 0 until re-armed */
+static inline int is_silent_car(OPLL_SLOT *slot) {
+  return !slot->key_flag && !slot->update_requests && slot->eg_state == RELEASE && slot->eg_out == EG_MUTE &&
+         slot->output[0] == 0 && slot->output[1] == 0;
+}
+
+static void wake_channel(OPLL *opll, int ch) {
+  const uint32_t start = opll->idle_pm_phase[ch];
+  const uint32_t count = opll->pm_phase - start;
+  OPLL_SLOT *mod = MOD(opll, ch);
+
+  if (!BIT(opll->idle_slot_mask, (ch << 1) | 1)) {
+    return;
+  }
+
+  if (count) {
+    skip_phase(CAR(opll, ch), start, count);
+
+    /* modulator output history only depends on its phase when there is no feedback or it is muted */
+    if (BIT(opll->idle_slot_mask, ch << 1)) {
+      const uint8_t am_prev = mod->patch->AM ? am_table[((opll->am_phase - 1) >> 6) % sizeof(am_table)] : 0;
+      const uint8_t am = mod->patch->AM ? opll->lfo_am : 0;
+      uint32_t prev;
+
+      skip_phase(mod, start, count);
+      prev = (mod->pg_phase - phase_increment(mod, (opll->pm_phase >> 10) & 7)) & (DP_WIDTH - 1);
+      mod->output[1] = to_linear(mod->wave_table[(prev >> DP_BASE_BITS) & (PG_WIDTH - 1)], mod, am_prev);
+      mod->output[0] = to_linear(mod->wave_table[mod->pg_out & (PG_WIDTH - 1)], mod, am);
+    }
+  }
+
+  opll->idle_slot_mask &= ~(3 << (ch << 1));
+}
+
+static void wake_all_channels(OPLL *opll) {
+  int ch;
+  for (ch = 0; ch < 9 && opll->idle_slot_mask; ch++) {
+    wake_channel(opll, ch);
+  }
+}
+
+static void update_idle(OPLL *opll) {
+  const int channels = opll->rhythm_mode ? 6 : 9;
+  int ch;
+
+  for (ch = 0; ch < channels; ch++) {
+    OPLL_SLOT *mod, *car;
+    int mod_idle;
+
+    if (BIT(opll->idle_slot_mask, ch << 1) || (opll->slot_key_status & (3 << (ch << 1))) ||
+        (opll->mask & OPLL_MASK_CH(ch)) || opll->ch_out[ch]) {
+      continue;
+    }
+
+    car = CAR(opll, ch);
+
+    if (!is_silent_car(car)) {
+      continue;
+    }
+
+    mod = MOD(opll, ch);
+    mod_idle = is_frozen_mod(mod) && (mod->patch->FB == 0 || mod->eg_out > EG_MAX);
+
+    if (BIT(opll->idle_slot_mask, (ch << 1) | 1)) {
+      if (!mod_idle) {
+        continue;
+      }
+      wake_channel(opll, ch);
+    }
+
+    opll->idle_pm_phase[ch] = opll->pm_phase;
+    opll->idle_slot_mask |= (mod_idle ? 3 : 2) << (ch << 1);
+  }
+}
+
+/* calc a melodic channel, skipping the slots of idle channels */
+static inline int16_t calc_channel(OPLL *opll, int ch) {
+  if (BIT(opll->idle_slot_mask, (ch << 1) | 1)) {
+    if (!BIT(opll->idle_slot_mask, ch << 1)) {
+      calc_slot_mod(opll, ch);
+    }
+    return 0;
+  }
+  return calc_slot_car(opll, ch, calc_slot_mod(opll, ch));
+}
+
 #define _MO(x) (-(x) >> 1)
 #define _RO(x) (x)
 
@@ -875,14 +1019,14 @@ static void update_output(OPLL *opll) {
   /* CH1-6 */
   for (i = 0; i < 6; i++) {
     if (!(opll->mask & OPLL_MASK_CH(i))) {
-      out[i] = _MO(calc_slot_car(opll, i, calc_slot_mod(opll, i)));
+      out[i] = _MO(calc_channel(opll, i));
     }
   }
 
   /* CH7 */
   if (!opll->rhythm_mode) {
     if (!(opll->mask & OPLL_MASK_CH(6))) {
-      out[6] = _MO(calc_slot_car(opll, 6, calc_slot_mod(opll, 6)));
+      out[6] = _MO(calc_channel(opll, 6));
     }
   } else {
     if (!(opll->mask & OPLL_MASK_BD)) {
@@ -894,7 +1038,7 @@ static void update_output(OPLL *opll) {
   /* CH8 */
   if (!opll->rhythm_mode) {
     if (!(opll->mask & OPLL_MASK_CH(7))) {
-      out[7] = _MO(calc_slot_car(opll, 7, calc_slot_mod(opll, 7)));
+      out[7] = _MO(calc_channel(opll, 7));
     }
   } else {
     if (!(opll->mask & OPLL_MASK_HH)) {
@@ -909,7 +1053,7 @@ static void update_output(OPLL *opll) {
   /* CH9 */
   if (!opll->rhythm_mode) {
     if (!(opll->mask & OPLL_MASK_CH(8))) {
-      out[8] = _MO(calc_slot_car(opll, 8, calc_slot_mod(opll, 8)));
+      out[8] = _MO(calc_channel(opll, 8));
     }
   } else {
     if (!(opll->mask & OPLL_MASK_TOM)) {
@@ -920,6 +1064,11 @@ static void update_output(OPLL *opll) {
     }
   }
   update_noise(opll, 2);
+
+  /* idle detection does not need to run every sample, entering it later is still exact */
+  if (opll->idle_skip && !opll->test_flag && !(opll->eg_counter & 7)) {
+    update_idle(opll);
+  }
 }
 
 static inline void mix_output(OPLL *opll) {
@@ -942,6 +1091,12 @@ static inline void mix_output_stereo(OPLL *opll) {
 
 ***********************************************************/
 
+void OPLL_initTables(void) {
+  if (!table_initialized) {
+    initializeTables();
+  }
+}
+
 OPLL *OPLL_new(void) {
   OPLL *opll;
   int i;
@@ -960,6 +1115,7 @@ OPLL *OPLL_new(void) {
   opll->mask = 0;
   opll->mix_out[0] = 0;
   opll->mix_out[1] = 0;
+  opll->idle_skip = 1;
 
   OPLL_reset(opll);
   OPLL_setChipType(opll, 0);
@@ -988,6 +1144,7 @@ void OPLL_reset(OPLL *opll) {
   opll->rhythm_mode = 0;
   opll->slot_key_status = 0;
   opll->eg_counter = 0;
+  opll->idle_slot_mask = 0;
 
   for (i = 0; i < 18; i++)
     reset_slot(&opll->slot[i], i);
@@ -1010,6 +1167,8 @@ void OPLL_forceRefresh(OPLL *opll) {
   if (opll == NULL)
     return;
 
+  wake_all_channels(opll);
+
   for (i = 0; i < 9; i++) {
     set_patch(opll, i, opll->patch_number[i]);
   }
@@ -1019,6 +1178,25 @@ void OPLL_forceRefresh(OPLL *opll) {
   }
 }
 
+void OPLL_refreshPatches(OPLL *opll) {
+  int i;
+
+  if (opll == NULL)
+    return;
+
+  wake_all_channels(opll);
+
+  /* rebind pointers only, the derived slot fields and their pending updates were restored as they were */
+  for (i = 0; i < 9; i++) {
+    MOD(opll, i)->patch = &opll->patch[opll->patch_number[i] * 2 + 0];
+    CAR(opll, i)->patch = &opll->patch[opll->patch_number[i] * 2 + 1];
+  }
+
+  for (i = 0; i < 18; i++) {
+    opll->slot[i].wave_table = wave_table_map[opll->slot[i].patch->WS];
+  }
+}
+
 void OPLL_setChipType(OPLL *opll, uint8_t type) { opll->chip_type = type; }
 
 void OPLL_writeReg(OPLL *opll, uint32_t reg, uint8_t data) {
@@ -1032,7 +1210,19 @@ void OPLL_writeReg(OPLL *opll, uint32_t reg, uint8_t data) {
     reg -= 9;
   }
 
-  opll->reg[reg] = (uint8_t)data;
+  if (opll->idle_slot_mask) {
+    if (reg >= 0x10) {
+      ch = reg & 0x0f;
+      if (ch < 9) {
+        wake_channel(opll, ch);
+      }
+    } else {
+      wake_all_channels(opll);
+    }
+  }
+
+  /* reg is already below 0x40, the mask keeps the range visible once OPLL_reset inlines this */
+  opll->reg[reg & 0x3f] = (uint8_t)data;
 
   switch (reg) {
   case 0x00:
@@ -1238,6 +1428,7 @@ void OPLL_getDefaultPatch(int32_t type, int32_t num, OPLL_PATCH *patch) {
 void OPLL_setPatch(OPLL *opll, const uint8_t *dump) {
   OPLL_PATCH patch[2];
   int i;
+  wake_all_channels(opll);
   for (i = 0; i < 19; i++) {
     OPLL_dumpToPatch(dump + i * 8, patch);
     memcpy(&opll->patch[i * 2 + 0], &patch[0], sizeof(OPLL_PATCH));
@@ -1257,6 +1448,7 @@ void OPLL_patchToDump(const OPLL_PATCH *patch, uint8_t *dump) {
 }
 
 void OPLL_copyPatch(OPLL *opll, int32_t num, OPLL_PATCH *patch) {
+  wake_all_channels(opll);
   memcpy(&opll->patch[num], patch, sizeof(OPLL_PATCH));
 }
 
@@ -1283,6 +1475,7 @@ uint32_t OPLL_setMask(OPLL *opll, uint32_t mask) {
   uint32_t ret;
 
   if (opll) {
+    wake_all_channels(opll);
     ret = opll->mask;
     opll->mask = mask;
     return ret;
@@ -1294,9 +1487,28 @@ uint32_t OPLL_toggleMask(OPLL *opll, uint32_t mask) {
   uint32_t ret;
 
   if (opll) {
+    wake_all_channels(opll);
     ret = opll->mask;
     opll->mask ^= mask;
     return ret;
   } else
     return 0;
-}
\ No newline at end of file
+}
+
+void OPLL_setIdleSkip(OPLL *opll, uint8_t enable) {
+  wake_all_channels(opll);
+  opll->idle_skip = enable ? 1 : 0;
+}
+
+void OPLL_syncIdle(OPLL *opll) { wake_all_channels(opll); }
+
+uint32_t OPLL_getIdleMask(OPLL *opll) {
+  uint32_t mask = 0;
+  int ch;
+  for (ch = 0; ch < 9; ch++) {
+    if (BIT(opll->idle_slot_mask, (ch << 1) | 1)) {
+      mask |= OPLL_MASK_CH(ch);
+    }
+  }
+  return mask;
+}
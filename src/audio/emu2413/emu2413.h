@@ -100,8 +100,16 @@ typedef struct __OPLL {
   int16_t ch_out[14];
 
   int16_t mix_out[2];
+
+  /* idle channel tracking */
+  uint8_t idle_skip;         /* if 1, silent key-off channels are skipped */
+  uint32_t idle_slot_mask;   /* slots not being calculated, same layout as slot_key_status */
+  uint32_t idle_pm_phase[9]; /* pm_phase when the channel went idle */
 } OPLL;
 
+/* Builds the shared tables. Not thread safe: call once before creating instances from several threads. */
+void OPLL_initTables(void);
+
 OPLL *OPLL_new(void);
 void OPLL_delete(OPLL *);
 
@@ -138,6 +146,29 @@ void OPLL_copyPatch(OPLL *, int32_t, OPLL_PATCH *);
  */
 void OPLL_forceRefresh(OPLL *);
 
+/**
+ * Refresh patch and wave table bindings after restoring every slot field,
+ * leaving their pending updates untouched.
+ */
+void OPLL_refreshPatches(OPLL *);
+
+/**
+ * Enable or disable skipping of silent key-off channels (enabled by default).
+ * Skipped channels are fast-forwarded when they are touched again so the output is identical.
+ */
+void OPLL_setIdleSkip(OPLL *, uint8_t enable);
+
+/**
+ * Fast-forward all skipped channels.
+ * External program should call this function before reading or writing the OPLL state directly.
+ */
+void OPLL_syncIdle(OPLL *);
+
+/**
+ * Get the channels currently being skipped (bit 0..8).
+ */
+uint32_t OPLL_getIdleMask(OPLL *);
+
 void OPLL_dumpToPatch(const uint8_t *dump, OPLL_PATCH *patch);
 void OPLL_patchToDump(const OPLL_PATCH *patch, uint8_t *dump);
 void OPLL_getDefaultPatch(int32_t type, int32_t num, OPLL_PATCH *);
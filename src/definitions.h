@@ -37,6 +37,10 @@
 #define PERFORMANCE
 #endif
 
+#if !defined(GEARSYSTEM_DISABLE_MMAP) && (defined(_WIN32) || defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__))
+#define GEARSYSTEM_MMAP
+#endif
+
 #if !defined(EMULATOR_BUILD)
     #define EMULATOR_BUILD "undefined"
 #endif
@@ -60,6 +64,7 @@
 #endif
 
 //#define GEARSYSTEM_DISABLE_DISASSEMBLER
+//#define GEARSYSTEM_DISABLE_PROFILER
 
 #define MAX_ROM_SIZE 0x800000
 
@@ -131,6 +136,16 @@ typedef void (*RamChangedCallback) (void);
 #define GS_AUDIO_BUFFER_SIZE 4096
 
 #define GS_SAVESTATE_MAGIC 0x03121220
+#define GS_SAVESTATE_CONTAINER_MAGIC 0x54535347
+#define GS_SAVESTATE_VERSION 1
+
+#define GS_REWIND_DEFAULT_BUFFER_SIZE (32 * 1024 * 1024)
+#define GS_REWIND_DEFAULT_KEYFRAME_INTERVAL 60
+
+#define GS_RUNAHEAD_MAX_FRAMES 4
+
+#define GS_BREAKPOINT_TRACE_SIZE 1024
+#define GS_EXECUTION_TRACE_DEFAULT_RECORDS (1024 * 1024)
 
 enum GS_Color_Format
 {
@@ -142,6 +157,15 @@ enum GS_Color_Format
     GS_PIXEL_BGRA8888
 };
 
+enum GS_Observation_Format
+{
+    GS_OBSERVATION_DISABLED,
+    GS_OBSERVATION_PALETTE,
+    GS_OBSERVATION_LUMINANCE,
+    GS_OBSERVATION_LUMINANCE_84X84,
+    GS_OBSERVATION_LUMINANCE_128X96
+};
+
 enum GS_Keys
 {
     Key_Up = 0,
@@ -180,6 +204,36 @@ struct GS_RuntimeInfo
     GS_Region region;
 };
 
+struct GS_FrameProfile
+{
+    u64 frames;
+    u64 cpu_ns;
+    u64 video_ns;
+    u64 audio_ns;
+    u64 render_ns;
+};
+
+struct GS_RunAheadStats
+{
+    int frames;
+    bool second_instance;
+    size_t state_size;
+    int frame_us;
+    int save_us;
+    int load_us;
+    int ahead_us;
+    int total_us;
+    int average_total_us;
+    int budget_us;
+    float budget_usage;
+};
+
+struct GS_StateHash
+{
+    u64 low;
+    u64 high;
+};
+
 inline u8 SetBit(const u8 value, const u8 bit)
 {
     return value | (0x01 << bit);
@@ -30,6 +30,11 @@
 #include "Video.h"
 #include "SixteenBitRegister.h"
 #include "MemoryRule.h"
+#include "RewindBuffer.h"
+#include "Movie.h"
+#include "CodeProfiler.h"
+#include "ExecutionTrace.h"
+#include "CodeDataLogger.h"
 
 #endif	/* GEARSYSTEM_H */
 
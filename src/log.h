@@ -22,6 +22,7 @@
 
 #include <cstdio>
 #include <cstdarg>
+#include <atomic>
 #include "definitions.h"
 
 #if defined(DEBUG_GEARSYSTEM)
@@ -36,9 +37,12 @@
 
 #define Log(msg, ...) (Log_func(false, msg, ##__VA_ARGS__))
 
+// Safe to call from several cores running on different threads. Only debug
+// messages, which exist in DEBUG_GEARSYSTEM builds, are flushed right away;
+// the rest follow the stdout buffering so ROM loads and traces stay cheap.
 inline void Log_func(bool debug, const char* const msg, ...)
 {
-    static int count = 1;
+    static std::atomic<int> count(1);
     char buffer[512];
     va_list args;
     va_start(args, msg);
@@ -47,13 +51,11 @@ inline void Log_func(bool debug, const char* const msg, ...)
 
     if (debug)
     {
-        printf("%d: [DEBUG] %s\n", count, buffer);
-        count++;
+        printf("%d: [DEBUG] %s\n", count++, buffer);
+        fflush(stdout);
     }
     else
         printf("%s\n", buffer);
-    
-    fflush(stdout);
 }
 
 #endif /* LOG_H */
@@ -30,10 +30,8 @@ void Processor::OPCode0x00()
 void Processor::OPCode0x01()
 {
     // LD BC,nn
-    OPCodes_LD(BC.GetLowRegister(), PC.GetValue());
-    PC.Increment();
-    OPCodes_LD(BC.GetHighRegister(), PC.GetValue());
-    PC.Increment();
+    OPCodes_LD(BC.GetLowRegister(), FetchArg8());
+    OPCodes_LD(BC.GetHighRegister(), FetchArg8());
 }
 
 void Processor::OPCode0x02()
@@ -65,8 +63,7 @@ void Processor::OPCode0x05()
 void Processor::OPCode0x06()
 {
     // LD B,n
-    OPCodes_LD(BC.GetHighRegister(), PC.GetValue());
-    PC.Increment();
+    OPCodes_LD(BC.GetHighRegister(), FetchArg8());
 }
 
 void Processor::OPCode0x07()
@@ -115,8 +112,7 @@ void Processor::OPCode0x0D()
 void Processor::OPCode0x0E()
 {
     // LD C,n
-    OPCodes_LD(BC.GetLowRegister(), PC.GetValue());
-    PC.Increment();
+    OPCodes_LD(BC.GetLowRegister(), FetchArg8());
 }
 
 void Processor::OPCode0x0F()
@@ -136,10 +132,8 @@ void Processor::OPCode0x10()
 void Processor::OPCode0x11()
 {
     // LD DE,nn
-    OPCodes_LD(DE.GetLowRegister(), PC.GetValue());
-    PC.Increment();
-    OPCodes_LD(DE.GetHighRegister(), PC.GetValue());
-    PC.Increment();
+    OPCodes_LD(DE.GetLowRegister(), FetchArg8());
+    OPCodes_LD(DE.GetHighRegister(), FetchArg8());
 }
 
 void Processor::OPCode0x12()
@@ -171,8 +165,7 @@ void Processor::OPCode0x15()
 void Processor::OPCode0x16()
 {
     // LD D,n
-    OPCodes_LD(DE.GetHighRegister(), PC.GetValue());
-    PC.Increment();
+    OPCodes_LD(DE.GetHighRegister(), FetchArg8());
 }
 
 void Processor::OPCode0x17()
@@ -221,8 +214,7 @@ void Processor::OPCode0x1D()
 void Processor::OPCode0x1E()
 {
     // LD E,n
-    OPCodes_LD(DE.GetLowRegister(), PC.GetValue());
-    PC.Increment();
+    OPCodes_LD(DE.GetLowRegister(), FetchArg8());
 }
 
 void Processor::OPCode0x1F()
@@ -241,10 +233,8 @@ void Processor::OPCode0x21()
 {
     // LD HL,nn
     SixteenBitRegister* reg = GetPrefixedRegister();
-    OPCodes_LD(reg->GetLowRegister(), PC.GetValue());
-    PC.Increment();
-    OPCodes_LD(reg->GetHighRegister(), PC.GetValue());
-    PC.Increment();
+    OPCodes_LD(reg->GetLowRegister(), FetchArg8());
+    OPCodes_LD(reg->GetHighRegister(), FetchArg8());
 }
 
 void Processor::OPCode0x22()
@@ -274,8 +264,7 @@ void Processor::OPCode0x25()
 void Processor::OPCode0x26()
 {
     // LD H,n
-    OPCodes_LD(GetPrefixedRegister()->GetHighRegister(), PC.GetValue());
-    PC.Increment();
+    OPCodes_LD(GetPrefixedRegister()->GetHighRegister(), FetchArg8());
 }
 
 void Processor::OPCode0x27()
@@ -331,8 +320,7 @@ void Processor::OPCode0x2D()
 void Processor::OPCode0x2E()
 {
     // LD L,n
-    OPCodes_LD(GetPrefixedRegister()->GetLowRegister(), PC.GetValue());
-    PC.Increment();
+    OPCodes_LD(GetPrefixedRegister()->GetLowRegister(), FetchArg8());
 
 }
 
@@ -354,10 +342,8 @@ void Processor::OPCode0x30()
 void Processor::OPCode0x31()
 {
     // LD SP,nn
-    SP.SetLow(m_pMemory->Read(PC.GetValue()));
-    PC.Increment();
-    SP.SetHigh(m_pMemory->Read(PC.GetValue()));
-    PC.Increment();
+    SP.SetLow(FetchArg8());
+    SP.SetHigh(FetchArg8());
 }
 
 void Processor::OPCode0x32()
@@ -392,23 +378,20 @@ void Processor::OPCode0x36()
     // LD (HL),n  
     if (m_CurrentPrefix == 0xDD)
     {
-        u8 d = m_pMemory->Read(PC.GetValue());
-        u8 n = m_pMemory->Read(PC.GetValue() + 1);
+        u8 d = FetchArg8();
+        u8 n = FetchArg8();
         u16 address = IX.GetValue() + static_cast<s8> (d);
         m_pMemory->Write(address, n);
-        PC.Increment();
     }
     else if (m_CurrentPrefix == 0xFD)
     {
-        u8 d = m_pMemory->Read(PC.GetValue());
-        u8 n = m_pMemory->Read(PC.GetValue() + 1);
+        u8 d = FetchArg8();
+        u8 n = FetchArg8();
         u16 address = IY.GetValue() + static_cast<s8> (d);
         m_pMemory->Write(address, n);
-        PC.Increment();
     }
     else
-        m_pMemory->Write(HL.GetValue(), m_pMemory->Read(PC.GetValue()));
-    PC.Increment();
+        m_pMemory->Write(HL.GetValue(), FetchArg8());
 }
 
 void Processor::OPCode0x37()
@@ -461,8 +444,7 @@ void Processor::OPCode0x3D()
 void Processor::OPCode0x3E()
 {
     // LD A,n
-    OPCodes_LD(AF.GetHighRegister(), PC.GetValue());
-    PC.Increment();
+    OPCodes_LD(AF.GetHighRegister(), FetchArg8());
 }
 
 void Processor::OPCode0x3F()
@@ -1288,8 +1270,7 @@ void Processor::OPCode0xC5()
 void Processor::OPCode0xC6()
 {
     // ADD A,n
-    OPCodes_ADD(m_pMemory->Read(PC.GetValue()));
-    PC.Increment();
+    OPCodes_ADD(FetchArg8());
 }
 
 void Processor::OPCode0xC7()
@@ -1337,8 +1318,7 @@ void Processor::OPCode0xCD()
 void Processor::OPCode0xCE()
 {
     // ADC A,n
-    OPCodes_ADC(m_pMemory->Read(PC.GetValue()));
-    PC.Increment();
+    OPCodes_ADC(FetchArg8());
 }
 
 void Processor::OPCode0xCF()
@@ -1368,9 +1348,8 @@ void Processor::OPCode0xD2()
 void Processor::OPCode0xD3()
 {
     // OUT (n),A
-    u8 port = m_pMemory->Read(PC.GetValue());
-    PC.Increment();
-    m_pIOPorts->DoOutput(port, AF.GetHigh());
+    u8 port = FetchArg8();
+    PortOutput(port, AF.GetHigh());
     WZ.SetLow((port + 1) & 0xFF);
     WZ.SetHigh(AF.GetHigh());
 }
@@ -1390,8 +1369,7 @@ void Processor::OPCode0xD5()
 void Processor::OPCode0xD6()
 {
     // SUB n
-    OPCodes_SUB(m_pMemory->Read(PC.GetValue()));
-    PC.Increment();
+    OPCodes_SUB(FetchArg8());
 }
 
 void Processor::OPCode0xD7()
@@ -1426,9 +1404,8 @@ void Processor::OPCode0xDB()
     if (m_bInputLastCycle)
     {
         u8 a = AF.GetHigh();
-        u8 port = m_pMemory->Read(PC.GetValue());
-        PC.Increment();
-        AF.SetHigh(m_pIOPorts->DoInput(port));
+        u8 port = FetchArg8();
+        AF.SetHigh(PortInput(port));
         WZ.SetValue((a << 8) | (port + 1));
         m_iTStates -= 10;
         m_bInputLastCycle = false;
@@ -1456,8 +1433,7 @@ void Processor::OPCode0xDD()
 void Processor::OPCode0xDE()
 {
     // SBC n
-    OPCodes_SBC(m_pMemory->Read(PC.GetValue()));
-    PC.Increment();
+    OPCodes_SBC(FetchArg8());
 }
 
 void Processor::OPCode0xDF()
@@ -1512,8 +1488,7 @@ void Processor::OPCode0xE5()
 void Processor::OPCode0xE6()
 {
     // AND n
-    OPCodes_AND(m_pMemory->Read(PC.GetValue()));
-    PC.Increment();
+    OPCodes_AND(FetchArg8());
 }
 
 void Processor::OPCode0xE7()
@@ -1561,8 +1536,7 @@ void Processor::OPCode0xED()
 void Processor::OPCode0xEE()
 {
     // XOR n
-    OPCodes_XOR(m_pMemory->Read(PC.GetValue()));
-    PC.Increment();
+    OPCodes_XOR(FetchArg8());
 }
 
 void Processor::OPCode0xEF()
@@ -1611,8 +1585,7 @@ void Processor::OPCode0xF5()
 void Processor::OPCode0xF6()
 {
     // OR n
-    OPCodes_OR(m_pMemory->Read(PC.GetValue()));
-    PC.Increment();
+    OPCodes_OR(FetchArg8());
 }
 
 void Processor::OPCode0xF7()
@@ -1662,8 +1635,7 @@ void Processor::OPCode0xFD()
 void Processor::OPCode0xFE()
 {
     // CP n
-    OPCodes_CP(m_pMemory->Read(PC.GetValue()));
-    PC.Increment();
+    OPCodes_CP(FetchArg8());
 }
 
 void Processor::OPCode0xFF()